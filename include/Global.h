@@ -19,4 +19,20 @@ typedef int8_t i8;
 typedef float f32;
 typedef double f64;
 
+#if defined(_MSC_VER)
+#define THREAD_LOCAL __declspec(thread)
+#else
+#define THREAD_LOCAL _Thread_local
+#endif
+
+#define VISUAL_STUDIO
+#undef VISUAL_STUDIO
+#if defined(VISUAL_STUDIO)
+#define asset_path(str) "../../../assets/" str
+#define path(str) "../../../" str
+#else
+#define asset_path(str) "../assets/" str
+#define path(str) "../" str
+#endif
+
 #endif
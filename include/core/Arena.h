@@ -5,19 +5,48 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+#define MB(n) ((n) * 1024000)
+#define GB(n) ((n) * 1024000000)
+
+#define ARENA_DEFAULT_ALIGNMENT 16
+
+typedef struct ArenaBlock ArenaBlock;
+
+// blocks are chained, a full block never moves, a new one is linked in front of it
 typedef struct {
-    void* storage;
-    uint32_t capacity; 
-    uint32_t base;
+    ArenaBlock* current;
+    uint64_t block_size; // minimum size of every new block
+    uint64_t used;       // bytes handed out over all blocks, alignment padding included
+    uint64_t high_water;
+    uint64_t reserved;   // bytes owned over all blocks
+    uint32_t block_count;
 }Arena;
 
-#define MB(n) ((n) * 1024000)
-#define GB(n) ((n) * 1024000000)
+// everything allocated after a marker is released by arena_restore
+typedef struct {
+    ArenaBlock* block;
+    uint64_t block_used;
+    uint64_t used;
+}ArenaMarker;
 
-bool arena_create(Arena* arena,uint32_t capacity);
+bool arena_create(Arena* arena,uint64_t capacity);
 void arena_free(Arena* arena);
-void* arena_alloc_(Arena* arena, uint32_t elemnt_size,uint32_t count);
+
+void* arena_alloc_aligned(Arena* arena,uint64_t size,uint64_t alignment);
+void* arena_alloc_(Arena* arena, uint64_t elemnt_size,uint64_t count);
 
 #define arena_alloc(arena_ptr,T,count) (T*)arena_alloc_(arena_ptr,sizeof(T),count)
 
+ArenaMarker arena_marker(const Arena* arena);
+void arena_restore(Arena* arena,ArenaMarker marker);
+
+// drops everything but keeps the first block, for arenas that live for one frame
+void arena_reset(Arena* arena);
+
+// per thread arena for short lived temporaries, always pair with a marker
+Arena* arena_scratch(void);
+void arena_scratch_release(void);
+
+void arena_print_stats(const Arena* arena,const char* name);
+
 #endif
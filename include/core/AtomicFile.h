@@ -0,0 +1,24 @@
+#ifndef ATOMIC_FILE_H
+#define ATOMIC_FILE_H
+
+#include "Global.h"
+#include <stdbool.h>
+#include <stdio.h>
+
+// writes go to "<path>.tmp" and only replace path once all of them succeeded,
+// so a crash mid write never leaves a valid looking file behind
+typedef struct {
+    FILE* file;
+    const char* path;
+    char tmp_path[1024];
+}AtomicFile;
+
+bool atomic_file_open(AtomicFile* atomic,const char* path);
+
+// closes the temporary and renames it over path when ok, otherwise removes it
+bool atomic_file_commit(AtomicFile* atomic,bool ok);
+
+// the common case of a fixed header followed by one payload
+bool file_write_atomic(const char* path,const void* header,u64 header_size,const void* payload,u64 payload_size);
+
+#endif
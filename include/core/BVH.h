@@ -0,0 +1,69 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include "Global.h"
+#include "Scene.h"
+#include "Culling.h"
+#include "JobSystem.h"
+#include <stdbool.h>
+
+#define BVH_BINS 16
+#define BVH_MAX_LEAF_SIZE 8
+#define BVH_MAX_DEPTH 64 // deeper nodes become leaves no matter their size, bounds the traversal stacks
+#define BVH_TRAVERSAL_COST 1.0f // relative to testing one item
+
+// 32 bytes, two per cache line. Siblings are stored next to each other, the right child is left_first + 1
+typedef struct {
+    vec3 min;
+    u32 left_first; // left child for interior nodes, first leaf slot for leaves
+    vec3 max;
+    u32 count;      // items in the leaf, 0 for interior nodes
+}BVHNode;
+
+typedef struct {
+    BVHNode* nodes; // nodes[0] is the root
+    u32* item_indices; // leaf slot -> index of the box the tree was built from
+    AABB* item_boxes;  // leaf slot -> its box, so leaves are tested without chasing item_indices
+    u32 node_count;
+    u32 item_count;
+    u32 depth;
+}BVH;
+
+typedef struct {
+    u32 item;
+    f32 t;
+}BVHHit;
+
+// narrow phase of the ray queries, called for every item in a leaf the ray reaches.
+// on a hit closer than *t it lowers *t and returns true. A NULL func treats the item boxes as the geometry
+typedef bool (*BVHRayFunc)(void* data,u32 item,const f32* origin,const f32* direction,f32* t);
+
+// SAH binned top down build. With a job system the upper levels are split serially until there is enough
+// independent subtrees to keep every thread busy, those are built in parallel and appended depth first
+void bvh_build(BVH* bvh,JobSystem* jobs,const AABB* boxes,u32 count);
+void bvh_free(BVH* bvh);
+
+// expected cost of a random ray relative to testing one item, for comparing builds
+f32 bvh_sah_cost(const BVH* bvh);
+
+// write the built from indices of the matching items, in no particular order, and return their count.
+// items must hold item_count entries
+u32 bvh_query_frustum(const BVH* bvh,const Frustum* frustum,u32* items);
+u32 bvh_query_aabb(const BVH* bvh,const AABB* box,u32* items);
+
+bool bvh_ray_closest(const BVH* bvh,const f32* origin,const f32* direction,f32 t_max,BVHRayFunc func,void* data,BVHHit* hit);
+bool bvh_ray_any(const BVH* bvh,const f32* origin,const f32* direction,f32 t_max,BVHRayFunc func,void* data);
+
+// distance at which the ray enters the box, 0 from inside, FLT_MAX when it misses it before t_max
+f32 ray_aabb_entry(const f32* origin,const f32* inv_direction,const f32* min,const f32* max,f32 t_max);
+
+// double sided Moller Trumbore, on a hit closer than *t writes t and the barycentrics of v1 and v2
+bool ray_triangle_intersect(const f32* origin,const f32* direction,const f32* v0,const f32* v1,const f32* v2,f32* t,f32* u,f32* v);
+
+// one item per triangle, positions are read with the given byte stride
+void bvh_build_triangles(BVH* bvh,JobSystem* jobs,const void* positions,u32 position_stride,const u32* indices,u32 triangle_count);
+
+// one item per command, the culled commands first and then the non culled ones
+void scene_build_command_bvh(BVH* bvh,JobSystem* jobs,const Scene* scene);
+
+#endif
@@ -4,6 +4,9 @@
 #include <cglm/types.h>
 #include <stdbool.h>
 
+#define CAMERA_NEAR 0.01f
+#define CAMERA_FAR 100.0f
+
 typedef enum { 
     FORWARD,
     BACKWARD,
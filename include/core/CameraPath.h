@@ -0,0 +1,40 @@
+#ifndef CAMERA_PATH_H
+#define CAMERA_PATH_H
+
+#include "Global.h"
+#include "Camera.h"
+#include "Scene.h"
+#include "Vector.h"
+#include <stdbool.h>
+
+typedef struct {
+    f32 time; // seconds from the start of the path
+    vec3 position;
+    vec3 target;
+}CameraKey;
+
+typedef struct {
+    vector(CameraKey) keys; // ascending time
+}CameraPath;
+
+void camera_path_init(CameraPath* path);
+void camera_path_free(CameraPath* path);
+
+// text file, one key per line as "time px py pz tx ty tz", lines starting with # are skipped
+bool camera_path_load(CameraPath* path,const char* file_path);
+
+// same format camera_path_load reads
+bool camera_path_save(const CameraPath* path,const char* file_path);
+
+// append the camera's current position and a target one unit along its front
+void camera_path_record(CameraPath* path,f32 time,const Camera* camera);
+
+// one loop around the box in the given time, above its centre and looking at it
+void camera_path_orbit(CameraPath* path,const AABB* bounds,f32 duration,u32 key_count);
+
+f32 camera_path_duration(const CameraPath* path);
+
+// Catmull-Rom through the keys, clamped to the first and last one. Sets position, front and yaw/pitch
+void camera_path_sample(const CameraPath* path,f32 time,Camera* camera);
+
+#endif
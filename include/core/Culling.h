@@ -0,0 +1,34 @@
+#ifndef CULLING_H
+#define CULLING_H
+
+#include "Global.h"
+#include "Scene.h"
+#include "JobSystem.h"
+#include <stdbool.h>
+
+// boxes tested per iteration by the widest path, CullBounds arrays are padded to it
+#define CULL_BATCH 8
+
+typedef struct {
+    vec4 planes[6]; // normalized, pointing inwards
+}Frustum;
+
+void frustum_from_matrix(mat4 view_proj,Frustum* frustum);
+
+void cull_bounds_build(CullBounds* bounds,const AABB* boxes,u32 count);
+void cull_bounds_free(CullBounds* bounds);
+
+// writes the indices of the boxes that intersect the frustum in ascending order, returns their count.
+// AVX when compiled with it, SSE on any other x86 build, scalar elsewhere
+u32 frustum_cull_aabbs(const Frustum* frustum,const CullBounds* bounds,u32* visible);
+u32 frustum_cull_aabbs_scalar(const Frustum* frustum,const CullBounds* bounds,u32* visible);
+
+const char* frustum_cull_isa(void);
+
+void cull_compact_commands(const DrawElementsIndirectCommand* commands,const u32* material_indices,const u32* visible,u32 count,
+                           DrawElementsIndirectCommand* out_commands,u32* out_material_indices);
+
+// world AABB of every command from the given ones on, positions come from vertex_vector or packed_vertex_vector
+void scene_compute_command_aabbs(JobSystem* jobs,Scene* scene,u32 first_culled_command,u32 first_non_culled_command);
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef FRAME_CAPTURE_H
+#define FRAME_CAPTURE_H
+
+#include "Global.h"
+#include <stdbool.h>
+
+// RGBA8 colour and 24 bit depth framebuffer the headless mode renders into instead of the window
+typedef struct {
+    u32 framebuffer;
+    u32 color;
+    u32 depth;
+    i32 width;
+    i32 height;
+    u8* pixels; // last readback, bottom row first like GL
+}OffscreenTarget;
+
+bool offscreen_target_create(OffscreenTarget* target,i32 width,i32 height);
+void offscreen_target_destroy(OffscreenTarget* target);
+
+void offscreen_target_read(OffscreenTarget* target);
+
+// writes the last readback top row first
+bool offscreen_target_write_png(const OffscreenTarget* target,const char* file_path);
+
+// creates the directory when it does not exist yet
+bool capture_directory_create(const char* directory);
+
+#endif
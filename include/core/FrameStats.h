@@ -0,0 +1,47 @@
+#ifndef FRAME_STATS_H
+#define FRAME_STATS_H
+
+#include "Global.h"
+#include "Vector.h"
+#include <stdbool.h>
+
+// CPU time of each pass of a frame. The render passes only measure submission, FRAME_PASS_TOTAL runs from the
+// start of the frame until glFinish returns so it also covers the GPU
+typedef enum {
+    FRAME_PASS_LIGHTS, // light cluster binning and its upload
+    FRAME_PASS_CULL,
+    FRAME_PASS_SHADOW,
+    FRAME_PASS_MAIN,
+    FRAME_PASS_SKYBOX,
+    FRAME_PASS_TOTAL,
+    FRAME_PASS_COUNT
+}FramePass;
+
+// histogram bucket i holds samples below FRAME_STATS_BUCKET_MIN_MS * 2^i ms, the last one everything above.
+// The edges are fixed so histograms from different builds line up
+#define FRAME_STATS_BUCKETS 12
+#define FRAME_STATS_BUCKET_MIN_MS 0.0625
+
+typedef struct {
+    vector(f32) samples[FRAME_PASS_COUNT]; // milliseconds, one per recorded frame
+}FrameStats;
+
+typedef struct {
+    f64 mean, min, max;
+    f64 p50, p95, p99;
+    u32 histogram[FRAME_STATS_BUCKETS];
+}FramePassSummary;
+
+extern const char* frame_pass_names[FRAME_PASS_COUNT];
+
+void frame_stats_init(FrameStats* stats,u32 frame_count);
+void frame_stats_free(FrameStats* stats);
+void frame_stats_add(FrameStats* stats,FramePass pass,f64 seconds);
+
+// nearest rank percentiles
+void frame_stats_summarize(const FrameStats* stats,FramePass pass,FramePassSummary* summary);
+
+// one object per pass with its percentiles and histogram, plus whatever identifies the run
+bool frame_stats_write_json(const FrameStats* stats,const char* file_path,const char* assets,const char* camera_path,f32 timestep);
+
+#endif
@@ -0,0 +1,14 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include "Global.h"
+#include <stdbool.h>
+
+#define HASH_FNV_SEED 0xcbf29ce484222325ull
+
+// FNV-1a 64, pass a previous result as seed to hash data in pieces
+u64 hash_fnv1a(const void* data,u64 size,u64 seed);
+
+bool hash_file(const char* path,u64* hash);
+
+#endif
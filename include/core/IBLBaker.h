@@ -0,0 +1,38 @@
+#ifndef IBL_BAKER_H
+#define IBL_BAKER_H
+
+#include "Global.h"
+#include "IBLCache.h"
+#include "JobSystem.h"
+#include "SphericalHarmonics.h"
+
+// the sizes the GL bake in main.c produces, so either bake loads the same way
+#define IBL_BAKE_ENV_SIZE       512
+#define IBL_BAKE_PREFILTER_SIZE 128
+#define IBL_BAKE_BRDF_SIZE      512
+#define IBL_BAKE_ROUGHNESS_LEVELS 5 // prefilter levels 0 to 4 span roughness 0 to 1, MAX_REFLECTION_LOD in default_fs.glsl
+
+// filtered importance sampling reads every sample from the env mip matching its solid angle, so a lobe needs a
+// fraction of the 1024 samples prefilter_fs.glsl takes from the full resolution map
+#define IBL_BAKE_PREFILTER_SAMPLES 128
+#define IBL_BAKE_BRDF_SAMPLES      1024
+
+typedef struct {
+    IBLImage images[IBL_TEXTURE_COUNT]; // env map, prefilter map and BRDF LUT, ready for ibl_cache_write_images
+    SH9 irradiance_sh;
+}IBLBake;
+
+typedef struct {
+    f64 env_seconds;       // equirect to cubemap and its mip chain
+    f64 prefilter_seconds;
+    f64 brdf_seconds;
+    f64 sh_seconds;
+}IBLBakeStats;
+
+// everything the renderer's IBL needs from an equirectangular image laid out like load_hdi_skybox loads it,
+// without a GL context. Rows of every pass run on the job system, the sample loops with SSE. The result does
+// not depend on the thread count
+void ibl_bake(JobSystem* jobs,const f32* pixels,u32 width,u32 height,u32 channels,IBLBake* bake,IBLBakeStats* stats);
+void ibl_bake_free(IBLBake* bake);
+
+#endif
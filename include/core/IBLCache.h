@@ -0,0 +1,65 @@
+#ifndef IBL_CACHE_H
+#define IBL_CACHE_H
+
+#include "Global.h"
+#include "SphericalHarmonics.h"
+#include <stdbool.h>
+
+#define IBL_CACHE_MAGIC   0x434c4249u // "IBLC"
+#define IBL_CACHE_VERSION 3
+
+#define IBL_CACHE_EXTENSION ".ibl"
+
+// shader_hash of files written by the CPU baker, the renderer takes them whatever its bake shaders are
+#define IBL_CACHE_CPU_BAKE 0x454b41425550432eull
+
+#define IBL_TEXTURE_COUNT 3
+
+// GL texture names, created by the bake or by ibl_cache_load, and the diffuse lighting
+typedef struct {
+    union {
+        struct {
+            u32 env_map;       // cube, the equirectangular source resampled
+            u32 prefilter_map; // cube with mips, specular convolution per roughness
+            u32 brdf_lut;      // 2D split sum lookup
+        };
+        u32 textures[IBL_TEXTURE_COUNT];
+    };
+    SH9 irradiance_sh;
+}IBLEnvironment;
+
+// one texture of the cache as half floats: levels in order, the faces of a level in GL cubemap order, rows
+// bottom up. Textures with more than one level are sampled trilinearly
+typedef struct {
+    u32 faces;    // 6 for cubemaps, 1 for 2D
+    u32 channels; // 3 for RGB16F, 2 for RG16F
+    u32 width;
+    u32 height;
+    u32 levels;
+    u16* data;
+}IBLImage;
+
+// what the cache was baked from: the environment image and the sources of the shaders that bake it, any
+// mismatch is a miss. The content hash decides rather than the modification time, so prebaked files survive
+// being copied or checked out
+typedef struct {
+    u64 source_size;
+    u64 source_hash;
+    u64 shader_hash;
+}IBLCacheKey;
+
+bool ibl_cache_key(const char* source_path,const char* const* shader_paths,u32 shader_count,IBLCacheKey* key);
+
+u64 ibl_image_size(const IBLImage* image);
+u64 ibl_image_level_offset(const IBLImage* image,u32 level);
+
+// env map, prefilter map and BRDF LUT in IBLEnvironment order. Needs no GL context
+bool ibl_cache_write_images(const char* cache_path,const IBLCacheKey* key,const IBLImage* images,const SH9* irradiance_sh);
+
+// reads every level and face of the textures back as half floats, the cache is a few MB per environment
+bool ibl_cache_write(const char* cache_path,const IBLCacheKey* key,const IBLEnvironment* ibl);
+
+// creates the textures straight from the cache, false without touching ibl when it is missing or stale
+bool ibl_cache_load(const char* cache_path,const IBLCacheKey* key,IBLEnvironment* ibl);
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+#include "Global.h"
+#include <stdbool.h>
+
+// runs items [begin,end) of a parallel_for batch
+typedef void (*JobFunc)(void* data,u32 begin,u32 end);
+
+typedef struct JobSystem JobSystem;
+
+// worker_count == 0 picks one worker per core minus the calling thread
+JobSystem* job_system_create(u32 worker_count);
+
+void job_system_destroy(JobSystem* jobs);
+
+// worker threads plus the calling thread
+u32 job_system_thread_count(const JobSystem* jobs);
+
+// index of the calling thread inside the system, 0 for the thread that created it
+u32 job_system_thread_index(const JobSystem* jobs);
+
+// splits [0,count) into batches of batch_size and blocks until all of them ran, the caller helps.
+// a NULL system runs everything inline on the calling thread
+void job_system_parallel_for(JobSystem* jobs,u32 count,u32 batch_size,JobFunc func,void* data);
+
+u32 job_system_core_count(void);
+
+#endif
@@ -0,0 +1,73 @@
+#ifndef LIGHT_CLUSTER_H
+#define LIGHT_CLUSTER_H
+
+#include "Global.h"
+#include "Scene.h"
+#include "JobSystem.h"
+#include "Camera.h"
+#include <stdbool.h>
+
+#define LIGHT_CLUSTER_NEAR 0.1f // reference depth of the exponential split, slice z ends at near * (far / near)^((z + 1) / CLUSTER_Z)
+#define LIGHT_CLUSTER_FAR CAMERA_FAR
+
+// froxel grid: screen tiles by exponential depth slices. default_fs.glsl repeats these and the slice formula
+#define CLUSTER_X 16
+#define CLUSTER_Y 9
+#define CLUSTER_Z 24
+#define CLUSTER_TILES (CLUSTER_X * CLUSTER_Y)
+#define CLUSTER_COUNT (CLUSTER_TILES * CLUSTER_Z)
+#define CLUSTER_MAX_INDICES (1u << 20) // light indices uploaded per frame, far clusters past it lose lights
+
+// radiance, relative to a light of intensity 1, below which a light is treated as out of range
+#define POINT_LIGHT_CUTOFF (1.0f / 64.0f)
+
+// matches uvec2 clusters[] in default_fs.glsl
+typedef struct {
+    u32 offset; // into the light index list
+    u32 count;
+}LightCluster;
+
+typedef struct {
+    mat4 view;
+    f32 tan_half_fov_y;
+    f32 aspect;
+    f32 z_near; // slice 0 covers everything closer than the end of the first slice
+    f32 z_far;  // the last slice covers everything beyond its start
+}ClusterView;
+
+typedef struct ClusterSlice ClusterSlice;
+
+typedef struct {
+    LightCluster clusters[CLUSTER_COUNT];
+    u32* indices; // lights of each cluster in ascending order, clusters in x, then y, then z order
+    u32 index_count;
+    u32 index_capacity;
+    f32* view_x; // view space centres, depth positive in front of the camera, and radii of the lights, padded to 8
+    f32* view_y;
+    f32* depth;
+    f32* radius;
+    u32 light_count;
+    u32 light_capacity;
+    ClusterSlice* slices;
+}LightClusterGrid;
+
+void light_cluster_grid_init(LightClusterGrid* grid);
+void light_cluster_grid_free(LightClusterGrid* grid);
+
+// distance at which the light's attenuation, 1 / (constant + linear d + quadratic d^2) from attenuation_factors,
+// drops its brightest channel below POINT_LIGHT_CUTOFF. default_fs.glsl fades lights out to it and reads it from
+// attenuation_factors.w, so store it there whenever a light changes
+f32 point_light_radius(const PointLight* light);
+
+// bins every light's bounding sphere into the froxels it overlaps. The depth slices run in parallel, each testing
+// the lights against its depth range with SSE/AVX before the per tile work
+void light_cluster_build(LightClusterGrid* grid,JobSystem* jobs,const PointLight* lights,u32 count,const ClusterView* view);
+
+u32 light_cluster_index(u32 x,u32 y,u32 z);
+
+// depth range [start, end] of slice z, the same split the shader uses
+void light_cluster_slice_depths(const ClusterView* view,u32 z,f32* start,f32* end);
+
+const char* light_cluster_isa(void);
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include "Global.h"
+#include "Arena.h"
+#include "Scene.h"
+#include <stdbool.h>
+
+#define MESH_OPTIMIZER_CACHE_SIZE 16
+#define MESH_OPTIMIZER_OVERDRAW_THRESHOLD 1.05f
+
+typedef struct {
+    f32 acmr; // cache misses per triangle, 0.5 is ideal for a regular grid, 3 is the worst
+    f32 atvr; // cache misses per referenced vertex, 1 is ideal
+}MeshCacheStats;
+
+typedef struct {
+    u32 vertex_count_before;
+    u32 vertex_count_after;
+    u64 bytes_saved;
+}MeshWeldStats;
+
+// FIFO post transform cache simulation
+void mesh_analyze_vertex_cache(const u32* indices,u32 index_count,u32 vertex_count,u32 cache_size,Arena* scratch,MeshCacheStats* stats);
+
+// Tipsify (Sander et al. 2007), reorders triangles for post transform cache locality. dest may alias indices
+void mesh_optimize_vertex_cache(u32* dest,const u32* indices,u32 index_count,u32 vertex_count,u32 cache_size,Arena* scratch);
+
+// splits a cache optimized index buffer into clusters and sorts them outside in to cut overdraw.
+// positions are read with the given byte stride. threshold > 1 trades cache efficiency for smaller clusters
+void mesh_optimize_overdraw(u32* dest,const u32* indices,u32 index_count,const f32* positions,u32 position_stride,
+                            u32 vertex_count,u32 cache_size,f32 threshold,Arena* scratch);
+
+// builds remap[old] = new in order of first use and rewrites the indices, unreferenced verticies go last.
+// returns the number of referenced verticies
+u32 mesh_optimize_vertex_fetch_remap(u32* remap,u32* indices,u32 index_count,u32 vertex_count);
+
+// moves element i to remap[i]
+void mesh_remap_vertices(void* verticies,u32 vertex_count,u32 vertex_size,const u32* remap,Arena* scratch);
+
+// the whole pass over one primitive in place: triangle order, optional overdraw order, then vertex fetch order.
+// position_offset locates a vec3 inside each vertex. before/after may be NULL
+void mesh_optimize(u32* indices,u32 index_count,void* verticies,u32 vertex_count,u32 vertex_size,u32 position_offset,
+                   bool optimize_overdraw,Arena* scratch,MeshCacheStats* before,MeshCacheStats* after);
+
+// remap[i] = index of the first bit identical vertex, numbered in order of first occurrence. returns the unique count
+u32 mesh_weld_vertices(u32* remap,const void* verticies,u32 vertex_count,u32 vertex_size,Arena* scratch);
+
+// welds vertex_vector from first_vertex on, within and across primitives, and rewrites the indices and baseVertex
+// of every command from the given ones on. Each command must own its index slice
+void scene_weld_vertices(Scene* scene,u32 first_vertex,u32 first_culled_command,u32 first_non_culled_command,
+                         Arena* scratch,MeshWeldStats* stats);
+
+#endif
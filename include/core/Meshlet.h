@@ -0,0 +1,63 @@
+#ifndef MESHLET_H
+#define MESHLET_H
+
+#include "Global.h"
+#include "Arena.h"
+#include "Scene.h"
+#include "JobSystem.h"
+#include <stdbool.h>
+
+typedef struct {
+    u32 meshlet_count;
+    u32 triangle_count;
+    u64 vertex_count; // summed per meshlet, a vertex shared by two meshlets counts twice
+    f64 seconds;
+}MeshletBuildStats;
+
+typedef struct {
+    vec4 planes[6]; // normalized, pointing inwards
+    vec3 camera_position;
+}MeshletCullView;
+
+typedef struct {
+    u32 meshlet_count;
+    u32 frustum_culled;
+    u32 cone_culled;
+    u64 triangle_count;
+    u64 visible_triangle_count;
+}MeshletCullStats;
+
+// one output stream, sized for every meshlet of the scene
+typedef struct {
+    DrawElementsIndirectCommand* commands;
+    u32* material_indices;
+    u32 count;
+}MeshletDrawList;
+
+// upper bound of meshlets for index_count indices, every meshlet but the last closes with at least 21 triangles
+u32 meshlet_max_count(u32 index_count);
+
+// greedily splits indices in their current order, so run it after the vertex cache optimization.
+// indices are relative to verticies, first_index is what the meshlets record. returns the meshlet count
+u32 meshlet_build(Meshlet* dest,const u32* indices,u32 index_count,u32 first_index,const void* verticies,
+                  u32 vertex_size,u32 position_offset,Arena* scratch);
+
+// builds meshlets for every command from the given ones on, positions are read from vertex_vector or
+// packed_vertex_vector, whichever is filled
+void scene_build_meshlets(JobSystem* jobs,Scene* scene,u32 first_culled_command,u32 first_non_culled_command,
+                          MeshletBuildStats* stats);
+
+void meshlet_build_stats_print(const MeshletBuildStats* stats,const char* name);
+
+void meshlet_cull_view(mat4 view_proj,vec3 camera_position,MeshletCullView* view);
+
+bool meshlet_visible(const Meshlet* meshlet,const MeshletCullView* view,bool* cone_culled);
+
+// writes one command per surviving meshlet, material indices follow the command they came from.
+// the visibility arrays (one byte per command, NULL for all) skip meshlets whose command was already culled
+void scene_cull_meshlets(const Scene* scene,const MeshletCullView* view,const u8* culled_command_visible,const u8* non_culled_command_visible,
+                         MeshletDrawList* culled,MeshletDrawList* non_culled,MeshletCullStats* stats);
+
+void meshlet_cull_stats_print(const MeshletCullStats* stats);
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef MIP_GENERATOR_H
+#define MIP_GENERATOR_H
+
+#include "Global.h"
+#include "JobSystem.h"
+#include "TextureLoader.h"
+#include <stdbool.h>
+
+#define MIP_KAISER_WIDTH 3.0 // half width of the windowed sinc, in texels of the level being made
+#define MIP_KAISER_ALPHA 4.0 // window shape, higher trades sharpness for less ringing
+#define MIP_BAND_ROWS 16     // rows of a level filtered per job, each band also filters the source rows it overlaps
+
+typedef enum {
+    MIP_MODE_LINEAR, // every channel filtered as stored
+    MIP_MODE_SRGB,   // r, g and b decoded from sRGB before filtering and encoded back, alpha filtered as stored
+    MIP_MODE_NORMAL, // r, g (and b) hold a unit vector remapped to [0,1], renormalized on every level
+    MIP_MODE_COUNT
+}MipMode;
+
+typedef struct {
+    u32 texture_count;
+    u64 source_texels;    // level 0 of every texture
+    u64 generated_texels; // every level past 0
+    f64 seconds;
+}MipStats;
+
+// replaces the pixels of a single level texture with its whole chain down to 1x1, laid out like
+// texture_decode_batch lays it out. Each level is filtered from the one above with a separable Kaiser windowed
+// sinc, clamped at the edges. Bands of rows are spread over the job system, SSE filters a texel's channels at once.
+// The result does not depend on the thread count
+void mip_generate(JobSystem* jobs,DecodedTexture* texture,MipMode mode);
+
+// textures one after the other, each using every thread. Textures that failed to decode are skipped, stats may be NULL
+void mip_generate_batch(JobSystem* jobs,DecodedTexture* textures,const MipMode* modes,u32 count,MipStats* stats);
+
+void mip_stats_print(const MipStats* stats,u32 thread_count);
+
+const char* mip_mode_name(MipMode mode);
+const char* mip_isa(void);
+
+#endif
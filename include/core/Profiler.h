@@ -0,0 +1,66 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include "Global.h"
+#include <stdbool.h>
+
+#define PROFILER_RING_SIZE 4096  // zones kept for export, the oldest are overwritten
+#define PROFILER_MAX_DEPTH 16    // deeper zones are not recorded
+#define PROFILER_GPU_FRAMES 2    // query sets in flight, a frame's GPU times arrive this many frames later
+#define PROFILER_GPU_ZONES 16    // GPU timed zones per frame, further ones are CPU only
+
+// zones are opened and closed on one thread, usually the one owning the GL context
+typedef struct Profiler Profiler;
+
+typedef struct {
+    const char* name; // not copied, must outlive the profiler
+    f64 start, end;   // seconds since the profiler was created, end < start while the zone is open
+    f32 gpu_ms;       // negative until the query result arrives, and for CPU only zones
+    u32 frame;
+    u32 depth;
+}ProfileZone;
+
+// without gpu no GL function is ever called, so the CPU half works without a context.
+// Every function accepts a NULL profiler and does nothing
+Profiler* profiler_create(bool gpu);
+void profiler_destroy(Profiler* profiler);
+
+// a GPU zone also wraps its commands in a GL_TIME_ELAPSED query. Those can not nest, a GPU zone opened inside
+// another one is timed on the CPU only. Results are only collected once available so the CPU never waits
+void profiler_begin(Profiler* profiler,const char* name,bool gpu);
+void profiler_end(Profiler* profiler);
+
+// call once at the end of every frame, collects the results of the query set about to be reused
+void profiler_frame(Profiler* profiler);
+
+// zones still in the ring, oldest first, returns how many were written. zones must hold PROFILER_RING_SIZE entries
+u32 profiler_zones(const Profiler* profiler,ProfileZone* zones);
+
+// chrome://tracing / Perfetto JSON, CPU zones on one track and GPU durations on a second one. The GPU track is
+// aligned to the CPU start of each zone, GL_TIME_ELAPSED gives durations, not timestamps
+bool profiler_write_chrome_trace(const Profiler* profiler,const char* file_path);
+
+// mean CPU and GPU time per zone name over the ring
+void profiler_print_summary(const Profiler* profiler);
+
+#ifdef CCRAFT_NO_PROFILER
+#define PROFILE_BEGIN(profiler,name)
+#define PROFILE_GPU_BEGIN(profiler,name)
+#define PROFILE_END(profiler)
+#define PROFILE_ZONE(profiler,name)
+#define PROFILE_GPU_ZONE(profiler,name)
+#else
+#define PROFILE_BEGIN(profiler,name) profiler_begin(profiler,name,false)
+#define PROFILE_GPU_BEGIN(profiler,name) profiler_begin(profiler,name,true)
+#define PROFILE_END(profiler) profiler_end(profiler)
+#define PROFILE_ZONE_CONCAT_(a,b) a##b
+#define PROFILE_ZONE_VAR_(line) PROFILE_ZONE_CONCAT_(profile_zone_once_,line)
+// PROFILE_ZONE(p,"name") { ... } times the block. Leaving it with break, return or goto skips the end
+#define PROFILE_ZONE_IMPL_(profiler,name,gpu) \
+    for(int PROFILE_ZONE_VAR_(__LINE__) = (profiler_begin(profiler,name,gpu),0); !PROFILE_ZONE_VAR_(__LINE__); \
+        PROFILE_ZONE_VAR_(__LINE__) = (profiler_end(profiler),1))
+#define PROFILE_ZONE(profiler,name) PROFILE_ZONE_IMPL_(profiler,name,false)
+#define PROFILE_GPU_ZONE(profiler,name) PROFILE_ZONE_IMPL_(profiler,name,true)
+#endif
+
+#endif
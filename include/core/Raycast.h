@@ -0,0 +1,62 @@
+#ifndef RAYCAST_H
+#define RAYCAST_H
+
+#include "Global.h"
+#include "Scene.h"
+#include "Camera.h"
+#include "BVH.h"
+#include "JobSystem.h"
+#include <stdbool.h>
+
+#define RAYCAST_PACKET_SIZE 4
+
+typedef struct {
+    vec3 origin;
+    vec3 direction; // t is measured in lengths of it
+    f32 t_max;
+}Ray;
+
+typedef struct {
+    f32 t;
+    f32 u, v;       // barycentrics of the triangle's second and third vertex
+    u32 primitive;  // command index, the culled commands first and then the non culled ones
+    u32 triangle;   // inside the command's index range
+    u32 material_index;
+    bool hit;
+}RayHit;
+
+// world space triangle BVH over every command of a scene. Triangles are stored in leaf order as one vertex
+// plus two edges, so a leaf is a contiguous run the packet path tests four rays at a time against
+typedef struct {
+    BVH bvh;
+    f32* triangles;            // leaf slot -> v0, e1, e2
+    u32* triangle_primitives;  // leaf slot -> primitive
+    u32* triangle_indices;     // leaf slot -> triangle inside its primitive
+    u32* primitive_materials;  // primitive -> material index
+    u32 triangle_count;
+    u32 primitive_count;
+}SceneRaycaster;
+
+// reads the scene's final vertex data, so build it after any scene_translate/scene_scale
+void scene_raycaster_build(SceneRaycaster* raycaster,JobSystem* jobs,const Scene* scene);
+void scene_raycaster_free(SceneRaycaster* raycaster);
+
+// closest hit, false and hit->hit cleared on a miss
+bool scene_raycast(const SceneRaycaster* raycaster,const Ray* ray,RayHit* hit);
+
+// true when anything blocks the ray before t_max
+bool scene_raycast_any(const SceneRaycaster* raycaster,const Ray* ray);
+
+bool scene_line_of_sight(const SceneRaycaster* raycaster,const vec3 from,const vec3 to);
+
+// closest hits of RAYCAST_PACKET_SIZE rays traversed together, SSE where available. The packet should be
+// coherent (neighbouring pixels, close origins) or it degrades to visiting the union of the rays' nodes
+void scene_raycast_packet(const SceneRaycaster* raycaster,const Ray* rays,RayHit* hits);
+
+// packets of consecutive rays spread over the job system, count need not be a multiple of the packet size
+void scene_raycast_batch(const SceneRaycaster* raycaster,JobSystem* jobs,const Ray* rays,u32 count,RayHit* hits);
+
+// ray through a pixel, (0,0) is the top left corner of a width x height viewport
+void ray_from_screen(Camera* camera,mat4 proj,f32 x,f32 y,f32 width,f32 height,Ray* ray);
+
+#endif
@@ -0,0 +1,160 @@
+#ifndef SCENE_H
+#define SCENE_H
+
+#include "Global.h"
+#include "Vector.h"
+#include "TextureResidency.h"
+#include <cglm/types.h>
+
+typedef struct {
+    vec3 min;
+    vec3 max;
+} AABB;
+
+typedef struct {
+    u32 count;
+    u32 instanceCount;
+    u32 firstIndex;
+    u32 baseVertex;
+    u32 baseInstance;
+} DrawElementsIndirectCommand;
+
+typedef struct {
+    vec4 color;
+    vec4 tangent;
+    vec4 weights;
+    vec3 position;
+    vec3 normal;
+    vec2 uv0;
+    vec2 uv1;
+    u64 joint_ids;
+}Vertex;
+
+// compact layout for SCENE_IMPORT_PACKED_VERTICES, see VertexPacking.h
+typedef struct {
+    vec3 position;
+    i16 normal[2];  // octahedral snorm16
+    i16 tangent[2]; // octahedral snorm16, handedness folded into the sign of [1]
+    u16 uv0[2];     // half floats
+    u16 uv1[2];
+    u8 color[4];    // unorm8
+}PackedVertex;
+
+// separate stream, only filled when the scene has skinned primitives
+typedef struct {
+    u16 joint_ids[4];
+    u16 weights[4]; // unorm16
+}SkinVertex;
+
+typedef enum {
+    SCENE_IMPORT_PACKED_VERTICES = 1 << 0,
+    SCENE_IMPORT_OPTIMIZE_MESHES = 1 << 1, // vertex cache and vertex fetch order, see MeshOptimizer.h
+    SCENE_IMPORT_OPTIMIZE_OVERDRAW = 1 << 2, // also sorts triangle clusters outside in, implies SCENE_IMPORT_OPTIMIZE_MESHES
+    SCENE_IMPORT_WELD_VERTICES = 1 << 3, // merges bit identical verticies within and across primitives
+    SCENE_IMPORT_BUILD_MESHLETS = 1 << 4, // see Meshlet.h
+    SCENE_IMPORT_SKIP_TEXTURES = 1 << 5, // geometry and materials only, for tools without a GL context. Not part of the cache key
+    SCENE_IMPORT_RAW_TEXTURES = 1 << 6 // uploads the decoded RGBA8 texels instead of block compressing them, see TextureCompress.h. Not part of the cache key
+}SceneImportFlags;
+
+#define MESHLET_MAX_VERTICES 64
+#define MESHLET_MAX_TRIANGLES 124
+
+#define MESHLET_DOUBLE_SIDED (1 << 0) // command lives in the non culled vector, never cone culled
+
+// a contiguous run of one command's indices, drawn with that command's baseVertex and material
+typedef struct {
+    vec4 sphere;    // xyz center, w radius
+    vec4 cone;      // xyz normal cone axis, w sine of its half angle, above 1 when the normals spread too far to cull
+    vec3 cone_apex;
+    u32 command;    // into the culled or non culled command vector
+    u32 first_index;
+    u32 index_count;
+    u32 vertex_count;
+    u32 flags;
+}Meshlet;
+
+typedef struct {
+    vec4 color_intensity;
+    vec4 pos; 
+    vec4 attenuation_factors; // vec4 due to paddings
+}PointLight;
+
+#define set_alpha_mode_opaque(material) material.flags &= 0xfffffffc
+#define set_alpha_mode_mask(material) material.flags = (material.flags & 0xfffffffc) | 0xfffffffd
+#define set_alpha_mode_blend(material) material.flags = (material.flags & 0xfffffffc) | 0xfffffffe
+
+#define alpha_mode_opaque(material) !(material.flags & 0)
+#define alpha_mode_mask(material) (material.flags & 0x00000001)
+#define alpha_mode_blend(material) (material.flags & 0x00000002)
+
+typedef struct {
+    vec4 base_color;
+    vec4 base_color_factor;
+    vec3 emissive_factor;
+    float metalic_factor;
+    float alpha_cutoff;
+    float roughness_factor;
+    int32_t base_color_texture_index;
+    int32_t metalic_texture_index;
+    int32_t normal_texture_index;
+    int32_t occlusion_texture_index;
+    int32_t emissive_texture_index;
+    uint32_t flags;
+}Material;
+
+// structure of arrays copy of the command AABBs for the SIMD culling in Culling.h, padded to CULL_BATCH
+typedef struct {
+    f32* min[3];
+    f32* max[3];
+    u32 count;
+}CullBounds;
+
+// compacted commands of one view, rewritten every frame into that frame's slice of the stream buffer
+typedef struct {
+    u32 buffer; // the stream buffer the offsets point into
+    u64 culled_command_offset;
+    u64 non_culled_command_offset;
+    u64 culled_material_index_offset;
+    u64 non_culled_material_index_offset;
+    u32 culled_capacity;
+    u32 non_culled_capacity;
+    u32 culled_count;
+    u32 non_culled_count;
+}SceneDrawList;
+
+#define SHADOW_MAX_CASCADES 4
+
+typedef struct {
+    vector(Vertex) vertex_vector; // empty for packed scenes
+    vector(PackedVertex) packed_vertex_vector;
+    vector(SkinVertex) skin_vertex_vector;
+    vector(uint32_t) index_vector;
+    vector(DrawElementsIndirectCommand) culled_backface_indirect_command_vector;
+    vector(DrawElementsIndirectCommand) non_culled_backface_indirect_command_vector;
+    vector(u64) texture_handle_vector; // GLuint64 bindless handles
+    vector(ResidentTexture) resident_texture_vector; // per texture_handle_vector slot, what the residency manager swaps it between
+    vector(Material) material_vector;
+    vector(uint32_t) culled_command_material_index_vector;
+    vector(uint32_t) non_culled_command_material_index_vector;
+    vector(PointLight) point_light_vector;
+    vector(Meshlet) meshlet_vector; // culled commands first, then non culled, each in command order
+    vector(AABB) culled_command_aabb_vector; // world space, one per command
+    vector(AABB) non_culled_command_aabb_vector;
+    CullBounds culled_command_bounds;
+    CullBounds non_culled_command_bounds;
+    AABB aabb;
+    u32 import_flags; // SceneImportFlags, set before loading
+    void* cache_mapping; // baked cache pages the geometry vectors point into, NULL when heap owned
+    u64 cache_mapping_size;
+    u32 vertex_array;
+    u32 vertex_buffer;
+    u32 skin_vertex_buffer;
+    u32 index_buffer;
+    SceneDrawList camera_draw_list;
+    SceneDrawList cascade_draw_lists[SHADOW_MAX_CASCADES]; // what each shadow cascade draws
+    u32 texture_handles_buffer;
+    u32 material_buffer;
+    u32 residency_first; // residency id of texture slot 0, the others follow in slot order
+}Scene;
+
+#endif
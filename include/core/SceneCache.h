@@ -0,0 +1,72 @@
+#ifndef SCENE_CACHE_H
+#define SCENE_CACHE_H
+
+#include "Global.h"
+#include "Scene.h"
+#include <stdbool.h>
+
+#define SCENE_CACHE_MAGIC   0x454b4142u // "BAKE"
+#define SCENE_CACHE_VERSION 5
+
+#define SCENE_CACHE_EXTENSION ".bake"
+
+typedef enum {
+    SCENE_TEXTURE_FILE,     // path relative to the scene folder
+    SCENE_TEXTURE_EMBEDDED  // encoded image bytes stored in the cache itself
+}SceneTextureSource;
+
+typedef struct {
+    u32 source;
+    u32 has_sampler;
+    i32 wrap_s;
+    i32 wrap_t;
+    i32 min_filter;
+    i32 mag_filter;
+    u32 role;   // TextureRole from the materials that bind it, picks the block format
+    u32 padding;
+    u64 offset; // into the texture data blob
+    u64 size;
+}SceneTextureRef;
+
+// what the cache was baked from, any mismatch is a miss
+typedef struct {
+    u64 source_size;
+    i64 source_mtime;
+    u64 source_hash; // the source and every external buffer it names
+    u32 import_flags;
+    u32 padding;
+}SceneCacheKey;
+
+// sizes of the scene vectors before the import, the baked indices are absolute so they must match
+typedef struct {
+    u32 vertex_count; // packed and unpacked
+    u32 index_count;
+    u32 culled_command_count;
+    u32 non_culled_command_count;
+    u32 material_count;
+    u32 texture_count;
+    u32 meshlet_count;
+}SceneCacheBase;
+
+typedef struct {
+    const SceneTextureRef* refs;
+    u32 ref_count;
+    const u8* data;
+}SceneCacheTextures;
+
+bool scene_cache_key(const char* source_path,u32 import_flags,SceneCacheKey* key);
+
+void scene_cache_base(const Scene* scene,SceneCacheBase* base);
+
+// writes everything the import appended to the scene after base
+bool scene_cache_write(const char* cache_path,const SceneCacheKey* key,const SceneCacheBase* base,const Scene* scene,
+                       const SceneTextureRef* refs,u32 ref_count,const u8* texture_data,u64 texture_data_size);
+
+// maps the cache and appends its contents to the scene. Empty geometry vectors borrow the mapped pages (copy on
+// write), growing one later copies it to the heap. The texture refs stay valid until scene_cache_release
+bool scene_cache_load(const char* cache_path,const SceneCacheKey* key,Scene* scene,SceneCacheTextures* textures);
+
+// unmaps the cache, vectors still borrowing it are left empty
+void scene_cache_release(Scene* scene);
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef SHADER_H
+#define SHADER_H
+
+#include "Global.h"
+#include "ShadowCascades.h"
+#include <cglm/cglm.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define FRAME_UNIFORM_BINDING 0 // layout(std140, binding = 0) uniform frame_data in the shaders
+
+typedef struct {
+    u64 name_hash;
+    i32 location;
+}ShaderUniform;
+
+// uniforms are reflected once at link time, lookups by name hash the name and search this table without
+// going to GL. Code that runs every frame should keep the location instead
+typedef struct {
+    u32 id;
+    ShaderUniform* uniforms;
+    u32 uniform_count;
+}ShaderProgram;
+
+// std140 layout of frame_data, uploaded once per frame and shared by every pass
+typedef struct {
+    mat4 proj;
+    mat4 view;
+    mat4 cascade_view_proj[SHADOW_MAX_CASCADES];
+    vec3 camera_pos;
+    f32 padding;     // std140 packs a scalar after a vec3 into the same 16 bytes
+    vec3 light_dir;
+    i32 color_state;
+    vec2 viewport;     // pixels, for finding the fragment's light cluster
+    f32 cluster_near;  // depth range split into the light clusters' slices
+    f32 cluster_far;
+    vec4 cascade_splits; // far depth of each cascade, shader picks the first one past the fragment
+    i32 cascade_count;
+    i32 padding_end[3];  // std140 rounds the block up to 16 bytes
+}FrameUniforms;
+
+_Static_assert(offsetof(FrameUniforms,light_dir) == 400 && offsetof(FrameUniforms,color_state) == 412 &&
+               offsetof(FrameUniforms,viewport) == 416 && offsetof(FrameUniforms,cascade_splits) == 432 &&
+               offsetof(FrameUniforms,cascade_count) == 448 && sizeof(FrameUniforms) == 464,
+               "FrameUniforms must match the std140 frame_data block");
+
+bool shader_program_create(ShaderProgram* program,const char* vs_path,const char* fs_path);
+void shader_program_destroy(ShaderProgram* program);
+void shader_bind(const ShaderProgram* program);
+
+// -1 when the program has no such active uniform
+i32 shader_uniform_location(const ShaderProgram* program,const char* name);
+
+// set through glProgramUniform, the program does not need to be bound
+void shader_set_int(const ShaderProgram* program,const char* name,i32 value);
+void shader_set_float(const ShaderProgram* program,const char* name,f32 value);
+void shader_set_mat4(const ShaderProgram* program,const char* name,mat4 value);
+void shader_set_vec4_array(const ShaderProgram* program,const char* name,const vec4* values,u32 count);
+void shader_set_texture_handle(const ShaderProgram* program,const char* name,u64 handle);
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef SHADOW_CASCADES_H
+#define SHADOW_CASCADES_H
+
+#include "Global.h"
+#include "Scene.h"
+#include "Camera.h"
+#include <cglm/types.h>
+#include <stdbool.h>
+
+#define SHADOW_CASCADE_RESOLUTION 2048
+#define SHADOW_DISTANCE CAMERA_FAR // the cascades split [CAMERA_NEAR, SHADOW_DISTANCE]
+#define SHADOW_SPLIT_LAMBDA 0.75f // 0 splits the depth range evenly, 1 logarithmically
+#define SHADOW_CACHE_ANGLE 0.02f  // radians the light turns before every cascade renders again
+
+typedef struct {
+    mat4 view; // world to camera view space
+    f32 tan_half_fov_y;
+    f32 aspect;
+}CascadeCamera;
+
+typedef struct {
+    mat4 view_proj;   // world to the cascade's clip space
+    f32 split_near;   // camera view depth range the cascade covers
+    f32 split_far;
+    f32 half_width;   // of the map in world units, the sphere around the frustum slice plus a texel
+    f32 texel_size;   // world units per shadow map texel
+}ShadowCascade;
+
+// practical split scheme, a lambda weighted blend of the logarithmic and the uniform split. Writes count + 1
+// depths from near to far, cascade i covers [splits[i], splits[i + 1]]
+void shadow_cascade_splits(f32 near_depth,f32 far_depth,f32 lambda,u32 count,f32* splits);
+
+// orthographic light projection around the camera frustum slice [split_near, split_far]. The map covers the
+// slice's bounding sphere, so its size does not change as the camera turns, and is moved in whole texels so
+// static geometry keeps rasterizing to the same texels as the camera moves. The depth range reaches out to
+// scene_bounds so casters between the light and the slice are not clipped. light_dir points towards the light
+void shadow_cascade_fit(const CascadeCamera* camera,const f32* light_dir,const AABB* scene_bounds,f32 split_near,f32 split_far,
+                        u32 resolution,ShadowCascade* cascade);
+
+// splits [near_depth, far_depth] and fits every cascade
+void shadow_cascades_build(const CascadeCamera* camera,const f32* light_dir,const AABB* scene_bounds,f32 near_depth,f32 far_depth,
+                           f32 lambda,u32 count,u32 resolution,ShadowCascade* cascades);
+
+// keeps each cascade's depth layer until it would render differently: the light turned past the angle threshold,
+// a caster overlapping it was reported moved, or the cascade's fitted region changed (the camera moved a texel or
+// more). Shading must sample with cascades[], which hold the matrices the layers were rendered with
+typedef struct {
+    ShadowCascade cascades[SHADOW_MAX_CASCADES];
+    vec3 light_dir;  // the layers were rendered towards
+    u32 cascade_count;
+    bool dirty[SHADOW_MAX_CASCADES];
+    bool enabled;    // false renders every cascade every frame
+    f32 cos_threshold;
+    u64 rendered[SHADOW_MAX_CASCADES];
+    u64 skipped[SHADOW_MAX_CASCADES];
+}ShadowCache;
+
+void shadow_cache_init(ShadowCache* cache,bool enabled,f32 angle_threshold);
+
+// fits the cascades for this frame and returns a bit mask of the ones whose layer has to be rendered again
+u32 shadow_cache_update(ShadowCache* cache,const CascadeCamera* camera,const f32* light_dir,const AABB* scene_bounds,f32 near_depth,
+                        f32 far_depth,f32 lambda,u32 count,u32 resolution);
+
+// a caster moved out of or into bounds, the cascades it overlaps render again on the next update
+void shadow_cache_invalidate(ShadowCache* cache,const AABB* bounds);
+
+#endif
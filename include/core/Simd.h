@@ -0,0 +1,25 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+#include "Global.h"
+
+// SSE2 is there on every x86-64 target and 32 bit builds that ask for it, the SIMD paths are compiled against it
+// and fall back to scalar code anywhere else. AVX builds test __AVX__ on top for their wider paths
+#if defined(__AVX__) || defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <immintrin.h>
+#define SIMD_SSE
+#endif
+
+// index of the lowest set bit, for walking the lanes a compare mask keeps. The mask must not be 0
+#if defined(_MSC_VER)
+#include <intrin.h>
+static inline u32 lowest_bit(u32 mask) {
+    unsigned long index;
+    _BitScanForward(&index,mask);
+    return (u32)index;
+}
+#else
+#define lowest_bit(mask) ((u32)__builtin_ctz(mask))
+#endif
+
+#endif
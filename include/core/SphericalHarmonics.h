@@ -0,0 +1,31 @@
+#ifndef SPHERICAL_HARMONICS_H
+#define SPHERICAL_HARMONICS_H
+
+#include "Global.h"
+#include "JobSystem.h"
+#include <cglm/cglm.h>
+
+#define SH_COEFFICIENT_COUNT 9 // bands 0 to 2, all a clamped cosine convolution needs to within a few percent
+
+// rgb of each coefficient in xyz, the w lanes are unused so the struct uploads as a vec4 array
+typedef struct {
+    vec4 coefficients[SH_COEFFICIENT_COUNT];
+}SH9;
+
+// the 9 real basis functions at a unit direction, in the order the coefficients are stored
+void sh9_basis(const f32* direction,f32* basis);
+
+// radiance of an equirectangular image, laid out the way eqrec_to_cubemap_fs.glsl samples it with row 0 at the
+// bottom (direction y = -1). Rows are projected in parallel, the columns of a row with SSE. The result does not
+// depend on the thread count
+void sh9_project_equirect(JobSystem* jobs,const f32* pixels,u32 width,u32 height,u32 channels,SH9* radiance);
+
+// convolves radiance with the clamped cosine and divides by pi, evaluating the result gives the irradiance
+// cubemap's value: what a white lambertian surface facing that direction reflects
+void sh9_irradiance(const SH9* radiance,SH9* irradiance);
+
+void sh9_evaluate(const SH9* sh,const f32* direction,f32* rgb);
+
+const char* sh9_isa(void);
+
+#endif
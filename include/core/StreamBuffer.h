@@ -0,0 +1,64 @@
+#ifndef STREAM_BUFFER_H
+#define STREAM_BUFFER_H
+
+#include "Global.h"
+#include <stdbool.h>
+
+#define STREAM_BUFFER_FRAMES 3        // slices, so the CPU can run this many frames ahead of the GPU
+#define STREAM_BUFFER_MAX_FRAMES 4
+#define STREAM_BUFFER_MAX_ALIGNMENT 256 // largest offset alignment GL may ask of uniform and storage ranges
+
+// slice bookkeeping of the ring without any GL, so it can be driven and checked on the CPU alone.
+// Frame n writes slice n % slice_count, which covers [slice * slice_size, (slice + 1) * slice_size) of the buffer
+typedef struct {
+    u64 slice_size;
+    u32 slice_count;
+    u32 slice;     // slice of the current frame
+    u64 frame;     // frames begun
+    u64 used;      // bytes allocated in the current slice, alignment included
+    u64 peak_used; // most any frame used
+    u32 failed;    // allocations that did not fit their slice
+    bool in_frame;
+    bool pending[STREAM_BUFFER_MAX_FRAMES]; // fenced at the end of its frame and not yet known to be consumed
+}StreamRing;
+
+void stream_ring_init(StreamRing* ring,u64 slice_size,u32 slice_count);
+
+// slice the next frame will write. While it is pending its fence must be waited on and the slice retired
+u32 stream_ring_next_slice(const StreamRing* ring);
+void stream_ring_retire(StreamRing* ring,u32 slice);
+
+// false, without starting the frame, when the next slice is still pending
+bool stream_ring_begin_frame(StreamRing* ring);
+
+// offset from the start of the buffer, false when the rest of the slice is too small
+bool stream_ring_alloc(StreamRing* ring,u64 size,u64 alignment,u64* offset);
+
+// the slice becomes pending until retired
+void stream_ring_end_frame(StreamRing* ring);
+
+// one persistently mapped, coherent buffer of slice_count slices, each guarded by a fence
+typedef struct {
+    StreamRing ring;
+    u32 buffer;
+    u8* mapped;
+    void* fences[STREAM_BUFFER_MAX_FRAMES]; // GLsync
+    u64 uniform_alignment;
+    u64 storage_alignment;
+    u32 stalls; // frames whose slice was still in use by the GPU when they began
+}StreamBuffer;
+
+bool stream_buffer_create(StreamBuffer* stream,u64 slice_size,u32 slice_count);
+void stream_buffer_destroy(StreamBuffer* stream);
+
+// waits, only if the GPU is slice_count frames behind, for the slice this frame writes
+void stream_buffer_begin_frame(StreamBuffer* stream);
+
+// mapped memory to write size bytes into during this frame, NULL when the slice is full
+void* stream_buffer_alloc(StreamBuffer* stream,u64 size,u64 alignment,u64* offset);
+bool stream_buffer_write(StreamBuffer* stream,const void* data,u64 size,u64 alignment,u64* offset);
+
+// fences the slice after every command of the frame that reads it
+void stream_buffer_end_frame(StreamBuffer* stream);
+
+#endif
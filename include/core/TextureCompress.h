@@ -0,0 +1,90 @@
+#ifndef TEXTURE_COMPRESS_H
+#define TEXTURE_COMPRESS_H
+
+#include "Global.h"
+#include "JobSystem.h"
+#include "TextureLoader.h"
+#include "MipGenerator.h"
+#include <stdbool.h>
+
+#define TEXTURE_CACHE_MAGIC   0x58544342u // "BCTX"
+#define TEXTURE_CACHE_VERSION 2           // part of every key, bump when an encoder or the mip filter changes its output
+
+#define TEXTURE_CACHE_DIRECTORY "texture_cache" // inside the scene folder, one file per content hash
+#define TEXTURE_CACHE_EXTENSION ".bct"
+
+// how the materials use a texture, which decides its block format. Later entries win when a texture has several
+typedef enum {
+    TEXTURE_ROLE_NONE,               // bound by no material
+    TEXTURE_ROLE_OCCLUSION,
+    TEXTURE_ROLE_EMISSIVE,
+    TEXTURE_ROLE_BASE_COLOR,
+    TEXTURE_ROLE_BASE_COLOR_ALPHA,   // base color of a masked or blended material
+    TEXTURE_ROLE_METALLIC_ROUGHNESS, // default_fs.glsl reads occlusion from r, roughness from g and metallic from b
+    TEXTURE_ROLE_NORMAL,
+    TEXTURE_ROLE_COUNT
+}TextureRole;
+
+typedef enum {
+    TEXTURE_FORMAT_BC1, // rgb, two 565 endpoints and 2 bit indices, 4 bits per texel
+    TEXTURE_FORMAT_BC3, // a BC1 colour block plus a BC4 alpha block, alpha stays independent of colour for cutouts
+    TEXTURE_FORMAT_BC4, // r, 4 bits per texel
+    TEXTURE_FORMAT_BC5, // rg as two BC4 blocks, default_fs.glsl rebuilds a normal's z
+    TEXTURE_FORMAT_BC7, // rgba, mode 6 only: one pair of 7 bit endpoints with p bits and 4 bit indices
+    TEXTURE_FORMAT_COUNT
+}TextureFormat;
+
+// every mip level of a texture in 4x4 blocks, rows of blocks top to bottom like the decoded pixels.
+// Levels smaller than a block repeat their edge texels
+typedef struct {
+    u8* blocks;
+    u64 blocks_size;
+    u32 format;
+    u32 width;
+    u32 height;
+    u32 mip_count;
+    TextureMip mips[TEXTURE_MAX_MIPS]; // offset and size into blocks
+}CompressedTexture;
+
+typedef struct {
+    u32 texture_count;
+    u64 texel_count;      // every mip level included
+    u64 compressed_bytes;
+    f64 seconds;
+}TextureCompressStats;
+
+TextureFormat texture_role_format(TextureRole role);
+
+// sRGB for colours, normal for normal maps, linear for data
+MipMode texture_role_mip_mode(TextureRole role);
+const char* texture_format_name(TextureFormat format);
+
+// 8 for BC1 and BC4, 16 for the others
+u32 texture_format_block_size(TextureFormat format);
+
+// 16 rgba8 texels in rows
+void texture_compress_block(TextureFormat format,const u8* rgba,u8* block);
+void texture_decompress_block(TextureFormat format,const u8* block,u8* rgba);
+
+// rows of blocks of every level of every texture spread over the job system. Textures that failed to decode
+// come back with blocks == NULL. stats may be NULL
+void texture_compress_batch(JobSystem* jobs,const DecodedTexture* textures,const TextureFormat* formats,u32 count,
+                            CompressedTexture* compressed,TextureCompressStats* stats);
+void texture_compressed_free(CompressedTexture* textures,u32 count);
+
+// dB over the channels the format keeps, 99 for an exact match. Channels missing from the source read as GL
+// expands them: 0 for g and b, 255 for alpha
+f64 texture_psnr(const DecodedTexture* source,const CompressedTexture* compressed,u32 mip);
+
+void texture_compress_stats_print(const TextureCompressStats* stats,u32 thread_count);
+
+// hash of the encoded image bytes, the format, how the mips were filtered and TEXTURE_CACHE_VERSION
+bool texture_cache_key(const TextureSource* source,TextureFormat format,MipMode mip_mode,u64* key);
+
+// directory/<key in hex>.bct, creating the directory
+void texture_cache_path(const char* directory,u64 key,char* path,u32 capacity);
+
+bool texture_cache_write(const char* path,u64 key,const CompressedTexture* texture);
+bool texture_cache_load(const char* path,u64 key,CompressedTexture* texture);
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef TEXTURE_LOADER_H
+#define TEXTURE_LOADER_H
+
+#include "Global.h"
+#include "JobSystem.h"
+#include <stdbool.h>
+
+#define TEXTURE_MAX_MIPS 16
+
+typedef struct {
+    const char* path; // read from disk when data is NULL
+    const u8* data;   // encoded image bytes
+    u64 size;
+}TextureSource;
+
+typedef struct {
+    u32 width;
+    u32 height;
+    u64 offset; // into DecodedTexture.pixels
+    u64 size;
+}TextureMip;
+
+// tightly packed, 8 bits per channel, every mip level back to back in one allocation
+typedef struct {
+    u8* pixels;
+    u64 pixels_size;
+    u32 width;
+    u32 height;
+    u32 channels;
+    u32 mip_count;
+    TextureMip mips[TEXTURE_MAX_MIPS];
+}DecodedTexture;
+
+typedef struct {
+    u32 image_count;
+    u32 failed_count;
+    u64 encoded_bytes;
+    u64 decoded_bytes; // every mip level included
+    f64 seconds;
+}TextureDecodeStats;
+
+u32 texture_mip_count(u32 width,u32 height);
+
+// decodes every source on the job system, failed images come back with pixels == NULL. stats may be NULL.
+// generate_mips filters every channel as stored, see mip_generate_batch for sRGB and normal map chains
+void texture_decode_batch(JobSystem* jobs,const TextureSource* sources,u32 count,bool generate_mips,
+                          DecodedTexture* textures,TextureDecodeStats* stats);
+
+void texture_decoded_free(DecodedTexture* textures,u32 count);
+
+void texture_decode_stats_print(const TextureDecodeStats* stats,u32 thread_count);
+
+#endif
@@ -0,0 +1,127 @@
+#ifndef TEXTURE_RESIDENCY_H
+#define TEXTURE_RESIDENCY_H
+
+#include "Global.h"
+#include "StreamBuffer.h"
+#include <stdbool.h>
+
+#define RESIDENCY_NONE 0xffffffffu
+#define RESIDENCY_FALLBACK_SIZE 64                   // largest side of the mip tail every texture keeps resident
+#define RESIDENCY_RELEASE_DELAY STREAM_BUFFER_FRAMES // frames an evicted handle stays resident, earlier frames may still sample it
+#define RESIDENCY_MAX_PROMOTIONS 64                  // textures made resident again per frame, the rest wait a frame on their fallback
+
+typedef enum {
+    RESIDENCY_PINNED,    // the fallback is the whole chain, nothing to evict
+    RESIDENCY_RESIDENT,  // the table points at the full chain
+    RESIDENCY_RELEASING, // the table points at the fallback, the full chain is made non resident at release_frame
+    RESIDENCY_EVICTED    // only the fallback is resident
+}ResidencyState;
+
+typedef struct {
+    u64 size;          // bytes of the full chain
+    u64 fallback_size; // bytes of the fallback, resident for as long as the texture exists
+    u64 last_used;     // frame it was last touched, 0 for never
+    u64 release_frame;
+    u32 older;         // LRU neighbours while RESIDENT
+    u32 newer;
+    u32 state;         // ResidencyState
+    u32 padding;
+}ResidencyEntry;
+
+typedef struct {
+    u64 frames;
+    u64 touches;    // distinct textures touched, summed over the frames
+    u64 hits;       // touches whose full chain was already resident
+    u64 promotions; // touches that made it resident again, or kept it from being released
+    u64 fallbacks;  // touches drawn with the fallback, the frame ran out of promotions or of budget
+    u64 evictions;
+    u64 releases;
+    u64 over_budget_frames; // frames that ended over the budget, releasing chains included
+    u64 peak_bytes;         // releasing chains included
+}ResidencyStats;
+
+// which textures have their full chain resident, without any GL, so it can be driven by simulated access traces.
+// Full chains are kept in least recently used order. A chain is evicted only to make room in the budget and never
+// in a frame that touched it, its handle is released RESIDENCY_RELEASE_DELAY frames later so frames still in
+// flight can finish sampling it. Until then its bytes still count against the budget. Each frame fills promoted,
+// evicted and released with the entries whose handle or table slot must change
+typedef struct {
+    ResidencyEntry* entries;
+    u32 count;
+    u32 capacity;
+    u64 budget;          // full chains, releasing ones included, and fallbacks together, in bytes
+    u64 resident_bytes;  // every fallback and the RESIDENT full chains
+    u64 releasing_bytes; // evicted full chains waiting for their release
+    u64 frame;           // frames begun
+    u32 lru_oldest;
+    u32 lru_newest;
+    u32 max_promotions;
+    u32 promotions_left;
+    u32* promoted; // the table goes back to the full chain, made resident first when it was released
+    u32* evicted;  // the table goes to the fallback
+    u32* released; // the full chain is made non resident
+    u32 promoted_count;
+    u32 evicted_count;
+    u32 released_count;
+    bool in_frame;
+    ResidencyStats stats;
+}ResidencyPolicy;
+
+// a budget of 0 never evicts
+void residency_policy_init(ResidencyPolicy* policy,u64 budget,u32 max_promotions);
+void residency_policy_free(ResidencyPolicy* policy);
+
+// a texture whose full chain is resident, returns its id. When size equals fallback_size it is pinned
+u32 residency_policy_add(ResidencyPolicy* policy,u64 size,u64 fallback_size);
+
+// releases the chains evicted RESIDENCY_RELEASE_DELAY frames ago
+void residency_policy_begin_frame(ResidencyPolicy* policy);
+
+// marks a texture as used this frame, true when it may be drawn with its full chain. An evicted texture is made
+// resident again if the frame has promotions left and the budget has room next to the releasing chains once
+// textures not used this frame go. While the chains evicted for it are releasing it is drawn with its fallback
+bool residency_policy_touch(ResidencyPolicy* policy,u32 id);
+
+// evicts least recently used chains not touched this frame until the budget holds
+void residency_policy_end_frame(ResidencyPolicy* policy);
+
+void residency_stats_print(const ResidencyStats* stats,u64 budget);
+
+// first level of a width x height chain of mip_count levels whose larger side fits RESIDENCY_FALLBACK_SIZE,
+// the last level when none does
+u32 residency_fallback_level(u32 width,u32 height,u32 mip_count);
+
+typedef struct {
+    u64 handle;          // GLuint64 of the full chain
+    u64 fallback_handle; // of the levels from residency_fallback_level down, the full handle when that is level 0
+    u64 size;
+    u64 fallback_size;
+}ResidentTexture;
+
+typedef struct {
+    ResidentTexture texture;
+    u32 buffer; // handle table the slot is in
+    u32 slot;
+    bool resident; // the full handle is resident in GL
+}ResidencyBinding;
+
+// the policy applied to bindless handles, swapping table slots between full chains and fallbacks
+typedef struct {
+    ResidencyPolicy policy;
+    ResidencyBinding* bindings; // per policy entry
+    u32 capacity;
+}TextureResidency;
+
+void texture_residency_init(TextureResidency* residency,u64 budget,u32 max_promotions);
+void texture_residency_free(TextureResidency* residency);
+
+// both handles of texture must already be resident and slot of buffer must hold the full handle
+u32 texture_residency_add(TextureResidency* residency,u32 buffer,u32 slot,const ResidentTexture* texture);
+
+void texture_residency_begin_frame(TextureResidency* residency);
+bool texture_residency_touch(TextureResidency* residency,u32 id);
+
+// ends the policy frame and makes its changes, before the frame draws anything that samples the tables
+void texture_residency_apply(TextureResidency* residency);
+
+#endif
@@ -0,0 +1,9 @@
+#ifndef TIMER_H
+#define TIMER_H
+
+#include "Global.h"
+
+// monotonic high resolution clock in seconds, usable without a window or GL context
+f64 timer_now(void);
+
+#endif
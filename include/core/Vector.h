@@ -8,48 +8,69 @@
 
 #define INITIAL_CAPACITY 256
 
-#define vector(T) struct { T* data; uint32_t capacity; uint32_t size; }
+// borrowed vectors point at memory they do not own (mapped file pages), they are never realloced or freed,
+// the first growth copies them to the heap
+#define vector(T) struct { T* data; uint32_t capacity; uint32_t size; uint32_t borrowed; }
 #define vector_create(vec,T) { \
     vec.data = malloc(sizeof(T) * INITIAL_CAPACITY);\
     vec.capacity = INITIAL_CAPACITY;\
     vec.size = 0;\
+    vec.borrowed = 0;\
 }
 
-#define vector_reserve(vec,T,capacity) {\
-    vec.data = realloc(vec.data,capacity * sizeof(T));\
-    vec.capacity = capacity;\
+#define vector_borrow(vec,T,array_ptr,count) {\
+    vector_free(vec);\
+    vec.data = (T*)(array_ptr);\
+    vec.capacity = (count);\
+    vec.size = (count);\
+    vec.borrowed = 1;\
 }
 
-#define vector_resize(vec,T,new_size) {\
-    if(new_size >= vec.capacity) {\
-        vec.capacity = (new_size * 2);\
-        vec.data = realloc(vec.data,vec.capacity * sizeof(T));\
+#define vector_free(vec) {\
+    if(!vec.borrowed)\
+        free(vec.data);\
+    vec.data = NULL;\
+    vec.capacity = vec.size = vec.borrowed = 0;\
+}
+
+#define vector_set_capacity(vec,T,new_capacity) {\
+    if(vec.borrowed) {\
+        T* owned = malloc((new_capacity) * sizeof(T));\
+        memcpy(owned,vec.data,(vec.size < (new_capacity) ? vec.size : (new_capacity)) * sizeof(T));\
+        vec.data = owned;\
+        vec.borrowed = 0;\
+    } else {\
+        vec.data = realloc(vec.data,(new_capacity) * sizeof(T));\
     }\
+    vec.capacity = (new_capacity);\
+}
+
+#define vector_reserve(vec,T,new_capacity) {\
+    vector_set_capacity(vec,T,new_capacity);\
+}
+
+#define vector_resize(vec,T,new_size) {\
+    if(new_size >= vec.capacity)\
+        vector_set_capacity(vec,T,(new_size) * 2);\
     vec.size = new_size;\
 }
 
 #define vector_push(vec,T,elem) {\
-    if(vec.size == vec.capacity) {\
-        vec.capacity *= 2;\
-        vec.data = realloc(vec.data,vec.capacity * sizeof(T));\
-    }\
+    if(vec.size == vec.capacity)\
+        vector_set_capacity(vec,T,vec.capacity ? vec.capacity * 2 : INITIAL_CAPACITY);\
     memcpy(&vec.data[vec.size],&elem,sizeof(T));\
     ++vec.size;\
 }
 
 #define vector_push_const(vec,T,elem) {\
-    if(vec.size == vec.capacity) {\
-        vec.capacity *= 2;\
-        vec.data = realloc(vec.data,vec.capacity * sizeof(T));\
-    }\
+    if(vec.size == vec.capacity)\
+        vector_set_capacity(vec,T,vec.capacity ? vec.capacity * 2 : INITIAL_CAPACITY);\
     vec.data[vec.size++] = (elem);\
 }
 
 #define vector_push_array(vec,T,array_ptr,count) {\
-    if(vec.size + count >= vec.capacity) {\
-        vec.capacity = (vec.size + (count)) * 2;\
-        vec.data = realloc(vec.data,vec.capacity * sizeof(T));\
-    }\
+    if(vec.size + count >= vec.capacity)\
+        vector_set_capacity(vec,T,(vec.size + (count)) * 2);\
     memcpy(&vec.data[vec.size],array_ptr,(count) * sizeof(T));\
     vec.size += (count);\
 }
@@ -0,0 +1,29 @@
+#ifndef VERTEX_PACKING_H
+#define VERTEX_PACKING_H
+
+#include "Global.h"
+#include "Scene.h"
+#include "JobSystem.h"
+#include <stdbool.h>
+
+u16 float_to_half(f32 value);
+f32 half_to_float(u16 value);
+
+i16 float_to_snorm16(f32 value);
+f32 snorm16_to_float(i16 value);
+
+// unit vector <-> two snorm16, picks the rounding with the smallest angular error
+void oct_encode(const f32 v[3],i16 dest[2]);
+void oct_decode(const i16 e[2],f32 dest[3]);
+
+void tangent_encode(const f32 tangent[4],i16 dest[2]);
+void tangent_decode(const i16 e[2],f32 dest[4]);
+
+void pack_vertex(const Vertex* vertex,PackedVertex* packed);
+void unpack_vertex(const PackedVertex* packed,const SkinVertex* skin,Vertex* vertex);
+
+// appends vertex_vector, the verticies of one import, to the packed (and if needed skin) vectors and releases it.
+// The baseVertex of every command from the given ones on moves past the verticies earlier imports packed
+void scene_pack_vertices(JobSystem* jobs,Scene* scene,bool has_skin,u32 first_culled_command,u32 first_non_culled_command);
+
+#endif
@@ -9,6 +9,10 @@ typedef struct Window Window;
 
 Window* windowCreate(i32 width,i32 height,const char* title); 
 
+// initializes GLFW itself, trying a surfaceless EGL context, then OSMesa, then a hidden window on the
+// default platform. The framebuffer of the result should not be presented, render into an FBO instead
+Window* windowCreateHeadless(i32 width,i32 height,const char* title);
+
 void    windowDestroy(Window* window);
 
 f32     windowAspectRatio(Window *window);
@@ -37,4 +41,6 @@ bool    windowPaused(Window* window);
 
 i32     windowKeyState(Window* window,i32 key);
 
+i32     windowMouseButtonState(Window* window,i32 button);
+
 #endif
@@ -1,8 +1,20 @@
 #version 450 core
 layout (location = 0) in vec3 aPos;
 
-uniform mat4 projection;
-uniform mat4 view;
+// matches FrameUniforms in Shader.h
+layout(std140, binding = 0) uniform frame_data {
+    mat4 proj;
+    mat4 view;
+    mat4 cascade_view_proj[4]; // SHADOW_MAX_CASCADES
+    vec3 camera_pos;
+    vec3 light_dir;
+    int color_state;
+    vec2 viewport;
+    float cluster_near;
+    float cluster_far;
+    vec4 cascade_splits; // far depth of each cascade
+    int cascade_count;
+};
 
 out vec3 WorldPos;
 
@@ -10,7 +22,7 @@ void main() {
     WorldPos = aPos;
 
 	mat4 rotView = mat4(mat3(view));
-	vec4 clipPos = projection * rotView * vec4(WorldPos, 1.0);
+	vec4 clipPos = proj * rotView * vec4(WorldPos, 1.0);
 
 	gl_Position = clipPos.xyww;
 }
@@ -18,11 +18,23 @@ in float handedness;
 
 flat in uint v_DrawID;
 
-uniform vec3 light_dir;
-uniform mat4 light_view;
-uniform mat4 light_ortho;
+// matches FrameUniforms in Shader.h
+layout(std140, binding = 0) uniform frame_data {
+    mat4 proj;
+    mat4 view;
+    mat4 cascade_view_proj[4]; // SHADOW_MAX_CASCADES
+    vec3 camera_pos;
+    vec3 light_dir;
+    int color_state;
+    vec2 viewport;
+    float cluster_near;
+    float cluster_far;
+    vec4 cascade_splits; // far depth of each cascade
+    int cascade_count;
+};
 
-layout(bindless_sampler) uniform samplerCube irradiance_map;
+// diffuse lighting of the environment as SH9, already convolved with the clamped cosine and divided by pi
+uniform vec4 irradiance_sh[9];
 layout(bindless_sampler) uniform samplerCube prefilter_map;
 layout(bindless_sampler) uniform sampler2D brdf_lut;
 
@@ -31,7 +43,7 @@ layout(bindless_sampler) uniform sampler2D brdf_lut;
 #define alpha_mode_blend(material)  ((material.flags & 0x00000002u) == 2)
 #define texture_exists(texture_index) ((texture_index) != 0)
 
-uniform sampler2D dir_shadowmap;
+uniform sampler2DArray dir_shadowmap;
 
 struct Material {
     vec4 base_color;
@@ -51,9 +63,14 @@ struct Material {
 struct PointLight {
     vec4 color_intensity;
     vec4 pos; 
-    vec4 attenuation_factors; // w components not used, just for padding
+    vec4 attenuation_factors; // constant, linear, quadratic and the range point_light_radius computed
 };
 
+// matches LightCluster.h
+#define CLUSTER_X 16
+#define CLUSTER_Y 9
+#define CLUSTER_Z 24
+
 layout(std430, binding = 0) readonly restrict buffer texture_handle_buffer {
     sampler2D texture_handles[];
 };
@@ -66,11 +83,19 @@ layout(std430, binding = 2) readonly restrict buffer command_material_buffer {
     uint command_material[];
 };
 
-layout(std140,binding = 3) readonly restrict uniform point_light_buffer {
-    uint num_lights;
+layout(std430, binding = 3) readonly restrict buffer point_light_buffer {
     PointLight lights[];
 };
 
+// offset and count into light_indices, x then y then z
+layout(std430, binding = 4) readonly restrict buffer light_cluster_buffer {
+    uvec2 clusters[];
+};
+
+layout(std430, binding = 5) readonly restrict buffer light_index_buffer {
+    uint light_indices[];
+};
+
 float DistributionGGX(vec3 N, vec3 H, float roughness) {
     float a = roughness*roughness;
     float a2 = a*a;
@@ -111,22 +136,48 @@ vec3 fresnelSchlickRoughness(float cosTheta, vec3 F0, float roughness) {
     return F0 + (max(vec3(1.0 - roughness), F0) - F0) * pow(clamp(1.0 - cosTheta, 0.0, 1.0), 5.0);
 } 
 
-float compute_shadows(vec4 frag_light_space,vec3 normal) {
+// same basis and order as sh9_basis in SphericalHarmonics.c
+vec3 sh_irradiance(vec3 n) {
+    return irradiance_sh[0].rgb * 0.282095
+         + irradiance_sh[1].rgb * (0.488603 * n.y)
+         + irradiance_sh[2].rgb * (0.488603 * n.z)
+         + irradiance_sh[3].rgb * (0.488603 * n.x)
+         + irradiance_sh[4].rgb * (1.092548 * n.x * n.y)
+         + irradiance_sh[5].rgb * (1.092548 * n.y * n.z)
+         + irradiance_sh[6].rgb * (0.315392 * (3.0 * n.z * n.z - 1.0))
+         + irradiance_sh[7].rgb * (1.092548 * n.x * n.z)
+         + irradiance_sh[8].rgb * (0.546274 * (n.x * n.x - n.y * n.y));
+}
+
+uint light_cluster(float view_depth) {
+    uvec2 tile = min(uvec2(gl_FragCoord.xy / viewport * vec2(CLUSTER_X,CLUSTER_Y)),uvec2(CLUSTER_X - 1,CLUSTER_Y - 1));
+    float slice = floor(log(view_depth / cluster_near) * CLUSTER_Z / log(cluster_far / cluster_near));
+    uint z = uint(clamp(slice,0.0,float(CLUSTER_Z - 1)));
+    return tile.x + CLUSTER_X * (tile.y + CLUSTER_Y * z);
+}
+
+// the first cascade whose slice reaches the fragment, nothing is shadowed past the last one
+float compute_shadows(vec3 normal,float view_depth) {
+    int cascade = 0;
+    while(cascade < cascade_count && view_depth > cascade_splits[cascade])
+        ++cascade;
+    if(cascade == cascade_count)
+        return 0.0;
+
+    vec4 frag_light_space = cascade_view_proj[cascade] * vec4(frag_pos,1.0);
     vec3 proj_coords = frag_light_space.xyz / frag_light_space.w;
     proj_coords = proj_coords * 0.5 + 0.5;
     if(proj_coords.z > 1.0)
         return 0.0;
 
     float bias = max(0.05 * (1.0 - dot(normal, light_dir)), 0.005);  
-    float closest_depth = texture(dir_shadowmap, proj_coords.xy).r; 
+    float closest_depth = texture(dir_shadowmap, vec3(proj_coords.xy,cascade)).r; 
     float current_depth = proj_coords.z;
     float shadow = current_depth > closest_depth + bias ? 1.0 : 0.0;
 
     return shadow;
 } 
 
-uniform int color_state = 0;
-
 void main() {
     uint current_material_index = command_material[v_DrawID];
     Material current_material = materials[current_material_index];
@@ -139,7 +190,9 @@ void main() {
         discard;
 
     vec3 occlusion_color = texture(texture_handles[current_material.occlusion_texture_index],tex_coord).rgb;
-    vec3 normal_color    = texture(texture_handles[current_material.normal_texture_index],tex_coord).rgb * 2.0 - 1.0;
+    // normal maps are BC5, two channels, so z is rebuilt from the unit length
+    vec2 normal_xy       = texture(texture_handles[current_material.normal_texture_index],tex_coord).rg * 2.0 - 1.0;
+    vec3 normal_color    = vec3(normal_xy,sqrt(max(1.0 - dot(normal_xy,normal_xy),0.0)));
     vec3 metalic_color   = texture(texture_handles[current_material.metalic_texture_index],tex_coord).rgb;
     vec3 emissive_color  = texture(texture_handles[current_material.emissive_texture_index],tex_coord).rgb;
 
@@ -179,18 +232,25 @@ void main() {
     vec3 specular_brdf = (D * G * F) / max(4.0 * n_dot_l * n_dot_v,0.01);
     vec3 radiance = vec3(5.0);
     // calculate it for the sun
-    vec4 frag_light_space = light_ortho * light_view * vec4(frag_pos,1.0); 
-    float shadow = compute_shadows(frag_light_space,final_normal);  
+    float view_depth = -(view * vec4(frag_pos,1.0)).z;
+    float shadow = compute_shadows(final_normal,view_depth);  
     float visibility = 1.0 - shadow;
     vec3 Lo = (diffuse_brdf + specular_brdf) * radiance * n_dot_l * visibility;
     
     // accumulate it for each point light
-    for(int i = 0; i < num_lights; ++i) {
-        vec3 L = normalize(lights[i].pos.xyz - frag_pos);
+    uvec2 cluster = clusters[light_cluster(view_depth)];
+    for(uint c = 0; c < cluster.y; ++c) {
+        PointLight light = lights[light_indices[cluster.x + c]];
+        float distance = length(light.pos.xyz - frag_pos);
+        if(distance >= light.attenuation_factors.w)
+            continue;
+        vec3 L = (light.pos.xyz - frag_pos) / max(distance,0.0001);
         vec3 H = normalize(view_vec + L);
-        float distance = length(lights[i].pos.xyz - frag_pos);
-        float attenuation = 1.0 / (distance * distance);
-        vec3 radiance = lights[i].color_intensity.rgb * attenuation;
+        vec3 factors = light.attenuation_factors.xyz;
+        float attenuation = light.color_intensity.w / (factors.x + factors.y * distance + factors.z * distance * distance);
+        // fades to zero at the range the light was binned with, so the cluster edges never show
+        float window = clamp(1.0 - pow(distance / light.attenuation_factors.w,4.0),0.0,1.0);
+        vec3 radiance = light.color_intensity.rgb * attenuation * window * window;
 
         float NDF = DistributionGGX(world_normal, H, roughness);   
         float G   = GeometrySmith(world_normal,view_vec, L, roughness);    
@@ -213,7 +273,7 @@ void main() {
     vec3 kS = F_schlick;
     vec3 kD = (1.0 - kS) * (1.0 - metallic);
 
-    vec3 irradiance = texture(irradiance_map,final_normal).rgb;
+    vec3 irradiance = max(sh_irradiance(final_normal),vec3(0.0));
     vec3 indirect_diffuse = albedo_color * irradiance;
 
     vec3 reflect_vec = reflect(-view_vec,final_normal);
@@ -10,9 +10,21 @@ layout(location = 5) in vec2 aTexCoord0;
 layout(location = 6) in vec2 aTexCoord1;
 layout(location = 7) in uvec4 aJoints;
 
-uniform mat4 proj;
-uniform mat4 view;
-uniform vec3 camera_pos;
+// matches FrameUniforms in Shader.h
+layout(std140, binding = 0) uniform frame_data {
+    mat4 proj;
+    mat4 view;
+    mat4 cascade_view_proj[4]; // SHADOW_MAX_CASCADES
+    vec3 camera_pos;
+    vec3 light_dir;
+    int color_state;
+    vec2 viewport;
+    float cluster_near;
+    float cluster_far;
+    vec4 cascade_splits; // far depth of each cascade
+    int cascade_count;
+};
+uniform bool packed_vertices = false;
 
 out mat3 tbn;
 out vec4 color;
@@ -27,12 +39,28 @@ out float handedness;
 
 flat out uint v_DrawID;
 
+// matches oct_decode / tangent_decode in VertexPacking.c
+vec3 oct_decode(vec2 e) {
+    vec3 v = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if(v.z < 0.0)
+        v.xy = (1.0 - abs(v.yx)) * vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+    return normalize(v);
+}
+
+vec4 tangent_decode(vec2 e) {
+    float w = e.y >= 0.0 ? 1.0 : -1.0;
+    return vec4(oct_decode(vec2(e.x, e.y * 2.0 - w)), w);
+}
+
 void main() {
     gl_Position = proj * view * vec4(aPos,1.0);
 
-    vec3 T = normalize(aTan.xyz);
-    vec3 B = normalize(cross(aNormal,aTan.xyz) * aTan.w);
-    vec3 N = normalize(aNormal);
+    vec4 tangent_in = packed_vertices ? tangent_decode(aTan.xy) : aTan;
+    vec3 normal_in  = packed_vertices ? oct_decode(aNormal.xy) : aNormal;
+
+    vec3 T = normalize(tangent_in.xyz);
+    vec3 B = normalize(cross(normal_in,tangent_in.xyz) * tangent_in.w);
+    vec3 N = normalize(normal_in);
     tbn = mat3(T, B, N);
 
     tex_coord = aTexCoord0;
@@ -43,6 +71,6 @@ void main() {
     tangent = T;
     normal = N;
     view_vec = normalize(camera_pos - aPos.xyz);
-    handedness = aTan.w;
+    handedness = tangent_in.w;
     v_DrawID = gl_DrawIDARB;
 }
@@ -4,8 +4,9 @@ out vec4 FragColor;
 
 in vec2 tex_coord;
 
-uniform sampler2D sampler;
+uniform sampler2DArray sampler;
+uniform int layer;
 
 void main() {
-    FragColor = vec4(vec3(texture(sampler,tex_coord).r),1.0);
+    FragColor = vec4(vec3(texture(sampler,vec3(tex_coord,layer)).r),1.0);
 }
@@ -3,12 +3,26 @@
 
 layout(location = 3) in vec3 aPos;
 
-uniform mat4 ortho;
-uniform mat4 view;
+// matches FrameUniforms in Shader.h
+layout(std140, binding = 0) uniform frame_data {
+    mat4 proj;
+    mat4 view;
+    mat4 cascade_view_proj[4]; // SHADOW_MAX_CASCADES
+    vec3 camera_pos;
+    vec3 light_dir;
+    int color_state;
+    vec2 viewport;
+    float cluster_near;
+    float cluster_far;
+    vec4 cascade_splits; // far depth of each cascade
+    int cascade_count;
+};
+
+uniform int cascade;
 
 out vec3 frag_pos;
 
 void main() {
-    gl_Position = ortho * view * vec4(aPos,1.0);
+    gl_Position = cascade_view_proj[cascade] * vec4(aPos,1.0);
     frag_pos = aPos;
 }
@@ -0,0 +1,176 @@
+#include "Bench.h"
+#include "BVH.h"
+#include "Raycast.h"
+#include "Timer.h"
+#include <cglm/cglm.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <float.h>
+
+typedef struct {
+    const vec3* positions;
+    const u32* indices;
+}BenchTriangles;
+
+static bool bench_triangle_hit(void* data,u32 item,const f32* origin,const f32* direction,f32* t) {
+    const BenchTriangles* triangles = (const BenchTriangles*)data;
+    const u32* triangle = triangles->indices + item * 3;
+    f32 u, v;
+    return ray_triangle_intersect(origin,direction,triangles->positions[triangle[0]],triangles->positions[triangle[1]],
+                                  triangles->positions[triangle[2]],t,&u,&v);
+}
+
+int bvh_benchmark(int argc,char** argv) {
+    u32 box_count = bench_arg(argc,argv,0,1000000);
+    u32 sphere_count = bench_arg(argc,argv,1,64);
+    JobSystem* jobs = job_system_create(0);
+    u32 thread_count = job_system_thread_count(jobs);
+    bool match = true;
+
+    // per primitive bounds: scattered boxes, queried with frusta and boxes
+    AABB* boxes = malloc((box_count + 1) * sizeof(AABB));
+    u32 seed = 0x9e3779b9u;
+    for(u32 i = 0; i < box_count; i++)
+        bench_random_box(&seed,500.0f,4.0f,&boxes[i]);
+
+    BVH bvh;
+    f64 start = timer_now();
+    bvh_build(&bvh,NULL,boxes,box_count);
+    f64 serial_seconds = timer_now() - start;
+    bvh_free(&bvh);
+    start = timer_now();
+    bvh_build(&bvh,jobs,boxes,box_count);
+    f64 parallel_seconds = timer_now() - start;
+    printf("[BVH] %u boxes: build %.1f ms serial, %.1f ms on %u threads, %u nodes, depth %u, SAH cost %.1f\n",box_count,
+           serial_seconds * 1000.0,parallel_seconds * 1000.0,thread_count,bvh.node_count,bvh.depth,bvh_sah_cost(&bvh));
+
+    CullBounds bounds;
+    cull_bounds_build(&bounds,boxes,box_count);
+    u32* items = malloc((box_count + 1) * sizeof(u32));
+    const u32 frustum_count = 64;
+    f64 tree_seconds = 0.0, flat_seconds = 0.0;
+    u64 found = 0;
+    for(u32 i = 0; i < frustum_count; i++) {
+        f32 yaw = 2.0f * GLM_PIf * i / frustum_count;
+        mat4 view, proj, view_proj;
+        glm_lookat((vec3){0.0f,0.0f,0.0f},(vec3){cosf(yaw),-0.2f,sinf(yaw)},(vec3){0.0f,1.0f,0.0f},view);
+        glm_perspective(glm_rad(60.0f),16.0f / 9.0f,0.1f,200.0f,proj);
+        glm_mat4_mul(proj,view,view_proj);
+        Frustum frustum;
+        frustum_from_matrix(view_proj,&frustum);
+
+        start = timer_now();
+        u32 tree_count = bvh_query_frustum(&bvh,&frustum,items);
+        tree_seconds += timer_now() - start;
+        start = timer_now();
+        u32 flat_count = frustum_cull_aabbs(&frustum,&bounds,items);
+        flat_seconds += timer_now() - start;
+        match &= tree_count == flat_count;
+        found += tree_count;
+    }
+    printf("[BVH] frustum: %.3f ms per query (%s flat scan %.3f ms), %llu boxes per query\n",tree_seconds * 1000.0 / frustum_count,
+           frustum_cull_isa(),flat_seconds * 1000.0 / frustum_count,(unsigned long long)(found / frustum_count));
+
+    const u32 box_query_count = 100000;
+    found = 0;
+    start = timer_now();
+    for(u32 i = 0; i < box_query_count; i++) {
+        AABB query;
+        bench_random_box(&seed,500.0f,10.0f,&query);
+        found += bvh_query_aabb(&bvh,&query,items);
+    }
+    f64 box_seconds = timer_now() - start;
+    printf("[BVH] aabb: %.2f Mqueries/s, %.2f boxes per query\n",box_query_count / box_seconds / 1e6,(f64)found / box_query_count);
+    for(u32 i = 0; i < 16; i++) {
+        AABB query;
+        bench_random_box(&seed,500.0f,10.0f,&query);
+        u32 brute = 0;
+        for(u32 b = 0; b < box_count; b++)
+            brute += query.min[0] <= boxes[b].max[0] && query.max[0] >= boxes[b].min[0] && query.min[1] <= boxes[b].max[1] &&
+                     query.max[1] >= boxes[b].min[1] && query.min[2] <= boxes[b].max[2] && query.max[2] >= boxes[b].min[2];
+        match &= brute == bvh_query_aabb(&bvh,&query,items);
+    }
+    bvh_free(&bvh);
+    cull_bounds_free(&bounds);
+    free(items);
+    free(boxes);
+
+    // per triangle bounds: a grid of spheres, queried with rays from above
+    const u32 rings = 64;
+    u32 side = (u32)ceilf(sqrtf((f32)sphere_count));
+    vector(vec3) positions;
+    vector(u32) indices;
+    vector_create(positions,vec3);
+    vector_create(indices,u32);
+    for(u32 i = 0; i < sphere_count; i++) {
+        BenchMesh sphere;
+        bench_sphere(rings,i,&sphere);
+        vec3 offset = { (i % side) * 3.0f, 0.0f, (i / side) * 3.0f };
+        for(u32 k = 0; k < sphere.index_count; k++)
+            sphere.indices[k] += positions.size;
+        for(u32 v = 0; v < sphere.vertex_count; v++)
+            glm_vec3_add(sphere.positions[v],offset,sphere.positions[v]);
+        vector_push_array(positions,vec3,sphere.positions,sphere.vertex_count);
+        vector_push_array(indices,u32,sphere.indices,sphere.index_count);
+        free(sphere.positions);
+        free(sphere.indices);
+    }
+    u32 triangle_count = indices.size / 3;
+
+    start = timer_now();
+    bvh_build_triangles(&bvh,NULL,positions.data,sizeof(vec3),indices.data,triangle_count);
+    serial_seconds = timer_now() - start;
+    bvh_free(&bvh);
+    start = timer_now();
+    bvh_build_triangles(&bvh,jobs,positions.data,sizeof(vec3),indices.data,triangle_count);
+    parallel_seconds = timer_now() - start;
+    printf("[BVH] %u triangles: build %.1f ms serial, %.1f ms on %u threads, %u nodes, depth %u, SAH cost %.1f\n",triangle_count,
+           serial_seconds * 1000.0,parallel_seconds * 1000.0,thread_count,bvh.node_count,bvh.depth,bvh_sah_cost(&bvh));
+
+    const u32 ray_count = 1 << 20;
+    vec3* origins = malloc(ray_count * sizeof(vec3));
+    vec3* directions = malloc(ray_count * sizeof(vec3));
+    for(u32 i = 0; i < ray_count; i++) {
+        // aim at the grid floor, a little off vertical so the rays cross the slabs at an angle
+        AABB target;
+        bench_random_box(&seed,side * 1.5f,0.0f,&target);
+        vec3 point = { target.min[0] + side * 1.5f - 1.5f, 0.0f, target.min[2] + side * 1.5f - 1.5f };
+        glm_vec3_copy((vec3){point[0] + 5.0f,10.0f,point[2] - 5.0f},origins[i]);
+        glm_vec3_sub(point,origins[i],directions[i]);
+        glm_vec3_normalize(directions[i]);
+    }
+
+    BenchTriangles triangles = { positions.data, indices.data };
+    u32 closest_hits = 0, any_hits = 0;
+    BVHHit hit;
+    start = timer_now();
+    for(u32 i = 0; i < ray_count; i++)
+        closest_hits += bvh_ray_closest(&bvh,origins[i],directions[i],FLT_MAX,bench_triangle_hit,&triangles,&hit);
+    f64 closest_seconds = timer_now() - start;
+    start = timer_now();
+    for(u32 i = 0; i < ray_count; i++)
+        any_hits += bvh_ray_any(&bvh,origins[i],directions[i],FLT_MAX,bench_triangle_hit,&triangles);
+    f64 any_seconds = timer_now() - start;
+    printf("[BVH] rays: closest hit %.2f Mrays/s, any hit %.2f Mrays/s, %.1f%% hit\n",ray_count / closest_seconds / 1e6,
+           ray_count / any_seconds / 1e6,100.0 * closest_hits / ray_count);
+    match &= closest_hits == any_hits;
+
+    for(u32 i = 0; i < 16; i++) {
+        f32 t = FLT_MAX;
+        for(u32 k = 0; k < triangle_count; k++)
+            bench_triangle_hit(&triangles,k,origins[i],directions[i],&t);
+        bool tree_hit = bvh_ray_closest(&bvh,origins[i],directions[i],FLT_MAX,bench_triangle_hit,&triangles,&hit);
+        match &= tree_hit == (t != FLT_MAX) && (!tree_hit || hit.t == t);
+    }
+    printf("[BVH] results %s the brute force queries\n",match ? "match" : "DIFFER from");
+
+    bvh_free(&bvh);
+    free(origins);
+    free(directions);
+    free(positions.data);
+    free(indices.data);
+    job_system_destroy(jobs);
+    arena_scratch_release();
+    return match ? 0 : 1;
+}
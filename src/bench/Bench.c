@@ -0,0 +1,56 @@
+#include "Bench.h"
+#include <cglm/cglm.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+void bench_sphere(u32 rings,u32 seed,BenchMesh* mesh) {
+    u32 segments = rings * 2;
+    mesh->vertex_count = (rings + 1) * (segments + 1);
+    mesh->index_count = rings * segments * 6;
+    mesh->positions = malloc(mesh->vertex_count * sizeof(vec3));
+    mesh->indices = malloc(mesh->index_count * sizeof(u32));
+
+    for(u32 r = 0; r <= rings; r++) {
+        f32 theta = GLM_PIf * r / rings;
+        for(u32 s = 0; s <= segments; s++) {
+            f32 phi = 2.0f * GLM_PIf * s / segments;
+            f32* p = mesh->positions[r * (segments + 1) + s];
+            p[0] = sinf(theta) * cosf(phi);
+            p[1] = cosf(theta);
+            p[2] = sinf(theta) * sinf(phi);
+        }
+    }
+
+    u32 written = 0;
+    for(u32 r = 0; r < rings; r++) {
+        for(u32 s = 0; s < segments; s++) {
+            u32 a = r * (segments + 1) + s, b = a + 1, c = a + segments + 1, d = c + 1;
+            u32 quad[6] = { a, c, b, b, c, d };
+            memcpy(mesh->indices + written,quad,sizeof(quad));
+            written += 6;
+        }
+    }
+
+    u32 state = seed * 747796405u + 2891336453u;
+    for(u32 t = mesh->index_count / 3 - 1; t > 0; t--) {
+        state = state * 1664525u + 1013904223u;
+        u32 other = state % (t + 1);
+        for(u32 k = 0; k < 3; k++) {
+            u32 tmp = mesh->indices[t * 3 + k];
+            mesh->indices[t * 3 + k] = mesh->indices[other * 3 + k];
+            mesh->indices[other * 3 + k] = tmp;
+        }
+    }
+}
+
+void bench_random_box(u32* seed,f32 range,f32 size,AABB* box) {
+    for(u32 axis = 0; axis < 3; axis++) {
+        *seed = *seed * 1664525u + 1013904223u;
+        f32 center = ((*seed >> 8) / 16777216.0f * 2.0f - 1.0f) * range;
+        *seed = *seed * 1664525u + 1013904223u;
+        f32 extent = size * (0.1f + (*seed >> 8) / 16777216.0f);
+        box->min[axis] = center - extent;
+        box->max[axis] = center + extent;
+    }
+}
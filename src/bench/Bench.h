@@ -0,0 +1,57 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include "Global.h"
+#include "Arena.h"
+#include "JobSystem.h"
+#include "Scene.h"
+#include "LightCluster.h"
+#include <cglm/types.h>
+#include <stdlib.h>
+
+// the argument at index after the mode flag as a number, fallback when it was not given
+#define bench_arg(argc,argv,index,fallback) ((argc) > (index) ? (u32)atoi((argv)[index]) : (u32)(fallback))
+
+// UV sphere with its triangles shuffled, the order a careless exporter could produce
+typedef struct {
+    vec3* positions;
+    u32* indices;
+    u32 vertex_count;
+    u32 index_count;
+}BenchMesh;
+
+void bench_sphere(u32 rings,u32 seed,BenchMesh* mesh);
+// centered within range of the origin on every axis, half extents between 0.1 and 1.1 times size
+void bench_random_box(u32* seed,f32 range,f32 size,AABB* box);
+
+// equirectangular synthetic sky of the SH bench, 0 with a broad warm lobe and 1 with a small bright sun
+f32* sh_bench_image(u32 sky,u32 width,u32 height);
+
+// defined by the renderer in main.c
+void scene_init(Scene* scene);
+void scene_data_destroy(Scene* scene_data);
+void load_scene_from_gltf(Arena* arena,JobSystem* jobs,const char* folder_path,const char* file_name,Scene* scene);
+void random_point_lights(u32* seed,const AABB* bounds,u32 count,PointLight* lights);
+
+// every mode takes the arguments after its flag and returns the process exit code
+int texture_decode_benchmark(int path_count,char** paths);
+int texture_compress_benchmark(int path_count,char** paths);
+int mip_benchmark(int argc,char** argv);
+int vertex_pack_benchmark(int argc,char** argv);
+int scene_cache_benchmark(int argc,char** argv);
+int mesh_optimize_benchmark(int argc,char** argv);
+int meshlet_benchmark(int argc,char** argv);
+int cull_benchmark(int argc,char** argv);
+int bvh_benchmark(int argc,char** argv);
+int raycast_benchmark(int argc,char** argv);
+int profile_benchmark(int argc,char** argv);
+int stream_benchmark(int argc,char** argv);
+int residency_benchmark(int argc,char** argv);
+int cascade_benchmark(int argc,char** argv);
+int shadow_cache_benchmark(int argc,char** argv);
+int cluster_benchmark(int argc,char** argv);
+int sh_benchmark(int argc,char** argv);
+int ibl_bake_file(int argc,char** argv);
+int ibl_bake_benchmark(int argc,char** argv);
+
+#endif
@@ -0,0 +1,79 @@
+#include "Bench.h"
+#include "Culling.h"
+#include "Timer.h"
+#include <cglm/cglm.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+int cull_benchmark(int argc,char** argv) {
+    u32 box_count = bench_arg(argc,argv,0,100000);
+    // boxes scattered around the camera so about a tenth of them survive
+    AABB* boxes = malloc((box_count + 1) * sizeof(AABB));
+    DrawElementsIndirectCommand* commands = malloc((box_count + 1) * sizeof(DrawElementsIndirectCommand));
+    u32* material_indices = malloc((box_count + 1) * sizeof(u32));
+    u32 seed = 0x9e3779b9u;
+    for(u32 i = 0; i < box_count; i++) {
+        vec3 center, extent;
+        for(u32 axis = 0; axis < 3; axis++) {
+            seed = seed * 1664525u + 1013904223u;
+            center[axis] = ((seed >> 8) / 16777216.0f * 2.0f - 1.0f) * 500.0f;
+            seed = seed * 1664525u + 1013904223u;
+            extent[axis] = 0.5f + (seed >> 8) / 16777216.0f * 4.0f;
+        }
+        glm_vec3_sub(center,extent,boxes[i].min);
+        glm_vec3_add(center,extent,boxes[i].max);
+        commands[i] = (DrawElementsIndirectCommand){ 36, 1, i * 36, 0, 0 };
+        material_indices[i] = i;
+    }
+
+    CullBounds bounds;
+    cull_bounds_build(&bounds,boxes,box_count);
+
+    mat4 view, proj, view_proj;
+    glm_lookat((vec3){0.0f,0.0f,0.0f},(vec3){1.0f,0.0f,-1.0f},(vec3){0.0f,1.0f,0.0f},view);
+    glm_perspective(glm_rad(60.0f),16.0f / 9.0f,0.1f,1000.0f,proj);
+    glm_mat4_mul(proj,view,view_proj);
+    Frustum frustum;
+    frustum_from_matrix(view_proj,&frustum);
+
+    u32* visible_scalar = malloc((box_count + 1) * sizeof(u32));
+    u32* visible = malloc((box_count + 1) * sizeof(u32));
+    DrawElementsIndirectCommand* out_commands = malloc((box_count + 1) * sizeof(DrawElementsIndirectCommand));
+    u32* out_material_indices = malloc((box_count + 1) * sizeof(u32));
+
+    const u32 iterations = 100;
+    u32 scalar_count = 0, simd_count = 0;
+    f64 start = timer_now();
+    for(u32 i = 0; i < iterations; i++)
+        scalar_count = frustum_cull_aabbs_scalar(&frustum,&bounds,visible_scalar);
+    f64 scalar_seconds = (timer_now() - start) / iterations;
+
+    start = timer_now();
+    for(u32 i = 0; i < iterations; i++)
+        simd_count = frustum_cull_aabbs(&frustum,&bounds,visible);
+    f64 simd_seconds = (timer_now() - start) / iterations;
+
+    start = timer_now();
+    for(u32 i = 0; i < iterations; i++)
+        cull_compact_commands(commands,material_indices,visible,simd_count,out_commands,out_material_indices);
+    f64 compact_seconds = (timer_now() - start) / iterations;
+
+    bool match = scalar_count == simd_count && memcmp(visible_scalar,visible,simd_count * sizeof(u32)) == 0;
+    printf("[CULL] %u boxes, %u visible (%.1f%%)\n",box_count,simd_count,100.0 * simd_count / (box_count ? box_count : 1));
+    printf("[CULL] scalar %.3f ms (%.2f ns/box)\n",scalar_seconds * 1000.0,scalar_seconds * 1e9 / (box_count ? box_count : 1));
+    printf("[CULL] %s %.3f ms (%.2f ns/box), %.2fx, results %s\n",frustum_cull_isa(),simd_seconds * 1000.0,
+           simd_seconds * 1e9 / (box_count ? box_count : 1),scalar_seconds / (simd_seconds > 0.0 ? simd_seconds : 1e-9),
+           match ? "match" : "DIFFER");
+    printf("[CULL] compaction %.3f ms\n",compact_seconds * 1000.0);
+
+    cull_bounds_free(&bounds);
+    free(boxes);
+    free(commands);
+    free(material_indices);
+    free(visible_scalar);
+    free(visible);
+    free(out_commands);
+    free(out_material_indices);
+    return match ? 0 : 1;
+}
@@ -0,0 +1,187 @@
+#include "Bench.h"
+#include "IBLBaker.h"
+#include "IBLCache.h"
+#include "Timer.h"
+#include "VertexPacking.h"
+#include "stb_image.h"
+#include <cglm/cglm.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+// IntegrateBRDF of brdf_fs.glsl as written, to check the baker's vectorised loop against
+static void ibl_bench_brdf_reference(f32 n_dot_v,f32 roughness,f32* ab) {
+    vec3 v = { sqrtf(1.0f - n_dot_v * n_dot_v), 0.0f, n_dot_v };
+    f32 a = roughness * roughness, k = roughness * roughness * 0.5f;
+    ab[0] = ab[1] = 0.0f;
+    for(u32 i = 0; i < IBL_BAKE_BRDF_SAMPLES; i++) {
+        u32 bits = i;
+        bits = (bits << 16u) | (bits >> 16u);
+        bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+        bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+        bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+        bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+        f32 xi = bits * 2.3283064365386963e-10f;
+        f32 phi = 2.0f * GLM_PIf * i / IBL_BAKE_BRDF_SAMPLES;
+        f32 cos_theta = sqrtf((1.0f - xi) / (1.0f + (a * a - 1.0f) * xi));
+        f32 sin_theta = sqrtf(1.0f - cos_theta * cos_theta);
+        vec3 h = { cosf(phi) * sin_theta, sinf(phi) * sin_theta, cos_theta }, l;
+        glm_vec3_scale(h,2.0f * glm_vec3_dot(v,h),l);
+        glm_vec3_sub(l,v,l);
+        f32 n_dot_l = fmaxf(l[2],0.0f), n_dot_h = fmaxf(h[2],0.0f), v_dot_h = fmaxf(glm_vec3_dot(v,h),0.0f);
+        if(n_dot_l > 0.0f) {
+            f32 g = n_dot_v / (n_dot_v * (1.0f - k) + k) * n_dot_l / (n_dot_l * (1.0f - k) + k);
+            f32 g_vis = g * v_dot_h / (n_dot_h * n_dot_v);
+            f32 fc = powf(1.0f - v_dot_h,5.0f);
+            ab[0] += (1.0f - fc) * g_vis;
+            ab[1] += fc * g_vis;
+        }
+    }
+    ab[0] /= IBL_BAKE_BRDF_SAMPLES;
+    ab[1] /= IBL_BAKE_BRDF_SAMPLES;
+}
+
+// largest difference of an image's texels from value, over the first channels
+static f32 ibl_bench_deviation(const IBLImage* image,u32 channels,f32 value) {
+    f32 deviation = 0.0f;
+    u64 count = ibl_image_size(image) / sizeof(u16);
+    for(u64 i = 0; i < count; i++)
+        if(i % image->channels < channels)
+            deviation = fmaxf(deviation,fabsf(half_to_float(image->data[i]) - value));
+    return deviation;
+}
+
+static bool ibl_bench_same(const IBLBake* a,const IBLBake* b) {
+    for(u32 i = 0; i < IBL_TEXTURE_COUNT; i++)
+        if(memcmp(a->images[i].data,b->images[i].data,ibl_image_size(&a->images[i])) != 0)
+            return false;
+    return memcmp(&a->irradiance_sh,&b->irradiance_sh,sizeof(SH9)) == 0;
+}
+
+// bakes an image on 1, 2, 4... threads up to every core, checking every thread count bakes the same bits, that a
+// uniform environment prefilters to itself and that the LUT matches brdf_fs.glsl
+int ibl_bake_benchmark(int argc,char** argv) {
+    const char* hdr_path = argc > 0 ? argv[0] : NULL;
+    u32 width = 1024, height = 512, channels = 3;
+    f32* pixels = NULL;
+    if(hdr_path) {
+        stbi_set_flip_vertically_on_load(true);
+        int w, h, c;
+        pixels = stbi_loadf(hdr_path,&w,&h,&c,0);
+        stbi_set_flip_vertically_on_load(false);
+        if(!pixels) {
+            fprintf(stderr,"[IBL] Failed to load \"%s\"\n",hdr_path);
+            return 1;
+        }
+        width = w;
+        height = h;
+        channels = c;
+    } else {
+        pixels = sh_bench_image(1,width,height);
+    }
+
+    u32 errors = 0;
+    u32 cores = job_system_core_count();
+    IBLBake reference = {0};
+    f64 reference_seconds = 0.0;
+    for(u32 threads = 1; ; threads = threads * 2 < cores ? threads * 2 : cores) {
+        JobSystem* jobs = threads > 1 ? job_system_create(threads - 1) : NULL;
+        IBLBake bake;
+        IBLBakeStats stats;
+        f64 start = timer_now();
+        ibl_bake(jobs,pixels,width,height,channels,&bake,&stats);
+        f64 seconds = timer_now() - start;
+        bool same = true;
+        if(threads == 1) {
+            reference = bake;
+            reference_seconds = seconds;
+        } else {
+            same = ibl_bench_same(&reference,&bake);
+            ibl_bake_free(&bake);
+        }
+        errors += !same;
+        printf("[IBL] %u threads: %.1f ms (env %.1f, prefilter %.1f, BRDF LUT %.1f, SH %.1f), %.2fx, result %s\n",threads,seconds * 1000.0,
+               stats.env_seconds * 1000.0,stats.prefilter_seconds * 1000.0,stats.brdf_seconds * 1000.0,stats.sh_seconds * 1000.0,
+               reference_seconds / seconds,same ? "matches 1 thread" : "DIFFERS");
+        if(jobs)
+            job_system_destroy(jobs);
+        if(threads >= cores)
+            break;
+    }
+
+    f32 brdf_error = 0.0f;
+    for(u32 i = 0; i < 64; i++) {
+        u32 x = (i * 37 + 5) % IBL_BAKE_BRDF_SIZE, y = (i * 71 + 3) % IBL_BAKE_BRDF_SIZE;
+        vec2 expected;
+        ibl_bench_brdf_reference((x + 0.5f) / IBL_BAKE_BRDF_SIZE,(y + 0.5f) / IBL_BAKE_BRDF_SIZE,expected);
+        const u16* texel = reference.images[2].data + ((u64)y * IBL_BAKE_BRDF_SIZE + x) * 2;
+        brdf_error = fmaxf(brdf_error,fmaxf(fabsf(half_to_float(texel[0]) - expected[0]),fabsf(half_to_float(texel[1]) - expected[1])));
+    }
+    ibl_bake_free(&reference);
+    free(pixels);
+
+    // a uniform sky comes out of every pass unchanged
+    u32 grey_width = 256, grey_height = 128;
+    f32* grey = malloc((u64)grey_width * grey_height * 3 * sizeof(f32));
+    for(u32 i = 0; i < grey_width * grey_height * 3; i++)
+        grey[i] = 1.0f;
+    IBLBake uniform;
+    IBLBakeStats stats;
+    ibl_bake(NULL,grey,grey_width,grey_height,3,&uniform,&stats);
+    vec3 up = { 0.0f, 1.0f, 0.0f }, irradiance;
+    sh9_evaluate(&uniform.irradiance_sh,up,irradiance);
+    f32 env_error = ibl_bench_deviation(&uniform.images[0],3,1.0f);
+    f32 prefilter_error = ibl_bench_deviation(&uniform.images[1],3,1.0f);
+    f32 sh_error = fabsf(irradiance[0] - 1.0f);
+    ibl_bake_free(&uniform);
+    free(grey);
+
+    errors += brdf_error > 2e-3f || env_error > 1e-3f || prefilter_error > 1e-3f || sh_error > 1e-3f;
+    printf("[IBL] BRDF LUT off brdf_fs.glsl by %.1e, uniform sky off by %.1e env, %.1e prefilter, %.1e irradiance\n",brdf_error,env_error,
+           prefilter_error,sh_error);
+    printf("[IBL] %u errors\n",errors);
+    return errors ? 1 : 0;
+}
+
+// bakes without a GL context into the file the renderer loads instead of baking, by default next to the image
+int ibl_bake_file(int argc,char** argv) {
+    if(argc < 1) {
+        fprintf(stderr,"[IBL] --ibl-bake needs an image\n");
+        return 1;
+    }
+    const char* hdr_path = argv[0];
+    const char* output_path = argc > 1 ? argv[1] : NULL;
+    char default_path[1024];
+    if(!output_path) {
+        snprintf(default_path,sizeof(default_path),"%s" IBL_CACHE_EXTENSION,hdr_path);
+        output_path = default_path;
+    }
+    IBLCacheKey key;
+    stbi_set_flip_vertically_on_load(true);
+    int width, height, channels;
+    f32* pixels = stbi_loadf(hdr_path,&width,&height,&channels,0);
+    stbi_set_flip_vertically_on_load(false);
+    if(!pixels || !ibl_cache_key(hdr_path,NULL,0,&key)) {
+        fprintf(stderr,"[IBL] Failed to load \"%s\"\n",hdr_path);
+        stbi_image_free(pixels);
+        return 1;
+    }
+    key.shader_hash = IBL_CACHE_CPU_BAKE;
+
+    JobSystem* jobs = job_system_create(0);
+    IBLBake bake;
+    IBLBakeStats stats;
+    f64 start = timer_now();
+    ibl_bake(jobs,pixels,width,height,channels,&bake,&stats);
+    bool ok = ibl_cache_write_images(output_path,&key,bake.images,&bake.irradiance_sh);
+    printf("[IBL] Baked \"%s\" on %u threads in %.1f ms (env %.1f, prefilter %.1f, BRDF LUT %.1f, SH %.1f)\n",hdr_path,
+           job_system_thread_count(jobs),(timer_now() - start) * 1000.0,stats.env_seconds * 1000.0,stats.prefilter_seconds * 1000.0,
+           stats.brdf_seconds * 1000.0,stats.sh_seconds * 1000.0);
+    if(!ok)
+        fprintf(stderr,"[IBL] Failed to write \"%s\"\n",output_path);
+    ibl_bake_free(&bake);
+    job_system_destroy(jobs);
+    stbi_image_free(pixels);
+    return ok ? 0 : 1;
+}
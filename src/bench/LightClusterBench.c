@@ -0,0 +1,122 @@
+#include "Bench.h"
+#include "LightCluster.h"
+#include "Timer.h"
+#include <cglm/cglm.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+typedef struct {
+    u32 light_count;
+    f64 serial_seconds;
+    f64 parallel_seconds;
+    u32 index_count;
+    u32 max_cluster;
+    u32 misses;
+    bool match;
+}ClusterBenchResult;
+
+// the froxel the shader picks for a view space point in front of the camera, false when it is off screen
+static bool cluster_bench_froxel(const ClusterView* view,const f32* p,u32* cluster) {
+    f32 depth = -p[2];
+    if(depth <= 0.0f)
+        return false;
+    f32 ndc_x = p[0] / (depth * view->tan_half_fov_y * view->aspect);
+    f32 ndc_y = p[1] / (depth * view->tan_half_fov_y);
+    if(fabsf(ndc_x) >= 1.0f || fabsf(ndc_y) >= 1.0f)
+        return false;
+    u32 x = (u32)((ndc_x * 0.5f + 0.5f) * CLUSTER_X);
+    u32 y = (u32)((ndc_y * 0.5f + 0.5f) * CLUSTER_Y);
+    x = x < CLUSTER_X ? x : CLUSTER_X - 1;
+    y = y < CLUSTER_Y ? y : CLUSTER_Y - 1;
+    f32 slice = floorf(logf(depth / view->z_near) * CLUSTER_Z / logf(view->z_far / view->z_near));
+    u32 z = (u32)glm_clamp(slice,0.0f,CLUSTER_Z - 1.0f);
+    *cluster = light_cluster_index(x,y,z);
+    return true;
+}
+
+static ClusterBenchResult cluster_benchmark_run(JobSystem* jobs,u32 light_count) {
+    ClusterBenchResult result = { light_count };
+    PointLight* lights = malloc((light_count + 1) * sizeof(PointLight));
+    u32 seed = 0x2545f491u;
+    AABB bounds = { { -60.0f, -20.0f, -110.0f }, { 60.0f, 20.0f, 10.0f } };
+    random_point_lights(&seed,&bounds,light_count,lights);
+
+    ClusterView view = { .tan_half_fov_y = tanf(glm_rad(30.0f)), .aspect = 16.0f / 9.0f, .z_near = LIGHT_CLUSTER_NEAR, .z_far = LIGHT_CLUSTER_FAR };
+    glm_lookat((vec3){0.0f,0.0f,0.0f},(vec3){0.1f,-0.05f,-1.0f},(vec3){0.0f,1.0f,0.0f},view.view);
+
+    LightClusterGrid serial, parallel;
+    light_cluster_grid_init(&serial);
+    light_cluster_grid_init(&parallel);
+    u32 iterations = 1000000 / (light_count ? light_count : 1);
+    iterations = iterations < 4 ? 4 : iterations > 256 ? 256 : iterations;
+    f64 start = timer_now();
+    for(u32 i = 0; i < iterations; i++)
+        light_cluster_build(&serial,NULL,lights,light_count,&view);
+    result.serial_seconds = (timer_now() - start) / iterations;
+    start = timer_now();
+    for(u32 i = 0; i < iterations; i++)
+        light_cluster_build(&parallel,jobs,lights,light_count,&view);
+    result.parallel_seconds = (timer_now() - start) / iterations;
+
+    result.index_count = parallel.index_count;
+    result.match = serial.index_count == parallel.index_count && memcmp(serial.clusters,parallel.clusters,sizeof(serial.clusters)) == 0 &&
+                   memcmp(serial.indices,parallel.indices,serial.index_count * sizeof(u32)) == 0;
+    for(u32 i = 0; i < CLUSTER_COUNT; i++)
+        result.max_cluster = parallel.clusters[i].count > result.max_cluster ? parallel.clusters[i].count : result.max_cluster;
+
+    // points inside a light's range must find the light in their froxel
+    const u32 sample_count = 200000;
+    for(u32 s = 0; s < sample_count && light_count; s++) {
+        seed = seed * 1664525u + 1013904223u;
+        const PointLight* light = &lights[(seed >> 8) % light_count];
+        vec3 offset;
+        do {
+            for(u32 axis = 0; axis < 3; axis++) {
+                seed = seed * 1664525u + 1013904223u;
+                offset[axis] = (seed >> 8) / 16777216.0f * 2.0f - 1.0f;
+            }
+        } while(glm_vec3_dot(offset,offset) > 1.0f);
+        vec4 world = { 0.0f, 0.0f, 0.0f, 1.0f }, p;
+        glm_vec3_muladds(offset,light->attenuation_factors[3],world);
+        glm_vec3_add(world,(f32*)light->pos,world);
+        glm_mat4_mulv(view.view,world,p);
+
+        u32 cluster;
+        if(!cluster_bench_froxel(&view,p,&cluster))
+            continue;
+        u32 index = light - lights;
+        const LightCluster* froxel = &parallel.clusters[cluster];
+        bool found = false;
+        for(u32 i = 0; i < froxel->count && !found; i++)
+            found = parallel.indices[froxel->offset + i] == index;
+        result.misses += !found;
+    }
+
+    light_cluster_grid_free(&serial);
+    light_cluster_grid_free(&parallel);
+    free(lights);
+    return result;
+}
+
+int cluster_benchmark(int argc,char** argv) {
+    u32 light_count = bench_arg(argc,argv,0,0);
+    JobSystem* jobs = job_system_create(0);
+    u32 counts[] = { 1000, 10000, 100000 };
+    u32 count_total = light_count ? 1 : sizeof(counts) / sizeof(counts[0]);
+    if(light_count)
+        counts[0] = light_count;
+
+    bool passed = true;
+    printf("[CLUSTER] %ux%ux%u froxels, %s depth tests\n",CLUSTER_X,CLUSTER_Y,CLUSTER_Z,light_cluster_isa());
+    for(u32 i = 0; i < count_total; i++) {
+        ClusterBenchResult result = cluster_benchmark_run(jobs,counts[i]);
+        printf("[CLUSTER] %u lights: %.3f ms serial, %.3f ms on %u threads, %u indices (max %u per froxel), results %s, %u misses\n",
+               result.light_count,result.serial_seconds * 1000.0,result.parallel_seconds * 1000.0,job_system_thread_count(jobs),
+               result.index_count,result.max_cluster,result.match ? "match" : "DIFFER",result.misses);
+        passed &= result.match && result.misses == 0;
+    }
+    job_system_destroy(jobs);
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,179 @@
+#include "Bench.h"
+#include "MeshOptimizer.h"
+#include "Meshlet.h"
+#include "Timer.h"
+#include <cglm/cglm.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <string.h>
+
+typedef struct {
+    BenchMesh mesh;
+    MeshCacheStats before;
+    MeshCacheStats after;
+}MeshBenchPrimitive;
+
+static void mesh_bench_job(void* data,u32 begin,u32 end) {
+    MeshBenchPrimitive* primitives = (MeshBenchPrimitive*)data;
+    for(u32 i = begin; i < end; i++)
+        mesh_optimize(primitives[i].mesh.indices,primitives[i].mesh.index_count,primitives[i].mesh.positions,primitives[i].mesh.vertex_count,
+                      sizeof(vec3),0,true,arena_scratch(),&primitives[i].before,&primitives[i].after);
+}
+
+// two overlapping primitives after an unwelded vertex: A repeats its first corner, B shares A's edge 1-2
+// bit for bit and adds a corner one ulp off A's third, which must stay its own vertex
+static bool weld_self_check(void) {
+    static const f32 positions[10][3] = {
+        { 9.0f, 9.0f, 9.0f },
+        { 0.0f, 0.0f, 0.0f }, { 1.0f, 0.0f, 0.0f }, { 1.0f, 1.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }, { 0.0f, 0.0f, 0.0f },
+        { 1.0f, 0.0f, 0.0f }, { 2.0f, 0.0f, 0.0f }, { 1.0f, 1.0f, 0.0f }, { 1.0f, 1.0f, 0.0f },
+    };
+    static const u32 indices[12] = { 0, 1, 2, 4, 2, 3,   0, 1, 2, 0, 3, 2 };
+    static const u32 welded_indices[12] = { 0, 1, 2, 0, 2, 3,   0, 3, 1, 0, 4, 1 };
+
+    Scene scene;
+    scene_init(&scene);
+    Vertex original[10];
+    memset(original,0,sizeof(original));
+    for(u32 v = 0; v < 10; v++) {
+        memcpy(original[v].position,positions[v],sizeof(vec3));
+        original[v].normal[2] = 1.0f;
+    }
+    original[9].position[0] = nextafterf(1.0f,2.0f);
+    vector_push_array(scene.vertex_vector,Vertex,original,10);
+    vector_push_array(scene.index_vector,u32,indices,12);
+    DrawElementsIndirectCommand a = { 6, 1, 0, 1, 0 };
+    DrawElementsIndirectCommand b = { 6, 1, 6, 6, 0 };
+    vector_push(scene.culled_backface_indirect_command_vector,DrawElementsIndirectCommand,a);
+    vector_push(scene.non_culled_backface_indirect_command_vector,DrawElementsIndirectCommand,b);
+
+    MeshWeldStats stats;
+    scene_weld_vertices(&scene,1,0,0,arena_scratch(),&stats);
+
+    DrawElementsIndirectCommand* welded[2] = { scene.culled_backface_indirect_command_vector.data,
+                                               scene.non_culled_backface_indirect_command_vector.data };
+    const DrawElementsIndirectCommand* commands[2] = { &a, &b };
+    bool passed = stats.vertex_count_before == 9 && stats.vertex_count_after == 6 && scene.vertex_vector.size == 7 &&
+                  welded[0]->baseVertex == 1 && welded[1]->baseVertex == 2 &&
+                  memcmp(&scene.vertex_vector.data[0],&original[0],sizeof(Vertex)) == 0 &&
+                  memcmp(scene.index_vector.data,welded_indices,sizeof(welded_indices)) == 0;
+    // every index still reaches a vertex identical to the one it drew before the weld
+    for(u32 c = 0; c < 2 && passed; c++) {
+        for(u32 i = 0; i < 6 && passed; i++) {
+            u32 before = commands[c]->baseVertex + indices[commands[c]->firstIndex + i];
+            u32 after = welded[c]->baseVertex + scene.index_vector.data[commands[c]->firstIndex + i];
+            passed = after < scene.vertex_vector.size && memcmp(&scene.vertex_vector.data[after],&original[before],sizeof(Vertex)) == 0;
+        }
+    }
+    printf("[MESHOPT] weld %u -> %u verticies: %s\n",stats.vertex_count_before,stats.vertex_count_after,passed ? "ok" : "FAILED");
+
+    scene_data_destroy(&scene);
+    return passed;
+}
+
+// CPU only, no window or GL context: optimizes shuffled spheres serially and once on every core
+int mesh_optimize_benchmark(int argc,char** argv) {
+    u32 rings = bench_arg(argc,argv,0,128);
+    u32 primitive_count = bench_arg(argc,argv,1,64);
+    MeshBenchPrimitive* primitives = calloc(primitive_count,sizeof(MeshBenchPrimitive));
+    JobSystem* jobs = job_system_create(0);
+
+    for(u32 pass = 0; pass < 2; pass++) {
+        for(u32 i = 0; i < primitive_count; i++)
+            bench_sphere(rings,i,&primitives[i].mesh);
+
+        JobSystem* pass_jobs = pass ? jobs : NULL;
+        f64 start = timer_now();
+        job_system_parallel_for(pass_jobs,primitive_count,1,mesh_bench_job,primitives);
+        f64 seconds = timer_now() - start;
+
+        u64 triangles = 0;
+        f64 acmr_before = 0.0, acmr_after = 0.0, atvr_before = 0.0, atvr_after = 0.0;
+        for(u32 i = 0; i < primitive_count; i++) {
+            acmr_before += primitives[i].before.acmr / primitive_count;
+            acmr_after  += primitives[i].after.acmr / primitive_count;
+            atvr_before += primitives[i].before.atvr / primitive_count;
+            atvr_after  += primitives[i].after.atvr / primitive_count;
+            triangles   += primitives[i].mesh.index_count / 3;
+            free(primitives[i].mesh.positions);
+            free(primitives[i].mesh.indices);
+        }
+        printf("[MESHOPT] %u primitives, %llu tris on %u threads in %.3f ms (%.2f Mtris/s)\n",primitive_count,
+               (unsigned long long)triangles,job_system_thread_count(pass_jobs),seconds * 1000.0,triangles / (seconds > 0.0 ? seconds : 1e-9) / 1e6);
+        printf("[MESHOPT] ACMR %.3f -> %.3f, ATVR %.3f -> %.3f (FIFO %u)\n",acmr_before,acmr_after,atvr_before,atvr_after,MESH_OPTIMIZER_CACHE_SIZE);
+    }
+
+    bool passed = weld_self_check();
+
+    job_system_destroy(jobs);
+    arena_scratch_release();
+    free(primitives);
+    return passed ? 0 : 1;
+}
+
+// CPU only, no window or GL context: a grid of optimized spheres split into meshlets and culled from its corner
+int meshlet_benchmark(int argc,char** argv) {
+    u32 rings = bench_arg(argc,argv,0,64);
+    u32 sphere_count = bench_arg(argc,argv,1,256);
+    Scene scene = {0};
+    scene_init(&scene);
+    JobSystem* jobs = job_system_create(0);
+
+    u32 side = (u32)ceilf(sqrtf((f32)sphere_count));
+    for(u32 i = 0; i < sphere_count; i++) {
+        BenchMesh sphere;
+        bench_sphere(rings,i,&sphere);
+        mesh_optimize(sphere.indices,sphere.index_count,sphere.positions,sphere.vertex_count,sizeof(vec3),0,false,
+                      arena_scratch(),NULL,NULL);
+
+        DrawElementsIndirectCommand command = { sphere.index_count, 1, scene.index_vector.size, scene.vertex_vector.size, 0 };
+        vec3 offset = { (i % side) * 3.0f, 0.0f, (i / side) * -3.0f };
+        for(u32 v = 0; v < sphere.vertex_count; v++) {
+            Vertex vertex = {0};
+            glm_vec3_add(sphere.positions[v],offset,vertex.position);
+            vector_push(scene.vertex_vector,Vertex,vertex);
+        }
+        vector_push_array(scene.index_vector,u32,sphere.indices,sphere.index_count);
+        u32 material_index = 0;
+        vector_push(scene.culled_backface_indirect_command_vector,DrawElementsIndirectCommand,command);
+        vector_push(scene.culled_command_material_index_vector,u32,material_index);
+        free(sphere.positions);
+        free(sphere.indices);
+    }
+
+    MeshletBuildStats build;
+    scene_build_meshlets(jobs,&scene,0,0,&build);
+    meshlet_build_stats_print(&build,"bench");
+
+    vec3 eye = { -3.0f, 3.0f, 3.0f };
+    vec3 target = { side * 1.5f, 0.0f, side * -1.5f };
+    mat4 view, proj, view_proj;
+    glm_lookat(eye,target,(vec3){0.0f,1.0f,0.0f},view);
+    glm_perspective(glm_rad(60.0f),16.0f / 9.0f,0.1f,1000.0f,proj);
+    glm_mat4_mul(proj,view,view_proj);
+
+    MeshletCullView cull_view;
+    meshlet_cull_view(view_proj,eye,&cull_view);
+    u32 meshlet_count = scene.meshlet_vector.size;
+    MeshletDrawList culled = { malloc((meshlet_count + 1) * sizeof(DrawElementsIndirectCommand)), malloc((meshlet_count + 1) * sizeof(u32)), 0 };
+    MeshletDrawList non_culled = { malloc((meshlet_count + 1) * sizeof(DrawElementsIndirectCommand)), malloc((meshlet_count + 1) * sizeof(u32)), 0 };
+
+    const u32 iterations = 100;
+    MeshletCullStats cull;
+    f64 start = timer_now();
+    for(u32 i = 0; i < iterations; i++)
+        scene_cull_meshlets(&scene,&cull_view,NULL,NULL,&culled,&non_culled,&cull);
+    f64 seconds = (timer_now() - start) / iterations;
+    meshlet_cull_stats_print(&cull);
+    printf("[MESHLET] cull %.3f ms, %.2f Mmeshlets/s\n",seconds * 1000.0,meshlet_count / (seconds > 0.0 ? seconds : 1e-9) / 1e6);
+
+    free(culled.commands);
+    free(culled.material_indices);
+    free(non_culled.commands);
+    free(non_culled.material_indices);
+    scene_data_destroy(&scene);
+    job_system_destroy(jobs);
+    arena_scratch_release();
+    return 0;
+}
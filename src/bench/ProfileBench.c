@@ -0,0 +1,52 @@
+#include "Bench.h"
+#include "Profiler.h"
+#include "Timer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// the CPU half of the profiler needs no GL context, so this runs anywhere: it measures the cost of a zone,
+// checks the ring keeps the newest zones in order and writes a trace of nested zones
+int profile_benchmark(int argc,char** argv) {
+    u32 frame_count = bench_arg(argc,argv,0,100000);
+    Profiler* profiler = profiler_create(false);
+
+    const u32 zones_per_frame = 6;
+    f64 start = timer_now();
+    for(u32 frame = 0; frame < frame_count; frame++) {
+        PROFILE_ZONE(profiler,"frame") {
+            PROFILE_ZONE(profiler,"cull") {}
+            PROFILE_ZONE(profiler,"shadow") {
+                PROFILE_ZONE(profiler,"draw") {}
+            }
+            PROFILE_BEGIN(profiler,"main");
+            PROFILE_BEGIN(profiler,"draw");
+            PROFILE_END(profiler);
+            PROFILE_END(profiler);
+        }
+        profiler_frame(profiler);
+    }
+    f64 seconds = timer_now() - start;
+    u32 zone_total = frame_count * zones_per_frame;
+
+    ProfileZone* zones = malloc(PROFILER_RING_SIZE * sizeof(ProfileZone));
+    u32 count = profiler_zones(profiler,zones);
+    u32 errors = 0;
+    for(u32 i = 0; i < count; i++) {
+        if(zones[i].end < zones[i].start || (i && zones[i].start < zones[i - 1].start))
+            ++errors;
+        if(strcmp(zones[i].name,"frame") == 0 && zones[i].depth != 0)
+            ++errors;
+    }
+    if(count != (zone_total < PROFILER_RING_SIZE ? zone_total : PROFILER_RING_SIZE))
+        ++errors;
+
+    printf("[PROFILE] %u zones over %u frames, %.1f ns per zone, %u kept, %u errors\n",zone_total,frame_count,
+           seconds * 1e9 / zone_total,count,errors);
+    profiler_print_summary(profiler);
+    profiler_write_chrome_trace(profiler,"profile_bench_trace.json");
+
+    free(zones);
+    profiler_destroy(profiler);
+    return errors ? 1 : 0;
+}
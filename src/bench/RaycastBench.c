@@ -0,0 +1,105 @@
+#include "Bench.h"
+#include "Camera.h"
+#include "Raycast.h"
+#include "Simd.h"
+#include "Timer.h"
+#include <cglm/cglm.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+// primary rays of a width x height image, pixel order inside 2x2 tiles so every packet covers one tile
+static void raycast_bench_camera_rays(Camera* camera,mat4 proj,u32 width,u32 height,Ray* rays) {
+    u32 ray = 0;
+    for(u32 y = 0; y < height; y += 2)
+        for(u32 x = 0; x < width; x += 2)
+            for(u32 k = 0; k < 4; k++)
+                ray_from_screen(camera,proj,x + (k & 1) + 0.5f,y + (k >> 1) + 0.5f,(f32)width,(f32)height,&rays[ray++]);
+}
+
+int raycast_benchmark(int argc,char** argv) {
+    u32 view_count = bench_arg(argc,argv,0,4);
+    Arena arena;
+    arena_create(&arena,MB(16));
+    JobSystem* jobs = job_system_create(0);
+
+    Scene scene;
+    scene_init(&scene);
+    scene.import_flags = SCENE_IMPORT_PACKED_VERTICES | SCENE_IMPORT_OPTIMIZE_MESHES | SCENE_IMPORT_WELD_VERTICES |
+                         SCENE_IMPORT_BUILD_MESHLETS | SCENE_IMPORT_SKIP_TEXTURES;
+    load_scene_from_gltf(&arena,jobs,asset_path("city"),"scene.gltf",&scene);
+
+    SceneRaycaster raycaster;
+    f64 start = timer_now();
+    scene_raycaster_build(&raycaster,jobs,&scene);
+    printf("[RAYCAST] %u triangles in %u primitives: BVH build %.1f ms, %u nodes, depth %u, SAH cost %.1f\n",
+           raycaster.triangle_count,raycaster.primitive_count,(timer_now() - start) * 1000.0,raycaster.bvh.node_count,
+           raycaster.bvh.depth,bvh_sah_cost(&raycaster.bvh));
+
+    // cameras on a circle around the scene looking at its centre, the same views as a 1280x720 render
+    const u32 width = 1280, height = 720;
+    u32 ray_count = width * height * view_count;
+    Ray* rays = malloc((ray_count + 1) * sizeof(Ray));
+    RayHit* hits = malloc((ray_count + 1) * sizeof(RayHit));
+    RayHit* packet_hits = malloc((ray_count + 1) * sizeof(RayHit));
+    vec3 center, extent;
+    glm_vec3_center(scene.aabb.min,scene.aabb.max,center);
+    glm_vec3_sub(scene.aabb.max,scene.aabb.min,extent);
+    f32 radius = glm_vec3_norm(extent) * 0.5f;
+    mat4 proj;
+    glm_perspective(glm_rad(90.0f),(f32)width / height,0.01f,radius * 4.0f,proj);
+    for(u32 i = 0; i < view_count; i++) {
+        Camera camera;
+        cameraDefaultInit(&camera);
+        f32 angle = 2.0f * GLM_PIf * i / view_count;
+        glm_vec3_copy((vec3){center[0] + cosf(angle) * radius,center[1] + radius * 0.5f,center[2] + sinf(angle) * radius},camera.pos);
+        glm_vec3_sub(center,camera.pos,camera.front);
+        glm_vec3_normalize(camera.front);
+        raycast_bench_camera_rays(&camera,proj,width,height,rays + i * width * height);
+    }
+
+    start = timer_now();
+    u32 hit_count = 0;
+    for(u32 i = 0; i < ray_count; i++)
+        hit_count += scene_raycast(&raycaster,&rays[i],&hits[i]);
+    f64 scalar_seconds = timer_now() - start;
+
+    start = timer_now();
+    for(u32 i = 0; i + RAYCAST_PACKET_SIZE <= ray_count; i += RAYCAST_PACKET_SIZE)
+        scene_raycast_packet(&raycaster,rays + i,packet_hits + i);
+    f64 packet_seconds = timer_now() - start;
+
+    u32 mismatches = 0;
+    for(u32 i = 0; i < ray_count; i++)
+        mismatches += hits[i].hit != packet_hits[i].hit || (hits[i].hit && (hits[i].primitive != packet_hits[i].primitive ||
+                      hits[i].triangle != packet_hits[i].triangle || hits[i].t != packet_hits[i].t));
+
+    start = timer_now();
+    scene_raycast_batch(&raycaster,jobs,rays,ray_count,packet_hits);
+    f64 batch_seconds = timer_now() - start;
+
+    start = timer_now();
+    u32 occluded = 0;
+    for(u32 i = 0; i < ray_count; i++)
+        occluded += scene_raycast_any(&raycaster,&rays[i]);
+    f64 any_seconds = timer_now() - start;
+
+    printf("[RAYCAST] %u primary rays over %u views, %.1f%% hit\n",ray_count,view_count,100.0 * hit_count / ray_count);
+    printf("[RAYCAST] single %.2f Mrays/s, any hit %.2f Mrays/s\n",ray_count / scalar_seconds / 1e6,ray_count / any_seconds / 1e6);
+#if defined(SIMD_SSE)
+    const char* packet_isa = "SSE";
+#else
+    const char* packet_isa = "scalar";
+#endif
+    printf("[RAYCAST] %s packets of %u %.2f Mrays/s, %u threads %.2f Mrays/s, %u mismatches against single rays\n",packet_isa,
+           RAYCAST_PACKET_SIZE,ray_count / packet_seconds / 1e6,job_system_thread_count(jobs),ray_count / batch_seconds / 1e6,mismatches);
+    bool match = mismatches == 0 && occluded == hit_count;
+
+    scene_raycaster_free(&raycaster);
+    free(rays);
+    free(hits);
+    free(packet_hits);
+    job_system_destroy(jobs);
+    arena_free(&arena);
+    return match ? 0 : 1;
+}
@@ -0,0 +1,168 @@
+#include "Bench.h"
+#include "TextureLoader.h"
+#include "TextureResidency.h"
+#include "StreamBuffer.h"
+#include "Timer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    const char* name;
+    u32 working_set; // textures a frame touches
+    u32 step;        // how far the working set moves every move_every frames
+    u32 move_every;
+    bool random;     // a random working_set of a window twice that size, instead of a contiguous run
+}ResidencyTrace;
+
+// BC7 sized chain of a square texture and of its fallback tail
+static void residency_bench_chain(u32 side,u64* size,u64* fallback_size) {
+    u32 mip_count = texture_mip_count(side,side);
+    u32 fallback = residency_fallback_level(side,side,mip_count);
+    *size = *fallback_size = 0;
+    for(u32 mip = 0; mip < mip_count; mip++) {
+        u32 blocks = ((side >> mip) + 3) / 4;
+        u64 bytes = (u64)(blocks ? blocks : 1) * (blocks ? blocks : 1) * 16;
+        *size += bytes;
+        if(mip >= fallback)
+            *fallback_size += bytes;
+    }
+}
+
+// drives the policy with simulated camera traces over a texture set four times the budget and checks, every frame,
+// that touched textures keep their chain, the budget holds whenever the frame's textures fit, chains are released
+// only once the GPU is done with every frame that drew them and the LRU matches the entry states
+int residency_benchmark(int argc,char** argv) {
+    u32 frame_count = bench_arg(argc,argv,0,10000);
+    const u32 texture_count = 1024;
+    const ResidencyTrace traces[] = {
+        { "static", 48, 0, 1, false },
+        { "walk", 64, 1, 4, false },
+        { "jump", 64, 256, 200, false },
+        { "random", 64, 8, 16, true },
+        { "thrash", 640, 16, 1, false },
+    };
+    u64* sizes = malloc(texture_count * sizeof(u64));
+    u64* fallback_sizes = malloc(texture_count * sizeof(u64));
+    u64* last_full_draw = malloc(texture_count * sizeof(u64));
+    u32* touched = malloc(texture_count * sizeof(u32));
+    bool* in_frame = malloc(texture_count * sizeof(bool));
+    srand(11);
+    u64 total_bytes = 0, fallback_bytes = 0;
+    for(u32 i = 0; i < texture_count; i++) {
+        residency_bench_chain(32u << (rand() % 8),&sizes[i],&fallback_sizes[i]);
+        total_bytes += sizes[i];
+        fallback_bytes += fallback_sizes[i];
+    }
+    u64 budget = total_bytes / 4;
+    printf("[RESIDENCY] %u textures, %.1f MB of chains and %.2f MB of fallbacks, %.1f MB budget, %u promotions per frame\n",texture_count,
+           total_bytes / (1024.0 * 1024.0),fallback_bytes / (1024.0 * 1024.0),budget / (1024.0 * 1024.0),RESIDENCY_MAX_PROMOTIONS);
+
+    u32 errors = 0;
+    for(u32 t = 0; t < sizeof(traces) / sizeof(traces[0]); t++) {
+        const ResidencyTrace* trace = &traces[t];
+        ResidencyPolicy policy;
+        residency_policy_init(&policy,budget,RESIDENCY_MAX_PROMOTIONS);
+        for(u32 i = 0; i < texture_count; i++) {
+            residency_policy_add(&policy,sizes[i],fallback_sizes[i]);
+            last_full_draw[i] = 0;
+        }
+        memset(in_frame,0,texture_count * sizeof(bool));
+
+        u32 trace_errors = 0, first = 0, unfit_frames = 0;
+        f64 seconds = 0.0;
+        bool settled = false;
+        for(u32 frame = 0; frame < frame_count; frame++) {
+            if(frame && frame % trace->move_every == 0)
+                first = (first + trace->step) % texture_count;
+            u32 touched_count = 0;
+            u64 frame_bytes = fallback_bytes;
+            for(u32 i = 0; i < trace->working_set; i++) {
+                u32 id = trace->random ? (first + rand() % (trace->working_set * 2)) % texture_count : (first + i) % texture_count;
+                if(in_frame[id])
+                    continue;
+                in_frame[id] = true;
+                touched[touched_count++] = id;
+                frame_bytes += sizes[id] - fallback_sizes[id];
+            }
+
+            u64 fallbacks = policy.stats.fallbacks;
+            u64 committed_bytes = policy.resident_bytes + policy.releasing_bytes;
+            f64 start = timer_now();
+            residency_policy_begin_frame(&policy);
+            for(u32 i = 0; i < touched_count; i++) {
+                bool full = residency_policy_touch(&policy,touched[i]);
+                u32 state = policy.entries[touched[i]].state;
+                if(full != (state == RESIDENCY_RESIDENT || state == RESIDENCY_PINNED))
+                    ++trace_errors;
+            }
+            residency_policy_end_frame(&policy);
+            seconds += timer_now() - start;
+
+            // frame f is drawn by the time frame f + STREAM_BUFFER_FRAMES begins
+            for(u32 i = 0; i < policy.released_count; i++) {
+                if(policy.frame < last_full_draw[policy.released[i]] + STREAM_BUFFER_FRAMES)
+                    ++trace_errors;
+            }
+            for(u32 i = 0; i < touched_count; i++) {
+                const ResidencyEntry* entry = &policy.entries[touched[i]];
+                if(entry->state == RESIDENCY_RESIDENT || entry->state == RESIDENCY_PINNED)
+                    last_full_draw[touched[i]] = policy.frame;
+                in_frame[touched[i]] = false;
+            }
+            // every chain starts resident, far over the budget. A frame may only drain that, never add bytes past the
+            // budget with releasing chains counted, and when the frame's textures fit with promotions to spare they
+            // only fall back while chains evicted for them are releasing
+            bool fits = frame_bytes <= budget;
+            unfit_frames += !fits;
+            u64 frame_end_bytes = policy.resident_bytes + policy.releasing_bytes;
+            if(frame_end_bytes > budget && frame_end_bytes > committed_bytes)
+                ++trace_errors;
+            if(fits && policy.promotions_left && policy.stats.fallbacks != fallbacks && !policy.releasing_bytes)
+                ++trace_errors;
+
+            u64 resident_bytes = 0, releasing_bytes = 0;
+            u32 resident_count = 0, lru_count = 0;
+            for(u32 i = 0; i < texture_count; i++) {
+                const ResidencyEntry* entry = &policy.entries[i];
+                resident_bytes += entry->fallback_size;
+                if(entry->state == RESIDENCY_RESIDENT)
+                    resident_bytes += entry->size, ++resident_count;
+                else if(entry->state == RESIDENCY_RELEASING)
+                    releasing_bytes += entry->size;
+            }
+            u64 previous_use = 0;
+            for(u32 id = policy.lru_oldest; id != RESIDENCY_NONE && lru_count <= texture_count; id = policy.entries[id].newer, lru_count++) {
+                if(policy.entries[id].state != RESIDENCY_RESIDENT || policy.entries[id].last_used < previous_use)
+                    ++trace_errors;
+                previous_use = policy.entries[id].last_used;
+            }
+            if(resident_bytes != policy.resident_bytes || releasing_bytes != policy.releasing_bytes || lru_count != resident_count)
+                ++trace_errors;
+            // everything starts resident, leave the first evictions and their releases out of the stats, up to the
+            // frame the chains resident from the start have drained below the budget
+            if(!settled && policy.frame > RESIDENCY_RELEASE_DELAY && frame_end_bytes <= budget) {
+                memset(&policy.stats,0,sizeof(ResidencyStats));
+                settled = true;
+            }
+        }
+
+        // a working set that stays put settles after the first frame
+        if(trace->step == 0 && !unfit_frames && (policy.stats.promotions || policy.stats.fallbacks || policy.stats.evictions))
+            ++trace_errors;
+        if(!settled || policy.stats.over_budget_frames || policy.stats.peak_bytes > budget)
+            ++trace_errors;
+        printf("[RESIDENCY] %-6s %u textures per frame, %u frames did not fit, %.1f M touches/s, %u errors\n",trace->name,trace->working_set,
+               unfit_frames,policy.stats.touches / seconds / 1e6,trace_errors);
+        residency_stats_print(&policy.stats,policy.budget);
+        errors += trace_errors;
+        residency_policy_free(&policy);
+    }
+    free(sizes);
+    free(fallback_sizes);
+    free(last_full_draw);
+    free(touched);
+    free(in_frame);
+    printf("[RESIDENCY] %u errors\n",errors);
+    return errors ? 1 : 0;
+}
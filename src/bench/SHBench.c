@@ -0,0 +1,150 @@
+#include "Bench.h"
+#include "SphericalHarmonics.h"
+#include "Timer.h"
+#include "stb_image.h"
+#include <cglm/cglm.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+// radiance of the synthetic test skies in a direction: a sky gradient over a darker ground, plus a broad warm lobe
+// or a small bright sun
+static void sh_bench_sky(u32 sky,const f32* d,f32* rgb) {
+    f32 up = d[1] * 0.5f + 0.5f;
+    rgb[0] = 0.2f + 0.3f * up;
+    rgb[1] = 0.25f + 0.4f * up;
+    rgb[2] = 0.3f + 0.9f * up * up;
+    vec3 sun = { 0.4f, 0.6f, -0.69282f };
+    f32 c = glm_vec3_dot((f32*)d,sun);
+    f32 lobe = sky == 0 ? 2.0f * powf(fmaxf(c,0.0f),4.0f) : 400.0f * powf(fmaxf(c,0.0f),2048.0f);
+    rgb[0] += lobe;
+    rgb[1] += 0.8f * lobe;
+    rgb[2] += 0.5f * lobe;
+}
+
+// direction of texel (x,y) the way eqrec_to_cubemap_fs.glsl maps it, row 0 at the bottom
+static void sh_bench_direction(u32 x,u32 y,u32 width,u32 height,f32* d) {
+    f32 phi = ((x + 0.5f) / width - 0.5f) * 2.0f * GLM_PIf;
+    f32 beta = ((y + 0.5f) / height - 0.5f) * GLM_PIf;
+    d[0] = cosf(beta) * cosf(phi);
+    d[1] = sinf(beta);
+    d[2] = cosf(beta) * sinf(phi);
+}
+
+f32* sh_bench_image(u32 sky,u32 width,u32 height) {
+    f32* pixels = malloc((u64)width * height * 3 * sizeof(f32));
+    for(u32 y = 0; y < height; y++)
+        for(u32 x = 0; x < width; x++) {
+            vec3 d;
+            sh_bench_direction(x,y,width,height,d);
+            sh_bench_sky(sky,d,pixels + ((u64)y * width + x) * 3);
+        }
+    return pixels;
+}
+
+// projects an image serially and on every core, checks both against a per texel double precision projection and
+// the irradiance SH against the brute force cosine integral over every texel
+static bool sh_benchmark_image(JobSystem* jobs,const char* name,const f32* pixels,u32 width,u32 height,u32 channels) {
+    SH9 serial, parallel, irradiance;
+    u32 iterations = (u32)(64000000ull / ((u64)width * height)) + 1;
+    iterations = iterations > 64 ? 64 : iterations;
+    f64 start = timer_now();
+    for(u32 i = 0; i < iterations; i++)
+        sh9_project_equirect(NULL,pixels,width,height,channels,&serial);
+    f64 serial_seconds = (timer_now() - start) / iterations;
+    start = timer_now();
+    for(u32 i = 0; i < iterations; i++)
+        sh9_project_equirect(jobs,pixels,width,height,channels,&parallel);
+    f64 parallel_seconds = (timer_now() - start) / iterations;
+    bool match = memcmp(&serial,&parallel,sizeof(SH9)) == 0;
+
+    f64 reference[SH_COEFFICIENT_COUNT][3] = {0};
+    f64 texel_angle = (2.0 * GLM_PI / width) * (GLM_PI / height);
+    for(u32 y = 0; y < height; y++)
+        for(u32 x = 0; x < width; x++) {
+            vec3 d;
+            f32 basis[SH_COEFFICIENT_COUNT];
+            sh_bench_direction(x,y,width,height,d);
+            sh9_basis(d,basis);
+            const f32* texel = pixels + ((u64)y * width + x) * channels;
+            f64 weight = texel_angle * sqrt(1.0 - d[1] * d[1]);
+            for(u32 k = 0; k < SH_COEFFICIENT_COUNT; k++)
+                for(u32 c = 0; c < 3; c++)
+                    reference[k][c] += weight * basis[k] * texel[c < channels ? c : 0];
+        }
+    f64 projection_error = 0.0;
+    for(u32 k = 0; k < SH_COEFFICIENT_COUNT; k++)
+        for(u32 c = 0; c < 3; c++)
+            projection_error = fmax(projection_error,fabs(parallel.coefficients[k][c] - reference[k][c]) / fabs(reference[0][c]));
+
+    // fibonacci sphere of normals, the integral runs over a quarter resolution copy to stay quick on large images
+    sh9_irradiance(&parallel,&irradiance);
+    const u32 normal_count = 128;
+    u32 step = width >= 1024 ? 4 : 1;
+    f64 max_error = 0.0, peak = 0.0;
+    for(u32 n = 0; n < normal_count; n++) {
+        f32 ny = 1.0f - 2.0f * (n + 0.5f) / normal_count;
+        f32 r = sqrtf(1.0f - ny * ny), phi = n * 2.39996323f;
+        vec3 normal = { r * cosf(phi), ny, r * sinf(phi) };
+        f64 exact[3] = {0};
+        for(u32 y = step / 2; y < height; y += step)
+            for(u32 x = step / 2; x < width; x += step) {
+                vec3 d;
+                sh_bench_direction(x,y,width,height,d);
+                f32 cos_theta = glm_vec3_dot(normal,d);
+                if(cos_theta <= 0.0f)
+                    continue;
+                const f32* texel = pixels + ((u64)y * width + x) * channels;
+                f64 weight = texel_angle * step * step * sqrt(1.0 - d[1] * d[1]) * cos_theta / GLM_PI;
+                for(u32 c = 0; c < 3; c++)
+                    exact[c] += weight * texel[c < channels ? c : 0];
+            }
+        vec3 approx;
+        sh9_evaluate(&irradiance,normal,approx);
+        for(u32 c = 0; c < 3; c++) {
+            max_error = fmax(max_error,fabs(approx[c] - exact[c]));
+            peak = fmax(peak,exact[c]);
+        }
+    }
+
+    // bands past 2 hold at most about 9% of a clamped cosine convolution, whatever the lighting
+    bool passed = match && projection_error < 1e-3 && max_error / peak < 0.09;
+    printf("[SH] %s %ux%u: %.2f ms serial, %.2f ms on %u threads (%.0f Mpixels/s), results %s, projection error %.1e, "
+           "irradiance max error %.2f%% of peak\n",name,width,height,serial_seconds * 1000.0,parallel_seconds * 1000.0,
+           job_system_thread_count(jobs),width * height / parallel_seconds / 1e6,match ? "match" : "DIFFER",projection_error,
+           max_error / peak * 100.0);
+    return passed;
+}
+
+int sh_benchmark(int argc,char** argv) {
+    const char* hdr_path = argc > 0 ? argv[0] : NULL;
+    JobSystem* jobs = job_system_create(0);
+    printf("[SH] %s projection\n",sh9_isa());
+    bool passed = true;
+    static const char* sky_names[] = { "broad sky", "sun sky" };
+    for(u32 sky = 0; sky < 2; sky++) {
+        f32* pixels = sh_bench_image(sky,1024,512);
+        passed &= sh_benchmark_image(jobs,sky_names[sky],pixels,1024,512,3);
+        free(pixels);
+    }
+    f32* pixels = sh_bench_image(0,4096,2048);
+    passed &= sh_benchmark_image(jobs,sky_names[0],pixels,4096,2048,3);
+    free(pixels);
+
+    if(hdr_path) {
+        stbi_set_flip_vertically_on_load(true);
+        int width, height, components;
+        pixels = stbi_loadf(hdr_path,&width,&height,&components,0);
+        stbi_set_flip_vertically_on_load(false);
+        if(pixels) {
+            passed &= sh_benchmark_image(jobs,hdr_path,pixels,width,height,components);
+            stbi_image_free(pixels);
+        } else {
+            fprintf(stderr,"[SH] Failed to load \"%s\"\n",hdr_path);
+            passed = false;
+        }
+    }
+    job_system_destroy(jobs);
+    return passed ? 0 : 1;
+}
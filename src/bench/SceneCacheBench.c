@@ -0,0 +1,429 @@
+#include "Bench.h"
+#include "SceneCache.h"
+#include "Timer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// random bytes, the cache stores every section as opaque data
+static void scene_cache_bench_fill(void* data,u64 size,u32* seed) {
+    u8* bytes = (u8*)data;
+    for(u64 i = 0; i < size; i++) {
+        *seed = *seed * 1664525u + 1013904223u;
+        bytes[i] = (u8)(*seed >> 24);
+    }
+}
+
+#define scene_cache_bench_vector(vec,T,count,seed) {\
+    vector_resize(vec,T,count);\
+    scene_cache_bench_fill(vec.data,(u64)(count) * sizeof(T),seed);\
+}
+
+#define scene_compare_vector(a,b,vec,T,tag,differences) {\
+    if(a->vec.size != b->vec.size || (a->vec.size && memcmp(a->vec.data,b->vec.data,(u64)a->vec.size * sizeof(T)) != 0)) {\
+        fprintf(stderr,"[%s] %s differs\n",tag,#vec);\
+        ++differences;\
+    }\
+}
+
+// compares the geometry, materials and bounds of two scenes byte for byte, returns how many of them differ
+static u32 scene_compare(const Scene* a,const Scene* b,const char* tag) {
+    u32 differences = 0;
+    scene_compare_vector(a,b,vertex_vector,Vertex,tag,differences);
+    scene_compare_vector(a,b,packed_vertex_vector,PackedVertex,tag,differences);
+    scene_compare_vector(a,b,skin_vertex_vector,SkinVertex,tag,differences);
+    scene_compare_vector(a,b,index_vector,u32,tag,differences);
+    scene_compare_vector(a,b,culled_backface_indirect_command_vector,DrawElementsIndirectCommand,tag,differences);
+    scene_compare_vector(a,b,non_culled_backface_indirect_command_vector,DrawElementsIndirectCommand,tag,differences);
+    scene_compare_vector(a,b,culled_command_material_index_vector,u32,tag,differences);
+    scene_compare_vector(a,b,non_culled_command_material_index_vector,u32,tag,differences);
+    scene_compare_vector(a,b,meshlet_vector,Meshlet,tag,differences);
+    scene_compare_vector(a,b,culled_command_aabb_vector,AABB,tag,differences);
+    scene_compare_vector(a,b,non_culled_command_aabb_vector,AABB,tag,differences);
+    scene_compare_vector(a,b,material_vector,Material,tag,differences);
+    if(memcmp(&a->aabb,&b->aabb,sizeof(AABB)) != 0) {
+        fprintf(stderr,"[%s] aabb differs\n",tag);
+        ++differences;
+    }
+    return differences;
+}
+
+static bool scene_cache_bench_rejects(const char* cache_path,const SceneCacheKey* key,Scene* scene) {
+    SceneCacheTextures textures;
+    bool loaded = scene_cache_load(cache_path,key,scene,&textures);
+    return !loaded;
+}
+
+static bool scene_cache_bench_write_source(const char* path,const u8* data,u64 size) {
+    FILE* f = fopen(path,"wb");
+    if(!f)
+        return false;
+    bool ok = fwrite(data,1,size,f) == size;
+    return (fclose(f) == 0) && ok;
+}
+
+// rows of shuffled spheres under rotated parents, every third one with a double sided material, as a glTF with
+// its buffer in bin_name next to it. The seed picks the spheres and lifts the rows
+static bool scene_cache_bench_write_gltf(const char* gltf_path,const char* bin_name,u32 sphere_count,u32 seed) {
+    FILE* bin = fopen(bin_name,"wb");
+    if(!bin)
+        return false;
+    u64* views = malloc(sphere_count * 4 * 2 * sizeof(u64)); // offset and length of every accessor's view
+    u32* counts = malloc(sphere_count * 2 * sizeof(u32));    // verticies and indices
+    u64 offset = 0;
+    bool ok = true;
+    for(u32 i = 0; i < sphere_count; i++) {
+        BenchMesh sphere;
+        bench_sphere(8 + ((seed + i) % 5) * 4,seed + i,&sphere);
+        counts[i * 2] = sphere.vertex_count;
+        counts[i * 2 + 1] = sphere.index_count;
+        vec2* uvs = malloc(sphere.vertex_count * sizeof(vec2));
+        for(u32 v = 0; v < sphere.vertex_count; v++) {
+            uvs[v][0] = sphere.positions[v][0] * 0.5f + 0.5f;
+            uvs[v][1] = sphere.positions[v][1] * 0.5f + 0.5f;
+        }
+        // unit spheres, the positions double as normals
+        const void* data[4] = { sphere.positions, sphere.positions, uvs, sphere.indices };
+        u64 sizes[4] = { sphere.vertex_count * sizeof(vec3), sphere.vertex_count * sizeof(vec3), sphere.vertex_count * sizeof(vec2),
+                         sphere.index_count * sizeof(u32) };
+        for(u32 a = 0; a < 4; a++) {
+            views[(i * 4 + a) * 2] = offset;
+            views[(i * 4 + a) * 2 + 1] = sizes[a];
+            ok = ok && fwrite(data[a],1,sizes[a],bin) == sizes[a];
+            offset += sizes[a];
+        }
+        free(uvs);
+        free(sphere.positions);
+        free(sphere.indices);
+    }
+    ok = (fclose(bin) == 0) && ok;
+
+    FILE* gltf = ok ? fopen(gltf_path,"w") : NULL;
+    if(gltf) {
+        u32 group_count = (sphere_count + 7) / 8;
+        fprintf(gltf,"{\"asset\":{\"version\":\"2.0\"},\"scene\":0,\"scenes\":[{\"nodes\":[");
+        for(u32 g = 0; g < group_count; g++)
+            fprintf(gltf,"%s%u",g ? "," : "",sphere_count + g);
+        fprintf(gltf,"]}],\n\"materials\":[{\"pbrMetallicRoughness\":{\"baseColorFactor\":[1,0.5,0.25,1]}},"
+                     "{\"pbrMetallicRoughness\":{\"metallicFactor\":0.25,\"roughnessFactor\":0.75}},"
+                     "{\"doubleSided\":true,\"pbrMetallicRoughness\":{}}],\n\"nodes\":[");
+        for(u32 i = 0; i < sphere_count; i++)
+            fprintf(gltf,"{\"mesh\":%u,\"translation\":[%u,%u,%u]},\n",i,(i % 8) * 3,seed % 7,(i / 8) * 3);
+        for(u32 g = 0; g < group_count; g++) {
+            fprintf(gltf,"{\"rotation\":[0,0.38268343,0,0.92387953],\"translation\":[0,%u,0],\"children\":[",g * 2);
+            for(u32 i = g * 8; i < sphere_count && i < g * 8 + 8; i++)
+                fprintf(gltf,"%s%u",i > g * 8 ? "," : "",i);
+            fprintf(gltf,"]}%s\n",g + 1 < group_count ? "," : "");
+        }
+        fprintf(gltf,"],\n\"meshes\":[");
+        for(u32 i = 0; i < sphere_count; i++)
+            fprintf(gltf,"{\"primitives\":[{\"attributes\":{\"POSITION\":%u,\"NORMAL\":%u,\"TEXCOORD_0\":%u},\"indices\":%u,\"material\":%u}]}%s\n",
+                    i * 4,i * 4 + 1,i * 4 + 2,i * 4 + 3,i % 3,i + 1 < sphere_count ? "," : "");
+        fprintf(gltf,"],\n\"accessors\":[");
+        for(u32 i = 0; i < sphere_count; i++) {
+            fprintf(gltf,"{\"bufferView\":%u,\"componentType\":5126,\"count\":%u,\"type\":\"VEC3\",\"min\":[-1,-1,-1],\"max\":[1,1,1]},\n",
+                    i * 4,counts[i * 2]);
+            fprintf(gltf,"{\"bufferView\":%u,\"componentType\":5126,\"count\":%u,\"type\":\"VEC3\"},\n",i * 4 + 1,counts[i * 2]);
+            fprintf(gltf,"{\"bufferView\":%u,\"componentType\":5126,\"count\":%u,\"type\":\"VEC2\"},\n",i * 4 + 2,counts[i * 2]);
+            fprintf(gltf,"{\"bufferView\":%u,\"componentType\":5125,\"count\":%u,\"type\":\"SCALAR\"}%s\n",i * 4 + 3,counts[i * 2 + 1],
+                    i + 1 < sphere_count ? "," : "");
+        }
+        fprintf(gltf,"],\n\"bufferViews\":[");
+        for(u32 v = 0; v < sphere_count * 4; v++)
+            fprintf(gltf,"{\"buffer\":0,\"byteOffset\":%llu,\"byteLength\":%llu}%s\n",(unsigned long long)views[v * 2],
+                    (unsigned long long)views[v * 2 + 1],v + 1 < sphere_count * 4 ? "," : "");
+        fprintf(gltf,"],\n\"buffers\":[{\"uri\":\"%s\",\"byteLength\":%llu}]}\n",bin_name,(unsigned long long)offset);
+        ok = fclose(gltf) == 0;
+    } else {
+        ok = false;
+    }
+    free(views);
+    free(counts);
+    return ok;
+}
+
+#define scene_cache_bench_import_flags (SCENE_IMPORT_PACKED_VERTICES | SCENE_IMPORT_OPTIMIZE_MESHES | SCENE_IMPORT_WELD_VERTICES | \
+                                        SCENE_IMPORT_BUILD_MESHLETS | SCENE_IMPORT_SKIP_TEXTURES)
+
+// a .gltf and the .bin it names, rewriting only the .bin must change the key and miss the cache baked before.
+// Returns the differences
+static u32 scene_cache_bench_buffers(const Scene* scene,u32 flags) {
+    const char* gltf_path = "scene_cache_bench_buffers.gltf";
+    const char* bin_path = "scene_cache_bench_buffers.bin";
+    const char* cache_path = "scene_cache_bench_buffers.gltf" SCENE_CACHE_EXTENSION;
+    const char* gltf = "{\"asset\":{\"version\":\"2.0\"},\"buffers\":[{\"uri\":\"scene_cache_bench_buffers.bin\",\"byteLength\":4096}]}";
+    u8 bin[4096];
+    u32 seed = 0x85ebca6bu;
+    scene_cache_bench_fill(bin,sizeof(bin),&seed);
+
+    u32 differences = 0;
+    SceneCacheKey key, stale;
+    SceneCacheBase base = {0};
+    Scene other;
+    scene_init(&other);
+    if(!scene_cache_bench_write_source(gltf_path,(const u8*)gltf,strlen(gltf)) || !scene_cache_bench_write_source(bin_path,bin,sizeof(bin)) ||
+       !scene_cache_key(gltf_path,flags,&key) || !scene_cache_write(cache_path,&key,&base,scene,NULL,0,NULL,0)) {
+        fprintf(stderr,"[CACHE] Failed to bake \"%s\"\n",gltf_path);
+        ++differences;
+    } else {
+        bin[0] ^= 0xff; // same size, same .gltf
+        if(!scene_cache_bench_write_source(bin_path,bin,sizeof(bin)) || !scene_cache_key(gltf_path,flags,&stale) ||
+           stale.source_size != key.source_size || stale.source_hash == key.source_hash || !scene_cache_bench_rejects(cache_path,&stale,&other)) {
+            fprintf(stderr,"[CACHE] \"%s\" hit after its buffer changed\n",gltf_path);
+            ++differences;
+        }
+    }
+    scene_data_destroy(&other);
+    remove(cache_path);
+    remove(gltf_path);
+    remove(bin_path);
+    return differences;
+}
+
+// the commands of a scene imported alone must come back after base in the one it was imported into, moved past the
+// verticies and indices imported before them. Returns the differences
+static u32 scene_cache_bench_appended(const Scene* alone,const Scene* combined,const SceneCacheBase* base) {
+    u32 differences = 0;
+    if(combined->packed_vertex_vector.size != base->vertex_count + alone->packed_vertex_vector.size ||
+       memcmp(combined->packed_vertex_vector.data + base->vertex_count,alone->packed_vertex_vector.data,
+              alone->packed_vertex_vector.size * sizeof(PackedVertex)) != 0) {
+        fprintf(stderr,"[CACHE] appended packed verticies differ\n");
+        ++differences;
+    }
+    if(combined->index_vector.size < base->index_count + alone->index_vector.size ||
+       memcmp(combined->index_vector.data + base->index_count,alone->index_vector.data,alone->index_vector.size * sizeof(u32)) != 0) {
+        fprintf(stderr,"[CACHE] appended indices differ\n");
+        ++differences;
+    }
+
+    const DrawElementsIndirectCommand* lists[2][2] = {
+        { alone->culled_backface_indirect_command_vector.data, combined->culled_backface_indirect_command_vector.data + base->culled_command_count },
+        { alone->non_culled_backface_indirect_command_vector.data, combined->non_culled_backface_indirect_command_vector.data + base->non_culled_command_count }
+    };
+    u32 counts[2][2] = {
+        { alone->culled_backface_indirect_command_vector.size, combined->culled_backface_indirect_command_vector.size - base->culled_command_count },
+        { alone->non_culled_backface_indirect_command_vector.size, combined->non_culled_backface_indirect_command_vector.size - base->non_culled_command_count }
+    };
+    for(u32 list = 0; list < 2; list++) {
+        if(counts[list][0] != counts[list][1]) {
+            fprintf(stderr,"[CACHE] %u appended commands, %u imported alone\n",counts[list][1],counts[list][0]);
+            ++differences;
+            continue;
+        }
+        for(u32 i = 0; i < counts[list][0]; i++) {
+            DrawElementsIndirectCommand expected = lists[list][0][i];
+            expected.firstIndex += base->index_count;
+            expected.baseVertex += base->vertex_count;
+            if(memcmp(&expected,&lists[list][1][i],sizeof(DrawElementsIndirectCommand)) != 0) {
+                fprintf(stderr,"[CACHE] appended command %u was not moved past the earlier import\n",i);
+                ++differences;
+                break;
+            }
+        }
+    }
+    return differences;
+}
+
+// imports two glTFs into one scene on 1 thread, 4 threads and every core and then once more with the caches the
+// last imports baked, every scene must match the single threaded one byte for byte. The second glTF imported
+// alone must match its part of the combined scene. Returns the differences
+static u32 scene_cache_bench_import(u32 sphere_count) {
+    const char* gltf_names[2] = { "scene_cache_bench_import0.gltf", "scene_cache_bench_import1.gltf" };
+    const char* bin_names[2] = { "scene_cache_bench_import0.bin", "scene_cache_bench_import1.bin" };
+    const char* cache_paths[2] = { "./scene_cache_bench_import0.gltf" SCENE_CACHE_EXTENSION, "./scene_cache_bench_import1.gltf" SCENE_CACHE_EXTENSION };
+    bool written = scene_cache_bench_write_gltf(gltf_names[0],bin_names[0],sphere_count,0);
+    written = written && scene_cache_bench_write_gltf(gltf_names[1],bin_names[1],sphere_count / 2,sphere_count);
+    if(!written) {
+        fprintf(stderr,"[CACHE] Failed to write the glTFs to import\n");
+        for(u32 f = 0; f < 2; f++) {
+            remove(gltf_names[f]);
+            remove(bin_names[f]);
+        }
+        return 1;
+    }
+
+    Arena arena;
+    arena_create(&arena,MB(4));
+    JobSystem* jobs[3] = { NULL, job_system_create(3), job_system_create(0) };
+    Scene scenes[5];
+    SceneCacheBase second_base;
+    f64 seconds[4];
+    for(u32 i = 0; i < 4; i++) {
+        // a scene maps one cache at most, the last round reads the first glTF from its cache and imports the second
+        // on top of the mapped vectors
+        if(i < 3) {
+            remove(cache_paths[0]);
+            remove(cache_paths[1]);
+        }
+        scene_init(&scenes[i]);
+        scenes[i].import_flags = scene_cache_bench_import_flags;
+        f64 start = timer_now();
+        load_scene_from_gltf(&arena,i < 3 ? jobs[i] : NULL,".",gltf_names[0],&scenes[i]);
+        if(i == 0)
+            scene_cache_base(&scenes[0],&second_base);
+        load_scene_from_gltf(&arena,i < 3 ? jobs[i] : NULL,".",gltf_names[1],&scenes[i]);
+        seconds[i] = timer_now() - start;
+    }
+    remove(cache_paths[1]);
+    scene_init(&scenes[4]);
+    scenes[4].import_flags = scene_cache_bench_import_flags;
+    load_scene_from_gltf(&arena,NULL,".",gltf_names[1],&scenes[4]);
+
+    u32 differences = 0;
+    if(!second_base.vertex_count || !scenes[0].meshlet_vector.size || !scenes[0].non_culled_backface_indirect_command_vector.size) {
+        fprintf(stderr,"[CACHE] \"%s\" imported no geometry\n",gltf_names[0]);
+        ++differences;
+    }
+    if(!scenes[3].cache_mapping) {
+        fprintf(stderr,"[CACHE] \"%s\" was not read back from its cache\n",gltf_names[0]);
+        ++differences;
+    }
+    for(u32 i = 1; i < 4; i++)
+        differences += scene_compare(&scenes[0],&scenes[i],"CACHE");
+    differences += scene_cache_bench_appended(&scenes[4],&scenes[0],&second_base);
+    printf("[CACHE] import of %u + %u spheres: 1 thread %.2f ms, %u threads %.2f ms, %u threads %.2f ms, with the cache %.2f ms\n",sphere_count,
+           sphere_count / 2,seconds[0] * 1000.0,job_system_thread_count(jobs[1]),seconds[1] * 1000.0,job_system_thread_count(jobs[2]),
+           seconds[2] * 1000.0,seconds[3] * 1000.0);
+
+    for(u32 i = 0; i < 5; i++)
+        scene_data_destroy(&scenes[i]);
+    job_system_destroy(jobs[1]);
+    job_system_destroy(jobs[2]);
+    arena_free(&arena);
+    arena_scratch_release();
+    for(u32 f = 0; f < 2; f++) {
+        remove(cache_paths[f]);
+        remove(gltf_names[f]);
+        remove(bin_names[f]);
+    }
+    return differences;
+}
+
+// bakes a scene of random sections, maps it back and checks every section comes back byte for byte, that
+// borrowed sections survive growing and the release, and that a changed source, buffer, key or scene base is a miss.
+// Then checks the glTF import itself is independent of the thread count and round trips through its cache
+int scene_cache_benchmark(int argc,char** argv) {
+    u32 vertex_count = bench_arg(argc,argv,0,100000);
+    const char* source_path = "scene_cache_bench.gltf";
+    const char* cache_path = "scene_cache_bench.gltf" SCENE_CACHE_EXTENSION;
+    const u32 flags = SCENE_IMPORT_PACKED_VERTICES | SCENE_IMPORT_BUILD_MESHLETS;
+    u32 seed = 0x9e3779b9u;
+    u32 errors = 0;
+
+    // the source only feeds the key, any bytes do
+    u8 source[4097];
+    scene_cache_bench_fill(source,sizeof(source),&seed);
+    if(!scene_cache_bench_write_source(source_path,source,4096)) {
+        fprintf(stderr,"[CACHE] Failed to write \"%s\"\n",source_path);
+        return 1;
+    }
+
+    vertex_count = vertex_count ? vertex_count : 1;
+    u32 index_count = vertex_count * 3;
+    u32 culled_count = vertex_count / 64 + 1;
+    u32 non_culled_count = culled_count / 4 + 1;
+    Scene scene;
+    scene_init(&scene);
+    scene_cache_bench_vector(scene.vertex_vector,Vertex,vertex_count,&seed);
+    scene_cache_bench_vector(scene.packed_vertex_vector,PackedVertex,vertex_count,&seed);
+    scene_cache_bench_vector(scene.skin_vertex_vector,SkinVertex,vertex_count,&seed);
+    scene_cache_bench_vector(scene.index_vector,u32,index_count,&seed);
+    scene_cache_bench_vector(scene.culled_backface_indirect_command_vector,DrawElementsIndirectCommand,culled_count,&seed);
+    scene_cache_bench_vector(scene.non_culled_backface_indirect_command_vector,DrawElementsIndirectCommand,non_culled_count,&seed);
+    scene_cache_bench_vector(scene.culled_command_material_index_vector,u32,culled_count,&seed);
+    scene_cache_bench_vector(scene.non_culled_command_material_index_vector,u32,non_culled_count,&seed);
+    scene_cache_bench_vector(scene.meshlet_vector,Meshlet,vertex_count / 32 + 1,&seed);
+    scene_cache_bench_vector(scene.culled_command_aabb_vector,AABB,culled_count,&seed);
+    scene_cache_bench_vector(scene.non_culled_command_aabb_vector,AABB,non_culled_count,&seed);
+    scene_cache_bench_vector(scene.material_vector,Material,16,&seed);
+    scene_cache_bench_fill(&scene.aabb,sizeof(AABB),&seed);
+    SceneTextureRef refs[8];
+    u8* texture_data = malloc(1 << 16);
+    scene_cache_bench_fill(refs,sizeof(refs),&seed);
+    scene_cache_bench_fill(texture_data,1 << 16,&seed);
+
+    SceneCacheKey key;
+    SceneCacheBase base = {0}; // everything was appended to an empty scene
+    if(!scene_cache_key(source_path,flags,&key))
+        ++errors;
+    f64 write_start = timer_now();
+    if(!scene_cache_write(cache_path,&key,&base,&scene,refs,8,texture_data,1 << 16))
+        ++errors;
+    f64 write_seconds = timer_now() - write_start;
+
+    Scene loaded;
+    scene_init(&loaded);
+    SceneCacheTextures textures;
+    f64 load_start = timer_now();
+    bool hit = scene_cache_load(cache_path,&key,&loaded,&textures);
+    f64 load_seconds = timer_now() - load_start;
+    if(!hit) {
+        fprintf(stderr,"[CACHE] \"%s\" did not load\n",cache_path);
+        ++errors;
+    } else {
+        errors += scene_compare(&scene,&loaded,"CACHE");
+        if(textures.ref_count != 8 || memcmp(textures.refs,refs,sizeof(refs)) != 0 || memcmp(textures.data,texture_data,1 << 16) != 0)
+            ++errors;
+
+        // a borrowed section moves to the heap when it grows and keeps its contents past the release
+        bool borrowed = loaded.index_vector.borrowed;
+        u32 extra_index = 7;
+        vector_push(loaded.index_vector,u32,extra_index);
+        if(!borrowed || loaded.index_vector.borrowed || loaded.index_vector.data[index_count] != extra_index ||
+           memcmp(loaded.index_vector.data,scene.index_vector.data,(u64)index_count * sizeof(u32)) != 0)
+            ++errors;
+        // a mapped scene takes no second cache
+        if(!scene_cache_bench_rejects(cache_path,&key,&loaded))
+            ++errors;
+        scene_cache_release(&loaded);
+        if(loaded.vertex_vector.size || loaded.vertex_vector.borrowed || loaded.meshlet_vector.size || loaded.index_vector.size != index_count + 1 ||
+           memcmp(loaded.index_vector.data,scene.index_vector.data,(u64)index_count * sizeof(u32)) != 0)
+            ++errors;
+    }
+    scene_data_destroy(&loaded);
+
+    // stale keys and a scene that already holds geometry must all miss
+    Scene other;
+    scene_init(&other);
+    SceneCacheKey stale = key;
+    stale.source_mtime += 1;
+    errors += !scene_cache_bench_rejects(cache_path,&stale,&other);
+    stale = key;
+    stale.import_flags ^= SCENE_IMPORT_PACKED_VERTICES;
+    errors += !scene_cache_bench_rejects(cache_path,&stale,&other);
+
+    source[0] ^= 0xff; // same size, only the hash tells
+    if(!scene_cache_bench_write_source(source_path,source,4096) || !scene_cache_key(source_path,flags,&stale) ||
+       stale.source_size != key.source_size || stale.source_hash == key.source_hash)
+        ++errors;
+    errors += !scene_cache_bench_rejects(cache_path,&stale,&other);
+    if(!scene_cache_bench_write_source(source_path,source,4097) || !scene_cache_key(source_path,flags,&stale) ||
+       stale.source_size == key.source_size)
+        ++errors;
+    errors += !scene_cache_bench_rejects(cache_path,&stale,&other);
+
+    Material material = {0};
+    vector_push(other.material_vector,Material,material);
+    errors += !scene_cache_bench_rejects(cache_path,&key,&other);
+    scene_data_destroy(&other);
+    errors += scene_cache_bench_buffers(&scene,flags);
+
+    u64 cache_size = 0;
+    FILE* f = fopen(cache_path,"rb");
+    if(f) {
+        fseek(f,0,SEEK_END);
+        cache_size = (u64)ftell(f);
+        fclose(f);
+    }
+    printf("[CACHE] %u verticies, %.2f MB baked in %.3f ms, mapped in %.3f ms\n",vertex_count,cache_size / (1024.0 * 1024.0),
+           write_seconds * 1000.0,load_seconds * 1000.0);
+
+    remove(cache_path);
+    remove(source_path);
+    free(texture_data);
+    scene_data_destroy(&scene);
+
+    errors += scene_cache_bench_import(64);
+    printf("[CACHE] %u errors\n",errors);
+    return errors ? 1 : 0;
+}
@@ -0,0 +1,240 @@
+#include "Bench.h"
+#include "Camera.h"
+#include "Culling.h"
+#include "ShadowCascades.h"
+#include "Timer.h"
+#include <cglm/cglm.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <float.h>
+
+// box overlaps the cascade's clip volume by more than margin, the exact answer culling against its frustum has to
+// reproduce. Boxes just touching it can go either way in float
+static bool cascade_bench_overlaps(const ShadowCascade* cascade,const AABB* box,f32 margin) {
+    vec3 min = { FLT_MAX, FLT_MAX, FLT_MAX }, max = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+    for(u32 i = 0; i < 8; i++) {
+        vec4 corner = { i & 1 ? box->max[0] : box->min[0], i & 2 ? box->max[1] : box->min[1], i & 4 ? box->max[2] : box->min[2], 1.0f }, clip;
+        glm_mat4_mulv((vec4*)cascade->view_proj,corner,clip);
+        glm_vec3_minv(min,clip,min);
+        glm_vec3_maxv(max,clip,max);
+    }
+    f32 edge = 1.0f - margin;
+    return min[0] <= edge && max[0] >= -edge && min[1] <= edge && max[1] >= -edge && min[2] <= edge && max[2] >= -edge;
+}
+
+// texel position of a world point in a cascade's map
+static void cascade_bench_texel(const ShadowCascade* cascade,const f32* point,f32* texel) {
+    vec4 world = { point[0], point[1], point[2], 1.0f }, clip;
+    glm_mat4_mulv((vec4*)cascade->view_proj,world,clip);
+    texel[0] = (clip[0] * 0.5f + 0.5f) * SHADOW_CASCADE_RESOLUTION;
+    texel[1] = (clip[1] * 0.5f + 0.5f) * SHADOW_CASCADE_RESOLUTION;
+}
+
+// CPU checks of the cascade math over random cameras: the split scheme, every slice inside its cascade, texel snapping
+// and per cascade culling of random boxes against brute force
+int cascade_benchmark(int argc,char** argv) {
+    u32 cascade_count = glm_clamp(argc > 0 ? atoi(argv[0]) : SHADOW_MAX_CASCADES,1,SHADOW_MAX_CASCADES);
+    u32 view_count = bench_arg(argc,argv,1,256);
+    u32 errors = 0;
+    f32 splits[SHADOW_MAX_CASCADES + 1];
+    for(u32 count = 1; count <= SHADOW_MAX_CASCADES; count++) {
+        f32 uniform[SHADOW_MAX_CASCADES + 1], logarithmic[SHADOW_MAX_CASCADES + 1];
+        shadow_cascade_splits(CAMERA_NEAR,SHADOW_DISTANCE,0.0f,count,uniform);
+        shadow_cascade_splits(CAMERA_NEAR,SHADOW_DISTANCE,1.0f,count,logarithmic);
+        shadow_cascade_splits(CAMERA_NEAR,SHADOW_DISTANCE,SHADOW_SPLIT_LAMBDA,count,splits);
+        for(u32 i = 0; i <= count; i++) {
+            f32 fraction = (f32)i / count;
+            errors += fabsf(uniform[i] - (CAMERA_NEAR + (SHADOW_DISTANCE - CAMERA_NEAR) * fraction)) > 1e-3f;
+            errors += fabsf(logarithmic[i] - CAMERA_NEAR * powf(SHADOW_DISTANCE / CAMERA_NEAR,fraction)) > 1e-3f;
+            errors += i && !(splits[i] > splits[i - 1] && splits[i] <= uniform[i] && splits[i] >= logarithmic[i]);
+        }
+        errors += splits[0] != CAMERA_NEAR || splits[count] != SHADOW_DISTANCE;
+    }
+    shadow_cascade_splits(CAMERA_NEAR,SHADOW_DISTANCE,SHADOW_SPLIT_LAMBDA,cascade_count,splits);
+    printf("[CASCADE] %u cascades, splits",cascade_count);
+    for(u32 i = 0; i <= cascade_count; i++)
+        printf(" %.2f",splits[i]);
+    printf("\n");
+
+    const u32 box_count = 100000;
+    AABB scene_bounds = { { -200.0f, -10.0f, -200.0f }, { 200.0f, 60.0f, 200.0f } };
+    AABB* boxes = malloc(box_count * sizeof(AABB));
+    u32 seed = 0x9e3779b9u;
+    for(u32 i = 0; i < box_count; i++) {
+        bench_random_box(&seed,190.0f,4.0f,&boxes[i]);
+        boxes[i].min[1] = glm_clamp(boxes[i].min[1],-10.0f,56.0f);
+        boxes[i].max[1] = boxes[i].min[1] + 4.0f;
+    }
+    CullBounds bounds;
+    cull_bounds_build(&bounds,boxes,box_count);
+    u32* visible = malloc((box_count + 1) * sizeof(u32));
+
+    u32 slice_errors = 0, snap_errors = 0, size_errors = 0, missed = 0, extra = 0;
+    u64 drawn[SHADOW_MAX_CASCADES] = {0};
+    f64 fit_seconds = 0.0, cull_seconds = 0.0;
+    for(u32 v = 0; v < view_count; v++) {
+        f32 random[6];
+        for(u32 r = 0; r < 6; r++) {
+            seed = seed * 1664525u + 1013904223u;
+            random[r] = (seed >> 8) / 16777216.0f;
+        }
+        vec3 eye = { (random[0] * 2.0f - 1.0f) * 150.0f, 2.0f + random[1] * 30.0f, (random[2] * 2.0f - 1.0f) * 150.0f };
+        f32 yaw = random[3] * 2.0f * GLM_PIf, pitch = (random[4] - 0.5f) * 1.2f;
+        vec3 forward = { cosf(yaw) * cosf(pitch), sinf(pitch), sinf(yaw) * cosf(pitch) }, target;
+        glm_vec3_add(eye,forward,target);
+        f32 sun = 0.2f + random[5] * 2.7f;
+        vec3 light_dir = { cosf(sun), sinf(sun), 0.3f };
+        glm_normalize(light_dir);
+
+        CascadeCamera camera = { .tan_half_fov_y = tanf(glm_rad(45.0f)), .aspect = 16.0f / 9.0f };
+        glm_lookat(eye,target,(vec3){0.0f,1.0f,0.0f},camera.view);
+        ShadowCascade cascades[SHADOW_MAX_CASCADES];
+        f64 start = timer_now();
+        shadow_cascades_build(&camera,light_dir,&scene_bounds,CAMERA_NEAR,SHADOW_DISTANCE,SHADOW_SPLIT_LAMBDA,cascade_count,
+                              SHADOW_CASCADE_RESOLUTION,cascades);
+        fit_seconds += timer_now() - start;
+
+        // the same camera moved a little and turned: same map sizes, and a fixed world point lands on the same sub texel position
+        CascadeCamera moved = camera;
+        vec3 moved_eye = { eye[0] + 0.37f * random[1], eye[1], eye[2] - 0.21f * random[2] }, moved_target;
+        vec3 moved_forward = { cosf(yaw + 0.5f) * cosf(pitch), sinf(pitch), sinf(yaw + 0.5f) * cosf(pitch) };
+        glm_vec3_add(moved_eye,moved_forward,moved_target);
+        glm_lookat(moved_eye,moved_target,(vec3){0.0f,1.0f,0.0f},moved.view);
+        ShadowCascade moved_cascades[SHADOW_MAX_CASCADES];
+        shadow_cascades_build(&moved,light_dir,&scene_bounds,CAMERA_NEAR,SHADOW_DISTANCE,SHADOW_SPLIT_LAMBDA,cascade_count,
+                              SHADOW_CASCADE_RESOLUTION,moved_cascades);
+
+        mat4 inverse_view;
+        glm_mat4_inv(camera.view,inverse_view);
+        for(u32 c = 0; c < cascade_count; c++) {
+            const ShadowCascade* cascade = &cascades[c];
+            // every corner of the slice inside the map and its depth range
+            for(u32 i = 0; i < 8; i++) {
+                f32 depth = i & 4 ? cascade->split_far : cascade->split_near;
+                vec4 view_corner = { (i & 1 ? 1.0f : -1.0f) * depth * camera.tan_half_fov_y * camera.aspect,
+                                     (i & 2 ? 1.0f : -1.0f) * depth * camera.tan_half_fov_y, -depth, 1.0f }, world, clip;
+                glm_mat4_mulv(inverse_view,view_corner,world);
+                glm_mat4_mulv((vec4*)cascade->view_proj,world,clip);
+                slice_errors += fabsf(clip[0]) > 1.0001f || fabsf(clip[1]) > 1.0001f || fabsf(clip[2]) > 1.0001f;
+            }
+
+            size_errors += cascade->half_width != moved_cascades[c].half_width;
+            vec2 texel, moved_texel;
+            cascade_bench_texel(cascade,(vec3){12.5f,3.25f,-7.75f},texel);
+            cascade_bench_texel(&moved_cascades[c],(vec3){12.5f,3.25f,-7.75f},moved_texel);
+            for(u32 axis = 0; axis < 2; axis++) {
+                f32 shift = moved_texel[axis] - texel[axis];
+                snap_errors += fabsf(shift - roundf(shift)) > 0.02f;
+            }
+
+            Frustum frustum;
+            frustum_from_matrix(cascades[c].view_proj,&frustum);
+            start = timer_now();
+            u32 visible_count = frustum_cull_aabbs(&frustum,&bounds,visible);
+            cull_seconds += timer_now() - start;
+            drawn[c] += visible_count;
+            u32 next = 0;
+            for(u32 i = 0; i < box_count; i++) {
+                bool kept = next < visible_count && visible[next] == i;
+                next += kept;
+                missed += !kept && cascade_bench_overlaps(cascade,&boxes[i],1e-4f);
+                extra += kept && !cascade_bench_overlaps(cascade,&boxes[i],-1e-4f);
+            }
+        }
+    }
+
+    for(u32 c = 0; c < cascade_count; c++)
+        printf("[CASCADE] cascade %u draws %.1f%% of %u boxes on average\n",c,100.0 * drawn[c] / ((f64)box_count * view_count),box_count);
+    printf("[CASCADE] %u views: fit %.2f us per camera, cull %.3f ms per cascade (%s)\n",view_count,fit_seconds * 1e6 / view_count,
+           cull_seconds * 1000.0 / (view_count * cascade_count),frustum_cull_isa());
+    printf("[CASCADE] slice corners outside %u, map size changes %u, unsnapped moves %u, boxes missed %u, boxes drawn without overlap %u\n",
+           slice_errors,size_errors,snap_errors,missed,extra);
+    errors += slice_errors + size_errors + snap_errors + missed;
+    printf("[CASCADE] %u errors\n",errors);
+
+    cull_bounds_free(&bounds);
+    free(boxes);
+    free(visible);
+    return errors ? 1 : 0;
+}
+
+// runs the shadow cache along scripted camera and sun motion at 60 Hz: how many cascade renders each case skips, that a
+// reused cascade always still holds its frustum slice and that invalidation only reaches cascades overlapping the box
+int shadow_cache_benchmark(int argc,char** argv) {
+    u32 frame_count = bench_arg(argc,argv,0,600);
+    const char* names[] = { "still", "sun turning", "walking", "turning head", "walking, sun turning" };
+    const f32 sun_speed[] = { 0.0f, 0.005f, 0.0f, 0.0f, 0.005f }; // radians per frame, the main loop's rate
+    const f32 walk_speed[] = { 0.0f, 0.0f, 1.4f / 60.0f, 0.0f, 1.4f / 60.0f };
+    const f32 turn_speed[] = { 0.0f, 0.0f, 0.0f, 0.01f, 0.0f };
+    AABB scene_bounds = { { -200.0f, -10.0f, -200.0f }, { 200.0f, 60.0f, 200.0f } };
+    u32 errors = 0;
+
+    for(u32 scenario = 0; scenario < sizeof(names) / sizeof(names[0]); scenario++) {
+        ShadowCache cache;
+        shadow_cache_init(&cache,true,SHADOW_CACHE_ANGLE);
+        u32 outside = 0;
+        for(u32 frame = 0; frame < frame_count; frame++) {
+            f32 sun = 0.8f + sun_speed[scenario] * frame;
+            vec3 light_dir = { sinf(sun), cosf(sun), 0.0f };
+            f32 yaw = 0.3f + turn_speed[scenario] * frame;
+            vec3 eye = { 5.0f + walk_speed[scenario] * frame, 2.0f, -3.0f }, target;
+            vec3 forward = { cosf(yaw), -0.1f, sinf(yaw) };
+            glm_vec3_add(eye,forward,target);
+            CascadeCamera camera = { .tan_half_fov_y = tanf(glm_rad(45.0f)), .aspect = 16.0f / 9.0f };
+            glm_lookat(eye,target,(vec3){0.0f,1.0f,0.0f},camera.view);
+            shadow_cache_update(&cache,&camera,light_dir,&scene_bounds,CAMERA_NEAR,SHADOW_DISTANCE,SHADOW_SPLIT_LAMBDA,
+                                SHADOW_MAX_CASCADES,SHADOW_CASCADE_RESOLUTION);
+
+            mat4 inverse_view;
+            glm_mat4_inv(camera.view,inverse_view);
+            for(u32 c = 0; c < SHADOW_MAX_CASCADES; c++) {
+                const ShadowCascade* cascade = &cache.cascades[c];
+                for(u32 i = 0; i < 8; i++) {
+                    f32 depth = i & 4 ? cascade->split_far : cascade->split_near;
+                    vec4 view_corner = { (i & 1 ? 1.0f : -1.0f) * depth * camera.tan_half_fov_y * camera.aspect,
+                                         (i & 2 ? 1.0f : -1.0f) * depth * camera.tan_half_fov_y, -depth, 1.0f }, world, clip;
+                    glm_mat4_mulv(inverse_view,view_corner,world);
+                    glm_mat4_mulv((vec4*)cascade->view_proj,world,clip);
+                    outside += fabsf(clip[0]) > 1.0001f || fabsf(clip[1]) > 1.0001f || fabsf(clip[2]) > 1.0001f;
+                }
+            }
+        }
+
+        u64 rendered = 0, skipped = 0;
+        printf("[SHADOW] %-20s",names[scenario]);
+        for(u32 c = 0; c < SHADOW_MAX_CASCADES; c++) {
+            printf(" cascade %u %5.1f%% skipped",c,100.0 * cache.skipped[c] / frame_count);
+            rendered += cache.rendered[c];
+            skipped += cache.skipped[c];
+        }
+        printf(", slice corners outside %u\n",outside);
+        errors += outside;
+        if(scenario == 0)
+            errors += rendered != SHADOW_MAX_CASCADES; // only the first frame renders
+        if(sun_speed[scenario] > 0.0f)
+            // at least once every time the sun passes the threshold
+            errors += rendered < (u64)(frame_count * sun_speed[scenario] / (SHADOW_CACHE_ANGLE + sun_speed[scenario])) * SHADOW_MAX_CASCADES;
+
+        // a caster far outside every cascade changes nothing, one at the camera reaches exactly the cascades over it
+        AABB far_box = { { 1000.0f, 0.0f, 1000.0f }, { 1001.0f, 1.0f, 1001.0f } };
+        AABB near_box = { { 5.5f, 1.0f, -3.5f }, { 6.5f, 2.0f, -2.5f } };
+        shadow_cache_invalidate(&cache,&far_box);
+        for(u32 c = 0; c < SHADOW_MAX_CASCADES; c++)
+            errors += cache.dirty[c];
+        shadow_cache_invalidate(&cache,&near_box);
+        errors += scenario == 0 && !cache.dirty[0];
+    }
+
+    ShadowCache disabled;
+    shadow_cache_init(&disabled,false,SHADOW_CACHE_ANGLE);
+    CascadeCamera camera = { .tan_half_fov_y = 1.0f, .aspect = 1.0f };
+    glm_mat4_identity(camera.view);
+    for(u32 frame = 0; frame < 8; frame++) {
+        u32 mask = shadow_cache_update(&disabled,&camera,(vec3){0.0f,1.0f,0.0f},&scene_bounds,CAMERA_NEAR,SHADOW_DISTANCE,SHADOW_SPLIT_LAMBDA,
+                                       SHADOW_MAX_CASCADES,SHADOW_CASCADE_RESOLUTION);
+        errors += mask != (1u << SHADOW_MAX_CASCADES) - 1;
+    }
+    printf("[SHADOW] %u errors\n",errors);
+    return errors ? 1 : 0;
+}
@@ -0,0 +1,58 @@
+#include "Bench.h"
+#include "StreamBuffer.h"
+#include "Timer.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+// drives the stream ring's slice and fence bookkeeping against a simulated GPU that finishes each frame a fixed
+// number of frames after it was submitted, no GL needed. Every allocation must land aligned inside the slice of its
+// frame, no frame may start on a slice the GPU still reads, and only a GPU further behind than the slice count stalls
+int stream_benchmark(int argc,char** argv) {
+    u32 frame_count = bench_arg(argc,argv,0,10000);
+    const u64 slice_size = 1 << 20;
+    u32 errors = 0;
+    srand(7);
+    for(u32 latency = 0; latency <= STREAM_BUFFER_FRAMES + 1; latency++) {
+        StreamRing ring;
+        stream_ring_init(&ring,slice_size,STREAM_BUFFER_FRAMES);
+        u64 done_frame[STREAM_BUFFER_MAX_FRAMES] = {0}; // frame at whose start the GPU is done with the slice
+        u32 stalls = 0;
+        u64 allocations = 0;
+
+        f64 start = timer_now();
+        for(u32 frame = 0; frame < frame_count; frame++) {
+            u32 slice = stream_ring_next_slice(&ring);
+            if(ring.pending[slice]) {
+                if(done_frame[slice] > frame)
+                    ++stalls;
+                stream_ring_retire(&ring,slice);
+            }
+            if(!stream_ring_begin_frame(&ring) || ring.slice != slice) {
+                ++errors;
+                break;
+            }
+
+            u64 offset;
+            for(;;) {
+                u64 size = 16 + rand() % 4096;
+                u64 alignment = 1ull << (rand() % 9);
+                if(!stream_ring_alloc(&ring,size,alignment,&offset))
+                    break;
+                ++allocations;
+                if(offset % alignment || offset < slice * slice_size || offset + size > (slice + 1) * slice_size)
+                    ++errors;
+            }
+            stream_ring_end_frame(&ring);
+            done_frame[slice] = frame + 1 + latency;
+        }
+        f64 seconds = timer_now() - start;
+
+        bool expect_stalls = latency >= STREAM_BUFFER_FRAMES;
+        if(expect_stalls != (stalls > 0))
+            ++errors;
+        printf("[STREAM] GPU %u frames behind: %u of %u frames stalled, %.1f M allocations/s, peak %llu of %llu bytes\n",latency,stalls,
+               frame_count,allocations / seconds / 1e6,(unsigned long long)ring.peak_used,(unsigned long long)slice_size);
+    }
+    printf("[STREAM] %u errors\n",errors);
+    return errors ? 1 : 0;
+}
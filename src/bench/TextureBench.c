@@ -0,0 +1,297 @@
+#include "Bench.h"
+#include "TextureLoader.h"
+#include "TextureCompress.h"
+#include "MipGenerator.h"
+#include "Timer.h"
+#include <cglm/cglm.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+// CPU only, no window or GL context: decodes the given images once serially and once on every core
+int texture_decode_benchmark(int path_count,char** paths) {
+    if(path_count < 1) {
+        fprintf(stderr,"[TEXTURE] --texture-decode-bench needs at least one image\n");
+        return 1;
+    }
+    TextureSource* sources = calloc(path_count,sizeof(TextureSource));
+    DecodedTexture* textures = calloc(path_count,sizeof(DecodedTexture));
+    for(int i = 0; i < path_count; i++)
+        sources[i].path = paths[i];
+
+    TextureDecodeStats stats;
+    texture_decode_batch(NULL,sources,path_count,true,textures,&stats);
+    texture_decoded_free(textures,path_count);
+    texture_decode_stats_print(&stats,1);
+
+    JobSystem* jobs = job_system_create(0);
+    texture_decode_batch(jobs,sources,path_count,true,textures,&stats);
+    texture_decoded_free(textures,path_count);
+    texture_decode_stats_print(&stats,job_system_thread_count(jobs));
+    job_system_destroy(jobs);
+
+    free(textures);
+    free(sources);
+    return stats.failed_count ? -1 : 0;
+}
+
+static u32 texture_bench_hash(u32 x,u32 y,u32 seed) {
+    u32 h = x * 0x8da6b343u ^ y * 0xd8163841u ^ seed * 0xcb1ab31fu;
+    h ^= h >> 15;
+    h *= 0x2c1b3c6du;
+    h ^= h >> 12;
+    return h;
+}
+
+// value noise in [0,1] with a period of cell texels
+static f32 texture_bench_noise(u32 x,u32 y,u32 cell,u32 seed) {
+    u32 cx = x / cell, cy = y / cell;
+    f32 fx = (f32)(x % cell) / cell, fy = (f32)(y % cell) / cell;
+    fx = fx * fx * (3.0f - 2.0f * fx);
+    fy = fy * fy * (3.0f - 2.0f * fy);
+    f32 v00 = (texture_bench_hash(cx,cy,seed) & 0xffff) / 65535.0f, v10 = (texture_bench_hash(cx + 1,cy,seed) & 0xffff) / 65535.0f;
+    f32 v01 = (texture_bench_hash(cx,cy + 1,seed) & 0xffff) / 65535.0f, v11 = (texture_bench_hash(cx + 1,cy + 1,seed) & 0xffff) / 65535.0f;
+    return (v00 * (1.0f - fx) + v10 * fx) * (1.0f - fy) + (v01 * (1.0f - fx) + v11 * fx) * fy;
+}
+
+// stand ins for a scene's textures: 0 is a base color with an alpha cutout, 1 a tangent space normal map and
+// 2 an occlusion map. rgba8, one level
+static void texture_bench_image(u32 kind,u32 size,DecodedTexture* texture) {
+    memset(texture,0,sizeof(DecodedTexture));
+    texture->width = texture->height = size;
+    texture->channels = 4;
+    texture->mip_count = 1;
+    texture->pixels_size = (u64)size * size * 4;
+    texture->pixels = malloc(texture->pixels_size);
+    texture->mips[0] = (TextureMip){ size, size, 0, texture->pixels_size };
+    for(u32 y = 0; y < size; y++)
+        for(u32 x = 0; x < size; x++) {
+            u8* texel = texture->pixels + ((u64)y * size + x) * 4;
+            f32 coarse = texture_bench_noise(x,y,64,kind), fine = texture_bench_noise(x,y,4,kind + 8);
+            f32 grain = (texture_bench_hash(x,y,kind + 16) & 0xff) / 255.0f;
+            if(kind == 0) {
+                texel[0] = (u8)(255.0f * (0.25f + 0.5f * coarse + 0.15f * fine + 0.1f * grain));
+                texel[1] = (u8)(255.0f * (0.2f + 0.4f * coarse + 0.2f * fine + 0.1f * grain));
+                texel[2] = (u8)(255.0f * (0.1f + 0.3f * coarse + 0.1f * fine + 0.1f * grain));
+                texel[3] = texture_bench_noise(x,y,16,kind + 24) > 0.4f ? 255 : 0;
+            } else if(kind == 1) {
+                f32 dx = texture_bench_noise(x + 1,y,16,kind) - texture_bench_noise(x,y,16,kind);
+                f32 dy = texture_bench_noise(x,y + 1,16,kind) - texture_bench_noise(x,y,16,kind);
+                vec3 n = { -dx * 8.0f, -dy * 8.0f, 1.0f };
+                glm_vec3_normalize(n);
+                texel[0] = (u8)(127.5f + 127.5f * n[0]);
+                texel[1] = (u8)(127.5f + 127.5f * n[1]);
+                texel[2] = (u8)(127.5f + 127.5f * n[2]);
+                texel[3] = 255;
+            } else {
+                texel[0] = texel[1] = texel[2] = (u8)(255.0f * (0.4f + 0.5f * coarse + 0.1f * fine));
+                texel[3] = 255;
+            }
+        }
+}
+
+// compresses a texture serially and on every core, checks both wrote the same blocks, that they survive a trip
+// through the cache and that the PSNR reaches min_psnr
+static bool texture_compress_benchmark_texture(JobSystem* jobs,const char* name,const DecodedTexture* texture,TextureFormat format,f64 min_psnr) {
+    CompressedTexture serial, parallel, cached = {0};
+    TextureCompressStats serial_stats, parallel_stats;
+    texture_compress_batch(NULL,texture,&format,1,&serial,&serial_stats);
+    texture_compress_batch(jobs,texture,&format,1,&parallel,&parallel_stats);
+    bool match = serial.blocks_size == parallel.blocks_size && memcmp(serial.blocks,parallel.blocks,serial.blocks_size) == 0;
+
+    char cache_path[256];
+    u64 key = 0x54584542454e4348ull ^ format;
+    texture_cache_path(TEXTURE_CACHE_DIRECTORY,key,cache_path,sizeof(cache_path));
+    bool cache = texture_cache_write(cache_path,key,&parallel) && texture_cache_load(cache_path,key,&cached) &&
+                 cached.blocks_size == parallel.blocks_size && memcmp(cached.blocks,parallel.blocks,cached.blocks_size) == 0;
+    remove(cache_path);
+
+    f64 psnr = 0.0;
+    for(u32 mip = 0; mip < texture->mip_count; mip++)
+        psnr += texture_psnr(texture,&parallel,mip);
+    psnr /= texture->mip_count;
+
+    printf("[TEXTURE] %s %s %ux%u: %.1f Mtexels/s serial, %.1f Mtexels/s on %u threads, %.1f:1 against rgba8, "
+           "PSNR %.2f dB, results %s, cache %s\n",name,texture_format_name(format),texture->width,texture->height,
+           serial_stats.texel_count / fmax(serial_stats.seconds,1e-9) / 1e6,parallel_stats.texel_count / fmax(parallel_stats.seconds,1e-9) / 1e6,
+           job_system_thread_count(jobs),serial_stats.texel_count * 4.0 / parallel.blocks_size,psnr,match ? "match" : "DIFFER",
+           cache ? "ok" : "FAILED");
+
+    texture_compressed_free(&serial,1);
+    texture_compressed_free(&parallel,1);
+    texture_compressed_free(&cached,1);
+    return match && cache && psnr >= min_psnr;
+}
+
+// CPU only: synthetic textures in the format of their role, then every given image in every format without a
+// quality bar
+int texture_compress_benchmark(int path_count,char** paths) {
+    JobSystem* jobs = job_system_create(0);
+    bool passed = true;
+
+    static const struct {
+        const char* name;
+        u32 kind;
+        TextureFormat format;
+        f64 min_psnr;
+    }cases[] = {
+        { "base color", 0, TEXTURE_FORMAT_BC1, 32.0 },
+        { "base color", 0, TEXTURE_FORMAT_BC3, 32.0 },
+        { "base color", 0, TEXTURE_FORMAT_BC7, 36.0 },
+        { "normal", 1, TEXTURE_FORMAT_BC5, 40.0 },
+        { "occlusion", 2, TEXTURE_FORMAT_BC4, 42.0 },
+    };
+    DecodedTexture textures[3];
+    for(u32 kind = 0; kind < 3; kind++)
+        texture_bench_image(kind,1024,&textures[kind]);
+    for(u32 i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+        passed &= texture_compress_benchmark_texture(jobs,cases[i].name,&textures[cases[i].kind],cases[i].format,cases[i].min_psnr);
+    texture_decoded_free(textures,3);
+
+    if(path_count) {
+        TextureSource* sources = calloc(path_count,sizeof(TextureSource));
+        DecodedTexture* decoded = calloc(path_count,sizeof(DecodedTexture));
+        for(int i = 0; i < path_count; i++)
+            sources[i].path = paths[i];
+        TextureDecodeStats stats;
+        texture_decode_batch(jobs,sources,path_count,true,decoded,&stats);
+        for(int i = 0; i < path_count; i++) {
+            if(!decoded[i].pixels) {
+                fprintf(stderr,"[TEXTURE] Failed to decode \"%s\"\n",paths[i]);
+                passed = false;
+                continue;
+            }
+            for(u32 format = 0; format < TEXTURE_FORMAT_COUNT; format++)
+                passed &= texture_compress_benchmark_texture(jobs,paths[i],&decoded[i],format,0.0);
+        }
+        texture_decoded_free(decoded,path_count);
+        free(decoded);
+        free(sources);
+    }
+
+    remove(TEXTURE_CACHE_DIRECTORY); // only removes it when empty
+    job_system_destroy(jobs);
+    return passed ? 0 : 1;
+}
+
+static DecodedTexture mip_bench_copy(const DecodedTexture* texture) {
+    DecodedTexture copy = *texture;
+    copy.pixels = malloc(texture->mips[0].size);
+    memcpy(copy.pixels,texture->pixels,texture->mips[0].size);
+    copy.pixels_size = texture->mips[0].size;
+    copy.mip_count = 1;
+    return copy;
+}
+
+// largest distance of any texel of any level past 0 from value, over the first channels
+static u32 mip_bench_deviation(const DecodedTexture* texture,const u8* value) {
+    u32 deviation = 0;
+    for(u32 mip = 1; mip < texture->mip_count; mip++) {
+        const TextureMip* level = &texture->mips[mip];
+        for(u64 i = 0; i < level->size; i++) {
+            i32 d = abs((i32)texture->pixels[level->offset + i] - (i32)value[i % texture->channels]);
+            deviation = (u32)d > deviation ? (u32)d : deviation;
+        }
+    }
+    return deviation;
+}
+
+// largest difference from 1 of the length of a normal map's texels, over every level past 0
+static f32 mip_bench_normal_error(const DecodedTexture* texture) {
+    f32 error = 0.0f;
+    for(u32 mip = 1; mip < texture->mip_count; mip++) {
+        const TextureMip* level = &texture->mips[mip];
+        for(u64 i = 0; i < level->size; i += texture->channels) {
+            const u8* texel = texture->pixels + level->offset + i;
+            vec3 n = { texel[0] / 127.5f - 1.0f, texel[1] / 127.5f - 1.0f, texel[2] / 127.5f - 1.0f };
+            error = fmaxf(error,fabsf(glm_vec3_norm(n) - 1.0f));
+        }
+    }
+    return error;
+}
+
+// builds each synthetic texture's chain serially and on every core, checking both match, then checks a flat
+// texture keeps its value on every level, a normal map stays unit length and a black and white checker filters
+// to linear grey in sRGB mode rather than to the sRGB midpoint
+int mip_benchmark(int argc,char** argv) {
+    u32 size = bench_arg(argc,argv,0,2048);
+    JobSystem* jobs = job_system_create(0);
+    bool passed = true;
+    printf("[MIP] Kaiser filter, width %.1f alpha %.1f, %s\n",MIP_KAISER_WIDTH,MIP_KAISER_ALPHA,mip_isa());
+
+    static const struct {
+        const char* name;
+        u32 kind;
+        MipMode mode;
+    }cases[] = {
+        { "base color", 0, MIP_MODE_SRGB },
+        { "normal", 1, MIP_MODE_NORMAL },
+        { "occlusion", 2, MIP_MODE_LINEAR },
+    };
+    for(u32 i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        DecodedTexture source, serial, parallel;
+        texture_bench_image(cases[i].kind,size,&source);
+        serial = mip_bench_copy(&source);
+        parallel = mip_bench_copy(&source);
+        MipStats serial_stats, parallel_stats;
+        mip_generate_batch(NULL,&serial,&cases[i].mode,1,&serial_stats);
+        mip_generate_batch(jobs,&parallel,&cases[i].mode,1,&parallel_stats);
+        bool match = serial.pixels_size == parallel.pixels_size && memcmp(serial.pixels,parallel.pixels,serial.pixels_size) == 0;
+        f32 normal_error = cases[i].mode == MIP_MODE_NORMAL ? mip_bench_normal_error(&parallel) : 0.0f;
+        passed &= match && normal_error < 0.01f;
+        printf("[MIP] %s %ux%u %s: %.2f ms serial, %.2f ms on %u threads (%.1f Mtexels/s), %u levels, results %s",
+               cases[i].name,size,size,mip_mode_name(cases[i].mode),serial_stats.seconds * 1000.0,parallel_stats.seconds * 1000.0,
+               job_system_thread_count(jobs),parallel_stats.source_texels / fmax(parallel_stats.seconds,1e-9) / 1e6,
+               parallel.mip_count,match ? "match" : "DIFFER");
+        if(cases[i].mode == MIP_MODE_NORMAL)
+            printf(", max length error %.4f",normal_error);
+        printf("\n");
+        texture_decoded_free(&source,1);
+        texture_decoded_free(&serial,1);
+        texture_decoded_free(&parallel,1);
+    }
+
+    // odd sizes so the kernels are not all the same 2:1 pattern
+    static const u8 flat_values[MIP_MODE_COUNT][4] = { { 200, 100, 50, 128 }, { 200, 100, 50, 128 }, { 128, 128, 255, 255 } };
+    for(u32 mode = 0; mode < MIP_MODE_COUNT; mode++) {
+        DecodedTexture flat = {0};
+        flat.width = 37;
+        flat.height = 23;
+        flat.channels = 4;
+        flat.mip_count = 1;
+        flat.pixels_size = flat.width * flat.height * 4;
+        flat.mips[0] = (TextureMip){ flat.width, flat.height, 0, flat.pixels_size };
+        flat.pixels = malloc(flat.pixels_size);
+        for(u64 i = 0; i < flat.pixels_size; i++)
+            flat.pixels[i] = flat_values[mode][i % 4];
+        mip_generate(jobs,&flat,mode);
+        u32 deviation = mip_bench_deviation(&flat,flat_values[mode]);
+        passed &= deviation == 0;
+        printf("[MIP] flat 37x23 %s: %u levels, max deviation %u\n",mip_mode_name(mode),flat.mip_count,deviation);
+        texture_decoded_free(&flat,1);
+    }
+
+    // linear 0.5 is sRGB 188, a gamma space filter would give 128
+    u8 grey[2] = { 0, 0 };
+    for(u32 mode = MIP_MODE_LINEAR; mode <= MIP_MODE_SRGB; mode++) {
+        DecodedTexture checker = {0};
+        checker.width = checker.height = 64;
+        checker.channels = 1;
+        checker.mip_count = 1;
+        checker.pixels_size = 64 * 64;
+        checker.mips[0] = (TextureMip){ 64, 64, 0, checker.pixels_size };
+        checker.pixels = malloc(checker.pixels_size);
+        for(u32 y = 0; y < 64; y++)
+            for(u32 x = 0; x < 64; x++)
+                checker.pixels[y * 64 + x] = (x ^ y) & 1 ? 255 : 0;
+        mip_generate(jobs,&checker,mode);
+        grey[mode] = checker.pixels[checker.mips[1].offset + 16 * 32 + 16];
+        texture_decoded_free(&checker,1);
+    }
+    passed &= abs(grey[MIP_MODE_SRGB] - 188) <= 2 && abs(grey[MIP_MODE_LINEAR] - 128) <= 2;
+    printf("[MIP] 1 texel checker level 1: %u linear, %u sRGB\n",grey[MIP_MODE_LINEAR],grey[MIP_MODE_SRGB]);
+
+    job_system_destroy(jobs);
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,161 @@
+#include "Bench.h"
+#include "VertexPacking.h"
+#include "Timer.h"
+#include <cglm/cglm.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define VERTEX_PACK_MAX_NORMAL_ERROR  0.003 // degrees, octahedral snorm16
+#define VERTEX_PACK_MAX_TANGENT_ERROR 0.008 // degrees, one bit of the second component holds the handedness
+
+static f32 vertex_pack_bench_random(u32* seed) {
+    *seed = *seed * 1664525u + 1013904223u;
+    return (*seed >> 8) / 16777216.0f;
+}
+
+// the axes and the octant diagonals first, the folds of the octahedral map, then uniform over the sphere
+static void vertex_pack_bench_direction(u32 index,u32* seed,f32 dest[3]) {
+    if(index < 6) {
+        dest[0] = dest[1] = dest[2] = 0.0f;
+        dest[index / 2] = index & 1 ? -1.0f : 1.0f;
+        return;
+    }
+    if(index < 14) {
+        for(u32 axis = 0; axis < 3; axis++)
+            dest[axis] = ((index - 6) >> axis) & 1 ? -0.57735027f : 0.57735027f;
+        return;
+    }
+    f32 z = vertex_pack_bench_random(seed) * 2.0f - 1.0f;
+    f32 phi = vertex_pack_bench_random(seed) * 2.0f * GLM_PIf;
+    f32 r = sqrtf(fmaxf(1.0f - z * z,0.0f));
+    dest[0] = r * cosf(phi);
+    dest[1] = r * sinf(phi);
+    dest[2] = z;
+}
+
+// degrees between two directions, atan2 keeps its precision for the tiny angles acos loses
+static f64 vertex_pack_bench_angle(const f32 a[3],const f32 b[3]) {
+    f64 cross[3] = {
+        (f64)a[1] * b[2] - (f64)a[2] * b[1],
+        (f64)a[2] * b[0] - (f64)a[0] * b[2],
+        (f64)a[0] * b[1] - (f64)a[1] * b[0]
+    };
+    f64 dot = (f64)a[0] * b[0] + (f64)a[1] * b[1] + (f64)a[2] * b[2];
+    return atan2(sqrt(cross[0] * cross[0] + cross[1] * cross[1] + cross[2] * cross[2]),dot) * 180.0 / GLM_PI;
+}
+
+// CPU only: packs count random verticies serially and on every core, checks both match, then unpacks them and
+// checks the octahedral normals and tangents stay within their angular error with the handedness kept, the half
+// float UVs within half an ulp, every unorm8 color value comes back exactly and the skin weights within unorm16
+int vertex_pack_benchmark(int argc,char** argv) {
+    u32 count = bench_arg(argc,argv,0,1000000);
+    count = count < 256 ? 256 : count;
+    JobSystem* jobs = job_system_create(0);
+    Scene serial, parallel;
+    scene_init(&serial);
+    scene_init(&parallel);
+    vector_reserve(serial.vertex_vector,Vertex,count + 1);
+    serial.vertex_vector.size = count;
+
+    u32 seed = 1;
+    for(u32 i = 0; i < count; i++) {
+        Vertex* vertex = &serial.vertex_vector.data[i];
+        memset(vertex,0,sizeof(Vertex));
+        for(u32 axis = 0; axis < 3; axis++)
+            vertex->position[axis] = (vertex_pack_bench_random(&seed) * 2.0f - 1.0f) * 100.0f;
+        vertex_pack_bench_direction(i,&seed,vertex->normal);
+        vertex_pack_bench_direction((i * 7) % count,&seed,vertex->tangent);
+        vertex->tangent[3] = i & 1 ? -1.0f : 1.0f;
+        for(u32 j = 0; j < 2; j++) {
+            vertex->uv0[j] = (vertex_pack_bench_random(&seed) * 2.0f - 1.0f) * 16.0f; // tiled
+            vertex->uv1[j] = vertex_pack_bench_random(&seed);
+        }
+        // every unorm8 value once, then random ones
+        for(u32 j = 0; j < 4; j++)
+            vertex->color[j] = i < 256 ? ((i + j * 64) % 256) / 255.0f : vertex_pack_bench_random(&seed);
+        f32 weight_sum = 0.0f;
+        for(u32 j = 0; j < 4; j++) {
+            vertex->weights[j] = vertex_pack_bench_random(&seed);
+            weight_sum += vertex->weights[j];
+        }
+        glm_vec4_scale(vertex->weights,1.0f / weight_sum,vertex->weights);
+        u16 joints[4];
+        for(u32 j = 0; j < 4; j++)
+            joints[j] = (u16)(vertex_pack_bench_random(&seed) * 65536.0f);
+        memcpy(&vertex->joint_ids,joints,sizeof(joints));
+    }
+    vector_push_array(parallel.vertex_vector,Vertex,serial.vertex_vector.data,count);
+    Vertex* source = malloc(count * sizeof(Vertex));
+    memcpy(source,serial.vertex_vector.data,count * sizeof(Vertex));
+
+    f64 start = timer_now();
+    scene_pack_vertices(NULL,&serial,true,0,0);
+    f64 serial_seconds = timer_now() - start;
+    start = timer_now();
+    scene_pack_vertices(jobs,&parallel,true,0,0);
+    f64 parallel_seconds = timer_now() - start;
+
+    u32 errors = 0;
+    bool match = serial.packed_vertex_vector.size == count && parallel.packed_vertex_vector.size == count &&
+                 serial.skin_vertex_vector.size == count && parallel.skin_vertex_vector.size == count &&
+                 memcmp(serial.packed_vertex_vector.data,parallel.packed_vertex_vector.data,count * sizeof(PackedVertex)) == 0 &&
+                 memcmp(serial.skin_vertex_vector.data,parallel.skin_vertex_vector.data,count * sizeof(SkinVertex)) == 0;
+    if(!match) {
+        fprintf(stderr,"[PACK] serial and parallel packing differ\n");
+        ++errors;
+    }
+
+    f64 normal_error = 0.0, tangent_error = 0.0, uv_error = 0.0, color_error = 0.0, weight_error = 0.0;
+    u32 handedness_flips = 0, position_changes = 0, joint_changes = 0, color_misses = 0;
+    for(u32 i = 0; i < count && match; i++) {
+        Vertex unpacked;
+        unpack_vertex(&serial.packed_vertex_vector.data[i],&serial.skin_vertex_vector.data[i],&unpacked);
+        const Vertex* vertex = &source[i];
+        position_changes += memcmp(unpacked.position,vertex->position,sizeof(vec3)) != 0;
+        normal_error = fmax(normal_error,vertex_pack_bench_angle(unpacked.normal,vertex->normal));
+        tangent_error = fmax(tangent_error,vertex_pack_bench_angle(unpacked.tangent,vertex->tangent));
+        handedness_flips += unpacked.tangent[3] != vertex->tangent[3];
+        for(u32 j = 0; j < 2; j++) {
+            // half an ulp of a half float is 2^-11 of the value, 2^-25 among the denormals
+            f64 ulps[2] = { fmax(fabs(vertex->uv0[j]) / 2048.0,1.0 / 33554432.0), fmax(fabs(vertex->uv1[j]) / 2048.0,1.0 / 33554432.0) };
+            uv_error = fmax(uv_error,fabs(unpacked.uv0[j] - vertex->uv0[j]) / ulps[0]);
+            uv_error = fmax(uv_error,fabs(unpacked.uv1[j] - vertex->uv1[j]) / ulps[1]);
+        }
+        for(u32 j = 0; j < 4; j++) {
+            color_error = fmax(color_error,fabs(unpacked.color[j] - vertex->color[j]) * 255.0);
+            weight_error = fmax(weight_error,fabs(unpacked.weights[j] - vertex->weights[j]) * 65535.0);
+            if(i < 256)
+                color_misses += serial.packed_vertex_vector.data[i].color[j] != (i + j * 64) % 256;
+        }
+        joint_changes += unpacked.joint_ids != vertex->joint_ids;
+    }
+    if(normal_error > VERTEX_PACK_MAX_NORMAL_ERROR || tangent_error > VERTEX_PACK_MAX_TANGENT_ERROR || handedness_flips) {
+        fprintf(stderr,"[PACK] octahedral error above %.3f / %.3f degrees or handedness lost\n",VERTEX_PACK_MAX_NORMAL_ERROR,
+                VERTEX_PACK_MAX_TANGENT_ERROR);
+        ++errors;
+    }
+    // half an ulp or half a step, with room for the float rounding, which is a hundredth of a unorm16 step
+    if(uv_error > 1.001 || color_error > 0.501 || weight_error > 0.51 || color_misses) {
+        fprintf(stderr,"[PACK] UV, color or weight error above half a step\n");
+        ++errors;
+    }
+    if(position_changes || joint_changes) {
+        fprintf(stderr,"[PACK] %u positions and %u joint ids changed\n",position_changes,joint_changes);
+        ++errors;
+    }
+
+    printf("[PACK] %u verticies: %.2f ms serial, %.2f ms on %u threads (%.1f Mverticies/s), %u -> %u + %u bytes each\n",count,
+           serial_seconds * 1000.0,parallel_seconds * 1000.0,job_system_thread_count(jobs),count / fmax(parallel_seconds,1e-9) / 1e6,
+           (u32)sizeof(Vertex),(u32)sizeof(PackedVertex),(u32)sizeof(SkinVertex));
+    printf("[PACK] max error: normal %.5f deg, tangent %.5f deg, %u handedness flips, UV %.3f half ulps, color %.3f steps, weight %.3f steps\n",
+           normal_error,tangent_error,handedness_flips,uv_error,color_error,weight_error);
+    printf("[PACK] %u errors\n",errors);
+
+    free(source);
+    scene_data_destroy(&serial);
+    scene_data_destroy(&parallel);
+    job_system_destroy(jobs);
+    return errors ? 1 : 0;
+}
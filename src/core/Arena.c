@@ -1,21 +1,147 @@
 #include "Arena.h"
+#include "Global.h"
 #include <stdbool.h>
 #include <stdint.h>
+#include <stdio.h>
+#include <assert.h>
 
-bool arena_create(Arena* arena,uint32_t capacity) {
-    arena->storage = malloc(capacity);
-    if(!arena->storage) return false;
-    arena->capacity = capacity; 
-    arena->base = 0;
+#define SCRATCH_BLOCK_SIZE MB(4)
+
+struct ArenaBlock {
+    ArenaBlock* prev;
+    uint64_t capacity;
+    uint64_t used;
+};
+
+// data starts right after the header, kept at the default alignment
+#define BLOCK_HEADER_SIZE ((sizeof(ArenaBlock) + ARENA_DEFAULT_ALIGNMENT - 1) & ~(uint64_t)(ARENA_DEFAULT_ALIGNMENT - 1))
+
+static THREAD_LOCAL Arena scratch_arena;
+
+static uint8_t* block_data(ArenaBlock* block) {
+    return (uint8_t*)block + BLOCK_HEADER_SIZE;
+}
+
+static ArenaBlock* block_create(ArenaBlock* prev,uint64_t capacity) {
+    ArenaBlock* block = malloc(BLOCK_HEADER_SIZE + capacity);
+    if(!block) return NULL;
+    block->prev = prev;
+    block->capacity = capacity;
+    block->used = 0;
+    return block;
+}
+
+bool arena_create(Arena* arena,uint64_t capacity) {
+    arena->current = block_create(NULL,capacity);
+    if(!arena->current) return false;
+    arena->block_size  = capacity;
+    arena->used        = 0;
+    arena->high_water  = 0;
+    arena->reserved    = capacity;
+    arena->block_count = 1;
     return true;
 }
 
 void arena_free(Arena* arena) {
-    free(arena->storage);
+    ArenaBlock* block = arena->current;
+    while(block) {
+        ArenaBlock* prev = block->prev;
+        free(block);
+        block = prev;
+    }
+    arena->current = NULL;
+    arena->used = 0;
+    arena->reserved = 0;
+    arena->block_count = 0;
 }
 
-void* arena_alloc_(Arena* arena, uint32_t element_size,uint32_t count) {
-    void* mem = (uint8_t*)arena->storage + arena->base;
-    arena->base += count*element_size;
+void* arena_alloc_aligned(Arena* arena,uint64_t size,uint64_t alignment) {
+    assert((alignment & (alignment - 1)) == 0 && "Alignment has to be a power of two");
+    if(alignment < 1) alignment = 1;
+
+    ArenaBlock* block = arena->current;
+    uint64_t base = block ? (uint64_t)(uintptr_t)(block_data(block) + block->used) : 0;
+    uint64_t padding = (alignment - (base & (alignment - 1))) & (alignment - 1);
+
+    if(!block || block->used + padding + size > block->capacity) {
+        uint64_t capacity = size + alignment > arena->block_size ? size + alignment : arena->block_size;
+        ArenaBlock* next = block_create(block,capacity);
+        if(!next) return NULL;
+
+        // whatever was left in the old block is counted as used so restore stays exact
+        if(block)
+            arena->used += block->capacity - block->used;
+        arena->current = next;
+        arena->reserved += capacity;
+        ++arena->block_count;
+
+        block = next;
+        base = (uint64_t)(uintptr_t)block_data(block);
+        padding = (alignment - (base & (alignment - 1))) & (alignment - 1);
+    }
+
+    void* mem = block_data(block) + block->used + padding;
+    block->used += padding + size;
+    arena->used += padding + size;
+    if(arena->used > arena->high_water)
+        arena->high_water = arena->used;
     return mem;
 }
+
+void* arena_alloc_(Arena* arena, uint64_t element_size,uint64_t count) {
+    if(element_size && count > UINT64_MAX / element_size)
+        return NULL;
+
+    // natural alignment of the element, capped at the default
+    uint64_t alignment = element_size & (~element_size + 1);
+    if(!alignment || alignment > ARENA_DEFAULT_ALIGNMENT)
+        alignment = ARENA_DEFAULT_ALIGNMENT;
+    return arena_alloc_aligned(arena,element_size * count,alignment);
+}
+
+ArenaMarker arena_marker(const Arena* arena) {
+    ArenaMarker marker = { arena->current, arena->current ? arena->current->used : 0, arena->used };
+    return marker;
+}
+
+void arena_restore(Arena* arena,ArenaMarker marker) {
+    while(arena->current && arena->current != marker.block) {
+        ArenaBlock* prev = arena->current->prev;
+        arena->reserved -= arena->current->capacity;
+        --arena->block_count;
+        free(arena->current);
+        arena->current = prev;
+    }
+    if(arena->current)
+        arena->current->used = marker.block_used;
+    arena->used = marker.used;
+}
+
+void arena_reset(Arena* arena) {
+    while(arena->current && arena->current->prev) {
+        ArenaBlock* prev = arena->current->prev;
+        arena->reserved -= arena->current->capacity;
+        --arena->block_count;
+        free(arena->current);
+        arena->current = prev;
+    }
+    if(arena->current)
+        arena->current->used = 0;
+    arena->used = 0;
+}
+
+Arena* arena_scratch(void) {
+    if(!scratch_arena.current)
+        arena_create(&scratch_arena,SCRATCH_BLOCK_SIZE);
+    return &scratch_arena;
+}
+
+void arena_scratch_release(void) {
+    arena_free(&scratch_arena);
+}
+
+void arena_print_stats(const Arena* arena,const char* name) {
+    printf("[ARENA] %s: %.2f MB used, %.2f MB high water, %.2f MB reserved in %u blocks\n",name,
+           arena->used / (1024.0 * 1024.0),arena->high_water / (1024.0 * 1024.0),
+           arena->reserved / (1024.0 * 1024.0),arena->block_count);
+}
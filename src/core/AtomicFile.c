@@ -0,0 +1,30 @@
+#include "AtomicFile.h"
+
+bool atomic_file_open(AtomicFile* atomic,const char* path) {
+    atomic->file = NULL;
+    atomic->path = path;
+    if(snprintf(atomic->tmp_path,sizeof(atomic->tmp_path),"%s.tmp",path) >= (int)sizeof(atomic->tmp_path))
+        return false;
+    atomic->file = fopen(atomic->tmp_path,"wb");
+    return atomic->file != NULL;
+}
+
+bool atomic_file_commit(AtomicFile* atomic,bool ok) {
+    ok = (fclose(atomic->file) == 0) && ok;
+    atomic->file = NULL;
+    if(!ok) {
+        remove(atomic->tmp_path);
+        return false;
+    }
+    remove(atomic->path);
+    return rename(atomic->tmp_path,atomic->path) == 0;
+}
+
+bool file_write_atomic(const char* path,const void* header,u64 header_size,const void* payload,u64 payload_size) {
+    AtomicFile atomic;
+    if(!atomic_file_open(&atomic,path))
+        return false;
+    bool ok = fwrite(header,1,header_size,atomic.file) == header_size;
+    ok = ok && (!payload_size || fwrite(payload,1,payload_size,atomic.file) == payload_size);
+    return atomic_file_commit(&atomic,ok);
+}
@@ -0,0 +1,639 @@
+#include "BVH.h"
+#include "Vector.h"
+#include <cglm/cglm.h>
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BVH_PARALLEL_BINNING 65536 // top level nodes with more items bin on every thread
+#define BVH_BIN_BATCH 16384
+#define BVH_MIN_TASK_SIZE 1024
+
+typedef struct {
+    vec3 min, max;   // item bounds
+    vec3 cmin, cmax; // centroid bounds
+    u32 count;
+}Bin;
+
+typedef Bin BinSet[3][BVH_BINS];
+
+typedef struct {
+    BVHNode* nodes;
+    u32 node_count;
+    u32 depth;
+}NodeBuffer;
+
+// a subtree left for a worker, its root already sits in the top level buffer
+typedef struct {
+    u32 node;
+    u32 depth;
+    vec3 cmin, cmax;
+    NodeBuffer buffer;
+}BuildTask;
+
+typedef struct {
+    JobSystem* jobs; // only set while the top levels are built on the calling thread
+    const AABB* boxes;
+    vec3* centroids;
+    u32* indices;
+    u32 task_threshold; // nodes with at most this many items are left as tasks, 0 inside a task
+    vector(BuildTask) tasks;
+}Builder;
+
+typedef struct {
+    const Builder* builder;
+    u32 first;
+    u32 count;
+    const f32* cmin;
+    const f32* scale;
+    BinSet* partial;
+}BinJob;
+
+typedef struct {
+    const void* positions;
+    u32 position_stride;
+    const u32* indices;
+    AABB* boxes;
+}TriangleBoundsJob;
+
+static void grow(f32* min,f32* max,const f32* point_min,const f32* point_max) {
+    for(u32 axis = 0; axis < 3; axis++) {
+        min[axis] = point_min[axis] < min[axis] ? point_min[axis] : min[axis];
+        max[axis] = point_max[axis] > max[axis] ? point_max[axis] : max[axis];
+    }
+}
+
+static void empty_bounds(f32* min,f32* max) {
+    for(u32 axis = 0; axis < 3; axis++) {
+        min[axis] = FLT_MAX;
+        max[axis] = -FLT_MAX;
+    }
+}
+
+static f32 half_area(const f32* min,const f32* max) {
+    f32 x = max[0] - min[0], y = max[1] - min[1], z = max[2] - min[2];
+    return x < 0.0f ? 0.0f : x * y + y * z + z * x;
+}
+
+static u32 bin_index(f32 centroid,f32 cmin,f32 scale) {
+    i32 bin = (i32)((centroid - cmin) * scale);
+    return bin < 0 ? 0 : (bin >= BVH_BINS ? BVH_BINS - 1 : (u32)bin);
+}
+
+static void bins_clear(BinSet bins) {
+    for(u32 axis = 0; axis < 3; axis++) {
+        for(u32 b = 0; b < BVH_BINS; b++) {
+            empty_bounds(bins[axis][b].min,bins[axis][b].max);
+            empty_bounds(bins[axis][b].cmin,bins[axis][b].cmax);
+            bins[axis][b].count = 0;
+        }
+    }
+}
+
+static void bin_items(const Builder* builder,u32 first,u32 count,const f32* cmin,const f32* scale,BinSet bins) {
+    bins_clear(bins);
+    for(u32 i = first; i < first + count; i++) {
+        u32 item = builder->indices[i];
+        const AABB* box = &builder->boxes[item];
+        const f32* centroid = builder->centroids[item];
+        for(u32 axis = 0; axis < 3; axis++) {
+            Bin* bin = &bins[axis][bin_index(centroid[axis],cmin[axis],scale[axis])];
+            grow(bin->min,bin->max,box->min,box->max);
+            grow(bin->cmin,bin->cmax,centroid,centroid);
+            ++bin->count;
+        }
+    }
+}
+
+static void bin_job(void* data,u32 begin,u32 end) {
+    BinJob* job = (BinJob*)data;
+    for(u32 batch = begin; batch < end; batch++) {
+        u32 first = job->first + batch * BVH_BIN_BATCH;
+        u32 last = first + BVH_BIN_BATCH < job->first + job->count ? first + BVH_BIN_BATCH : job->first + job->count;
+        bin_items(job->builder,first,last - first,job->cmin,job->scale,job->partial[batch]);
+    }
+}
+
+static void merge_bin(Bin* dest,const Bin* bin) {
+    grow(dest->min,dest->max,bin->min,bin->max);
+    grow(dest->cmin,dest->cmax,bin->cmin,bin->cmax);
+    dest->count += bin->count;
+}
+
+static void range_bounds(const Builder* builder,u32 first,u32 count,f32* min,f32* max,f32* cmin,f32* cmax) {
+    empty_bounds(min,max);
+    empty_bounds(cmin,cmax);
+    for(u32 i = first; i < first + count; i++) {
+        u32 item = builder->indices[i];
+        grow(min,max,builder->boxes[item].min,builder->boxes[item].max);
+        grow(cmin,cmax,builder->centroids[item],builder->centroids[item]);
+    }
+}
+
+static void subdivide(Builder* builder,NodeBuffer* buffer,u32 node_index,const f32* cmin,const f32* cmax,u32 depth) {
+    BVHNode* node = &buffer->nodes[node_index];
+    if(depth > buffer->depth)
+        buffer->depth = depth;
+
+    u32 first = node->left_first, count = node->count;
+    if(count <= 1 || depth + 1 >= BVH_MAX_DEPTH)
+        return;
+
+    if(builder->task_threshold && count <= builder->task_threshold) {
+        BuildTask task = { node_index, depth, { cmin[0], cmin[1], cmin[2] }, { cmax[0], cmax[1], cmax[2] }, { NULL, 0, 0 } };
+        vector_push(builder->tasks,BuildTask,task);
+        return;
+    }
+
+    vec3 scale;
+    bool separable = false;
+    for(u32 axis = 0; axis < 3; axis++) {
+        f32 extent = cmax[axis] - cmin[axis];
+        scale[axis] = extent > 0.0f ? BVH_BINS * 0.9999f / extent : 0.0f;
+        separable |= extent > 0.0f;
+    }
+
+    u32 best_axis = 0, best_split = 0, left_count = 0;
+    f32 best_cost = FLT_MAX;
+    BinSet bins;
+    if(separable) {
+        if(builder->jobs && count >= BVH_PARALLEL_BINNING) {
+            u32 batch_count = (count + BVH_BIN_BATCH - 1) / BVH_BIN_BATCH;
+            BinJob job = { builder, first, count, cmin, scale, malloc(batch_count * sizeof(BinSet)) };
+            job_system_parallel_for(builder->jobs,batch_count,1,bin_job,&job);
+            bins_clear(bins);
+            for(u32 batch = 0; batch < batch_count; batch++)
+                for(u32 axis = 0; axis < 3; axis++)
+                    for(u32 b = 0; b < BVH_BINS; b++)
+                        merge_bin(&bins[axis][b],&job.partial[batch][axis][b]);
+            free(job.partial);
+        } else {
+            bin_items(builder,first,count,cmin,scale,bins);
+        }
+
+        // sweep from both ends, split s puts bins [0,s) on the left
+        for(u32 axis = 0; axis < 3; axis++) {
+            if(scale[axis] == 0.0f)
+                continue;
+
+            f32 right_cost[BVH_BINS];
+            vec3 min, max;
+            empty_bounds(min,max);
+            u32 right = 0;
+            for(u32 s = BVH_BINS - 1; s > 0; s--) {
+                grow(min,max,bins[axis][s].min,bins[axis][s].max);
+                right += bins[axis][s].count;
+                right_cost[s] = half_area(min,max) * right;
+            }
+
+            empty_bounds(min,max);
+            u32 left = 0;
+            for(u32 s = 1; s < BVH_BINS; s++) {
+                grow(min,max,bins[axis][s - 1].min,bins[axis][s - 1].max);
+                left += bins[axis][s - 1].count;
+                if(!left || left == count)
+                    continue;
+                f32 cost = half_area(min,max) * left + right_cost[s];
+                if(cost < best_cost) {
+                    best_cost = cost;
+                    best_axis = axis;
+                    best_split = s;
+                    left_count = left;
+                }
+            }
+        }
+    }
+
+    vec3 left_min, left_max, left_cmin, left_cmax, right_min, right_max, right_cmin, right_cmax;
+    if(best_cost != FLT_MAX) {
+        f32 area = half_area(node->min,node->max);
+        if(count <= BVH_MAX_LEAF_SIZE && BVH_TRAVERSAL_COST * area + best_cost >= area * count)
+            return;
+
+        u32 i = first, end = first + count;
+        while(i < end) {
+            if(bin_index(builder->centroids[builder->indices[i]][best_axis],cmin[best_axis],scale[best_axis]) < best_split) {
+                ++i;
+            } else {
+                u32 swap = builder->indices[i];
+                builder->indices[i] = builder->indices[--end];
+                builder->indices[end] = swap;
+            }
+        }
+
+        empty_bounds(left_min,left_max);
+        empty_bounds(left_cmin,left_cmax);
+        empty_bounds(right_min,right_max);
+        empty_bounds(right_cmin,right_cmax);
+        for(u32 b = 0; b < BVH_BINS; b++) {
+            const Bin* bin = &bins[best_axis][b];
+            if(b < best_split) {
+                grow(left_min,left_max,bin->min,bin->max);
+                grow(left_cmin,left_cmax,bin->cmin,bin->cmax);
+            } else {
+                grow(right_min,right_max,bin->min,bin->max);
+                grow(right_cmin,right_cmax,bin->cmin,bin->cmax);
+            }
+        }
+    } else {
+        // every centroid is the same point, binning cannot separate them
+        if(count <= BVH_MAX_LEAF_SIZE)
+            return;
+        left_count = count / 2;
+        range_bounds(builder,first,left_count,left_min,left_max,left_cmin,left_cmax);
+        range_bounds(builder,first + left_count,count - left_count,right_min,right_max,right_cmin,right_cmax);
+    }
+
+    u32 left = buffer->node_count;
+    buffer->node_count += 2;
+    BVHNode* left_node = &buffer->nodes[left];
+    BVHNode* right_node = &buffer->nodes[left + 1];
+    glm_vec3_copy(left_min,left_node->min);
+    glm_vec3_copy(left_max,left_node->max);
+    left_node->left_first = first;
+    left_node->count = left_count;
+    glm_vec3_copy(right_min,right_node->min);
+    glm_vec3_copy(right_max,right_node->max);
+    right_node->left_first = first + left_count;
+    right_node->count = count - left_count;
+    node->left_first = left;
+    node->count = 0;
+
+    subdivide(builder,buffer,left,left_cmin,left_cmax,depth + 1);
+    subdivide(builder,buffer,left + 1,right_cmin,right_cmax,depth + 1);
+}
+
+static void task_job(void* data,u32 begin,u32 end) {
+    Builder* builder = (Builder*)data;
+    for(u32 t = begin; t < end; t++) {
+        BuildTask* task = &builder->tasks.data[t];
+        NodeBuffer* buffer = &task->buffer;
+        u32 count = buffer->nodes[0].count;
+        buffer->nodes = realloc(buffer->nodes,(count * 2 - 1) * sizeof(BVHNode));
+        subdivide(builder,buffer,0,task->cmin,task->cmax,task->depth);
+    }
+}
+
+static void centroid_job(void* data,u32 begin,u32 end) {
+    Builder* builder = (Builder*)data;
+    for(u32 i = begin; i < end; i++) {
+        const AABB* box = &builder->boxes[i];
+        for(u32 axis = 0; axis < 3; axis++)
+            builder->centroids[i][axis] = (box->min[axis] + box->max[axis]) * 0.5f;
+        builder->indices[i] = i;
+    }
+}
+
+void bvh_build(BVH* bvh,JobSystem* jobs,const AABB* boxes,u32 count) {
+    memset(bvh,0,sizeof(BVH));
+    bvh->item_count = count;
+    bvh->item_indices = malloc((count + 1) * sizeof(u32));
+    bvh->item_boxes = malloc((count + 1) * sizeof(AABB));
+    bvh->nodes = malloc((count ? count * 2 - 1 : 1) * sizeof(BVHNode));
+    if(!count)
+        return;
+
+    Builder builder = { jobs, boxes, malloc(count * sizeof(vec3)), bvh->item_indices, 0 };
+    job_system_parallel_for(jobs,count,4096,centroid_job,&builder);
+
+    u32 thread_count = jobs ? job_system_thread_count(jobs) : 1;
+    if(thread_count > 1) {
+        builder.task_threshold = count / (thread_count * 8);
+        if(builder.task_threshold < BVH_MIN_TASK_SIZE)
+            builder.task_threshold = BVH_MIN_TASK_SIZE;
+    }
+    vector_create(builder.tasks,BuildTask);
+
+    NodeBuffer top = { bvh->nodes, 1, 0 };
+    vec3 cmin, cmax;
+    range_bounds(&builder,0,count,bvh->nodes[0].min,bvh->nodes[0].max,cmin,cmax);
+    bvh->nodes[0].left_first = 0;
+    bvh->nodes[0].count = count;
+    subdivide(&builder,&top,0,cmin,cmax,0);
+
+    if(builder.tasks.size) {
+        for(u32 t = 0; t < builder.tasks.size; t++) {
+            BuildTask* task = &builder.tasks.data[t];
+            task->buffer.nodes = malloc(sizeof(BVHNode));
+            task->buffer.nodes[0] = top.nodes[task->node];
+            task->buffer.node_count = 1;
+            task->buffer.depth = task->depth;
+        }
+
+        builder.jobs = NULL;
+        builder.task_threshold = 0;
+        job_system_parallel_for(jobs,builder.tasks.size,1,task_job,&builder);
+
+        // append every subtree depth first behind the top levels, its local node i lands at base + i - 1
+        for(u32 t = 0; t < builder.tasks.size; t++) {
+            const NodeBuffer* buffer = &builder.tasks.data[t].buffer;
+            u32 base = top.node_count;
+            for(u32 i = 0; i < buffer->node_count; i++) {
+                BVHNode node = buffer->nodes[i];
+                if(!node.count)
+                    node.left_first += base - 1;
+                top.nodes[i ? base + i - 1 : builder.tasks.data[t].node] = node;
+            }
+            top.node_count += buffer->node_count - 1;
+            if(buffer->depth > top.depth)
+                top.depth = buffer->depth;
+            free(buffer->nodes);
+        }
+    }
+
+    for(u32 i = 0; i < count; i++)
+        bvh->item_boxes[i] = boxes[bvh->item_indices[i]];
+
+    bvh->node_count = top.node_count;
+    bvh->depth = top.depth;
+    bvh->nodes = realloc(bvh->nodes,bvh->node_count * sizeof(BVHNode));
+    free(builder.centroids);
+    free(builder.tasks.data);
+}
+
+void bvh_free(BVH* bvh) {
+    free(bvh->nodes);
+    free(bvh->item_indices);
+    free(bvh->item_boxes);
+    memset(bvh,0,sizeof(BVH));
+}
+
+f32 bvh_sah_cost(const BVH* bvh) {
+    if(!bvh->node_count)
+        return 0.0f;
+
+    f64 cost = 0.0;
+    for(u32 i = 0; i < bvh->node_count; i++) {
+        const BVHNode* node = &bvh->nodes[i];
+        f32 area = half_area(node->min,node->max);
+        cost += node->count ? area * node->count : area * BVH_TRAVERSAL_COST;
+    }
+    f32 root_area = half_area(bvh->nodes[0].min,bvh->nodes[0].max);
+    return root_area > 0.0f ? (f32)(cost / root_area) : 0.0f;
+}
+
+// same corner selection and order of operations as frustum_cull_aabbs, so both agree
+static f32 plane_distance(const f32* plane,const f32* min,const f32* max,bool furthest) {
+    f32 x = (plane[0] >= 0.0f) == furthest ? max[0] : min[0];
+    f32 y = (plane[1] >= 0.0f) == furthest ? max[1] : min[1];
+    f32 z = (plane[2] >= 0.0f) == furthest ? max[2] : min[2];
+    return plane[0] * x + plane[3] + plane[1] * y + plane[2] * z;
+}
+
+u32 bvh_query_frustum(const BVH* bvh,const Frustum* frustum,u32* items) {
+    if(!bvh->item_count)
+        return 0;
+
+    // planes a node lies fully inside of are dropped for its subtree
+    u32 stack[BVH_MAX_DEPTH + 1];
+    u8 stack_masks[BVH_MAX_DEPTH + 1];
+    u32 stack_size = 0, count = 0;
+    u32 node_index = 0;
+    u8 mask = 0x3f;
+    for(;;) {
+        const BVHNode* node = &bvh->nodes[node_index];
+        bool visible = true;
+        for(u32 p = 0; p < 6 && visible; p++) {
+            if(!(mask & (1 << p)))
+                continue;
+            visible = plane_distance(frustum->planes[p],node->min,node->max,true) >= 0.0f;
+            if(plane_distance(frustum->planes[p],node->min,node->max,false) >= 0.0f)
+                mask &= ~(1 << p);
+        }
+
+        if(visible) {
+            if(!node->count) {
+                stack[stack_size] = node->left_first + 1;
+                stack_masks[stack_size++] = mask;
+                node_index = node->left_first;
+                continue;
+            }
+            for(u32 slot = node->left_first; slot < node->left_first + node->count; slot++) {
+                const AABB* box = &bvh->item_boxes[slot];
+                bool inside = true;
+                for(u32 p = 0; p < 6 && inside; p++)
+                    inside = !(mask & (1 << p)) || plane_distance(frustum->planes[p],box->min,box->max,true) >= 0.0f;
+                if(inside)
+                    items[count++] = bvh->item_indices[slot];
+            }
+        }
+
+        if(!stack_size)
+            break;
+        node_index = stack[--stack_size];
+        mask = stack_masks[stack_size];
+    }
+    return count;
+}
+
+static bool overlaps(const f32* min,const f32* max,const AABB* box) {
+    return min[0] <= box->max[0] && max[0] >= box->min[0] &&
+           min[1] <= box->max[1] && max[1] >= box->min[1] &&
+           min[2] <= box->max[2] && max[2] >= box->min[2];
+}
+
+u32 bvh_query_aabb(const BVH* bvh,const AABB* box,u32* items) {
+    if(!bvh->item_count)
+        return 0;
+
+    u32 stack[BVH_MAX_DEPTH + 1];
+    u32 stack_size = 0, count = 0;
+    u32 node_index = 0;
+    for(;;) {
+        const BVHNode* node = &bvh->nodes[node_index];
+        if(overlaps(node->min,node->max,box)) {
+            if(!node->count) {
+                stack[stack_size++] = node->left_first + 1;
+                node_index = node->left_first;
+                continue;
+            }
+            for(u32 slot = node->left_first; slot < node->left_first + node->count; slot++)
+                if(overlaps(bvh->item_boxes[slot].min,bvh->item_boxes[slot].max,box))
+                    items[count++] = bvh->item_indices[slot];
+        }
+
+        if(!stack_size)
+            break;
+        node_index = stack[--stack_size];
+    }
+    return count;
+}
+
+f32 ray_aabb_entry(const f32* origin,const f32* inv_direction,const f32* min,const f32* max,f32 t_max) {
+    f32 t_near = 0.0f, t_far = t_max;
+    for(u32 axis = 0; axis < 3; axis++) {
+        f32 a = (min[axis] - origin[axis]) * inv_direction[axis];
+        f32 b = (max[axis] - origin[axis]) * inv_direction[axis];
+        f32 entry = a < b ? a : b, exit = a < b ? b : a;
+        t_near = entry > t_near ? entry : t_near;
+        t_far = exit < t_far ? exit : t_far;
+    }
+    return t_near <= t_far ? t_near : FLT_MAX;
+}
+
+static bool ray_item(const BVH* bvh,u32 slot,BVHRayFunc func,void* data,const f32* origin,const f32* direction,
+                     const f32* inv_direction,f32* t) {
+    if(func)
+        return func(data,bvh->item_indices[slot],origin,direction,t);
+
+    f32 entry = ray_aabb_entry(origin,inv_direction,bvh->item_boxes[slot].min,bvh->item_boxes[slot].max,*t);
+    if(entry >= *t)
+        return false;
+    *t = entry;
+    return true;
+}
+
+bool bvh_ray_closest(const BVH* bvh,const f32* origin,const f32* direction,f32 t_max,BVHRayFunc func,void* data,BVHHit* hit) {
+    if(!bvh->item_count)
+        return false;
+
+    vec3 inv_direction = { 1.0f / direction[0], 1.0f / direction[1], 1.0f / direction[2] };
+    if(ray_aabb_entry(origin,inv_direction,bvh->nodes[0].min,bvh->nodes[0].max,t_max) == FLT_MAX)
+        return false;
+
+    // near child first, far children are skipped on the way back once a closer hit is known
+    u32 stack[BVH_MAX_DEPTH + 1];
+    f32 stack_distances[BVH_MAX_DEPTH + 1];
+    u32 stack_size = 0;
+    u32 node_index = 0;
+    f32 t = t_max;
+    bool found = false;
+    for(;;) {
+        const BVHNode* node = &bvh->nodes[node_index];
+        if(node->count) {
+            for(u32 slot = node->left_first; slot < node->left_first + node->count; slot++) {
+                if(ray_item(bvh,slot,func,data,origin,direction,inv_direction,&t)) {
+                    found = true;
+                    hit->item = bvh->item_indices[slot];
+                }
+            }
+        } else {
+            u32 near = node->left_first, far = near + 1;
+            f32 near_distance = ray_aabb_entry(origin,inv_direction,bvh->nodes[near].min,bvh->nodes[near].max,t);
+            f32 far_distance = ray_aabb_entry(origin,inv_direction,bvh->nodes[far].min,bvh->nodes[far].max,t);
+            if(far_distance < near_distance) {
+                u32 swap = near;
+                near = far;
+                far = swap;
+                f32 swap_distance = near_distance;
+                near_distance = far_distance;
+                far_distance = swap_distance;
+            }
+            if(near_distance != FLT_MAX) {
+                if(far_distance != FLT_MAX) {
+                    stack[stack_size] = far;
+                    stack_distances[stack_size++] = far_distance;
+                }
+                node_index = near;
+                continue;
+            }
+        }
+
+        while(stack_size && stack_distances[stack_size - 1] >= t)
+            --stack_size;
+        if(!stack_size)
+            break;
+        node_index = stack[--stack_size];
+    }
+
+    if(found)
+        hit->t = t;
+    return found;
+}
+
+bool bvh_ray_any(const BVH* bvh,const f32* origin,const f32* direction,f32 t_max,BVHRayFunc func,void* data) {
+    if(!bvh->item_count)
+        return false;
+
+    vec3 inv_direction = { 1.0f / direction[0], 1.0f / direction[1], 1.0f / direction[2] };
+    u32 stack[BVH_MAX_DEPTH + 1];
+    u32 stack_size = 0;
+    u32 node_index = 0;
+    for(;;) {
+        const BVHNode* node = &bvh->nodes[node_index];
+        if(ray_aabb_entry(origin,inv_direction,node->min,node->max,t_max) != FLT_MAX) {
+            if(!node->count) {
+                stack[stack_size++] = node->left_first + 1;
+                node_index = node->left_first;
+                continue;
+            }
+            for(u32 slot = node->left_first; slot < node->left_first + node->count; slot++) {
+                f32 t = t_max;
+                if(ray_item(bvh,slot,func,data,origin,direction,inv_direction,&t))
+                    return true;
+            }
+        }
+
+        if(!stack_size)
+            break;
+        node_index = stack[--stack_size];
+    }
+    return false;
+}
+
+bool ray_triangle_intersect(const f32* origin,const f32* direction,const f32* v0,const f32* v1,const f32* v2,f32* t,f32* u,f32* v) {
+    vec3 e1 = { v1[0] - v0[0], v1[1] - v0[1], v1[2] - v0[2] };
+    vec3 e2 = { v2[0] - v0[0], v2[1] - v0[1], v2[2] - v0[2] };
+    vec3 p = {
+        direction[1] * e2[2] - direction[2] * e2[1],
+        direction[2] * e2[0] - direction[0] * e2[2],
+        direction[0] * e2[1] - direction[1] * e2[0]
+    };
+    f32 det = e1[0] * p[0] + e1[1] * p[1] + e1[2] * p[2];
+    if(fabsf(det) < 1e-12f)
+        return false;
+
+    f32 inv_det = 1.0f / det;
+    vec3 s = { origin[0] - v0[0], origin[1] - v0[1], origin[2] - v0[2] };
+    f32 hit_u = (s[0] * p[0] + s[1] * p[1] + s[2] * p[2]) * inv_det;
+    if(hit_u < 0.0f || hit_u > 1.0f)
+        return false;
+
+    vec3 q = {
+        s[1] * e1[2] - s[2] * e1[1],
+        s[2] * e1[0] - s[0] * e1[2],
+        s[0] * e1[1] - s[1] * e1[0]
+    };
+    f32 hit_v = (direction[0] * q[0] + direction[1] * q[1] + direction[2] * q[2]) * inv_det;
+    if(hit_v < 0.0f || hit_u + hit_v > 1.0f)
+        return false;
+
+    f32 hit_t = (e2[0] * q[0] + e2[1] * q[1] + e2[2] * q[2]) * inv_det;
+    if(hit_t <= 0.0f || hit_t >= *t)
+        return false;
+
+    *t = hit_t;
+    *u = hit_u;
+    *v = hit_v;
+    return true;
+}
+
+static void triangle_bounds_job(void* data,u32 begin,u32 end) {
+    TriangleBoundsJob* job = (TriangleBoundsJob*)data;
+    for(u32 i = begin; i < end; i++) {
+        AABB* box = &job->boxes[i];
+        empty_bounds(box->min,box->max);
+        for(u32 k = 0; k < 3; k++) {
+            const f32* position = (const f32*)((const u8*)job->positions + (u64)job->indices[i * 3 + k] * job->position_stride);
+            grow(box->min,box->max,position,position);
+        }
+    }
+}
+
+void bvh_build_triangles(BVH* bvh,JobSystem* jobs,const void* positions,u32 position_stride,const u32* indices,u32 triangle_count) {
+    TriangleBoundsJob job = { positions, position_stride, indices, malloc((triangle_count + 1) * sizeof(AABB)) };
+    job_system_parallel_for(jobs,triangle_count,4096,triangle_bounds_job,&job);
+    bvh_build(bvh,jobs,job.boxes,triangle_count);
+    free(job.boxes);
+}
+
+void scene_build_command_bvh(BVH* bvh,JobSystem* jobs,const Scene* scene) {
+    u32 culled_count = scene->culled_command_aabb_vector.size;
+    u32 count = culled_count + scene->non_culled_command_aabb_vector.size;
+    AABB* boxes = malloc((count + 1) * sizeof(AABB));
+    memcpy(boxes,scene->culled_command_aabb_vector.data,culled_count * sizeof(AABB));
+    memcpy(boxes + culled_count,scene->non_culled_command_aabb_vector.data,(count - culled_count) * sizeof(AABB));
+    bvh_build(bvh,jobs,boxes,count);
+    free(boxes);
+}
@@ -0,0 +1,140 @@
+#include "CameraPath.h"
+#include <cglm/cglm.h>
+#include <math.h>
+#include <stdio.h>
+
+void camera_path_init(CameraPath* path) {
+    vector_create(path->keys,CameraKey);
+}
+
+void camera_path_free(CameraPath* path) {
+    vector_free(path->keys);
+}
+
+bool camera_path_load(CameraPath* path,const char* file_path) {
+    FILE* file = fopen(file_path,"r");
+    if(!file) {
+        fprintf(stderr,"[CAMERA] Failed to open camera path \"%s\"\n",file_path);
+        return false;
+    }
+
+    char line[256];
+    u32 line_number = 0;
+    while(fgets(line,sizeof(line),file)) {
+        ++line_number;
+        if(line[0] == '#' || line[0] == '\n' || line[0] == '\r')
+            continue;
+
+        CameraKey key;
+        if(sscanf(line,"%f %f %f %f %f %f %f",&key.time,&key.position[0],&key.position[1],&key.position[2],
+                  &key.target[0],&key.target[1],&key.target[2]) != 7) {
+            fprintf(stderr,"[CAMERA] %s:%u: expected \"time px py pz tx ty tz\"\n",file_path,line_number);
+            fclose(file);
+            return false;
+        }
+        if(path->keys.size && key.time < path->keys.data[path->keys.size - 1].time) {
+            fprintf(stderr,"[CAMERA] %s:%u: key times must not decrease\n",file_path,line_number);
+            fclose(file);
+            return false;
+        }
+        vector_push(path->keys,CameraKey,key);
+    }
+
+    fclose(file);
+    printf("[CAMERA] Loaded %u keys, %.2f s from \"%s\"\n",path->keys.size,camera_path_duration(path),file_path);
+    return path->keys.size > 0;
+}
+
+bool camera_path_save(const CameraPath* path,const char* file_path) {
+    FILE* file = fopen(file_path,"w");
+    if(!file) {
+        fprintf(stderr,"[CAMERA] Failed to open \"%s\" for writing\n",file_path);
+        return false;
+    }
+
+    fprintf(file,"# time px py pz tx ty tz\n");
+    for(u32 i = 0; i < path->keys.size; i++) {
+        const CameraKey* key = &path->keys.data[i];
+        fprintf(file,"%.4f %.4f %.4f %.4f %.4f %.4f %.4f\n",key->time,key->position[0],key->position[1],key->position[2],
+                key->target[0],key->target[1],key->target[2]);
+    }
+
+    fclose(file);
+    printf("[CAMERA] Saved %u keys, %.2f s to \"%s\"\n",path->keys.size,camera_path_duration(path),file_path);
+    return true;
+}
+
+void camera_path_record(CameraPath* path,f32 time,const Camera* camera) {
+    CameraKey key;
+    key.time = time;
+    glm_vec3_copy((f32*)camera->pos,key.position);
+    glm_vec3_add((f32*)camera->pos,(f32*)camera->front,key.target);
+    vector_push(path->keys,CameraKey,key);
+}
+
+void camera_path_orbit(CameraPath* path,const AABB* bounds,f32 duration,u32 key_count) {
+    vec3 center, extent;
+    glm_vec3_add((f32*)bounds->min,(f32*)bounds->max,center);
+    glm_vec3_scale(center,0.5f,center);
+    glm_vec3_sub((f32*)bounds->max,(f32*)bounds->min,extent);
+    f32 radius = 0.5f * sqrtf(extent[0] * extent[0] + extent[2] * extent[2]);
+
+    // the last key repeats the first so the loop closes
+    for(u32 i = 0; i <= key_count; i++) {
+        f32 angle = 2.0f * GLM_PIf * i / key_count;
+        CameraKey key = {
+            duration * i / key_count,
+            { center[0] + cosf(angle) * radius, center[1] + extent[1] * 0.25f, center[2] + sinf(angle) * radius },
+            { center[0], center[1], center[2] }
+        };
+        vector_push(path->keys,CameraKey,key);
+    }
+}
+
+f32 camera_path_duration(const CameraPath* path) {
+    return path->keys.size ? path->keys.data[path->keys.size - 1].time : 0.0f;
+}
+
+static void catmull_rom(const f32* p0,const f32* p1,const f32* p2,const f32* p3,f32 t,f32* dest) {
+    f32 t2 = t * t, t3 = t2 * t;
+    for(u32 axis = 0; axis < 3; axis++) {
+        dest[axis] = 0.5f * (2.0f * p1[axis] + (p2[axis] - p0[axis]) * t +
+                             (2.0f * p0[axis] - 5.0f * p1[axis] + 4.0f * p2[axis] - p3[axis]) * t2 +
+                             (3.0f * p1[axis] - p0[axis] - 3.0f * p2[axis] + p3[axis]) * t3);
+    }
+}
+
+void camera_path_sample(const CameraPath* path,f32 time,Camera* camera) {
+    if(!path->keys.size)
+        return;
+
+    const CameraKey* keys = path->keys.data;
+    u32 last = path->keys.size - 1;
+    u32 segment = 0;
+    while(segment < last && keys[segment + 1].time <= time)
+        ++segment;
+
+    vec3 position, target;
+    if(segment == last) {
+        glm_vec3_copy((f32*)keys[last].position,position);
+        glm_vec3_copy((f32*)keys[last].target,target);
+    } else {
+        const CameraKey* k0 = &keys[segment ? segment - 1 : 0];
+        const CameraKey* k1 = &keys[segment];
+        const CameraKey* k2 = &keys[segment + 1];
+        const CameraKey* k3 = &keys[segment + 2 <= last ? segment + 2 : last];
+        f32 span = k2->time - k1->time;
+        f32 t = span > 0.0f ? (time - k1->time) / span : 1.0f;
+        t = t < 0.0f ? 0.0f : t;
+        catmull_rom(k0->position,k1->position,k2->position,k3->position,t,position);
+        catmull_rom(k0->target,k1->target,k2->target,k3->target,t,target);
+    }
+
+    glm_vec3_copy(position,camera->pos);
+    glm_vec3_sub(target,position,camera->front);
+    glm_vec3_normalize(camera->front);
+    glm_vec3_cross(camera->front,camera->up,camera->right);
+    glm_vec3_normalize(camera->right);
+    camera->pitch = glm_deg(asinf(camera->front[1]));
+    camera->yaw = glm_deg(atan2f(camera->front[2],camera->front[0]));
+}
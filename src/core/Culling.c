@@ -0,0 +1,210 @@
+#include "Culling.h"
+#include "Simd.h"
+#include <cglm/cglm.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    Scene* scene;
+    const DrawElementsIndirectCommand* commands;
+    AABB* boxes;
+    const u8* verticies;
+    u32 vertex_size;
+    u32 position_offset;
+}AABBBatch;
+
+void frustum_from_matrix(mat4 view_proj,Frustum* frustum) {
+    glm_frustum_planes(view_proj,frustum->planes);
+}
+
+void cull_bounds_build(CullBounds* bounds,const AABB* boxes,u32 count) {
+    u32 padded = (count + CULL_BATCH - 1) / CULL_BATCH * CULL_BATCH;
+    if(!padded)
+        padded = CULL_BATCH;
+
+    // one allocation, min xyz then max xyz
+    f32* data = malloc(padded * 6 * sizeof(f32));
+    memset(data,0,padded * 6 * sizeof(f32));
+    for(u32 axis = 0; axis < 3; axis++) {
+        bounds->min[axis] = data + padded * axis;
+        bounds->max[axis] = data + padded * (axis + 3);
+    }
+    for(u32 i = 0; i < count; i++) {
+        for(u32 axis = 0; axis < 3; axis++) {
+            bounds->min[axis][i] = boxes[i].min[axis];
+            bounds->max[axis][i] = boxes[i].max[axis];
+        }
+    }
+    bounds->count = count;
+}
+
+void cull_bounds_free(CullBounds* bounds) {
+    free(bounds->min[0]);
+    memset(bounds,0,sizeof(CullBounds));
+}
+
+// per plane only the box corner furthest along its normal matters, pick its arrays once
+static void plane_corner(const f32* plane,const CullBounds* bounds,const f32* corner[3]) {
+    for(u32 axis = 0; axis < 3; axis++)
+        corner[axis] = plane[axis] >= 0.0f ? bounds->max[axis] : bounds->min[axis];
+}
+
+u32 frustum_cull_aabbs_scalar(const Frustum* frustum,const CullBounds* bounds,u32* visible) {
+    const f32* corners[6][3];
+    for(u32 p = 0; p < 6; p++)
+        plane_corner(frustum->planes[p],bounds,corners[p]);
+
+    u32 count = 0;
+    for(u32 i = 0; i < bounds->count; i++) {
+        bool inside = true;
+        for(u32 p = 0; p < 6 && inside; p++) {
+            const f32* plane = frustum->planes[p];
+            // same order of operations as the SIMD paths so both agree bit for bit
+            inside = plane[0] * corners[p][0][i] + plane[3] + plane[1] * corners[p][1][i] + plane[2] * corners[p][2][i] >= 0.0f;
+        }
+        if(inside)
+            visible[count++] = i;
+    }
+    return count;
+}
+
+#if defined(SIMD_SSE)
+// the padding past count is zeroed, so it may report visible and is dropped here
+static u32 emit_visible(u32 mask,u32 first,u32 box_count,u32* visible,u32 count) {
+    while(mask) {
+        u32 index = first + lowest_bit(mask);
+        if(index < box_count)
+            visible[count++] = index;
+        mask &= mask - 1;
+    }
+    return count;
+}
+#endif
+
+#if defined(__AVX__)
+static u32 cull_avx(const Frustum* frustum,const f32* corners[6][3],u32 box_count,u32* visible) {
+    __m256 plane_x[6], plane_y[6], plane_z[6], plane_w[6];
+    for(u32 p = 0; p < 6; p++) {
+        plane_x[p] = _mm256_set1_ps(frustum->planes[p][0]);
+        plane_y[p] = _mm256_set1_ps(frustum->planes[p][1]);
+        plane_z[p] = _mm256_set1_ps(frustum->planes[p][2]);
+        plane_w[p] = _mm256_set1_ps(frustum->planes[p][3]);
+    }
+
+    const __m256 zero = _mm256_setzero_ps();
+    u32 count = 0;
+    for(u32 i = 0; i < box_count; i += 8) {
+        __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for(u32 p = 0; p < 6; p++) {
+            __m256 d = _mm256_add_ps(_mm256_mul_ps(plane_x[p],_mm256_loadu_ps(corners[p][0] + i)),plane_w[p]);
+            d = _mm256_add_ps(d,_mm256_mul_ps(plane_y[p],_mm256_loadu_ps(corners[p][1] + i)));
+            d = _mm256_add_ps(d,_mm256_mul_ps(plane_z[p],_mm256_loadu_ps(corners[p][2] + i)));
+            inside = _mm256_and_ps(inside,_mm256_cmp_ps(d,zero,_CMP_GE_OQ));
+        }
+        count = emit_visible((u32)_mm256_movemask_ps(inside),i,box_count,visible,count);
+    }
+    return count;
+}
+#elif defined(SIMD_SSE)
+static u32 cull_sse(const Frustum* frustum,const f32* corners[6][3],u32 box_count,u32* visible) {
+    __m128 plane_x[6], plane_y[6], plane_z[6], plane_w[6];
+    for(u32 p = 0; p < 6; p++) {
+        plane_x[p] = _mm_set1_ps(frustum->planes[p][0]);
+        plane_y[p] = _mm_set1_ps(frustum->planes[p][1]);
+        plane_z[p] = _mm_set1_ps(frustum->planes[p][2]);
+        plane_w[p] = _mm_set1_ps(frustum->planes[p][3]);
+    }
+
+    const __m128 zero = _mm_setzero_ps();
+    u32 count = 0;
+    for(u32 i = 0; i < box_count; i += 4) {
+        __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for(u32 p = 0; p < 6; p++) {
+            __m128 d = _mm_add_ps(_mm_mul_ps(plane_x[p],_mm_loadu_ps(corners[p][0] + i)),plane_w[p]);
+            d = _mm_add_ps(d,_mm_mul_ps(plane_y[p],_mm_loadu_ps(corners[p][1] + i)));
+            d = _mm_add_ps(d,_mm_mul_ps(plane_z[p],_mm_loadu_ps(corners[p][2] + i)));
+            inside = _mm_and_ps(inside,_mm_cmpge_ps(d,zero));
+        }
+        count = emit_visible((u32)_mm_movemask_ps(inside),i,box_count,visible,count);
+    }
+    return count;
+}
+#endif
+
+u32 frustum_cull_aabbs(const Frustum* frustum,const CullBounds* bounds,u32* visible) {
+    const f32* corners[6][3];
+    for(u32 p = 0; p < 6; p++)
+        plane_corner(frustum->planes[p],bounds,corners[p]);
+
+#if defined(__AVX__)
+    return cull_avx(frustum,corners,bounds->count,visible);
+#elif defined(SIMD_SSE)
+    return cull_sse(frustum,corners,bounds->count,visible);
+#else
+    return frustum_cull_aabbs_scalar(frustum,bounds,visible);
+#endif
+}
+
+const char* frustum_cull_isa(void) {
+#if defined(__AVX__)
+    return "AVX";
+#elif defined(SIMD_SSE)
+    return "SSE";
+#else
+    return "scalar";
+#endif
+}
+
+void cull_compact_commands(const DrawElementsIndirectCommand* commands,const u32* material_indices,const u32* visible,u32 count,
+                           DrawElementsIndirectCommand* out_commands,u32* out_material_indices) {
+    for(u32 i = 0; i < count; i++) {
+        out_commands[i] = commands[visible[i]];
+        out_material_indices[i] = material_indices[visible[i]];
+    }
+}
+
+static void command_aabb_job(void* data,u32 begin,u32 end) {
+    AABBBatch* batch = (AABBBatch*)data;
+    const u32* indices = batch->scene->index_vector.data;
+    for(u32 c = begin; c < end; c++) {
+        const DrawElementsIndirectCommand* command = &batch->commands[c];
+        AABB* box = &batch->boxes[c];
+        glm_vec3_copy((vec3){FLT_MAX,FLT_MAX,FLT_MAX},box->min);
+        glm_vec3_copy((vec3){-FLT_MAX,-FLT_MAX,-FLT_MAX},box->max);
+        for(u32 i = 0; i < command->count; i++) {
+            u32 v = command->baseVertex + indices[command->firstIndex + i];
+            f32* position = (f32*)(batch->verticies + (u64)v * batch->vertex_size + batch->position_offset);
+            glm_vec3_minv(box->min,position,box->min);
+            glm_vec3_maxv(box->max,position,box->max);
+        }
+    }
+}
+
+void scene_compute_command_aabbs(JobSystem* jobs,Scene* scene,u32 first_culled_command,u32 first_non_culled_command) {
+    bool packed = scene->vertex_vector.size == 0;
+    AABBBatch batch = {
+        scene,
+        NULL,
+        NULL,
+        packed ? (const u8*)scene->packed_vertex_vector.data : (const u8*)scene->vertex_vector.data,
+        packed ? sizeof(PackedVertex) : sizeof(Vertex),
+        packed ? offsetof(PackedVertex,position) : offsetof(Vertex,position)
+    };
+
+    u32 culled_count = scene->culled_backface_indirect_command_vector.size;
+    if(culled_count >= scene->culled_command_aabb_vector.capacity)
+        vector_reserve(scene->culled_command_aabb_vector,AABB,culled_count + 1);
+    scene->culled_command_aabb_vector.size = culled_count;
+    batch.commands = scene->culled_backface_indirect_command_vector.data + first_culled_command;
+    batch.boxes = scene->culled_command_aabb_vector.data + first_culled_command;
+    job_system_parallel_for(jobs,culled_count - first_culled_command,16,command_aabb_job,&batch);
+
+    u32 non_culled_count = scene->non_culled_backface_indirect_command_vector.size;
+    if(non_culled_count >= scene->non_culled_command_aabb_vector.capacity)
+        vector_reserve(scene->non_culled_command_aabb_vector,AABB,non_culled_count + 1);
+    scene->non_culled_command_aabb_vector.size = non_culled_count;
+    batch.commands = scene->non_culled_backface_indirect_command_vector.data + first_non_culled_command;
+    batch.boxes = scene->non_culled_command_aabb_vector.data + first_non_culled_command;
+    job_system_parallel_for(jobs,non_culled_count - first_non_culled_command,16,command_aabb_job,&batch);
+}
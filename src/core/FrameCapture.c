@@ -0,0 +1,79 @@
+#include "FrameCapture.h"
+#include <glad/glad.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/stat.h>
+
+#if defined(_WIN32)
+#include <direct.h>
+#define make_directory(path) _mkdir(path)
+#else
+#define make_directory(path) mkdir(path,0755)
+#endif
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "stb_image_write.h"
+
+bool offscreen_target_create(OffscreenTarget* target,i32 width,i32 height) {
+    memset(target,0,sizeof(OffscreenTarget));
+    target->width = width;
+    target->height = height;
+
+    glGenTextures(1,&target->color);
+    glBindTexture(GL_TEXTURE_2D,target->color);
+    glTexStorage2D(GL_TEXTURE_2D,1,GL_RGBA8,width,height);
+
+    glGenRenderbuffers(1,&target->depth);
+    glBindRenderbuffer(GL_RENDERBUFFER,target->depth);
+    glRenderbufferStorage(GL_RENDERBUFFER,GL_DEPTH_COMPONENT24,width,height);
+
+    glGenFramebuffers(1,&target->framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER,target->framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER,GL_COLOR_ATTACHMENT0,GL_TEXTURE_2D,target->color,0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER,GL_DEPTH_ATTACHMENT,GL_RENDERBUFFER,target->depth);
+    bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    glBindFramebuffer(GL_FRAMEBUFFER,0);
+
+    if(!complete) {
+        fprintf(stderr,"[CAPTURE] Offscreen framebuffer %dx%d is incomplete\n",width,height);
+        offscreen_target_destroy(target);
+        return false;
+    }
+
+    target->pixels = malloc((u64)width * height * 4);
+    return true;
+}
+
+void offscreen_target_destroy(OffscreenTarget* target) {
+    glDeleteFramebuffers(1,&target->framebuffer);
+    glDeleteRenderbuffers(1,&target->depth);
+    glDeleteTextures(1,&target->color);
+    free(target->pixels);
+    memset(target,0,sizeof(OffscreenTarget));
+}
+
+void offscreen_target_read(OffscreenTarget* target) {
+    glBindFramebuffer(GL_READ_FRAMEBUFFER,target->framebuffer);
+    glReadBuffer(GL_COLOR_ATTACHMENT0);
+    glPixelStorei(GL_PACK_ALIGNMENT,1);
+    glReadPixels(0,0,target->width,target->height,GL_RGBA,GL_UNSIGNED_BYTE,target->pixels);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER,0);
+}
+
+bool offscreen_target_write_png(const OffscreenTarget* target,const char* file_path) {
+    stbi_flip_vertically_on_write(1);
+    if(!stbi_write_png(file_path,target->width,target->height,4,target->pixels,target->width * 4)) {
+        fprintf(stderr,"[CAPTURE] Failed to write \"%s\"\n",file_path);
+        return false;
+    }
+    return true;
+}
+
+bool capture_directory_create(const char* directory) {
+    if(make_directory(directory) == 0 || errno == EEXIST)
+        return true;
+    fprintf(stderr,"[CAPTURE] Failed to create directory \"%s\"\n",directory);
+    return false;
+}
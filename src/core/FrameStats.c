@@ -0,0 +1,111 @@
+#include "FrameStats.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+const char* frame_pass_names[FRAME_PASS_COUNT] = { "lights", "cull", "shadow", "main", "skybox", "total" };
+
+void frame_stats_init(FrameStats* stats,u32 frame_count) {
+    for(u32 i = 0; i < FRAME_PASS_COUNT; i++) {
+        vector_create(stats->samples[i],f32);
+        vector_reserve(stats->samples[i],f32,frame_count + 1);
+    }
+}
+
+void frame_stats_free(FrameStats* stats) {
+    for(u32 i = 0; i < FRAME_PASS_COUNT; i++)
+        vector_free(stats->samples[i]);
+}
+
+void frame_stats_add(FrameStats* stats,FramePass pass,f64 seconds) {
+    f32 ms = (f32)(seconds * 1000.0);
+    vector_push(stats->samples[pass],f32,ms);
+}
+
+static int compare_f32(const void* a,const void* b) {
+    f32 x = *(const f32*)a, y = *(const f32*)b;
+    return (x > y) - (x < y);
+}
+
+static f64 percentile(const f32* sorted,u32 count,f64 p) {
+    u32 rank = (u32)ceil(p * count);
+    return sorted[rank ? rank - 1 : 0];
+}
+
+void frame_stats_summarize(const FrameStats* stats,FramePass pass,FramePassSummary* summary) {
+    memset(summary,0,sizeof(*summary));
+    u32 count = stats->samples[pass].size;
+    if(!count)
+        return;
+
+    f32* sorted = malloc(count * sizeof(f32));
+    memcpy(sorted,stats->samples[pass].data,count * sizeof(f32));
+    qsort(sorted,count,sizeof(f32),compare_f32);
+
+    f64 sum = 0.0;
+    for(u32 i = 0; i < count; i++) {
+        sum += sorted[i];
+        u32 bucket = 0;
+        f64 edge = FRAME_STATS_BUCKET_MIN_MS;
+        while(bucket < FRAME_STATS_BUCKETS - 1 && sorted[i] >= edge) {
+            ++bucket;
+            edge *= 2.0;
+        }
+        summary->histogram[bucket]++;
+    }
+    summary->mean = sum / count;
+    summary->min = sorted[0];
+    summary->max = sorted[count - 1];
+    summary->p50 = percentile(sorted,count,0.50);
+    summary->p95 = percentile(sorted,count,0.95);
+    summary->p99 = percentile(sorted,count,0.99);
+    free(sorted);
+}
+
+static void write_json_string(FILE* file,const char* string) {
+    fputc('"',file);
+    for(const char* c = string; *c; c++) {
+        if(*c == '"' || *c == '\\')
+            fputc('\\',file);
+        fputc(*c,file);
+    }
+    fputc('"',file);
+}
+
+bool frame_stats_write_json(const FrameStats* stats,const char* file_path,const char* assets,const char* camera_path,f32 timestep) {
+    FILE* file = fopen(file_path,"w");
+    if(!file) {
+        fprintf(stderr,"[BENCH] Failed to open \"%s\"\n",file_path);
+        return false;
+    }
+
+    fprintf(file,"{\n  \"assets\": ");
+    write_json_string(file,assets);
+    fprintf(file,",\n  \"camera_path\": ");
+    if(camera_path)
+        write_json_string(file,camera_path);
+    else
+        fprintf(file,"null");
+    fprintf(file,",\n  \"timestep_s\": %.6f,\n  \"frames\": %u,\n",timestep,stats->samples[FRAME_PASS_TOTAL].size);
+
+    fprintf(file,"  \"histogram_upper_ms\": [");
+    f64 edge = FRAME_STATS_BUCKET_MIN_MS;
+    for(u32 i = 0; i < FRAME_STATS_BUCKETS - 1; i++, edge *= 2.0)
+        fprintf(file,"%s%g",i ? ", " : "",edge);
+    fprintf(file,", null],\n  \"passes\": {\n");
+
+    for(u32 pass = 0; pass < FRAME_PASS_COUNT; pass++) {
+        FramePassSummary summary;
+        frame_stats_summarize(stats,pass,&summary);
+        fprintf(file,"    \"%s\": { \"mean_ms\": %.4f, \"min_ms\": %.4f, \"max_ms\": %.4f, \"p50_ms\": %.4f, \"p95_ms\": %.4f, \"p99_ms\": %.4f, \"histogram\": [",
+                frame_pass_names[pass],summary.mean,summary.min,summary.max,summary.p50,summary.p95,summary.p99);
+        for(u32 i = 0; i < FRAME_STATS_BUCKETS; i++)
+            fprintf(file,"%s%u",i ? ", " : "",summary.histogram[i]);
+        fprintf(file,"] }%s\n",pass + 1 < FRAME_PASS_COUNT ? "," : "");
+    }
+    fprintf(file,"  }\n}\n");
+
+    fclose(file);
+    return true;
+}
@@ -0,0 +1,28 @@
+#include "Hash.h"
+#include <stdio.h>
+#include <stdint.h>
+
+u64 hash_fnv1a(const void* data,u64 size,u64 seed) {
+    const u8* bytes = (const u8*)data;
+    u64 hash = seed;
+    for(u64 i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+bool hash_file(const char* path,u64* hash) {
+    FILE* f = fopen(path,"rb");
+    if(!f) return false;
+
+    u8 chunk[64 * 1024];
+    u64 result = HASH_FNV_SEED;
+    size_t read;
+    while((read = fread(chunk,1,sizeof(chunk),f)) > 0)
+        result = hash_fnv1a(chunk,read,result);
+
+    fclose(f);
+    *hash = result;
+    return true;
+}
@@ -0,0 +1,422 @@
+#include "IBLBaker.h"
+#include "Simd.h"
+#include "Timer.h"
+#include "VertexPacking.h"
+#include <cglm/cglm.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define IBL_BAKE_MAX_RADIANCE 200.0f // prefilter_fs.glsl clamps samples to it so a hot sun does not leave sparkles
+
+typedef struct {
+    u32 size;     // per face
+    f32* texels;  // 6 faces of size * size rgb, GL face order, rows bottom up
+}CubeLevel;
+
+typedef struct {
+    CubeLevel levels[16];
+    u32 level_count;
+}CubeMips;
+
+// the texel direction of face coordinates sc, tc in [-1,1], the inverse of the GL face selection in cube_sample
+static void cube_direction(u32 face,f32 sc,f32 tc,f32* d) {
+    switch(face) {
+        case 0: d[0] =  1.0f; d[1] = -tc;   d[2] = -sc;   break;
+        case 1: d[0] = -1.0f; d[1] = -tc;   d[2] =  sc;   break;
+        case 2: d[0] =  sc;   d[1] =  1.0f; d[2] =  tc;   break;
+        case 3: d[0] =  sc;   d[1] = -1.0f; d[2] = -tc;   break;
+        case 4: d[0] =  sc;   d[1] = -tc;   d[2] =  1.0f; break;
+        default: d[0] = -sc;  d[1] = -tc;   d[2] = -1.0f; break;
+    }
+    glm_vec3_normalize(d);
+}
+
+static void texel_direction(u32 face,u32 x,u32 y,u32 size,f32* d) {
+    cube_direction(face,(x + 0.5f) / size * 2.0f - 1.0f,(y + 0.5f) / size * 2.0f - 1.0f,d);
+}
+
+// bilinear with clamp to edge, like GL_LINEAR on a texture without mips. Images with fewer than 3 channels
+// repeat their first one
+static void bilinear(const f32* texels,u32 width,u32 height,u32 channels,f32 u,f32 v,f32* rgb) {
+    f32 x = u * width - 0.5f, y = v * height - 0.5f;
+    x = x < 0.0f ? 0.0f : x > width - 1.0f ? width - 1.0f : x;
+    y = y < 0.0f ? 0.0f : y > height - 1.0f ? height - 1.0f : y;
+    u32 x0 = (u32)x, y0 = (u32)y;
+    u32 x1 = x0 + 1 < width ? x0 + 1 : x0, y1 = y0 + 1 < height ? y0 + 1 : y0;
+    f32 fx = x - x0, fy = y - y0;
+    const f32* t00 = texels + ((u64)y0 * width + x0) * channels;
+    const f32* t10 = texels + ((u64)y0 * width + x1) * channels;
+    const f32* t01 = texels + ((u64)y1 * width + x0) * channels;
+    const f32* t11 = texels + ((u64)y1 * width + x1) * channels;
+    for(u32 c = 0; c < 3; c++) {
+        u32 i = c < channels ? c : 0;
+        f32 top = t00[i] + (t10[i] - t00[i]) * fx;
+        f32 bottom = t01[i] + (t11[i] - t01[i]) * fx;
+        rgb[c] = top + (bottom - top) * fy;
+    }
+}
+
+static void cube_level_sample(const CubeLevel* level,const f32* d,f32* rgb) {
+    f32 ax = fabsf(d[0]), ay = fabsf(d[1]), az = fabsf(d[2]);
+    u32 face;
+    f32 sc, tc, ma;
+    if(ax >= ay && ax >= az) {
+        face = d[0] > 0.0f ? 0 : 1;
+        sc = d[0] > 0.0f ? -d[2] : d[2];
+        tc = -d[1];
+        ma = ax;
+    } else if(ay >= az) {
+        face = d[1] > 0.0f ? 2 : 3;
+        sc = d[0];
+        tc = d[1] > 0.0f ? d[2] : -d[2];
+        ma = ay;
+    } else {
+        face = d[2] > 0.0f ? 4 : 5;
+        sc = d[2] > 0.0f ? d[0] : -d[0];
+        tc = -d[1];
+        ma = az;
+    }
+    const f32* texels = level->texels + (u64)face * level->size * level->size * 3;
+    bilinear(texels,level->size,level->size,3,(sc / ma + 1.0f) * 0.5f,(tc / ma + 1.0f) * 0.5f,rgb);
+}
+
+// trilinear, the faces are filtered on their own like a cubemap without GL_TEXTURE_CUBE_MAP_SEAMLESS
+static void cube_sample(const CubeMips* mips,const f32* d,f32 lod,f32* rgb) {
+    f32 max_lod = mips->level_count - 1.0f;
+    lod = lod < 0.0f ? 0.0f : lod > max_lod ? max_lod : lod;
+    u32 l0 = (u32)lod;
+    cube_level_sample(&mips->levels[l0],d,rgb);
+    f32 t = lod - l0;
+    if(t > 0.0f && l0 + 1 < mips->level_count) {
+        vec3 next;
+        cube_level_sample(&mips->levels[l0 + 1],d,next);
+        glm_vec3_lerp(rgb,next,t,rgb);
+    }
+}
+
+static f32 radical_inverse(u32 bits) {
+    bits = (bits << 16u) | (bits >> 16u);
+    bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+    bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+    bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+    bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+    return bits * 2.3283064365386963e-10f;
+}
+
+// GGX distributed half vector around +z for Hammersley point i of count, as ImportanceSampleGGX
+static void ggx_half_vector(u32 i,u32 count,f32 roughness,f32* h) {
+    f32 a = roughness * roughness;
+    f32 phi = 2.0f * GLM_PIf * i / count;
+    f32 xi = radical_inverse(i);
+    f32 cos_theta = sqrtf((1.0f - xi) / (1.0f + (a * a - 1.0f) * xi));
+    f32 sin_theta = sqrtf(1.0f - cos_theta * cos_theta);
+    h[0] = cosf(phi) * sin_theta;
+    h[1] = sinf(phi) * sin_theta;
+    h[2] = cos_theta;
+}
+
+typedef struct {
+    const f32* pixels;
+    u32 width;
+    u32 height;
+    u32 channels;
+    CubeLevel* level;
+}EnvJob;
+
+// one face row per item, bilinear lookups at the uv eqrec_to_cubemap_fs.glsl computes
+static void env_rows(void* data,u32 begin,u32 end) {
+    EnvJob* job = data;
+    u32 size = job->level->size;
+    for(u32 item = begin; item < end; item++) {
+        u32 face = item / size, y = item % size;
+        f32* out = job->level->texels + ((u64)face * size + y) * size * 3;
+        for(u32 x = 0; x < size; x++) {
+            vec3 d;
+            texel_direction(face,x,y,size,d);
+            f32 u = atan2f(d[2],d[0]) * 0.1591f + 0.5f;
+            f32 v = asinf(d[1]) * 0.3183f + 0.5f;
+            bilinear(job->pixels,job->width,job->height,job->channels,u,v,out + x * 3);
+        }
+    }
+}
+
+typedef struct {
+    const CubeLevel* src;
+    CubeLevel* dst;
+}DownsampleJob;
+
+static void downsample_rows(void* data,u32 begin,u32 end) {
+    DownsampleJob* job = data;
+    u32 size = job->dst->size, src_size = job->src->size;
+    for(u32 item = begin; item < end; item++) {
+        u32 face = item / size, y = item % size;
+        const f32* src = job->src->texels + (u64)face * src_size * src_size * 3;
+        f32* out = job->dst->texels + ((u64)face * size + y) * size * 3;
+        for(u32 x = 0; x < size; x++)
+            for(u32 c = 0; c < 3; c++)
+                out[x * 3 + c] = 0.25f * (src[((2 * y) * src_size + 2 * x) * 3 + c] + src[((2 * y) * src_size + 2 * x + 1) * 3 + c] +
+                                          src[((2 * y + 1) * src_size + 2 * x) * 3 + c] + src[((2 * y + 1) * src_size + 2 * x + 1) * 3 + c]);
+    }
+}
+
+// sample directions around +z with N = V = R, shared by every texel of a level and turned into its frame.
+// Padded to a multiple of 4 with zero weights
+typedef struct {
+    f32* x;
+    f32* y;
+    f32* z;
+    f32* lod;
+    u32 count;
+}PrefilterSamples;
+
+typedef struct {
+    const CubeMips* env;
+    const PrefilterSamples* samples;
+    f32 lod;             // for roughness 0, a single lookup at the output texel's footprint
+    u32 size;
+    u16* out;            // the level's 6 faces as half floats
+}PrefilterJob;
+
+static void prefilter_rows(void* data,u32 begin,u32 end) {
+    PrefilterJob* job = data;
+    const PrefilterSamples* samples = job->samples;
+    u32 size = job->size;
+    f32 lx[4], ly[4], lz[4];
+    for(u32 item = begin; item < end; item++) {
+        u32 face = item / size, y = item % size;
+        u16* out = job->out + ((u64)face * size + y) * size * 3;
+        for(u32 x = 0; x < size; x++) {
+            vec3 n, color = {0.0f,0.0f,0.0f};
+            texel_direction(face,x,y,size,n);
+            if(!samples) {
+                cube_sample(job->env,n,job->lod,color);
+            } else {
+                // the tangent frame ImportanceSampleGGX builds
+                vec3 up = { 0.0f, 0.0f, 1.0f }, t, b;
+                if(fabsf(n[2]) >= 0.999f)
+                    glm_vec3_copy((vec3){1.0f,0.0f,0.0f},up);
+                glm_vec3_cross(up,n,t);
+                glm_vec3_normalize(t);
+                glm_vec3_cross(n,t,b);
+
+                f32 total = 0.0f;
+                for(u32 i = 0; i < samples->count; i += 4) {
+#if defined(SIMD_SSE)
+                    __m128 sx = _mm_loadu_ps(samples->x + i), sy = _mm_loadu_ps(samples->y + i), sz = _mm_loadu_ps(samples->z + i);
+                    _mm_storeu_ps(lx,_mm_add_ps(_mm_add_ps(_mm_mul_ps(sx,_mm_set1_ps(t[0])),_mm_mul_ps(sy,_mm_set1_ps(b[0]))),_mm_mul_ps(sz,_mm_set1_ps(n[0]))));
+                    _mm_storeu_ps(ly,_mm_add_ps(_mm_add_ps(_mm_mul_ps(sx,_mm_set1_ps(t[1])),_mm_mul_ps(sy,_mm_set1_ps(b[1]))),_mm_mul_ps(sz,_mm_set1_ps(n[1]))));
+                    _mm_storeu_ps(lz,_mm_add_ps(_mm_add_ps(_mm_mul_ps(sx,_mm_set1_ps(t[2])),_mm_mul_ps(sy,_mm_set1_ps(b[2]))),_mm_mul_ps(sz,_mm_set1_ps(n[2]))));
+#else
+                    for(u32 k = 0; k < 4; k++) {
+                        lx[k] = samples->x[i + k] * t[0] + samples->y[i + k] * b[0] + samples->z[i + k] * n[0];
+                        ly[k] = samples->x[i + k] * t[1] + samples->y[i + k] * b[1] + samples->z[i + k] * n[1];
+                        lz[k] = samples->x[i + k] * t[2] + samples->y[i + k] * b[2] + samples->z[i + k] * n[2];
+                    }
+#endif
+                    for(u32 k = 0; k < 4; k++) {
+                        // the tangent space z of L is its NdotL, the weight
+                        f32 weight = samples->z[i + k];
+                        if(weight <= 0.0f)
+                            continue;
+                        vec3 l = { lx[k], ly[k], lz[k] }, sample;
+                        cube_sample(job->env,l,samples->lod[i + k],sample);
+                        for(u32 c = 0; c < 3; c++)
+                            color[c] += (sample[c] < IBL_BAKE_MAX_RADIANCE ? sample[c] : IBL_BAKE_MAX_RADIANCE) * weight;
+                        total += weight;
+                    }
+                }
+                glm_vec3_scale(color,1.0f / total,color);
+            }
+            for(u32 c = 0; c < 3; c++)
+                out[x * 3 + c] = float_to_half(color[c]);
+        }
+    }
+}
+
+static void prefilter_samples(f32 roughness,u32 env_size,PrefilterSamples* samples) {
+    u32 capacity = (IBL_BAKE_PREFILTER_SAMPLES + 3) & ~3u;
+    samples->x = calloc(capacity * 4,sizeof(f32));
+    samples->y = samples->x + capacity;
+    samples->z = samples->y + capacity;
+    samples->lod = samples->z + capacity;
+    samples->count = capacity;
+
+    f32 a2 = roughness * roughness * roughness * roughness;
+    f32 texel_angle = 4.0f * GLM_PIf / (6.0f * env_size * env_size);
+    for(u32 i = 0; i < IBL_BAKE_PREFILTER_SAMPLES; i++) {
+        vec3 h;
+        ggx_half_vector(i,IBL_BAKE_PREFILTER_SAMPLES,roughness,h);
+        // reflect V = N = +z about H
+        f32 lz = 2.0f * h[2] * h[2] - 1.0f;
+        if(lz <= 0.0f)
+            continue;
+        samples->x[i] = 2.0f * h[2] * h[0];
+        samples->y[i] = 2.0f * h[2] * h[1];
+        samples->z[i] = lz;
+        // pdf of L is D * NdotH / (4 HdotV), which is D / 4 with N = V. The lookup covers the sample's solid angle
+        // with the mip level prefilter_fs.glsl computes, but here the env map has the mips to honour it
+        f32 denom = h[2] * h[2] * (a2 - 1.0f) + 1.0f;
+        f32 pdf = a2 / (GLM_PIf * denom * denom) * 0.25f;
+        f32 sample_angle = 1.0f / (IBL_BAKE_PREFILTER_SAMPLES * pdf + 1e-4f);
+        samples->lod[i] = 0.5f * log2f(sample_angle / texel_angle);
+    }
+}
+
+typedef struct {
+    u16* out;
+    u32 size;
+}BRDFJob;
+
+// one roughness per row, the half vectors of a row are shared by its NdotV columns, taken four samples at a time
+static void brdf_rows(void* data,u32 begin,u32 end) {
+    BRDFJob* job = data;
+    u32 size = job->size;
+    u32 count = IBL_BAKE_BRDF_SAMPLES;
+    f32* hx = malloc(count * 2 * sizeof(f32));
+    f32* hz = hx + count;
+    for(u32 y = begin; y < end; y++) {
+        f32 roughness = (y + 0.5f) / size;
+        f32 k = roughness * roughness * 0.5f;
+        for(u32 i = 0; i < count; i++) {
+            vec3 h;
+            ggx_half_vector(i,count,roughness,h);
+            // V = (sin, 0, NdotV) has no y, so neither V.H nor L.z need the half vector's
+            hx[i] = h[0];
+            hz[i] = h[2];
+        }
+        u16* out = job->out + (u64)y * size * 2;
+        for(u32 x = 0; x < size; x++) {
+            f32 n_dot_v = (x + 0.5f) / size;
+            f32 vx = sqrtf(1.0f - n_dot_v * n_dot_v), vz = n_dot_v;
+            f32 g_v = n_dot_v / (n_dot_v * (1.0f - k) + k);
+            f32 a = 0.0f, b = 0.0f;
+            u32 i = 0;
+#if defined(SIMD_SSE)
+            __m128 sum_a = _mm_setzero_ps(), sum_b = _mm_setzero_ps();
+            __m128 one = _mm_set1_ps(1.0f), zero = _mm_setzero_ps();
+            __m128 kk = _mm_set1_ps(k), one_minus_k = _mm_set1_ps(1.0f - k);
+            __m128 scale = _mm_set1_ps(g_v / n_dot_v);
+            for(; i + 4 <= count; i += 4) {
+                __m128 x4 = _mm_loadu_ps(hx + i), z4 = _mm_loadu_ps(hz + i);
+                __m128 v_dot_h = _mm_max_ps(_mm_add_ps(_mm_mul_ps(x4,_mm_set1_ps(vx)),_mm_mul_ps(z4,_mm_set1_ps(vz))),zero);
+                // L.z of L = 2 (V.H) H - V
+                __m128 n_dot_l = _mm_sub_ps(_mm_mul_ps(_mm_mul_ps(_mm_set1_ps(2.0f),v_dot_h),z4),_mm_set1_ps(vz));
+                __m128 lit = _mm_cmpgt_ps(n_dot_l,zero);
+                __m128 g_l = _mm_div_ps(n_dot_l,_mm_add_ps(_mm_mul_ps(n_dot_l,one_minus_k),kk));
+                __m128 g_vis = _mm_div_ps(_mm_mul_ps(_mm_mul_ps(g_l,scale),v_dot_h),z4);
+                g_vis = _mm_and_ps(g_vis,lit);
+                __m128 f = _mm_sub_ps(one,v_dot_h);
+                __m128 f2 = _mm_mul_ps(f,f);
+                __m128 fc = _mm_mul_ps(_mm_mul_ps(f2,f2),f);
+                sum_a = _mm_add_ps(sum_a,_mm_mul_ps(_mm_sub_ps(one,fc),g_vis));
+                sum_b = _mm_add_ps(sum_b,_mm_mul_ps(fc,g_vis));
+            }
+            f32 lanes_a[4], lanes_b[4];
+            _mm_storeu_ps(lanes_a,sum_a);
+            _mm_storeu_ps(lanes_b,sum_b);
+            a = (lanes_a[0] + lanes_a[1]) + (lanes_a[2] + lanes_a[3]);
+            b = (lanes_b[0] + lanes_b[1]) + (lanes_b[2] + lanes_b[3]);
+#endif
+            for(; i < count; i++) {
+                f32 v_dot_h = fmaxf(hx[i] * vx + hz[i] * vz,0.0f);
+                f32 n_dot_l = 2.0f * v_dot_h * hz[i] - vz;
+                if(n_dot_l <= 0.0f)
+                    continue;
+                f32 g_l = n_dot_l / (n_dot_l * (1.0f - k) + k);
+                f32 g_vis = g_l * g_v * v_dot_h / (hz[i] * n_dot_v);
+                f32 f = 1.0f - v_dot_h;
+                f32 fc = f * f * f * f * f;
+                a += (1.0f - fc) * g_vis;
+                b += fc * g_vis;
+            }
+            out[x * 2] = float_to_half(a / count);
+            out[x * 2 + 1] = float_to_half(b / count);
+        }
+    }
+    free(hx);
+}
+
+static void image_alloc(IBLImage* image,u32 faces,u32 channels,u32 width,u32 height,u32 levels) {
+    image->faces = faces;
+    image->channels = channels;
+    image->width = width;
+    image->height = height;
+    image->levels = levels;
+    image->data = malloc(ibl_image_size(image));
+}
+
+static u32 level_count(u32 size) {
+    u32 levels = 1;
+    while(size >> levels)
+        ++levels;
+    return levels;
+}
+
+void ibl_bake(JobSystem* jobs,const f32* pixels,u32 width,u32 height,u32 channels,IBLBake* bake,IBLBakeStats* stats) {
+    memset(stats,0,sizeof(IBLBakeStats));
+    IBLImage* env_image = &bake->images[0];
+    IBLImage* prefilter_image = &bake->images[1];
+    IBLImage* brdf_image = &bake->images[2];
+
+    // environment and its box filtered mips, only level 0 is stored, the rest feed the prefilter's lookups
+    f64 start = timer_now();
+    CubeMips env;
+    env.level_count = level_count(IBL_BAKE_ENV_SIZE);
+    for(u32 level = 0; level < env.level_count; level++) {
+        env.levels[level].size = IBL_BAKE_ENV_SIZE >> level;
+        env.levels[level].texels = malloc((u64)6 * env.levels[level].size * env.levels[level].size * 3 * sizeof(f32));
+    }
+    EnvJob env_job = { pixels, width, height, channels, &env.levels[0] };
+    job_system_parallel_for(jobs,6 * IBL_BAKE_ENV_SIZE,8,env_rows,&env_job);
+    for(u32 level = 1; level < env.level_count; level++) {
+        DownsampleJob downsample_job = { &env.levels[level - 1], &env.levels[level] };
+        job_system_parallel_for(jobs,6 * env.levels[level].size,16,downsample_rows,&downsample_job);
+    }
+    image_alloc(env_image,6,3,IBL_BAKE_ENV_SIZE,IBL_BAKE_ENV_SIZE,1);
+    u64 env_floats = (u64)6 * IBL_BAKE_ENV_SIZE * IBL_BAKE_ENV_SIZE * 3;
+    for(u64 i = 0; i < env_floats; i++)
+        env_image->data[i] = float_to_half(env.levels[0].texels[i]);
+    stats->env_seconds = timer_now() - start;
+
+    // full chain like glGenerateMipmap leaves it, levels past the last roughness step stay at roughness 1
+    start = timer_now();
+    image_alloc(prefilter_image,6,3,IBL_BAKE_PREFILTER_SIZE,IBL_BAKE_PREFILTER_SIZE,level_count(IBL_BAKE_PREFILTER_SIZE));
+    for(u32 level = 0; level < prefilter_image->levels; level++) {
+        f32 roughness = (f32)level / (IBL_BAKE_ROUGHNESS_LEVELS - 1);
+        roughness = roughness < 1.0f ? roughness : 1.0f;
+        PrefilterSamples samples;
+        PrefilterJob job = { &env, NULL, 0.0f, IBL_BAKE_PREFILTER_SIZE >> level, prefilter_image->data + ibl_image_level_offset(prefilter_image,level) };
+        if(level == 0)
+            job.lod = log2f((f32)IBL_BAKE_ENV_SIZE / IBL_BAKE_PREFILTER_SIZE);
+        else {
+            prefilter_samples(roughness,IBL_BAKE_ENV_SIZE,&samples);
+            job.samples = &samples;
+        }
+        job_system_parallel_for(jobs,6 * job.size,4,prefilter_rows,&job);
+        if(level)
+            free(samples.x);
+    }
+    stats->prefilter_seconds = timer_now() - start;
+
+    start = timer_now();
+    image_alloc(brdf_image,1,2,IBL_BAKE_BRDF_SIZE,IBL_BAKE_BRDF_SIZE,1);
+    BRDFJob brdf_job = { brdf_image->data, IBL_BAKE_BRDF_SIZE };
+    job_system_parallel_for(jobs,IBL_BAKE_BRDF_SIZE,4,brdf_rows,&brdf_job);
+    stats->brdf_seconds = timer_now() - start;
+
+    start = timer_now();
+    SH9 radiance;
+    sh9_project_equirect(jobs,pixels,width,height,channels,&radiance);
+    sh9_irradiance(&radiance,&bake->irradiance_sh);
+    stats->sh_seconds = timer_now() - start;
+
+    for(u32 level = 0; level < env.level_count; level++)
+        free(env.levels[level].texels);
+}
+
+void ibl_bake_free(IBLBake* bake) {
+    for(u32 i = 0; i < IBL_TEXTURE_COUNT; i++)
+        free(bake->images[i].data);
+    memset(bake,0,sizeof(IBLBake));
+}
@@ -0,0 +1,227 @@
+#include "IBLCache.h"
+#include "Hash.h"
+#include "AtomicFile.h"
+#include <glad/glad.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#define IBL_MAX_LEVELS 16
+
+typedef struct {
+    u32 faces;
+    u32 channels;
+    u32 width;
+    u32 height;
+    u32 levels;
+    u32 padding;
+    u64 offset; // from the start of the file
+    u64 size;
+}TextureRecord;
+
+typedef struct {
+    u32 magic;
+    u32 version;
+    IBLCacheKey key;
+    SH9 irradiance_sh;
+    TextureRecord records[IBL_TEXTURE_COUNT];
+}Header;
+
+bool ibl_cache_key(const char* source_path,const char* const* shader_paths,u32 shader_count,IBLCacheKey* key) {
+    struct stat info;
+    if(stat(source_path,&info) != 0)
+        return false;
+
+    memset(key,0,sizeof(IBLCacheKey));
+    key->source_size = (u64)info.st_size;
+    if(!hash_file(source_path,&key->source_hash))
+        return false;
+
+    key->shader_hash = HASH_FNV_SEED;
+    for(u32 i = 0; i < shader_count; i++) {
+        u64 hash;
+        if(!hash_file(shader_paths[i],&hash))
+            return false;
+        key->shader_hash = hash_fnv1a(&hash,sizeof(hash),key->shader_hash);
+    }
+    return true;
+}
+
+static u64 level_size(const IBLImage* image,u32 level) {
+    u32 width = image->width >> level ? image->width >> level : 1;
+    u32 height = image->height >> level ? image->height >> level : 1;
+    return (u64)width * height * image->channels * image->faces;
+}
+
+u64 ibl_image_level_offset(const IBLImage* image,u32 level) {
+    u64 offset = 0;
+    for(u32 i = 0; i < level; i++)
+        offset += level_size(image,i);
+    return offset;
+}
+
+u64 ibl_image_size(const IBLImage* image) {
+    return ibl_image_level_offset(image,image->levels) * sizeof(u16);
+}
+
+bool ibl_cache_write_images(const char* cache_path,const IBLCacheKey* key,const IBLImage* images,const SH9* irradiance_sh) {
+    Header header;
+    memset(&header,0,sizeof(Header));
+    header.magic = IBL_CACHE_MAGIC;
+    header.version = IBL_CACHE_VERSION;
+    header.key = *key;
+    header.irradiance_sh = *irradiance_sh;
+
+    u64 offset = sizeof(Header);
+    for(u32 i = 0; i < IBL_TEXTURE_COUNT; i++) {
+        TextureRecord* record = &header.records[i];
+        record->faces = images[i].faces;
+        record->channels = images[i].channels;
+        record->width = images[i].width;
+        record->height = images[i].height;
+        record->levels = images[i].levels;
+        record->offset = offset;
+        record->size = ibl_image_size(&images[i]);
+        offset += record->size;
+    }
+
+    AtomicFile atomic;
+    if(!atomic_file_open(&atomic,cache_path))
+        return false;
+    bool ok = fwrite(&header,sizeof(Header),1,atomic.file) == 1;
+    for(u32 i = 0; i < IBL_TEXTURE_COUNT && ok; i++)
+        ok = fwrite(images[i].data,1,header.records[i].size,atomic.file) == header.records[i].size;
+    return atomic_file_commit(&atomic,ok);
+}
+
+static u32 gl_target(u32 faces) {
+    return faces == 6 ? GL_TEXTURE_CUBE_MAP : GL_TEXTURE_2D;
+}
+
+static u32 gl_face(u32 faces,u32 face) {
+    return faces == 6 ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + face : GL_TEXTURE_2D;
+}
+
+static u32 gl_format(u32 channels) {
+    return channels == 2 ? GL_RG : GL_RGB;
+}
+
+static u32 gl_internal_format(u32 channels) {
+    return channels == 2 ? GL_RG16F : GL_RGB16F;
+}
+
+bool ibl_cache_write(const char* cache_path,const IBLCacheKey* key,const IBLEnvironment* ibl) {
+    static const u32 faces[IBL_TEXTURE_COUNT] = { 6, 6, 1 };
+    IBLImage images[IBL_TEXTURE_COUNT];
+    bool ok = true;
+
+    glPixelStorei(GL_PACK_ALIGNMENT,1);
+    for(u32 i = 0; i < IBL_TEXTURE_COUNT; i++) {
+        IBLImage* image = &images[i];
+        u32 target = gl_target(faces[i]);
+        glBindTexture(target,ibl->textures[i]);
+        i32 width, height, internal_format, min_filter;
+        glGetTexLevelParameteriv(gl_face(faces[i],0),0,GL_TEXTURE_WIDTH,&width);
+        glGetTexLevelParameteriv(gl_face(faces[i],0),0,GL_TEXTURE_HEIGHT,&height);
+        glGetTexLevelParameteriv(gl_face(faces[i],0),0,GL_TEXTURE_INTERNAL_FORMAT,&internal_format);
+        glGetTexParameteriv(target,GL_TEXTURE_MIN_FILTER,&min_filter);
+
+        image->faces = faces[i];
+        image->channels = internal_format == GL_RG16F ? 2 : 3;
+        image->width = width;
+        image->height = height;
+        // mip chains come from glGenerateMipmap, so they are either complete or a single level
+        image->levels = 1;
+        bool mipmapped = min_filter != GL_LINEAR && min_filter != GL_NEAREST;
+        while(mipmapped && ((u32)width >> image->levels || (u32)height >> image->levels))
+            ++image->levels;
+
+        image->data = malloc(ibl_image_size(image));
+        ok = ok && image->data;
+        for(u32 level = 0; level < image->levels && image->data; level++) {
+            u64 face_size = level_size(image,level) / image->faces;
+            u16* dst = image->data + ibl_image_level_offset(image,level);
+            for(u32 face = 0; face < image->faces; face++, dst += face_size)
+                glGetTexImage(gl_face(image->faces,face),level,gl_format(image->channels),GL_HALF_FLOAT,dst);
+        }
+    }
+    glPixelStorei(GL_PACK_ALIGNMENT,4);
+
+    ok = ok && ibl_cache_write_images(cache_path,key,images,&ibl->irradiance_sh);
+    for(u32 i = 0; i < IBL_TEXTURE_COUNT; i++)
+        free(images[i].data);
+    return ok;
+}
+
+static bool header_valid(const Header* header,u64 file_size,const IBLCacheKey* key) {
+    if(header->magic != IBL_CACHE_MAGIC || header->version != IBL_CACHE_VERSION)
+        return false;
+    if(header->key.source_size != key->source_size || header->key.source_hash != key->source_hash)
+        return false;
+    if(header->key.shader_hash != key->shader_hash && header->key.shader_hash != IBL_CACHE_CPU_BAKE)
+        return false;
+
+    for(u32 i = 0; i < IBL_TEXTURE_COUNT; i++) {
+        const TextureRecord* record = &header->records[i];
+        if(record->faces != (i == IBL_TEXTURE_COUNT - 1 ? 1u : 6u) || (record->channels != 2 && record->channels != 3))
+            return false;
+        if(!record->width || !record->height || !record->levels || record->levels > IBL_MAX_LEVELS)
+            return false;
+        IBLImage image = { record->faces, record->channels, record->width, record->height, record->levels };
+        if(ibl_image_size(&image) != record->size || record->offset > file_size || record->size > file_size - record->offset)
+            return false;
+    }
+    return true;
+}
+
+bool ibl_cache_load(const char* cache_path,const IBLCacheKey* key,IBLEnvironment* ibl) {
+    FILE* f = fopen(cache_path,"rb");
+    if(!f)
+        return false;
+    fseek(f,0,SEEK_END);
+    long file_size = ftell(f);
+    fseek(f,0,SEEK_SET);
+    if(file_size < (long)sizeof(Header)) {
+        fclose(f);
+        return false;
+    }
+
+    u8* data = malloc(file_size);
+    bool ok = data && fread(data,1,file_size,f) == (size_t)file_size;
+    fclose(f);
+    const Header* header = (const Header*)data;
+    if(!ok || !header_valid(header,(u64)file_size,key)) {
+        free(data);
+        return false;
+    }
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT,1);
+    for(u32 i = 0; i < IBL_TEXTURE_COUNT; i++) {
+        const TextureRecord* record = &header->records[i];
+        IBLImage image = { record->faces, record->channels, record->width, record->height, record->levels, (u16*)(data + record->offset) };
+        u32 target = gl_target(image.faces);
+        glGenTextures(1,&ibl->textures[i]);
+        glBindTexture(target,ibl->textures[i]);
+        glTexStorage2D(target,image.levels,gl_internal_format(image.channels),image.width,image.height);
+        for(u32 level = 0; level < image.levels; level++) {
+            u32 width = image.width >> level ? image.width >> level : 1;
+            u32 height = image.height >> level ? image.height >> level : 1;
+            u64 face_size = level_size(&image,level) / image.faces;
+            const u16* src = image.data + ibl_image_level_offset(&image,level);
+            for(u32 face = 0; face < image.faces; face++, src += face_size)
+                glTexSubImage2D(gl_face(image.faces,face),level,0,0,width,height,gl_format(image.channels),GL_HALF_FLOAT,src);
+        }
+        glTexParameteri(target,GL_TEXTURE_WRAP_S,GL_CLAMP_TO_EDGE);
+        glTexParameteri(target,GL_TEXTURE_WRAP_T,GL_CLAMP_TO_EDGE);
+        if(target == GL_TEXTURE_CUBE_MAP)
+            glTexParameteri(target,GL_TEXTURE_WRAP_R,GL_CLAMP_TO_EDGE);
+        glTexParameteri(target,GL_TEXTURE_MIN_FILTER,image.levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+        glTexParameteri(target,GL_TEXTURE_MAG_FILTER,GL_LINEAR);
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT,4);
+    ibl->irradiance_sh = header->irradiance_sh;
+
+    free(data);
+    return true;
+}
@@ -0,0 +1,299 @@
+#include "JobSystem.h"
+#include "Arena.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+typedef SRWLOCK Mutex;
+typedef CONDITION_VARIABLE Cond;
+typedef HANDLE Thread;
+#define mutex_init(m)         InitializeSRWLock(m)
+#define mutex_destroy(m)
+#define mutex_lock(m)         AcquireSRWLockExclusive(m)
+#define mutex_unlock(m)       ReleaseSRWLockExclusive(m)
+#define cond_init(c)          InitializeConditionVariable(c)
+#define cond_destroy(c)
+#define cond_wait(c,m)        SleepConditionVariableSRW(c,m,INFINITE,0)
+#define cond_broadcast(c)     WakeAllConditionVariable(c)
+#define atomic_add(ptr,value) (InterlockedExchangeAdd((ptr),(value)) + (value))
+#define atomic_load(ptr)      InterlockedCompareExchange((ptr),0,0)
+#define thread_yield()        SwitchToThread()
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+typedef pthread_mutex_t Mutex;
+typedef pthread_cond_t Cond;
+typedef pthread_t Thread;
+#define mutex_init(m)         pthread_mutex_init(m,NULL)
+#define mutex_destroy(m)      pthread_mutex_destroy(m)
+#define mutex_lock(m)         pthread_mutex_lock(m)
+#define mutex_unlock(m)       pthread_mutex_unlock(m)
+#define cond_init(c)          pthread_cond_init(c,NULL)
+#define cond_destroy(c)       pthread_cond_destroy(c)
+#define cond_wait(c,m)        pthread_cond_wait(c,m)
+#define cond_broadcast(c)     pthread_cond_broadcast(c)
+#define atomic_add(ptr,value) __atomic_add_fetch((ptr),(value),__ATOMIC_ACQ_REL)
+#define atomic_load(ptr)      __atomic_load_n((ptr),__ATOMIC_ACQUIRE)
+#define thread_yield()        sched_yield()
+#endif
+
+#define QUEUE_INITIAL_CAPACITY 64
+
+typedef struct {
+    JobFunc func;
+    void* data;
+    u32 begin;
+    u32 end;
+    volatile long* remaining;
+}Job;
+
+// owner pops from the back, thieves take from the front
+typedef struct {
+    Mutex lock;
+    Job* jobs;
+    u32 capacity;
+    u32 head;
+    u32 count;
+}JobQueue;
+
+typedef struct {
+    JobSystem* system;
+    u32 index;
+}WorkerArgs;
+
+struct JobSystem {
+    Thread* threads;
+    WorkerArgs* worker_args;
+    JobQueue* queues; // one per thread, slot 0 belongs to the creating thread
+    u32 thread_count;
+    volatile long pending;
+    volatile long quit;
+    Mutex sleep_lock;
+    Cond wake;
+};
+
+static THREAD_LOCAL const JobSystem* tls_system = NULL;
+static THREAD_LOCAL u32 tls_index = 0;
+
+static void queue_push(JobQueue* queue,const Job* job) {
+    mutex_lock(&queue->lock);
+    if(queue->count == queue->capacity) {
+        u32 new_capacity = queue->capacity * 2;
+        Job* jobs = malloc(new_capacity * sizeof(Job));
+        for(u32 i = 0; i < queue->count; i++)
+            jobs[i] = queue->jobs[(queue->head + i) % queue->capacity];
+        free(queue->jobs);
+        queue->jobs = jobs;
+        queue->capacity = new_capacity;
+        queue->head = 0;
+    }
+    queue->jobs[(queue->head + queue->count) % queue->capacity] = *job;
+    ++queue->count;
+    mutex_unlock(&queue->lock);
+}
+
+static bool queue_pop(JobQueue* queue,Job* job) {
+    bool found = false;
+    mutex_lock(&queue->lock);
+    if(queue->count) {
+        --queue->count;
+        *job = queue->jobs[(queue->head + queue->count) % queue->capacity];
+        found = true;
+    }
+    mutex_unlock(&queue->lock);
+    return found;
+}
+
+static bool queue_steal(JobQueue* queue,Job* job) {
+    bool found = false;
+    mutex_lock(&queue->lock);
+    if(queue->count) {
+        *job = queue->jobs[queue->head];
+        queue->head = (queue->head + 1) % queue->capacity;
+        --queue->count;
+        found = true;
+    }
+    mutex_unlock(&queue->lock);
+    return found;
+}
+
+static bool find_job(JobSystem* jobs,u32 index,Job* job) {
+    if(!atomic_load(&jobs->pending))
+        return false;
+
+    bool found = queue_pop(&jobs->queues[index],job);
+    for(u32 i = 1; !found && i < jobs->thread_count; i++)
+        found = queue_steal(&jobs->queues[(index + i) % jobs->thread_count],job);
+
+    if(found)
+        atomic_add(&jobs->pending,-1);
+    return found;
+}
+
+static void run_job(const Job* job) {
+    job->func(job->data,job->begin,job->end);
+    atomic_add(job->remaining,-1);
+}
+
+static void worker_loop(WorkerArgs* args) {
+    JobSystem* jobs = args->system;
+    tls_system = jobs;
+    tls_index = args->index;
+
+    for(;;) {
+        Job job;
+        if(find_job(jobs,args->index,&job)) {
+            run_job(&job);
+            continue;
+        }
+
+        mutex_lock(&jobs->sleep_lock);
+        while(!atomic_load(&jobs->pending) && !atomic_load(&jobs->quit))
+            cond_wait(&jobs->wake,&jobs->sleep_lock);
+        mutex_unlock(&jobs->sleep_lock);
+
+        if(atomic_load(&jobs->quit))
+            break;
+    }
+    arena_scratch_release();
+}
+
+#if defined(_WIN32)
+static DWORD WINAPI worker_entry(LPVOID args) {
+    worker_loop((WorkerArgs*)args);
+    return 0;
+}
+#else
+static void* worker_entry(void* args) {
+    worker_loop((WorkerArgs*)args);
+    return NULL;
+}
+#endif
+
+u32 job_system_core_count(void) {
+#if defined(_WIN32)
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors ? info.dwNumberOfProcessors : 1;
+#else
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (u32)count : 1;
+#endif
+}
+
+JobSystem* job_system_create(u32 worker_count) {
+    if(worker_count == 0)
+        worker_count = job_system_core_count() > 1 ? job_system_core_count() - 1 : 0;
+
+    JobSystem* jobs = calloc(1,sizeof(JobSystem));
+    if(!jobs)
+        return NULL;
+
+    jobs->thread_count = worker_count + 1;
+    jobs->queues      = calloc(jobs->thread_count,sizeof(JobQueue));
+    jobs->threads     = calloc(jobs->thread_count,sizeof(Thread));
+    jobs->worker_args = calloc(jobs->thread_count,sizeof(WorkerArgs));
+    mutex_init(&jobs->sleep_lock);
+    cond_init(&jobs->wake);
+
+    for(u32 i = 0; i < jobs->thread_count; i++) {
+        mutex_init(&jobs->queues[i].lock);
+        jobs->queues[i].jobs = malloc(QUEUE_INITIAL_CAPACITY * sizeof(Job));
+        jobs->queues[i].capacity = QUEUE_INITIAL_CAPACITY;
+    }
+
+    tls_system = jobs;
+    tls_index = 0;
+
+    for(u32 i = 1; i < jobs->thread_count; i++) {
+        jobs->worker_args[i].system = jobs;
+        jobs->worker_args[i].index = i;
+#if defined(_WIN32)
+        jobs->threads[i] = CreateThread(NULL,0,worker_entry,&jobs->worker_args[i],0,NULL);
+#else
+        pthread_create(&jobs->threads[i],NULL,worker_entry,&jobs->worker_args[i]);
+#endif
+    }
+    return jobs;
+}
+
+void job_system_destroy(JobSystem* jobs) {
+    if(!jobs)
+        return;
+
+    mutex_lock(&jobs->sleep_lock);
+    atomic_add(&jobs->quit,1);
+    cond_broadcast(&jobs->wake);
+    mutex_unlock(&jobs->sleep_lock);
+
+    for(u32 i = 1; i < jobs->thread_count; i++) {
+#if defined(_WIN32)
+        WaitForSingleObject(jobs->threads[i],INFINITE);
+        CloseHandle(jobs->threads[i]);
+#else
+        pthread_join(jobs->threads[i],NULL);
+#endif
+    }
+
+    for(u32 i = 0; i < jobs->thread_count; i++) {
+        mutex_destroy(&jobs->queues[i].lock);
+        free(jobs->queues[i].jobs);
+    }
+
+    if(tls_system == jobs)
+        tls_system = NULL;
+
+    cond_destroy(&jobs->wake);
+    mutex_destroy(&jobs->sleep_lock);
+    free(jobs->queues);
+    free(jobs->threads);
+    free(jobs->worker_args);
+    free(jobs);
+}
+
+u32 job_system_thread_count(const JobSystem* jobs) {
+    return jobs ? jobs->thread_count : 1;
+}
+
+u32 job_system_thread_index(const JobSystem* jobs) {
+    return (jobs && tls_system == jobs) ? tls_index : 0;
+}
+
+void job_system_parallel_for(JobSystem* jobs,u32 count,u32 batch_size,JobFunc func,void* data) {
+    if(!count)
+        return;
+    if(!batch_size)
+        batch_size = 1;
+
+    if(!jobs || jobs->thread_count == 1 || count <= batch_size) {
+        func(data,0,count);
+        return;
+    }
+
+    u32 index = job_system_thread_index(jobs);
+    u32 batch_count = (count + batch_size - 1) / batch_size;
+    volatile long remaining = batch_count;
+
+    // round robin over every queue, stealing evens out whatever is left unbalanced
+    for(u32 i = 0; i < batch_count; i++) {
+        Job job = { func, data, i * batch_size, i * batch_size + batch_size, &remaining };
+        if(job.end > count)
+            job.end = count;
+        queue_push(&jobs->queues[(index + i) % jobs->thread_count],&job);
+    }
+
+    atomic_add(&jobs->pending,(long)batch_count);
+    mutex_lock(&jobs->sleep_lock);
+    cond_broadcast(&jobs->wake);
+    mutex_unlock(&jobs->sleep_lock);
+
+    while(atomic_load(&remaining) > 0) {
+        Job job;
+        if(find_job(jobs,index,&job))
+            run_job(&job);
+        else
+            thread_yield();
+    }
+}
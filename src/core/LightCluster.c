@@ -0,0 +1,256 @@
+#include "LightCluster.h"
+#include "Simd.h"
+#include <cglm/cglm.h>
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CLUSTER_LIGHT_BATCH 8
+// the shader picks a froxel from its own float math, widening the ranges keeps borderline fragments covered
+#define CLUSTER_EPSILON 1e-3f
+
+typedef struct {
+    u32 light;
+    u8 x0, x1, y0, y1;
+}ClusterCandidate;
+
+struct ClusterSlice {
+    ClusterCandidate* candidates;
+    u32 candidate_capacity;
+    u32* indices;
+    u32 index_count;
+    u32 index_capacity;
+    u32 counts[CLUSTER_TILES];
+    u32 offsets[CLUSTER_TILES];
+};
+
+typedef struct {
+    LightClusterGrid* grid;
+    const PointLight* lights;
+    const ClusterView* view;
+}ClusterBuild;
+
+void light_cluster_grid_init(LightClusterGrid* grid) {
+    memset(grid,0,sizeof(LightClusterGrid));
+    grid->slices = calloc(CLUSTER_Z,sizeof(ClusterSlice));
+}
+
+void light_cluster_grid_free(LightClusterGrid* grid) {
+    for(u32 z = 0; z < CLUSTER_Z; z++) {
+        free(grid->slices[z].candidates);
+        free(grid->slices[z].indices);
+    }
+    free(grid->slices);
+    free(grid->indices);
+    free(grid->view_x);
+    memset(grid,0,sizeof(LightClusterGrid));
+}
+
+f32 point_light_radius(const PointLight* light) {
+    f32 brightest = glm_max(light->color_intensity[0],glm_max(light->color_intensity[1],light->color_intensity[2]));
+    f32 k = brightest * light->color_intensity[3] / POINT_LIGHT_CUTOFF;
+    f32 c = light->attenuation_factors[0];
+    f32 l = light->attenuation_factors[1];
+    f32 q = light->attenuation_factors[2];
+    if(k <= c)
+        return 0.0f;
+    if(q > 0.0f)
+        return (-l + sqrtf(l * l + 4.0f * q * (k - c))) / (2.0f * q);
+    if(l > 0.0f)
+        return (k - c) / l;
+    return FLT_MAX; // constant attenuation never fades
+}
+
+u32 light_cluster_index(u32 x,u32 y,u32 z) {
+    return x + CLUSTER_X * (y + CLUSTER_Y * z);
+}
+
+void light_cluster_slice_depths(const ClusterView* view,u32 z,f32* start,f32* end) {
+    f32 ratio = view->z_far / view->z_near;
+    *start = z == 0 ? 0.0f : view->z_near * powf(ratio,(f32)z / CLUSTER_Z);
+    *end = z == CLUSTER_Z - 1 ? FLT_MAX : view->z_near * powf(ratio,(f32)(z + 1) / CLUSTER_Z);
+}
+
+static void transform_lights(void* data,u32 begin,u32 end) {
+    ClusterBuild* build = data;
+    LightClusterGrid* grid = build->grid;
+    const vec4* view = (const vec4*)build->view->view;
+    for(u32 i = begin; i < end; i++) {
+        const f32* p = build->lights[i].pos;
+        grid->view_x[i] = view[0][0] * p[0] + view[1][0] * p[1] + view[2][0] * p[2] + view[3][0];
+        grid->view_y[i] = view[0][1] * p[0] + view[1][1] * p[1] + view[2][1] * p[2] + view[3][1];
+        grid->depth[i] = -(view[0][2] * p[0] + view[1][2] * p[1] + view[2][2] * p[2] + view[3][2]);
+        grid->radius[i] = build->lights[i].attenuation_factors[3];
+    }
+}
+
+static u32 tile_coordinate(f32 ndc,u32 tiles) {
+    f32 t = (ndc * 0.5f + 0.5f) * tiles;
+    if(t <= 0.0f)
+        return 0;
+    return t >= tiles ? tiles - 1 : (u32)t;
+}
+
+// tiles the light covers somewhere in the depth range [d0, d1], false when it is off screen there
+static bool light_tiles(f32 x,f32 y,f32 depth,f32 radius,f32 d0,f32 d1,f32 tan_x,f32 tan_y,ClusterCandidate* candidate) {
+    f32 a = glm_max(d0,depth - radius);
+    f32 b = glm_min(d1,depth + radius);
+    // widest cross section of the sphere inside the range
+    f32 dz = depth < a ? a - depth : depth > b ? depth - b : 0.0f;
+    f32 e = sqrtf(glm_max(radius * radius - dz * dz,0.0f));
+    a = glm_max(a,1e-4f);
+
+    f32 x_min = glm_min((x - e) / a,(x - e) / b) / tan_x - CLUSTER_EPSILON;
+    f32 x_max = glm_max((x + e) / a,(x + e) / b) / tan_x + CLUSTER_EPSILON;
+    f32 y_min = glm_min((y - e) / a,(y - e) / b) / tan_y - CLUSTER_EPSILON;
+    f32 y_max = glm_max((y + e) / a,(y + e) / b) / tan_y + CLUSTER_EPSILON;
+    if(x_min > 1.0f || x_max < -1.0f || y_min > 1.0f || y_max < -1.0f)
+        return false;
+
+    candidate->x0 = tile_coordinate(x_min,CLUSTER_X);
+    candidate->x1 = tile_coordinate(x_max,CLUSTER_X);
+    candidate->y0 = tile_coordinate(y_min,CLUSTER_Y);
+    candidate->y1 = tile_coordinate(y_max,CLUSTER_Y);
+    return true;
+}
+
+static void bin_slice(void* data,u32 begin,u32 end) {
+    ClusterBuild* build = data;
+    LightClusterGrid* grid = build->grid;
+    const ClusterView* view = build->view;
+    f32 tan_y = view->tan_half_fov_y;
+    f32 tan_x = tan_y * view->aspect;
+
+    for(u32 z = begin; z < end; z++) {
+        ClusterSlice* slice = &grid->slices[z];
+        f32 d0, d1;
+        light_cluster_slice_depths(view,z,&d0,&d1);
+        d0 = z == 0 ? d0 : d0 * (1.0f - CLUSTER_EPSILON);
+        d1 = z == CLUSTER_Z - 1 ? d1 : d1 * (1.0f + CLUSTER_EPSILON);
+
+        // lights whose depth interval overlaps the slice, SIMD over the structure of arrays copy
+        u32 candidate_count = 0;
+        u32 padded = (grid->light_count + CLUSTER_LIGHT_BATCH - 1) / CLUSTER_LIGHT_BATCH * CLUSTER_LIGHT_BATCH;
+        for(u32 base = 0; base < padded; base += CLUSTER_LIGHT_BATCH) {
+            u32 mask = 0;
+#if defined(__AVX__)
+            __m256 depth = _mm256_loadu_ps(grid->depth + base);
+            __m256 radius = _mm256_loadu_ps(grid->radius + base);
+            __m256 front = _mm256_cmp_ps(_mm256_sub_ps(depth,radius),_mm256_set1_ps(d1),_CMP_LE_OQ);
+            __m256 back = _mm256_cmp_ps(_mm256_add_ps(depth,radius),_mm256_set1_ps(d0),_CMP_GE_OQ);
+            __m256 lit = _mm256_cmp_ps(radius,_mm256_setzero_ps(),_CMP_GT_OQ);
+            mask = (u32)_mm256_movemask_ps(_mm256_and_ps(_mm256_and_ps(front,back),lit));
+#elif defined(SIMD_SSE)
+            for(u32 half = 0; half < CLUSTER_LIGHT_BATCH; half += 4) {
+                __m128 depth = _mm_loadu_ps(grid->depth + base + half);
+                __m128 radius = _mm_loadu_ps(grid->radius + base + half);
+                __m128 front = _mm_cmple_ps(_mm_sub_ps(depth,radius),_mm_set1_ps(d1));
+                __m128 back = _mm_cmpge_ps(_mm_add_ps(depth,radius),_mm_set1_ps(d0));
+                __m128 lit = _mm_cmpgt_ps(radius,_mm_setzero_ps());
+                mask |= (u32)_mm_movemask_ps(_mm_and_ps(_mm_and_ps(front,back),lit)) << half;
+            }
+#else
+            for(u32 lane = 0; lane < CLUSTER_LIGHT_BATCH; lane++) {
+                f32 depth = grid->depth[base + lane], radius = grid->radius[base + lane];
+                mask |= (u32)(depth - radius <= d1 && depth + radius >= d0 && radius > 0.0f) << lane;
+            }
+#endif
+            while(mask) {
+                u32 i = base + lowest_bit(mask);
+                mask &= mask - 1;
+                ClusterCandidate* candidate = &slice->candidates[candidate_count];
+                if(light_tiles(grid->view_x[i],grid->view_y[i],grid->depth[i],grid->radius[i],d0,d1,tan_x,tan_y,candidate)) {
+                    candidate->light = i;
+                    ++candidate_count;
+                }
+            }
+        }
+
+        // count, prefix sum and fill, so every cluster's lights stay in ascending order
+        memset(slice->counts,0,sizeof(slice->counts));
+        for(u32 c = 0; c < candidate_count; c++) {
+            const ClusterCandidate* candidate = &slice->candidates[c];
+            for(u32 y = candidate->y0; y <= candidate->y1; y++) {
+                for(u32 x = candidate->x0; x <= candidate->x1; x++)
+                    slice->counts[x + CLUSTER_X * y]++;
+            }
+        }
+        u32 total = 0;
+        for(u32 t = 0; t < CLUSTER_TILES; t++) {
+            slice->offsets[t] = total;
+            total += slice->counts[t];
+        }
+        if(total > slice->index_capacity) {
+            slice->index_capacity = total + total / 2;
+            free(slice->indices);
+            slice->indices = malloc(slice->index_capacity * sizeof(u32));
+        }
+        slice->index_count = total;
+
+        u32 cursor[CLUSTER_TILES];
+        memcpy(cursor,slice->offsets,sizeof(cursor));
+        for(u32 c = 0; c < candidate_count; c++) {
+            const ClusterCandidate* candidate = &slice->candidates[c];
+            for(u32 y = candidate->y0; y <= candidate->y1; y++) {
+                for(u32 x = candidate->x0; x <= candidate->x1; x++)
+                    slice->indices[cursor[x + CLUSTER_X * y]++] = candidate->light;
+            }
+        }
+    }
+}
+
+void light_cluster_build(LightClusterGrid* grid,JobSystem* jobs,const PointLight* lights,u32 count,const ClusterView* view) {
+    u32 padded = (count + CLUSTER_LIGHT_BATCH - 1) / CLUSTER_LIGHT_BATCH * CLUSTER_LIGHT_BATCH;
+    if(padded > grid->light_capacity || !grid->view_x) {
+        grid->light_capacity = padded > CLUSTER_LIGHT_BATCH ? padded : CLUSTER_LIGHT_BATCH;
+        free(grid->view_x);
+        // one allocation, x then y then depth then radius
+        grid->view_x = malloc(grid->light_capacity * 4 * sizeof(f32));
+        grid->view_y = grid->view_x + grid->light_capacity;
+        grid->depth = grid->view_y + grid->light_capacity;
+        grid->radius = grid->depth + grid->light_capacity;
+        for(u32 z = 0; z < CLUSTER_Z; z++) {
+            free(grid->slices[z].candidates);
+            grid->slices[z].candidates = malloc(grid->light_capacity * sizeof(ClusterCandidate));
+            grid->slices[z].candidate_capacity = grid->light_capacity;
+        }
+    }
+    grid->light_count = count;
+    // padding lanes have no radius, so they never pass the depth test
+    for(u32 i = count; i < padded; i++)
+        grid->view_x[i] = grid->view_y[i] = grid->depth[i] = grid->radius[i] = 0.0f;
+
+    ClusterBuild build = { grid, lights, view };
+    job_system_parallel_for(jobs,count,4096,transform_lights,&build);
+    job_system_parallel_for(jobs,CLUSTER_Z,1,bin_slice,&build);
+
+    u32 total = 0;
+    for(u32 z = 0; z < CLUSTER_Z; z++)
+        total += grid->slices[z].index_count;
+    if(total > grid->index_capacity) {
+        grid->index_capacity = total + total / 2;
+        free(grid->indices);
+        grid->indices = malloc(grid->index_capacity * sizeof(u32));
+    }
+
+    u32 base = 0;
+    for(u32 z = 0; z < CLUSTER_Z; z++) {
+        const ClusterSlice* slice = &grid->slices[z];
+        for(u32 t = 0; t < CLUSTER_TILES; t++)
+            grid->clusters[t + CLUSTER_TILES * z] = (LightCluster){ base + slice->offsets[t], slice->counts[t] };
+        memcpy(grid->indices + base,slice->indices,slice->index_count * sizeof(u32));
+        base += slice->index_count;
+    }
+    grid->index_count = total;
+}
+
+const char* light_cluster_isa(void) {
+#if defined(__AVX__)
+    return "AVX";
+#elif defined(SIMD_SSE)
+    return "SSE";
+#else
+    return "scalar";
+#endif
+}
@@ -0,0 +1,426 @@
+#include "MeshOptimizer.h"
+#include "Hash.h"
+#include <cglm/types.h>
+#include <math.h>
+#include <string.h>
+#include <stdlib.h>
+
+// vertex -> triangle adjacency in one offsets/data pair
+typedef struct {
+    u32* offsets; // vertex_count + 1
+    u32* triangles;
+    u32* live;    // triangles not emitted yet per vertex
+}Adjacency;
+
+static void build_adjacency(Arena* scratch,const u32* indices,u32 index_count,u32 vertex_count,Adjacency* adjacency) {
+    adjacency->offsets   = arena_alloc(scratch,u32,vertex_count + 1);
+    adjacency->triangles = arena_alloc(scratch,u32,index_count);
+    adjacency->live      = arena_alloc(scratch,u32,vertex_count);
+    memset(adjacency->live,0,vertex_count * sizeof(u32));
+
+    for(u32 i = 0; i < index_count; i++)
+        ++adjacency->live[indices[i]];
+
+    u32 offset = 0;
+    for(u32 v = 0; v < vertex_count; v++) {
+        adjacency->offsets[v] = offset;
+        offset += adjacency->live[v];
+    }
+    adjacency->offsets[vertex_count] = offset;
+
+    // offsets are used as write cursors and shifted back afterwards
+    for(u32 i = 0; i < index_count; i++)
+        adjacency->triangles[adjacency->offsets[indices[i]]++] = i / 3;
+    for(u32 v = vertex_count; v > 0; v--)
+        adjacency->offsets[v] = adjacency->offsets[v - 1];
+    adjacency->offsets[0] = 0;
+}
+
+void mesh_analyze_vertex_cache(const u32* indices,u32 index_count,u32 vertex_count,u32 cache_size,Arena* scratch,MeshCacheStats* stats) {
+    memset(stats,0,sizeof(MeshCacheStats));
+    if(index_count < 3 || !vertex_count)
+        return;
+
+    ArenaMarker marker = arena_marker(scratch);
+    // a vertex is in the FIFO while fewer than cache_size misses happened since it was loaded
+    u32* loaded_at = arena_alloc(scratch,u32,vertex_count);
+    u8* referenced = arena_alloc(scratch,u8,vertex_count);
+    memset(loaded_at,0,vertex_count * sizeof(u32));
+    memset(referenced,0,vertex_count);
+
+    u32 misses = 0, unique = 0;
+    for(u32 i = 0; i < index_count; i++) {
+        u32 v = indices[i];
+        if(!referenced[v]) {
+            referenced[v] = 1;
+            ++unique;
+        }
+        // miss numbers start at 1 so 0 always reads as never loaded
+        if(!loaded_at[v] || misses - loaded_at[v] >= cache_size)
+            loaded_at[v] = ++misses;
+    }
+
+    stats->acmr = (f32)misses / (f32)(index_count / 3);
+    stats->atvr = (f32)misses / (f32)unique;
+    arena_restore(scratch,marker);
+}
+
+static u32 skip_dead_end(const u32* live,u32* dead_end,u32* dead_end_count,u32* cursor,u32 vertex_count) {
+    while(*dead_end_count) {
+        u32 v = dead_end[--*dead_end_count];
+        if(live[v])
+            return v;
+    }
+    while(*cursor < vertex_count) {
+        if(live[*cursor])
+            return *cursor;
+        ++*cursor;
+    }
+    return UINT32_MAX;
+}
+
+void mesh_optimize_vertex_cache(u32* dest,const u32* indices,u32 index_count,u32 vertex_count,u32 cache_size,Arena* scratch) {
+    u32 triangle_count = index_count / 3;
+    if(!triangle_count || !vertex_count)
+        return;
+
+    ArenaMarker marker = arena_marker(scratch);
+
+    // dest may alias indices, read from a copy
+    u32* source = arena_alloc(scratch,u32,index_count);
+    memcpy(source,indices,index_count * sizeof(u32));
+
+    Adjacency adjacency;
+    build_adjacency(scratch,source,index_count,vertex_count,&adjacency);
+
+    u32* cache_time = arena_alloc(scratch,u32,vertex_count);
+    u8* emitted     = arena_alloc(scratch,u8,triangle_count);
+    u32* dead_end   = arena_alloc(scratch,u32,index_count);
+    u32* candidates = arena_alloc(scratch,u32,index_count);
+    memset(cache_time,0,vertex_count * sizeof(u32));
+    memset(emitted,0,triangle_count);
+
+    u32 dead_end_count = 0;
+    u32 time = cache_size + 1;
+    u32 cursor = 0;
+    u32 written = 0;
+    u32 fan = 0;
+
+    while(fan != UINT32_MAX) {
+        u32 candidate_count = 0;
+
+        for(u32 i = adjacency.offsets[fan]; i < adjacency.offsets[fan + 1]; i++) {
+            u32 t = adjacency.triangles[i];
+            if(emitted[t])
+                continue;
+            emitted[t] = 1;
+
+            for(u32 k = 0; k < 3; k++) {
+                u32 v = source[t * 3 + k];
+                dest[written++] = v;
+                dead_end[dead_end_count++] = v;
+                candidates[candidate_count++] = v;
+                --adjacency.live[v];
+                if(time - cache_time[v] > cache_size)
+                    cache_time[v] = time++;
+            }
+        }
+
+        // prefer the candidate that stays in the cache the longest once its remaining fan is emitted
+        u32 best = UINT32_MAX;
+        i64 best_priority = -1;
+        for(u32 i = 0; i < candidate_count; i++) {
+            u32 v = candidates[i];
+            if(!adjacency.live[v])
+                continue;
+            i64 priority = 0;
+            if(time - cache_time[v] + 2 * adjacency.live[v] <= cache_size)
+                priority = time - cache_time[v];
+            if(priority > best_priority) {
+                best_priority = priority;
+                best = v;
+            }
+        }
+
+        fan = best != UINT32_MAX ? best : skip_dead_end(adjacency.live,dead_end,&dead_end_count,&cursor,vertex_count);
+    }
+
+    arena_restore(scratch,marker);
+}
+
+typedef struct {
+    u32 first_triangle;
+    u32 triangle_count;
+    f32 sort_key;
+}Cluster;
+
+static int cluster_compare(const void* a,const void* b) {
+    const Cluster* ca = (const Cluster*)a;
+    const Cluster* cb = (const Cluster*)b;
+    // outward facing clusters first, ties keep the cache order
+    if(ca->sort_key != cb->sort_key)
+        return ca->sort_key > cb->sort_key ? -1 : 1;
+    return ca->first_triangle < cb->first_triangle ? -1 : 1;
+}
+
+static const f32* position_at(const f32* positions,u32 stride,u32 v) {
+    return (const f32*)((const u8*)positions + (u64)v * stride);
+}
+
+void mesh_optimize_overdraw(u32* dest,const u32* indices,u32 index_count,const f32* positions,u32 position_stride,
+                            u32 vertex_count,u32 cache_size,f32 threshold,Arena* scratch) {
+    u32 triangle_count = index_count / 3;
+    if(!triangle_count || !vertex_count)
+        return;
+
+    ArenaMarker marker = arena_marker(scratch);
+    u32* source = arena_alloc(scratch,u32,index_count);
+    memcpy(source,indices,index_count * sizeof(u32));
+
+    // per triangle cache misses with the same FIFO model as mesh_analyze_vertex_cache
+    u8* triangle_misses = arena_alloc(scratch,u8,triangle_count);
+    u32* loaded_at = arena_alloc(scratch,u32,vertex_count);
+    memset(loaded_at,0,vertex_count * sizeof(u32));
+    u32 misses = 0;
+    for(u32 t = 0; t < triangle_count; t++) {
+        triangle_misses[t] = 0;
+        for(u32 k = 0; k < 3; k++) {
+            u32 v = source[t * 3 + k];
+            if(!loaded_at[v] || misses - loaded_at[v] >= cache_size) {
+                loaded_at[v] = ++misses;
+                ++triangle_misses[t];
+            }
+        }
+    }
+    f32 mesh_acmr = (f32)misses / (f32)triangle_count;
+
+    // hard boundaries where the cache order jumped to a fresh region anyway. soft ones once the cluster,
+    // simulated from a flushed cache as it will be after sorting, is within threshold of the whole mesh
+    Cluster* clusters = arena_alloc(scratch,Cluster,triangle_count);
+    u32 cluster_count = 0;
+    u32 cluster_start = 0;
+    memset(loaded_at,0,vertex_count * sizeof(u32));
+    misses = 0;
+    for(u32 t = 0; t < triangle_count; t++) {
+        bool hard = triangle_misses[t] == 3;
+        bool soft = cluster_count && triangle_misses[t] > 0 &&
+                    (f32)(misses - cluster_start) / (f32)clusters[cluster_count - 1].triangle_count <= mesh_acmr * threshold;
+        if(!cluster_count || hard || soft) {
+            clusters[cluster_count].first_triangle = t;
+            clusters[cluster_count].triangle_count = 0;
+            ++cluster_count;
+            cluster_start = misses;
+        }
+        ++clusters[cluster_count - 1].triangle_count;
+
+        for(u32 k = 0; k < 3; k++) {
+            u32 v = source[t * 3 + k];
+            if(loaded_at[v] <= cluster_start || misses - loaded_at[v] >= cache_size)
+                loaded_at[v] = ++misses;
+        }
+    }
+
+    vec3 mesh_center = {0.0f, 0.0f, 0.0f};
+    f32 mesh_area = 0.0f;
+    f32* areas = arena_alloc(scratch,f32,triangle_count);
+    vec3* normals = arena_alloc(scratch,vec3,triangle_count);
+    vec3* centers = arena_alloc(scratch,vec3,triangle_count);
+    for(u32 t = 0; t < triangle_count; t++) {
+        const f32* a = position_at(positions,position_stride,source[t * 3 + 0]);
+        const f32* b = position_at(positions,position_stride,source[t * 3 + 1]);
+        const f32* c = position_at(positions,position_stride,source[t * 3 + 2]);
+        vec3 e0 = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+        vec3 e1 = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+        // cross product length is twice the area, the factor cancels out in every weighted sum
+        normals[t][0] = e0[1] * e1[2] - e0[2] * e1[1];
+        normals[t][1] = e0[2] * e1[0] - e0[0] * e1[2];
+        normals[t][2] = e0[0] * e1[1] - e0[1] * e1[0];
+        areas[t] = sqrtf(normals[t][0] * normals[t][0] + normals[t][1] * normals[t][1] + normals[t][2] * normals[t][2]);
+        for(u32 k = 0; k < 3; k++) {
+            centers[t][k] = (a[k] + b[k] + c[k]) / 3.0f;
+            mesh_center[k] += centers[t][k] * areas[t];
+        }
+        mesh_area += areas[t];
+    }
+    if(mesh_area > 0.0f)
+        for(u32 k = 0; k < 3; k++)
+            mesh_center[k] /= mesh_area;
+
+    for(u32 i = 0; i < cluster_count; i++) {
+        Cluster* cluster = &clusters[i];
+        vec3 center = {0.0f, 0.0f, 0.0f};
+        vec3 normal = {0.0f, 0.0f, 0.0f};
+        f32 area = 0.0f;
+        for(u32 t = cluster->first_triangle; t < cluster->first_triangle + cluster->triangle_count; t++) {
+            for(u32 k = 0; k < 3; k++) {
+                center[k] += centers[t][k] * areas[t];
+                normal[k] += normals[t][k]; // already area weighted
+            }
+            area += areas[t];
+        }
+        if(area > 0.0f)
+            for(u32 k = 0; k < 3; k++)
+                center[k] /= area;
+
+        cluster->sort_key = (center[0] - mesh_center[0]) * normal[0] +
+                            (center[1] - mesh_center[1]) * normal[1] +
+                            (center[2] - mesh_center[2]) * normal[2];
+        f32 normal_length = sqrtf(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+        if(normal_length > 0.0f)
+            cluster->sort_key /= normal_length;
+    }
+
+    qsort(clusters,cluster_count,sizeof(Cluster),cluster_compare);
+
+    u32 written = 0;
+    for(u32 i = 0; i < cluster_count; i++) {
+        u32 count = clusters[i].triangle_count * 3;
+        memcpy(dest + written,source + clusters[i].first_triangle * 3,count * sizeof(u32));
+        written += count;
+    }
+
+    arena_restore(scratch,marker);
+}
+
+u32 mesh_optimize_vertex_fetch_remap(u32* remap,u32* indices,u32 index_count,u32 vertex_count) {
+    memset(remap,0xff,vertex_count * sizeof(u32));
+
+    u32 next = 0;
+    for(u32 i = 0; i < index_count; i++) {
+        u32 v = indices[i];
+        if(remap[v] == UINT32_MAX)
+            remap[v] = next++;
+        indices[i] = remap[v];
+    }
+
+    u32 referenced = next;
+    for(u32 v = 0; v < vertex_count; v++)
+        if(remap[v] == UINT32_MAX)
+            remap[v] = next++;
+    return referenced;
+}
+
+void mesh_remap_vertices(void* verticies,u32 vertex_count,u32 vertex_size,const u32* remap,Arena* scratch) {
+    if(!vertex_count)
+        return;
+
+    ArenaMarker marker = arena_marker(scratch);
+    u8* copy = arena_alloc_aligned(scratch,(u64)vertex_count * vertex_size,ARENA_DEFAULT_ALIGNMENT);
+    memcpy(copy,verticies,(u64)vertex_count * vertex_size);
+    for(u32 v = 0; v < vertex_count; v++)
+        memcpy((u8*)verticies + (u64)remap[v] * vertex_size,copy + (u64)v * vertex_size,vertex_size);
+    arena_restore(scratch,marker);
+}
+
+void mesh_optimize(u32* indices,u32 index_count,void* verticies,u32 vertex_count,u32 vertex_size,u32 position_offset,
+                   bool optimize_overdraw,Arena* scratch,MeshCacheStats* before,MeshCacheStats* after) {
+    if(before)
+        mesh_analyze_vertex_cache(indices,index_count,vertex_count,MESH_OPTIMIZER_CACHE_SIZE,scratch,before);
+
+    mesh_optimize_vertex_cache(indices,indices,index_count,vertex_count,MESH_OPTIMIZER_CACHE_SIZE,scratch);
+    if(optimize_overdraw)
+        mesh_optimize_overdraw(indices,indices,index_count,(const f32*)((const u8*)verticies + position_offset),vertex_size,
+                               vertex_count,MESH_OPTIMIZER_CACHE_SIZE,MESH_OPTIMIZER_OVERDRAW_THRESHOLD,scratch);
+
+    ArenaMarker marker = arena_marker(scratch);
+    u32* remap = arena_alloc(scratch,u32,vertex_count ? vertex_count : 1);
+    mesh_optimize_vertex_fetch_remap(remap,indices,index_count,vertex_count);
+    mesh_remap_vertices(verticies,vertex_count,vertex_size,remap,scratch);
+    arena_restore(scratch,marker);
+
+    if(after)
+        mesh_analyze_vertex_cache(indices,index_count,vertex_count,MESH_OPTIMIZER_CACHE_SIZE,scratch,after);
+}
+
+u32 mesh_weld_vertices(u32* remap,const void* verticies,u32 vertex_count,u32 vertex_size,Arena* scratch) {
+    if(!vertex_count)
+        return 0;
+
+    // open addressing, at most half full
+    u32 table_size = 1;
+    while(table_size < vertex_count * 2)
+        table_size <<= 1;
+
+    ArenaMarker marker = arena_marker(scratch);
+    u32* table = arena_alloc(scratch,u32,table_size);
+    memset(table,0xff,table_size * sizeof(u32));
+
+    const u8* bytes = (const u8*)verticies;
+    u32 unique = 0;
+    for(u32 v = 0; v < vertex_count; v++) {
+        const u8* vertex = bytes + (u64)v * vertex_size;
+        u32 slot = (u32)hash_fnv1a(vertex,vertex_size,HASH_FNV_SEED) & (table_size - 1);
+        for(;;) {
+            u32 existing = table[slot];
+            if(existing == UINT32_MAX) {
+                table[slot] = v;
+                remap[v] = unique++;
+                break;
+            }
+            if(memcmp(bytes + (u64)existing * vertex_size,vertex,vertex_size) == 0) {
+                remap[v] = remap[existing];
+                break;
+            }
+            slot = (slot + 1) & (table_size - 1);
+        }
+    }
+
+    arena_restore(scratch,marker);
+    return unique;
+}
+
+static void weld_commands(DrawElementsIndirectCommand* commands,u32 count,u32* indices,u32 first_vertex,const u32* remap) {
+    for(u32 c = 0; c < count; c++) {
+        DrawElementsIndirectCommand* command = &commands[c];
+        u32* slice = indices + command->firstIndex;
+        u32 lowest = UINT32_MAX;
+        for(u32 i = 0; i < command->count; i++) {
+            slice[i] = remap[command->baseVertex + slice[i] - first_vertex];
+            if(slice[i] < lowest)
+                lowest = slice[i];
+        }
+        if(!command->count)
+            lowest = 0;
+        for(u32 i = 0; i < command->count; i++)
+            slice[i] -= lowest;
+        command->baseVertex = first_vertex + lowest;
+    }
+}
+
+void scene_weld_vertices(Scene* scene,u32 first_vertex,u32 first_culled_command,u32 first_non_culled_command,
+                         Arena* scratch,MeshWeldStats* stats) {
+    u32 count = scene->vertex_vector.size - first_vertex;
+    Vertex* verticies = scene->vertex_vector.data + first_vertex;
+
+    ArenaMarker marker = arena_marker(scratch);
+    u32* remap = arena_alloc(scratch,u32,count ? count : 1);
+    u32 unique = mesh_weld_vertices(remap,verticies,count,sizeof(Vertex),scratch);
+
+    weld_commands(scene->culled_backface_indirect_command_vector.data + first_culled_command,
+                  scene->culled_backface_indirect_command_vector.size - first_culled_command,
+                  scene->index_vector.data,first_vertex,remap);
+    weld_commands(scene->non_culled_backface_indirect_command_vector.data + first_non_culled_command,
+                  scene->non_culled_backface_indirect_command_vector.size - first_non_culled_command,
+                  scene->index_vector.data,first_vertex,remap);
+
+    // numbered by first occurrence, so every unique vertex moves down or stays
+    u32 next = 0;
+    for(u32 v = 0; v < count; v++) {
+        if(remap[v] != next)
+            continue;
+        if(v != next)
+            verticies[next] = verticies[v];
+        ++next;
+    }
+    arena_restore(scratch,marker);
+
+    scene->vertex_vector.size = first_vertex + unique;
+    if(unique < count)
+        vector_reserve(scene->vertex_vector,Vertex,scene->vertex_vector.size + 1);
+
+    if(stats) {
+        stats->vertex_count_before = count;
+        stats->vertex_count_after = unique;
+        stats->bytes_saved = (u64)(count - unique) * sizeof(Vertex);
+    }
+}
@@ -0,0 +1,320 @@
+#include "Meshlet.h"
+#include "Timer.h"
+#include <cglm/cglm.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    const DrawElementsIndirectCommand* commands;
+    u32 command_index;
+    u32 flags;
+}MeshletSource;
+
+typedef struct {
+    Scene* scene;
+    const MeshletSource* sources;
+    Meshlet** meshlets; // per source
+    u32* meshlet_counts;
+    const u8* verticies;
+    u32 vertex_size;
+    u32 position_offset;
+}MeshletBatch;
+
+u32 meshlet_max_count(u32 index_count) {
+    return index_count / 3 / 21 + 1;
+}
+
+static const f32* meshlet_position(const void* verticies,u32 vertex_size,u32 position_offset,u32 v) {
+    return (const f32*)((const u8*)verticies + (u64)v * vertex_size + position_offset);
+}
+
+static void compute_bounds(Meshlet* meshlet,const u32* indices,const void* verticies,u32 vertex_size,u32 position_offset) {
+    vec3 min = {FLT_MAX,FLT_MAX,FLT_MAX};
+    vec3 max = {-FLT_MAX,-FLT_MAX,-FLT_MAX};
+    for(u32 i = 0; i < meshlet->index_count; i++) {
+        const f32* p = meshlet_position(verticies,vertex_size,position_offset,indices[i]);
+        glm_vec3_minv(min,(f32*)p,min);
+        glm_vec3_maxv(max,(f32*)p,max);
+    }
+
+    vec3 center;
+    glm_vec3_center(min,max,center);
+    f32 radius = 0.0f;
+    for(u32 i = 0; i < meshlet->index_count; i++) {
+        f32 distance = glm_vec3_distance(center,(f32*)meshlet_position(verticies,vertex_size,position_offset,indices[i]));
+        radius = distance > radius ? distance : radius;
+    }
+    glm_vec4(center,radius,meshlet->sphere);
+
+    // normal cone over the non degenerate triangles
+    u32 triangle_count = meshlet->index_count / 3;
+    vec3 axis = {0.0f,0.0f,0.0f};
+    u32 normal_count = 0;
+    for(u32 t = 0; t < triangle_count; t++) {
+        const f32* a = meshlet_position(verticies,vertex_size,position_offset,indices[t * 3 + 0]);
+        const f32* b = meshlet_position(verticies,vertex_size,position_offset,indices[t * 3 + 1]);
+        const f32* c = meshlet_position(verticies,vertex_size,position_offset,indices[t * 3 + 2]);
+        vec3 e0, e1, normal;
+        glm_vec3_sub((f32*)b,(f32*)a,e0);
+        glm_vec3_sub((f32*)c,(f32*)a,e1);
+        glm_vec3_cross(e0,e1,normal);
+        f32 length = glm_vec3_norm(normal);
+        if(length <= 1e-12f)
+            continue;
+        glm_vec3_muladds(normal,1.0f / length,axis);
+        ++normal_count;
+    }
+
+    meshlet->cone[3] = 2.0f;
+    glm_vec3_copy(center,meshlet->cone_apex);
+    f32 axis_length = glm_vec3_norm(axis);
+    if(!normal_count || axis_length <= 1e-6f)
+        return;
+    glm_vec3_scale(axis,1.0f / axis_length,axis);
+
+    f32 min_dot = 1.0f;
+    for(u32 t = 0; t < triangle_count; t++) {
+        const f32* a = meshlet_position(verticies,vertex_size,position_offset,indices[t * 3 + 0]);
+        const f32* b = meshlet_position(verticies,vertex_size,position_offset,indices[t * 3 + 1]);
+        const f32* c = meshlet_position(verticies,vertex_size,position_offset,indices[t * 3 + 2]);
+        vec3 e0, e1, normal;
+        glm_vec3_sub((f32*)b,(f32*)a,e0);
+        glm_vec3_sub((f32*)c,(f32*)a,e1);
+        glm_vec3_cross(e0,e1,normal);
+        f32 length = glm_vec3_norm(normal);
+        if(length <= 1e-12f)
+            continue;
+        f32 d = glm_vec3_dot(axis,normal) / length;
+        min_dot = d < min_dot ? d : min_dot;
+    }
+    // too wide to ever be entirely backfacing
+    if(min_dot <= 0.1f)
+        return;
+
+    // apex on the axis behind every triangle plane: center - axis * t with dot(center - axis * t - corner, normal) <= 0
+    f32 max_t = 0.0f;
+    for(u32 t = 0; t < triangle_count; t++) {
+        const f32* a = meshlet_position(verticies,vertex_size,position_offset,indices[t * 3 + 0]);
+        const f32* b = meshlet_position(verticies,vertex_size,position_offset,indices[t * 3 + 1]);
+        const f32* c = meshlet_position(verticies,vertex_size,position_offset,indices[t * 3 + 2]);
+        vec3 e0, e1, normal, to_center;
+        glm_vec3_sub((f32*)b,(f32*)a,e0);
+        glm_vec3_sub((f32*)c,(f32*)a,e1);
+        glm_vec3_cross(e0,e1,normal);
+        if(glm_vec3_norm(normal) <= 1e-12f)
+            continue;
+        glm_vec3_sub(center,(f32*)a,to_center);
+        f32 t_plane = glm_vec3_dot(to_center,normal) / glm_vec3_dot(axis,normal);
+        max_t = t_plane > max_t ? t_plane : max_t;
+    }
+
+    glm_vec3_copy(axis,meshlet->cone);
+    meshlet->cone[3] = sqrtf(1.0f - min_dot * min_dot);
+    glm_vec3_copy(center,meshlet->cone_apex);
+    glm_vec3_muladds(axis,-max_t,meshlet->cone_apex);
+}
+
+// distinct verticies of the triangle that the current meshlet does not hold yet
+static u32 new_vertex_count(const u32* stamp,const u32* triangle,u32 meshlet) {
+    u32 a = triangle[0], b = triangle[1], c = triangle[2];
+    return (stamp[a] != meshlet) + (stamp[b] != meshlet && b != a) + (stamp[c] != meshlet && c != a && c != b);
+}
+
+u32 meshlet_build(Meshlet* dest,const u32* indices,u32 index_count,u32 first_index,const void* verticies,
+                  u32 vertex_size,u32 position_offset,Arena* scratch) {
+    u32 triangle_count = index_count / 3;
+    if(!triangle_count)
+        return 0;
+
+    u32 max_index = 0;
+    for(u32 i = 0; i < index_count; i++)
+        max_index = indices[i] > max_index ? indices[i] : max_index;
+
+    ArenaMarker marker = arena_marker(scratch);
+    // holds the 1 based number of the last meshlet a vertex went into
+    u32* stamp = arena_alloc(scratch,u32,max_index + 1);
+    memset(stamp,0,(max_index + 1) * sizeof(u32));
+
+    u32 count = 0;
+    Meshlet* meshlet = NULL;
+    for(u32 t = 0; t < triangle_count; t++) {
+        const u32* triangle = indices + t * 3;
+        if(meshlet && (meshlet->vertex_count + new_vertex_count(stamp,triangle,count) > MESHLET_MAX_VERTICES ||
+                       meshlet->index_count / 3 + 1 > MESHLET_MAX_TRIANGLES))
+            meshlet = NULL;
+
+        if(!meshlet) {
+            meshlet = &dest[count++];
+            memset(meshlet,0,sizeof(Meshlet));
+            meshlet->first_index = first_index + t * 3;
+        }
+
+        for(u32 k = 0; k < 3; k++) {
+            if(stamp[triangle[k]] != count) {
+                stamp[triangle[k]] = count;
+                ++meshlet->vertex_count;
+            }
+        }
+        meshlet->index_count += 3;
+    }
+    arena_restore(scratch,marker);
+
+    for(u32 i = 0; i < count; i++)
+        compute_bounds(&dest[i],indices + (dest[i].first_index - first_index),verticies,vertex_size,position_offset);
+    return count;
+}
+
+static void build_job(void* data,u32 begin,u32 end) {
+    MeshletBatch* batch = (MeshletBatch*)data;
+    for(u32 i = begin; i < end; i++) {
+        const MeshletSource* source = &batch->sources[i];
+        const DrawElementsIndirectCommand* command = &source->commands[source->command_index];
+        batch->meshlets[i] = malloc(meshlet_max_count(command->count) * sizeof(Meshlet));
+        batch->meshlet_counts[i] = meshlet_build(batch->meshlets[i],batch->scene->index_vector.data + command->firstIndex,
+                                                 command->count,command->firstIndex,
+                                                 batch->verticies + (u64)command->baseVertex * batch->vertex_size,
+                                                 batch->vertex_size,batch->position_offset,arena_scratch());
+        for(u32 m = 0; m < batch->meshlet_counts[i]; m++) {
+            batch->meshlets[i][m].command = source->command_index;
+            batch->meshlets[i][m].flags = source->flags;
+        }
+    }
+}
+
+void scene_build_meshlets(JobSystem* jobs,Scene* scene,u32 first_culled_command,u32 first_non_culled_command,
+                          MeshletBuildStats* stats) {
+    f64 start = timer_now();
+    u32 culled_count = scene->culled_backface_indirect_command_vector.size - first_culled_command;
+    u32 non_culled_count = scene->non_culled_backface_indirect_command_vector.size - first_non_culled_command;
+    u32 source_count = culled_count + non_culled_count;
+
+    MeshletSource* sources = calloc(source_count + 1,sizeof(MeshletSource));
+    for(u32 i = 0; i < culled_count; i++)
+        sources[i] = (MeshletSource){ scene->culled_backface_indirect_command_vector.data, first_culled_command + i, 0 };
+    for(u32 i = 0; i < non_culled_count; i++)
+        sources[culled_count + i] = (MeshletSource){ scene->non_culled_backface_indirect_command_vector.data,
+                                                     first_non_culled_command + i, MESHLET_DOUBLE_SIDED };
+
+    bool packed = scene->vertex_vector.size == 0;
+    MeshletBatch batch = {
+        scene,
+        sources,
+        calloc(source_count + 1,sizeof(Meshlet*)),
+        calloc(source_count + 1,sizeof(u32)),
+        packed ? (const u8*)scene->packed_vertex_vector.data : (const u8*)scene->vertex_vector.data,
+        packed ? sizeof(PackedVertex) : sizeof(Vertex),
+        packed ? offsetof(PackedVertex,position) : offsetof(Vertex,position)
+    };
+    job_system_parallel_for(jobs,source_count,1,build_job,&batch);
+
+    u32 total = 0;
+    for(u32 i = 0; i < source_count; i++)
+        total += batch.meshlet_counts[i];
+    if(scene->meshlet_vector.size + total >= scene->meshlet_vector.capacity)
+        vector_reserve(scene->meshlet_vector,Meshlet,scene->meshlet_vector.size + total + 1);
+
+    MeshletBuildStats build = {0};
+    for(u32 i = 0; i < source_count; i++) {
+        for(u32 m = 0; m < batch.meshlet_counts[i]; m++) {
+            build.triangle_count += batch.meshlets[i][m].index_count / 3;
+            build.vertex_count += batch.meshlets[i][m].vertex_count;
+        }
+        vector_push_array(scene->meshlet_vector,Meshlet,batch.meshlets[i],batch.meshlet_counts[i]);
+        free(batch.meshlets[i]);
+    }
+    build.meshlet_count = total;
+    build.seconds = timer_now() - start;
+    if(stats)
+        *stats = build;
+
+    free(batch.meshlets);
+    free(batch.meshlet_counts);
+    free(sources);
+}
+
+void meshlet_build_stats_print(const MeshletBuildStats* stats,const char* name) {
+    f64 meshlets = stats->meshlet_count ? stats->meshlet_count : 1;
+    printf("[MESHLET] \"%s\": %u meshlets over %u tris in %.3f ms, fill %.1f%% verticies %.1f%% triangles\n",
+           name,stats->meshlet_count,stats->triangle_count,stats->seconds * 1000.0,
+           100.0 * stats->vertex_count / (meshlets * MESHLET_MAX_VERTICES),
+           100.0 * stats->triangle_count / (meshlets * MESHLET_MAX_TRIANGLES));
+}
+
+void meshlet_cull_view(mat4 view_proj,vec3 camera_position,MeshletCullView* view) {
+    glm_frustum_planes(view_proj,view->planes);
+    glm_vec3_copy(camera_position,view->camera_position);
+}
+
+bool meshlet_visible(const Meshlet* meshlet,const MeshletCullView* view,bool* cone_culled) {
+    *cone_culled = false;
+    for(u32 p = 0; p < 6; p++) {
+        const f32* plane = view->planes[p];
+        if(plane[0] * meshlet->sphere[0] + plane[1] * meshlet->sphere[1] + plane[2] * meshlet->sphere[2] + plane[3] < -meshlet->sphere[3])
+            return false;
+    }
+
+    if(meshlet->flags & MESHLET_DOUBLE_SIDED || meshlet->cone[3] > 1.0f)
+        return true;
+
+    // every triangle faces away once the view direction to the apex lies inside the cone widened by 90 degrees
+    vec3 direction;
+    glm_vec3_sub((f32*)meshlet->cone_apex,(f32*)view->camera_position,direction);
+    f32 length = glm_vec3_norm(direction);
+    if(length > 0.0f && glm_vec3_dot(direction,(f32*)meshlet->cone) >= meshlet->cone[3] * length) {
+        *cone_culled = true;
+        return false;
+    }
+    return true;
+}
+
+void scene_cull_meshlets(const Scene* scene,const MeshletCullView* view,const u8* culled_command_visible,const u8* non_culled_command_visible,
+                         MeshletDrawList* culled,MeshletDrawList* non_culled,MeshletCullStats* stats) {
+    MeshletCullStats cull = {0};
+    culled->count = 0;
+    non_culled->count = 0;
+
+    for(u32 i = 0; i < scene->meshlet_vector.size; i++) {
+        const Meshlet* meshlet = &scene->meshlet_vector.data[i];
+        bool double_sided = meshlet->flags & MESHLET_DOUBLE_SIDED;
+        const u8* command_visible = double_sided ? non_culled_command_visible : culled_command_visible;
+        cull.triangle_count += meshlet->index_count / 3;
+        if(command_visible && !command_visible[meshlet->command]) {
+            ++cull.frustum_culled;
+            continue;
+        }
+
+        bool cone_culled;
+        bool visible = meshlet_visible(meshlet,view,&cone_culled);
+        if(!visible) {
+            cull.cone_culled += cone_culled;
+            cull.frustum_culled += !cone_culled;
+            continue;
+        }
+        cull.visible_triangle_count += meshlet->index_count / 3;
+
+        const DrawElementsIndirectCommand* source = double_sided ?
+            &scene->non_culled_backface_indirect_command_vector.data[meshlet->command] :
+            &scene->culled_backface_indirect_command_vector.data[meshlet->command];
+        u32 material_index = double_sided ?
+            scene->non_culled_command_material_index_vector.data[meshlet->command] :
+            scene->culled_command_material_index_vector.data[meshlet->command];
+
+        MeshletDrawList* list = double_sided ? non_culled : culled;
+        list->commands[list->count] = (DrawElementsIndirectCommand){ meshlet->index_count, 1, meshlet->first_index, source->baseVertex, 0 };
+        list->material_indices[list->count] = material_index;
+        ++list->count;
+    }
+
+    cull.meshlet_count = scene->meshlet_vector.size;
+    if(stats)
+        *stats = cull;
+}
+
+void meshlet_cull_stats_print(const MeshletCullStats* stats) {
+    f64 meshlets = stats->meshlet_count ? stats->meshlet_count : 1;
+    printf("[MESHLET] %u meshlets: %.1f%% frustum culled, %.1f%% cone culled, %llu of %llu tris left\n",stats->meshlet_count,
+           100.0 * stats->frustum_culled / meshlets,100.0 * stats->cone_culled / meshlets,
+           (unsigned long long)stats->visible_triangle_count,(unsigned long long)stats->triangle_count);
+}
@@ -0,0 +1,320 @@
+#include "MipGenerator.h"
+#include "Simd.h"
+#include "Timer.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// texels are filtered as 4 floats whatever the channel count, one SSE register each
+#define MIP_LANES 4
+
+#define MIP_PI 3.14159265358979323846
+
+// buckets of linear values a bucket's first sRGB byte is looked up in, fine enough that the search after takes a step or two
+#define MIP_SRGB_BUCKETS 4096
+
+// per destination texel along one axis: the run of source texels it reads and their weights, taps apart
+typedef struct {
+    u32* first;
+    u32* count;
+    f32* weights;
+    u32 taps;
+}MipKernel;
+
+typedef struct {
+    const u8* src;
+    u8* dst;
+    u32 src_width;
+    u32 src_height;
+    u32 dst_width;
+    u32 dst_height;
+    u32 channels;
+    MipMode mode;
+    MipKernel horizontal;
+    MipKernel vertical;
+    f32 decode[MIP_LANES][256];  // byte -> filtered value, per channel
+    f32 srgb_thresholds[256];    // linear value halfway between two sRGB bytes, then one past 1
+    u8 srgb_buckets[MIP_SRGB_BUCKETS];
+}MipLevel;
+
+static f64 srgb_to_linear(f64 s) {
+    return s <= 0.04045 ? s / 12.92 : pow((s + 0.055) / 1.055,2.4);
+}
+
+// zeroth order modified bessel function of the first kind, the series converges well before 32 terms for alpha 4
+static f64 bessel_i0(f64 x) {
+    f64 sum = 1.0, term = 1.0, half = x * 0.5;
+    for(u32 k = 1; k < 32; k++) {
+        term *= (half / k) * (half / k);
+        sum += term;
+    }
+    return sum;
+}
+
+static f64 kaiser_sinc(f64 x) {
+    if(fabs(x) >= MIP_KAISER_WIDTH)
+        return 0.0;
+    f64 sinc = fabs(x) < 1e-9 ? 1.0 : sin(MIP_PI * x) / (MIP_PI * x);
+    f64 r = x / MIP_KAISER_WIDTH;
+    return sinc * bessel_i0(MIP_KAISER_ALPHA * sqrt(1.0 - r * r)) / bessel_i0(MIP_KAISER_ALPHA);
+}
+
+// taps outside the source are folded onto the edge texel so every run stays inside it
+static void kernel_build(MipKernel* kernel,u32 src_size,u32 dst_size) {
+    f64 scale = (f64)src_size / dst_size, support = MIP_KAISER_WIDTH * scale;
+    kernel->taps = (u32)ceil(support * 2.0) + 2;
+    kernel->first = malloc(dst_size * sizeof(u32));
+    kernel->count = malloc(dst_size * sizeof(u32));
+    kernel->weights = calloc((u64)dst_size * kernel->taps,sizeof(f32));
+
+    f64* weights = malloc(kernel->taps * sizeof(f64));
+    for(u32 x = 0; x < dst_size; x++) {
+        f64 center = (x + 0.5) * scale;
+        i64 low = (i64)floor(center - support), high = (i64)ceil(center + support);
+        u32 first = low < 0 ? 0 : (u32)low;
+        u32 last = high >= (i64)src_size ? src_size - 1 : (u32)high;
+        memset(weights,0,kernel->taps * sizeof(f64));
+        f64 sum = 0.0;
+        for(i64 i = low; i <= high; i++) {
+            f64 w = kaiser_sinc((i + 0.5 - center) / scale);
+            i64 texel = i < first ? first : i > last ? last : i;
+            weights[texel - first] += w;
+            sum += w;
+        }
+        kernel->first[x] = first;
+        kernel->count[x] = last - first + 1;
+        for(u32 t = 0; t < kernel->count[x]; t++)
+            kernel->weights[(u64)x * kernel->taps + t] = (f32)(weights[t] / sum);
+    }
+    free(weights);
+}
+
+static void kernel_free(MipKernel* kernel) {
+    free(kernel->first);
+    free(kernel->count);
+    free(kernel->weights);
+}
+
+// weighted sums of runs of src texels, one per destination texel
+static void filter_row(const f32* src,const MipKernel* kernel,u32 count,f32* dst) {
+    for(u32 x = 0; x < count; x++) {
+        const f32* weights = kernel->weights + (u64)x * kernel->taps;
+        const f32* texels = src + (u64)kernel->first[x] * MIP_LANES;
+#if defined(SIMD_SSE)
+        __m128 sum = _mm_setzero_ps();
+        for(u32 t = 0; t < kernel->count[x]; t++)
+            sum = _mm_add_ps(sum,_mm_mul_ps(_mm_set1_ps(weights[t]),_mm_loadu_ps(texels + t * MIP_LANES)));
+        _mm_storeu_ps(dst + (u64)x * MIP_LANES,sum);
+#else
+        f32 sum[MIP_LANES] = {0};
+        for(u32 t = 0; t < kernel->count[x]; t++)
+            for(u32 c = 0; c < MIP_LANES; c++)
+                sum[c] += weights[t] * texels[t * MIP_LANES + c];
+        memcpy(dst + (u64)x * MIP_LANES,sum,sizeof(sum));
+#endif
+    }
+}
+
+// dst += weight * src over a row of floats, a multiple of MIP_LANES long
+static void accumulate_row(f32* dst,const f32* src,f32 weight,u32 count) {
+#if defined(SIMD_SSE)
+    __m128 w = _mm_set1_ps(weight);
+    for(u32 i = 0; i < count; i += MIP_LANES)
+        _mm_storeu_ps(dst + i,_mm_add_ps(_mm_loadu_ps(dst + i),_mm_mul_ps(w,_mm_loadu_ps(src + i))));
+#else
+    for(u32 i = 0; i < count; i++)
+        dst[i] += weight * src[i];
+#endif
+}
+
+static u8 encode_unorm(f32 value) {
+    return value <= 0.0f ? 0 : value >= 1.0f ? 255 : (u8)(value * 255.0f + 0.5f);
+}
+
+// the byte whose sRGB value is closest to the linear value: the first halfway point above it
+static u8 encode_srgb(const MipLevel* level,f32 value) {
+    if(value <= 0.0f)
+        return 0;
+    u32 byte = level->srgb_buckets[value >= 1.0f ? MIP_SRGB_BUCKETS - 1 : (u32)(value * (MIP_SRGB_BUCKETS - 1))];
+    while(value >= level->srgb_thresholds[byte])
+        byte++;
+    return (u8)byte;
+}
+
+static void encode_row(const MipLevel* level,const f32* row,u8* dst) {
+    u32 channels = level->channels;
+    u32 color_channels = channels < 3 ? channels : 3;
+    for(u32 x = 0; x < level->dst_width; x++) {
+        const f32* texel = row + (u64)x * MIP_LANES;
+        u8* out = dst + (u64)x * channels;
+        if(level->mode == MIP_MODE_NORMAL) {
+            // a filtered normal is shorter the more its sources disagreed, a 2 channel one only when it left the disc
+            f32 length = 0.0f;
+            for(u32 c = 0; c < color_channels; c++)
+                length += texel[c] * texel[c];
+            f32 scale = (color_channels == 3 || length > 1.0f) && length > 1e-12f ? 1.0f / sqrtf(length) : 1.0f;
+            if(color_channels == 3 && length <= 1e-12f) {
+                out[0] = out[1] = 128;
+                out[2] = 255;
+            } else {
+                for(u32 c = 0; c < color_channels; c++)
+                    out[c] = encode_unorm(texel[c] * scale * 0.5f + 0.5f);
+            }
+        } else if(level->mode == MIP_MODE_SRGB) {
+            for(u32 c = 0; c < color_channels; c++)
+                out[c] = encode_srgb(level,texel[c]);
+        } else {
+            for(u32 c = 0; c < color_channels; c++)
+                out[c] = encode_unorm(texel[c]);
+        }
+        if(channels == 4)
+            out[3] = encode_unorm(texel[3]);
+    }
+}
+
+static void decode_row(const MipLevel* level,const u8* src,f32* row) {
+    for(u32 x = 0; x < level->src_width; x++)
+        for(u32 c = 0; c < MIP_LANES; c++)
+            row[(u64)x * MIP_LANES + c] = c < level->channels ? level->decode[c][src[(u64)x * level->channels + c]] : 0.0f;
+}
+
+// horizontally filters the source rows a band of destination rows reads, then sums them vertically. Bands
+// overlap in the source rows they filter, which makes every destination row independent of the band it is in
+static void level_job(void* data,u32 begin,u32 end) {
+    MipLevel* level = data;
+    u32 row_floats = level->dst_width * MIP_LANES;
+    f32* source_row = malloc((u64)level->src_width * MIP_LANES * sizeof(f32));
+    f32* sum = malloc((u64)row_floats * sizeof(f32));
+
+    for(u32 band = begin; band < end; band += MIP_BAND_ROWS) {
+        u32 band_end = band + MIP_BAND_ROWS < end ? band + MIP_BAND_ROWS : end;
+        u32 src_first = level->vertical.first[band];
+        u32 src_rows = level->vertical.first[band_end - 1] + level->vertical.count[band_end - 1] - src_first;
+        f32* filtered = malloc((u64)src_rows * row_floats * sizeof(f32));
+        for(u32 r = 0; r < src_rows; r++) {
+            decode_row(level,level->src + (u64)(src_first + r) * level->src_width * level->channels,source_row);
+            filter_row(source_row,&level->horizontal,level->dst_width,filtered + (u64)r * row_floats);
+        }
+
+        for(u32 y = band; y < band_end; y++) {
+            const f32* weights = level->vertical.weights + (u64)y * level->vertical.taps;
+            memset(sum,0,(u64)row_floats * sizeof(f32));
+            for(u32 t = 0; t < level->vertical.count[y]; t++)
+                accumulate_row(sum,filtered + (u64)(level->vertical.first[y] + t - src_first) * row_floats,weights[t],row_floats);
+            encode_row(level,sum,level->dst + (u64)y * level->dst_width * level->channels);
+        }
+        free(filtered);
+    }
+    free(sum);
+    free(source_row);
+}
+
+static void level_tables(MipLevel* level) {
+    for(u32 c = 0; c < MIP_LANES; c++)
+        for(u32 v = 0; v < 256; v++) {
+            bool color = c < 3;
+            if(level->mode == MIP_MODE_SRGB && color)
+                level->decode[c][v] = (f32)srgb_to_linear(v / 255.0);
+            else if(level->mode == MIP_MODE_NORMAL && color)
+                level->decode[c][v] = v / 255.0f * 2.0f - 1.0f;
+            else
+                level->decode[c][v] = v / 255.0f;
+        }
+    for(u32 v = 0; v < 255; v++)
+        level->srgb_thresholds[v] = (f32)srgb_to_linear((v + 0.5) / 255.0);
+    level->srgb_thresholds[255] = 2.0f;
+    u32 byte = 0;
+    for(u32 b = 0; b < MIP_SRGB_BUCKETS; b++) {
+        while(b / (f32)(MIP_SRGB_BUCKETS - 1) >= level->srgb_thresholds[byte])
+            byte++;
+        level->srgb_buckets[b] = (u8)byte;
+    }
+}
+
+void mip_generate(JobSystem* jobs,DecodedTexture* texture,MipMode mode) {
+    if(!texture->pixels || texture->mip_count != 1)
+        return;
+
+    u32 channels = texture->channels;
+    texture->mip_count = texture_mip_count(texture->width,texture->height);
+    u64 total = 0;
+    u32 width = texture->width, height = texture->height;
+    for(u32 mip = 0; mip < texture->mip_count; mip++) {
+        texture->mips[mip].width  = width;
+        texture->mips[mip].height = height;
+        texture->mips[mip].offset = total;
+        texture->mips[mip].size   = (u64)width * height * channels;
+        total += texture->mips[mip].size;
+        width  = width > 1 ? width / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
+    }
+
+    u8* pixels = malloc(total);
+    memcpy(pixels,texture->pixels,texture->mips[0].size);
+    free(texture->pixels);
+    texture->pixels = pixels;
+    texture->pixels_size = total;
+    if(texture->mip_count == 1)
+        return;
+
+    MipLevel* level = malloc(sizeof(MipLevel));
+    level->channels = channels;
+    level->mode = mode;
+    level_tables(level);
+    for(u32 mip = 1; mip < texture->mip_count; mip++) {
+        const TextureMip* src = &texture->mips[mip - 1];
+        const TextureMip* dst = &texture->mips[mip];
+        level->src = pixels + src->offset;
+        level->dst = pixels + dst->offset;
+        level->src_width = src->width;
+        level->src_height = src->height;
+        level->dst_width = dst->width;
+        level->dst_height = dst->height;
+        kernel_build(&level->horizontal,src->width,dst->width);
+        kernel_build(&level->vertical,src->height,dst->height);
+        job_system_parallel_for(jobs,dst->height,MIP_BAND_ROWS,level_job,level);
+        kernel_free(&level->horizontal);
+        kernel_free(&level->vertical);
+    }
+    free(level);
+}
+
+void mip_generate_batch(JobSystem* jobs,DecodedTexture* textures,const MipMode* modes,u32 count,MipStats* stats) {
+    f64 start = timer_now();
+    u64 source_texels = 0, generated_texels = 0;
+    for(u32 i = 0; i < count; i++) {
+        if(!textures[i].pixels)
+            continue;
+        mip_generate(jobs,&textures[i],modes[i]);
+        source_texels += (u64)textures[i].width * textures[i].height;
+        for(u32 mip = 1; mip < textures[i].mip_count; mip++)
+            generated_texels += (u64)textures[i].mips[mip].width * textures[i].mips[mip].height;
+    }
+    if(stats) {
+        stats->texture_count = count;
+        stats->source_texels = source_texels;
+        stats->generated_texels = generated_texels;
+        stats->seconds = timer_now() - start;
+    }
+}
+
+void mip_stats_print(const MipStats* stats,u32 thread_count) {
+    f64 seconds = stats->seconds > 0.0 ? stats->seconds : 1e-9;
+    printf("[MIP] %u chains on %u threads (%s) in %.3f ms, %.2f Mtexels/s of level 0 in, %.2f Mtexels generated\n",
+           stats->texture_count,thread_count,mip_isa(),stats->seconds * 1000.0,stats->source_texels / seconds / 1e6,
+           stats->generated_texels / 1e6);
+}
+
+const char* mip_mode_name(MipMode mode) {
+    static const char* names[MIP_MODE_COUNT] = { "linear", "sRGB", "normal" };
+    return mode < MIP_MODE_COUNT ? names[mode] : "?";
+}
+
+const char* mip_isa(void) {
+#if defined(SIMD_SSE)
+    return "SSE";
+#else
+    return "scalar";
+#endif
+}
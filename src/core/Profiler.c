@@ -0,0 +1,225 @@
+#include "Profiler.h"
+#include "Timer.h"
+#include <glad/glad.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    GLuint queries[PROFILER_GPU_ZONES];
+    u64 zone_ids[PROFILER_GPU_ZONES]; // absolute zone index each query times
+    u32 count;
+}ProfileQuerySet;
+
+struct Profiler {
+    ProfileZone zones[PROFILER_RING_SIZE];
+    u64 zone_count; // zones ever begun, the next one goes to zones[zone_count % PROFILER_RING_SIZE]
+    u64 stack[PROFILER_MAX_DEPTH];
+    bool stack_gpu[PROFILER_MAX_DEPTH];
+    u32 depth;      // may exceed PROFILER_MAX_DEPTH, those levels are just counted
+    u32 frame;
+    f64 epoch;
+    bool gpu;
+    bool gpu_open;
+    ProfileQuerySet query_sets[PROFILER_GPU_FRAMES];
+    u32 dropped_gpu; // results that were not ready when their set came around again
+};
+
+Profiler* profiler_create(bool gpu) {
+    Profiler* profiler = calloc(1,sizeof(Profiler));
+    profiler->epoch = timer_now();
+    profiler->gpu = gpu;
+    if(gpu) {
+        for(u32 i = 0; i < PROFILER_GPU_FRAMES; i++)
+            glGenQueries(PROFILER_GPU_ZONES,profiler->query_sets[i].queries);
+    }
+    return profiler;
+}
+
+void profiler_destroy(Profiler* profiler) {
+    if(!profiler)
+        return;
+    if(profiler->gpu) {
+        for(u32 i = 0; i < PROFILER_GPU_FRAMES; i++)
+            glDeleteQueries(PROFILER_GPU_ZONES,profiler->query_sets[i].queries);
+    }
+    free(profiler);
+}
+
+void profiler_begin(Profiler* profiler,const char* name,bool gpu) {
+    if(!profiler)
+        return;
+    if(profiler->depth >= PROFILER_MAX_DEPTH) {
+        ++profiler->depth;
+        return;
+    }
+
+    u64 id = profiler->zone_count++;
+    ProfileZone* zone = &profiler->zones[id % PROFILER_RING_SIZE];
+    zone->name = name;
+    zone->start = timer_now() - profiler->epoch;
+    zone->end = -1.0;
+    zone->gpu_ms = -1.0f;
+    zone->frame = profiler->frame;
+    zone->depth = profiler->depth;
+
+    ProfileQuerySet* set = &profiler->query_sets[profiler->frame % PROFILER_GPU_FRAMES];
+    gpu = gpu && profiler->gpu && !profiler->gpu_open && set->count < PROFILER_GPU_ZONES;
+    if(gpu) {
+        glBeginQuery(GL_TIME_ELAPSED,set->queries[set->count]);
+        set->zone_ids[set->count++] = id;
+        profiler->gpu_open = true;
+    }
+
+    profiler->stack[profiler->depth] = id;
+    profiler->stack_gpu[profiler->depth] = gpu;
+    ++profiler->depth;
+}
+
+void profiler_end(Profiler* profiler) {
+    if(!profiler || !profiler->depth)
+        return;
+    if(--profiler->depth >= PROFILER_MAX_DEPTH)
+        return;
+
+    if(profiler->stack_gpu[profiler->depth]) {
+        glEndQuery(GL_TIME_ELAPSED);
+        profiler->gpu_open = false;
+    }
+    u64 id = profiler->stack[profiler->depth];
+    // a zone left open for a whole ring of others has been overwritten
+    if(id + PROFILER_RING_SIZE >= profiler->zone_count)
+        profiler->zones[id % PROFILER_RING_SIZE].end = timer_now() - profiler->epoch;
+}
+
+void profiler_frame(Profiler* profiler) {
+    if(!profiler)
+        return;
+    ++profiler->frame;
+    if(!profiler->gpu)
+        return;
+
+    // the set the next frame records into was filled PROFILER_GPU_FRAMES frames ago
+    ProfileQuerySet* set = &profiler->query_sets[profiler->frame % PROFILER_GPU_FRAMES];
+    for(u32 i = 0; i < set->count; i++) {
+        GLint available = 0;
+        glGetQueryObjectiv(set->queries[i],GL_QUERY_RESULT_AVAILABLE,&available);
+        if(!available) {
+            ++profiler->dropped_gpu;
+            continue;
+        }
+        GLuint64 nanoseconds = 0;
+        glGetQueryObjectui64v(set->queries[i],GL_QUERY_RESULT,&nanoseconds);
+        u64 id = set->zone_ids[i];
+        if(id + PROFILER_RING_SIZE >= profiler->zone_count)
+            profiler->zones[id % PROFILER_RING_SIZE].gpu_ms = (f32)(nanoseconds / 1e6);
+    }
+    set->count = 0;
+}
+
+u32 profiler_zones(const Profiler* profiler,ProfileZone* zones) {
+    if(!profiler)
+        return 0;
+    u64 first = profiler->zone_count > PROFILER_RING_SIZE ? profiler->zone_count - PROFILER_RING_SIZE : 0;
+    u32 count = 0;
+    for(u64 id = first; id < profiler->zone_count; id++)
+        zones[count++] = profiler->zones[id % PROFILER_RING_SIZE];
+    return count;
+}
+
+static void write_json_string(FILE* file,const char* string) {
+    fputc('"',file);
+    for(const char* c = string; *c; c++) {
+        if(*c == '"' || *c == '\\')
+            fputc('\\',file);
+        fputc(*c,file);
+    }
+    fputc('"',file);
+}
+
+bool profiler_write_chrome_trace(const Profiler* profiler,const char* file_path) {
+    if(!profiler)
+        return false;
+    FILE* file = fopen(file_path,"w");
+    if(!file) {
+        fprintf(stderr,"[PROFILE] Failed to open \"%s\"\n",file_path);
+        return false;
+    }
+
+    ProfileZone* zones = malloc(PROFILER_RING_SIZE * sizeof(ProfileZone));
+    u32 count = profiler_zones(profiler,zones);
+
+    fprintf(file,"{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    fprintf(file,"{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"CPU\"}},\n");
+    fprintf(file,"{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"GPU\"}}");
+    u32 written = 0;
+    for(u32 i = 0; i < count; i++) {
+        const ProfileZone* zone = &zones[i];
+        if(zone->end < zone->start)
+            continue;
+        fprintf(file,",\n{\"name\":");
+        write_json_string(file,zone->name);
+        fprintf(file,",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"frame\":%u}}",
+                zone->start * 1e6,(zone->end - zone->start) * 1e6,zone->frame);
+        if(zone->gpu_ms >= 0.0f) {
+            fprintf(file,",\n{\"name\":");
+            write_json_string(file,zone->name);
+            fprintf(file,",\"ph\":\"X\",\"pid\":1,\"tid\":2,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"frame\":%u}}",
+                    zone->start * 1e6,zone->gpu_ms * 1e3,zone->frame);
+        }
+        ++written;
+    }
+    fprintf(file,"\n]}\n");
+    fclose(file);
+    free(zones);
+
+    printf("[PROFILE] Wrote %u zones to \"%s\"\n",written,file_path);
+    return true;
+}
+
+void profiler_print_summary(const Profiler* profiler) {
+    if(!profiler)
+        return;
+
+    typedef struct {
+        const char* name;
+        f64 cpu_ms, gpu_ms;
+        u32 count, gpu_count;
+    }ZoneTotal;
+    enum { MAX_NAMES = 64 };
+    ZoneTotal totals[MAX_NAMES];
+    u32 name_count = 0;
+
+    ProfileZone* zones = malloc(PROFILER_RING_SIZE * sizeof(ProfileZone));
+    u32 count = profiler_zones(profiler,zones);
+    for(u32 i = 0; i < count; i++) {
+        const ProfileZone* zone = &zones[i];
+        if(zone->end < zone->start)
+            continue;
+        u32 t = 0;
+        while(t < name_count && totals[t].name != zone->name && strcmp(totals[t].name,zone->name) != 0)
+            ++t;
+        if(t == name_count) {
+            if(name_count == MAX_NAMES)
+                continue;
+            totals[name_count++] = (ZoneTotal){ zone->name, 0.0, 0.0, 0, 0 };
+        }
+        totals[t].cpu_ms += (zone->end - zone->start) * 1000.0;
+        totals[t].count++;
+        if(zone->gpu_ms >= 0.0f) {
+            totals[t].gpu_ms += zone->gpu_ms;
+            totals[t].gpu_count++;
+        }
+    }
+    free(zones);
+
+    for(u32 t = 0; t < name_count; t++) {
+        if(totals[t].gpu_count)
+            printf("[PROFILE] %-12s cpu %.3f ms, gpu %.3f ms over %u zones\n",totals[t].name,totals[t].cpu_ms / totals[t].count,
+                   totals[t].gpu_ms / totals[t].gpu_count,totals[t].count);
+        else
+            printf("[PROFILE] %-12s cpu %.3f ms over %u zones\n",totals[t].name,totals[t].cpu_ms / totals[t].count,totals[t].count);
+    }
+    if(profiler->dropped_gpu)
+        printf("[PROFILE] %u GPU results were not ready in time and were dropped\n",profiler->dropped_gpu);
+}
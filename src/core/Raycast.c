@@ -0,0 +1,431 @@
+#include "Raycast.h"
+#include "Simd.h"
+#include <cglm/cglm.h>
+#include <float.h>
+#include <math.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TRIANGLE_FLOATS 9
+
+typedef struct {
+    const Scene* scene;
+    const u8* verticies;
+    u32 vertex_size;
+    u32 position_offset;
+    const u32* first_triangles; // primitive -> its first triangle in build order
+    u32* build_primitives;      // triangle in build order -> primitive
+    AABB* boxes;
+    SceneRaycaster* raycaster;
+}RaycasterBuild;
+
+typedef struct {
+    const SceneRaycaster* raycaster;
+    const Ray* rays;
+    u32 count;
+    RayHit* hits;
+}RaycastBatch;
+
+static const DrawElementsIndirectCommand* primitive_command(const Scene* scene,u32 primitive) {
+    u32 culled_count = scene->culled_backface_indirect_command_vector.size;
+    return primitive < culled_count ? &scene->culled_backface_indirect_command_vector.data[primitive]
+                                    : &scene->non_culled_backface_indirect_command_vector.data[primitive - culled_count];
+}
+
+static const f32* triangle_position(const RaycasterBuild* build,const DrawElementsIndirectCommand* command,u32 triangle,u32 corner) {
+    u32 vertex = command->baseVertex + build->scene->index_vector.data[command->firstIndex + triangle * 3 + corner];
+    return (const f32*)(build->verticies + (u64)vertex * build->vertex_size + build->position_offset);
+}
+
+static void triangle_bounds_job(void* data,u32 begin,u32 end) {
+    RaycasterBuild* build = (RaycasterBuild*)data;
+    for(u32 p = begin; p < end; p++) {
+        const DrawElementsIndirectCommand* command = primitive_command(build->scene,p);
+        for(u32 t = 0; t < command->count / 3; t++) {
+            u32 triangle = build->first_triangles[p] + t;
+            AABB* box = &build->boxes[triangle];
+            glm_vec3_copy((vec3){FLT_MAX,FLT_MAX,FLT_MAX},box->min);
+            glm_vec3_copy((vec3){-FLT_MAX,-FLT_MAX,-FLT_MAX},box->max);
+            for(u32 corner = 0; corner < 3; corner++) {
+                f32* position = (f32*)triangle_position(build,command,t,corner);
+                glm_vec3_minv(box->min,position,box->min);
+                glm_vec3_maxv(box->max,position,box->max);
+            }
+            build->build_primitives[triangle] = p;
+        }
+    }
+}
+
+static void triangle_slots_job(void* data,u32 begin,u32 end) {
+    RaycasterBuild* build = (RaycasterBuild*)data;
+    SceneRaycaster* raycaster = build->raycaster;
+    for(u32 slot = begin; slot < end; slot++) {
+        u32 triangle = raycaster->bvh.item_indices[slot];
+        u32 primitive = build->build_primitives[triangle];
+        u32 local = triangle - build->first_triangles[primitive];
+        const DrawElementsIndirectCommand* command = primitive_command(build->scene,primitive);
+        const f32* v0 = triangle_position(build,command,local,0);
+        const f32* v1 = triangle_position(build,command,local,1);
+        const f32* v2 = triangle_position(build,command,local,2);
+        f32* data = raycaster->triangles + (u64)slot * TRIANGLE_FLOATS;
+        for(u32 axis = 0; axis < 3; axis++) {
+            data[axis] = v0[axis];
+            data[3 + axis] = v1[axis] - v0[axis];
+            data[6 + axis] = v2[axis] - v0[axis];
+        }
+        raycaster->triangle_primitives[slot] = primitive;
+        raycaster->triangle_indices[slot] = local;
+    }
+}
+
+void scene_raycaster_build(SceneRaycaster* raycaster,JobSystem* jobs,const Scene* scene) {
+    memset(raycaster,0,sizeof(SceneRaycaster));
+    u32 culled_count = scene->culled_backface_indirect_command_vector.size;
+    raycaster->primitive_count = culled_count + scene->non_culled_backface_indirect_command_vector.size;
+    raycaster->primitive_materials = malloc((raycaster->primitive_count + 1) * sizeof(u32));
+    memcpy(raycaster->primitive_materials,scene->culled_command_material_index_vector.data,culled_count * sizeof(u32));
+    memcpy(raycaster->primitive_materials + culled_count,scene->non_culled_command_material_index_vector.data,
+           (raycaster->primitive_count - culled_count) * sizeof(u32));
+
+    u32* first_triangles = malloc((raycaster->primitive_count + 1) * sizeof(u32));
+    for(u32 p = 0; p < raycaster->primitive_count; p++) {
+        first_triangles[p] = raycaster->triangle_count;
+        raycaster->triangle_count += primitive_command(scene,p)->count / 3;
+    }
+
+    bool packed = scene->vertex_vector.size == 0;
+    RaycasterBuild build = {
+        scene,
+        packed ? (const u8*)scene->packed_vertex_vector.data : (const u8*)scene->vertex_vector.data,
+        packed ? sizeof(PackedVertex) : sizeof(Vertex),
+        packed ? offsetof(PackedVertex,position) : offsetof(Vertex,position),
+        first_triangles,
+        malloc((raycaster->triangle_count + 1) * sizeof(u32)),
+        malloc((raycaster->triangle_count + 1) * sizeof(AABB)),
+        raycaster
+    };
+    job_system_parallel_for(jobs,raycaster->primitive_count,4,triangle_bounds_job,&build);
+    bvh_build(&raycaster->bvh,jobs,build.boxes,raycaster->triangle_count);
+
+    raycaster->triangles = malloc(((u64)raycaster->triangle_count + 1) * TRIANGLE_FLOATS * sizeof(f32));
+    raycaster->triangle_primitives = malloc((raycaster->triangle_count + 1) * sizeof(u32));
+    raycaster->triangle_indices = malloc((raycaster->triangle_count + 1) * sizeof(u32));
+    job_system_parallel_for(jobs,raycaster->triangle_count,4096,triangle_slots_job,&build);
+
+    free(first_triangles);
+    free(build.build_primitives);
+    free(build.boxes);
+}
+
+void scene_raycaster_free(SceneRaycaster* raycaster) {
+    bvh_free(&raycaster->bvh);
+    free(raycaster->triangles);
+    free(raycaster->triangle_primitives);
+    free(raycaster->triangle_indices);
+    free(raycaster->primitive_materials);
+    memset(raycaster,0,sizeof(SceneRaycaster));
+}
+
+// Moller Trumbore on a precomputed vertex and edges, the packet path below does the same operations in the same order
+static bool triangle_hit(const f32* origin,const f32* direction,const f32* triangle,f32* t,f32* u,f32* v) {
+    const f32* v0 = triangle;
+    const f32* e1 = triangle + 3;
+    const f32* e2 = triangle + 6;
+    f32 px = direction[1] * e2[2] - direction[2] * e2[1];
+    f32 py = direction[2] * e2[0] - direction[0] * e2[2];
+    f32 pz = direction[0] * e2[1] - direction[1] * e2[0];
+    f32 det = e1[0] * px + e1[1] * py + e1[2] * pz;
+    if(fabsf(det) < 1e-12f)
+        return false;
+
+    f32 inv_det = 1.0f / det;
+    f32 sx = origin[0] - v0[0], sy = origin[1] - v0[1], sz = origin[2] - v0[2];
+    f32 hit_u = (sx * px + sy * py + sz * pz) * inv_det;
+    f32 qx = sy * e1[2] - sz * e1[1];
+    f32 qy = sz * e1[0] - sx * e1[2];
+    f32 qz = sx * e1[1] - sy * e1[0];
+    f32 hit_v = (direction[0] * qx + direction[1] * qy + direction[2] * qz) * inv_det;
+    f32 hit_t = (e2[0] * qx + e2[1] * qy + e2[2] * qz) * inv_det;
+    if(hit_u < 0.0f || hit_v < 0.0f || hit_u + hit_v > 1.0f || hit_t <= 0.0f || hit_t >= *t)
+        return false;
+
+    *t = hit_t;
+    *u = hit_u;
+    *v = hit_v;
+    return true;
+}
+
+static void fill_hit(const SceneRaycaster* raycaster,u32 slot,f32 t,f32 u,f32 v,RayHit* hit) {
+    hit->hit = true;
+    hit->t = t;
+    hit->u = u;
+    hit->v = v;
+    hit->primitive = raycaster->triangle_primitives[slot];
+    hit->triangle = raycaster->triangle_indices[slot];
+    hit->material_index = raycaster->primitive_materials[hit->primitive];
+}
+
+// shared by the closest and any hit queries, any hit returns on the first triangle and skips the child ordering
+static bool traverse(const SceneRaycaster* raycaster,const Ray* ray,bool any,RayHit* hit) {
+    const BVH* bvh = &raycaster->bvh;
+    if(!bvh->item_count)
+        return false;
+
+    vec3 inv_direction = { 1.0f / ray->direction[0], 1.0f / ray->direction[1], 1.0f / ray->direction[2] };
+    if(ray_aabb_entry(ray->origin,inv_direction,bvh->nodes[0].min,bvh->nodes[0].max,ray->t_max) == FLT_MAX)
+        return false;
+
+    u32 stack[BVH_MAX_DEPTH + 1];
+    f32 stack_distances[BVH_MAX_DEPTH + 1];
+    u32 stack_size = 0;
+    u32 node_index = 0;
+    u32 hit_slot = UINT32_MAX;
+    f32 t = ray->t_max, u = 0.0f, v = 0.0f;
+    for(;;) {
+        const BVHNode* node = &bvh->nodes[node_index];
+        if(node->count) {
+            for(u32 slot = node->left_first; slot < node->left_first + node->count; slot++) {
+                if(triangle_hit(ray->origin,ray->direction,raycaster->triangles + (u64)slot * TRIANGLE_FLOATS,&t,&u,&v)) {
+                    hit_slot = slot;
+                    if(any)
+                        return true;
+                }
+            }
+        } else {
+            u32 near = node->left_first, far = near + 1;
+            f32 near_distance = ray_aabb_entry(ray->origin,inv_direction,bvh->nodes[near].min,bvh->nodes[near].max,t);
+            f32 far_distance = ray_aabb_entry(ray->origin,inv_direction,bvh->nodes[far].min,bvh->nodes[far].max,t);
+            if(far_distance < near_distance) {
+                u32 swap = near;
+                near = far;
+                far = swap;
+                f32 swap_distance = near_distance;
+                near_distance = far_distance;
+                far_distance = swap_distance;
+            }
+            if(near_distance != FLT_MAX) {
+                if(far_distance != FLT_MAX) {
+                    stack[stack_size] = far;
+                    stack_distances[stack_size++] = far_distance;
+                }
+                node_index = near;
+                continue;
+            }
+        }
+
+        while(stack_size && stack_distances[stack_size - 1] >= t)
+            --stack_size;
+        if(!stack_size)
+            break;
+        node_index = stack[--stack_size];
+    }
+
+    if(hit_slot == UINT32_MAX)
+        return false;
+    fill_hit(raycaster,hit_slot,t,u,v,hit);
+    return true;
+}
+
+bool scene_raycast(const SceneRaycaster* raycaster,const Ray* ray,RayHit* hit) {
+    memset(hit,0,sizeof(RayHit));
+    return traverse(raycaster,ray,false,hit);
+}
+
+bool scene_raycast_any(const SceneRaycaster* raycaster,const Ray* ray) {
+    return traverse(raycaster,ray,true,NULL);
+}
+
+bool scene_line_of_sight(const SceneRaycaster* raycaster,const vec3 from,const vec3 to) {
+    // t runs from 0 to 1 along the segment, stop just short of the target so its own surface does not count
+    Ray ray = { { from[0], from[1], from[2] }, { to[0] - from[0], to[1] - from[1], to[2] - from[2] }, 1.0f - 1e-4f };
+    return !scene_raycast_any(raycaster,&ray);
+}
+
+#if defined(SIMD_SSE)
+typedef struct {
+    __m128 origin[3];
+    __m128 direction[3];
+    __m128 inv_direction[3];
+}RayPacket;
+
+static __m128 select_ps(__m128 mask,__m128 a,__m128 b) {
+    return _mm_or_ps(_mm_and_ps(mask,a),_mm_andnot_ps(mask,b));
+}
+
+// lanes that enter the box before their current t, entry distances of the others are FLT_MAX
+static __m128 packet_box(const RayPacket* packet,const BVHNode* node,__m128 t,__m128* entry) {
+    __m128 near = _mm_setzero_ps(), far = t;
+    for(u32 axis = 0; axis < 3; axis++) {
+        __m128 a = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node->min[axis]),packet->origin[axis]),packet->inv_direction[axis]);
+        __m128 b = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node->max[axis]),packet->origin[axis]),packet->inv_direction[axis]);
+        near = _mm_max_ps(near,_mm_min_ps(a,b));
+        far = _mm_min_ps(far,_mm_max_ps(a,b));
+    }
+    __m128 mask = _mm_cmple_ps(near,far);
+    *entry = select_ps(mask,near,_mm_set1_ps(FLT_MAX));
+    return mask;
+}
+
+static f32 min_lane(__m128 value) {
+    value = _mm_min_ps(value,_mm_shuffle_ps(value,value,_MM_SHUFFLE(2,3,0,1)));
+    value = _mm_min_ps(value,_mm_shuffle_ps(value,value,_MM_SHUFFLE(1,0,3,2)));
+    return _mm_cvtss_f32(value);
+}
+
+void scene_raycast_packet(const SceneRaycaster* raycaster,const Ray* rays,RayHit* hits) {
+    memset(hits,0,RAYCAST_PACKET_SIZE * sizeof(RayHit));
+    const BVH* bvh = &raycaster->bvh;
+    if(!bvh->item_count)
+        return;
+
+    RayPacket packet;
+    for(u32 axis = 0; axis < 3; axis++) {
+        packet.origin[axis] = _mm_setr_ps(rays[0].origin[axis],rays[1].origin[axis],rays[2].origin[axis],rays[3].origin[axis]);
+        packet.direction[axis] = _mm_setr_ps(rays[0].direction[axis],rays[1].direction[axis],rays[2].direction[axis],rays[3].direction[axis]);
+        packet.inv_direction[axis] = _mm_div_ps(_mm_set1_ps(1.0f),packet.direction[axis]);
+    }
+    __m128 t_max = _mm_setr_ps(rays[0].t_max,rays[1].t_max,rays[2].t_max,rays[3].t_max);
+    __m128 t = t_max, u = _mm_setzero_ps(), v = _mm_setzero_ps();
+    __m128i slots = _mm_set1_epi32(-1);
+
+    __m128 entry;
+    if(!_mm_movemask_ps(packet_box(&packet,&bvh->nodes[0],t,&entry)))
+        return;
+
+    // a node is visited when any lane reaches it, lanes that miss its triangles keep their t
+    u32 stack[BVH_MAX_DEPTH + 1];
+    __m128 stack_entries[BVH_MAX_DEPTH + 1];
+    u32 stack_size = 0;
+    u32 node_index = 0;
+    const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f), epsilon = _mm_set1_ps(1e-12f);
+    const __m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    for(;;) {
+        const BVHNode* node = &bvh->nodes[node_index];
+        if(node->count) {
+            for(u32 slot = node->left_first; slot < node->left_first + node->count; slot++) {
+                const f32* triangle = raycaster->triangles + (u64)slot * TRIANGLE_FLOATS;
+                __m128 e1[3] = { _mm_set1_ps(triangle[3]), _mm_set1_ps(triangle[4]), _mm_set1_ps(triangle[5]) };
+                __m128 e2[3] = { _mm_set1_ps(triangle[6]), _mm_set1_ps(triangle[7]), _mm_set1_ps(triangle[8]) };
+                const __m128* d = packet.direction;
+                __m128 px = _mm_sub_ps(_mm_mul_ps(d[1],e2[2]),_mm_mul_ps(d[2],e2[1]));
+                __m128 py = _mm_sub_ps(_mm_mul_ps(d[2],e2[0]),_mm_mul_ps(d[0],e2[2]));
+                __m128 pz = _mm_sub_ps(_mm_mul_ps(d[0],e2[1]),_mm_mul_ps(d[1],e2[0]));
+                __m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1[0],px),_mm_mul_ps(e1[1],py)),_mm_mul_ps(e1[2],pz));
+                __m128 inv_det = _mm_div_ps(one,det);
+                __m128 sx = _mm_sub_ps(packet.origin[0],_mm_set1_ps(triangle[0]));
+                __m128 sy = _mm_sub_ps(packet.origin[1],_mm_set1_ps(triangle[1]));
+                __m128 sz = _mm_sub_ps(packet.origin[2],_mm_set1_ps(triangle[2]));
+                __m128 hit_u = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(sx,px),_mm_mul_ps(sy,py)),_mm_mul_ps(sz,pz)),inv_det);
+                __m128 qx = _mm_sub_ps(_mm_mul_ps(sy,e1[2]),_mm_mul_ps(sz,e1[1]));
+                __m128 qy = _mm_sub_ps(_mm_mul_ps(sz,e1[0]),_mm_mul_ps(sx,e1[2]));
+                __m128 qz = _mm_sub_ps(_mm_mul_ps(sx,e1[1]),_mm_mul_ps(sy,e1[0]));
+                __m128 hit_v = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(d[0],qx),_mm_mul_ps(d[1],qy)),_mm_mul_ps(d[2],qz)),inv_det);
+                __m128 hit_t = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2[0],qx),_mm_mul_ps(e2[1],qy)),_mm_mul_ps(e2[2],qz)),inv_det);
+
+                __m128 mask = _mm_cmpge_ps(_mm_and_ps(det,abs_mask),epsilon);
+                mask = _mm_and_ps(mask,_mm_cmpge_ps(hit_u,zero));
+                mask = _mm_and_ps(mask,_mm_cmpge_ps(hit_v,zero));
+                mask = _mm_and_ps(mask,_mm_cmple_ps(_mm_add_ps(hit_u,hit_v),one));
+                mask = _mm_and_ps(mask,_mm_cmpgt_ps(hit_t,zero));
+                mask = _mm_and_ps(mask,_mm_cmplt_ps(hit_t,t));
+                if(!_mm_movemask_ps(mask))
+                    continue;
+
+                t = select_ps(mask,hit_t,t);
+                u = select_ps(mask,hit_u,u);
+                v = select_ps(mask,hit_v,v);
+                slots = _mm_castps_si128(select_ps(mask,_mm_castsi128_ps(_mm_set1_epi32((i32)slot)),_mm_castsi128_ps(slots)));
+            }
+        } else {
+            u32 near = node->left_first, far = near + 1;
+            __m128 near_entry, far_entry;
+            bool near_hit = _mm_movemask_ps(packet_box(&packet,&bvh->nodes[near],t,&near_entry)) != 0;
+            bool far_hit = _mm_movemask_ps(packet_box(&packet,&bvh->nodes[far],t,&far_entry)) != 0;
+            if(near_hit && far_hit) {
+                if(min_lane(far_entry) < min_lane(near_entry)) {
+                    u32 swap = near;
+                    near = far;
+                    far = swap;
+                    far_entry = near_entry;
+                }
+                stack[stack_size] = far;
+                stack_entries[stack_size++] = far_entry;
+                node_index = near;
+                continue;
+            }
+            if(near_hit || far_hit) {
+                node_index = near_hit ? near : far;
+                continue;
+            }
+        }
+
+        while(stack_size && !_mm_movemask_ps(_mm_cmplt_ps(stack_entries[stack_size - 1],t)))
+            --stack_size;
+        if(!stack_size)
+            break;
+        node_index = stack[--stack_size];
+    }
+
+    f32 lane_t[4], lane_u[4], lane_v[4];
+    u32 lane_slots[4];
+    _mm_storeu_ps(lane_t,t);
+    _mm_storeu_ps(lane_u,u);
+    _mm_storeu_ps(lane_v,v);
+    _mm_storeu_si128((__m128i*)lane_slots,slots);
+    for(u32 lane = 0; lane < RAYCAST_PACKET_SIZE; lane++)
+        if(lane_slots[lane] != UINT32_MAX)
+            fill_hit(raycaster,lane_slots[lane],lane_t[lane],lane_u[lane],lane_v[lane],&hits[lane]);
+}
+#else
+void scene_raycast_packet(const SceneRaycaster* raycaster,const Ray* rays,RayHit* hits) {
+    for(u32 lane = 0; lane < RAYCAST_PACKET_SIZE; lane++)
+        scene_raycast(raycaster,&rays[lane],&hits[lane]);
+}
+#endif
+
+static void raycast_batch_job(void* data,u32 begin,u32 end) {
+    RaycastBatch* batch = (RaycastBatch*)data;
+    for(u32 packet = begin; packet < end; packet++) {
+        u32 first = packet * RAYCAST_PACKET_SIZE;
+        if(first + RAYCAST_PACKET_SIZE <= batch->count) {
+            scene_raycast_packet(batch->raycaster,batch->rays + first,batch->hits + first);
+            continue;
+        }
+
+        // pad the last packet with copies of its last ray
+        Ray rays[RAYCAST_PACKET_SIZE];
+        RayHit hits[RAYCAST_PACKET_SIZE];
+        u32 live = batch->count - first;
+        for(u32 lane = 0; lane < RAYCAST_PACKET_SIZE; lane++)
+            rays[lane] = batch->rays[first + (lane < live ? lane : live - 1)];
+        scene_raycast_packet(batch->raycaster,rays,hits);
+        memcpy(batch->hits + first,hits,live * sizeof(RayHit));
+    }
+}
+
+void scene_raycast_batch(const SceneRaycaster* raycaster,JobSystem* jobs,const Ray* rays,u32 count,RayHit* hits) {
+    RaycastBatch batch = { raycaster, rays, count, hits };
+    job_system_parallel_for(jobs,(count + RAYCAST_PACKET_SIZE - 1) / RAYCAST_PACKET_SIZE,64,raycast_batch_job,&batch);
+}
+
+void ray_from_screen(Camera* camera,mat4 proj,f32 x,f32 y,f32 width,f32 height,Ray* ray) {
+    mat4 view, view_proj;
+    cameraViewMat(camera,view);
+    glm_mat4_mul(proj,view,view_proj);
+    glm_mat4_inv(view_proj,view_proj);
+
+    f32 ndc_x = 2.0f * x / width - 1.0f;
+    f32 ndc_y = 1.0f - 2.0f * y / height;
+    vec4 near = { ndc_x, ndc_y, -1.0f, 1.0f };
+    vec4 far = { ndc_x, ndc_y, 1.0f, 1.0f };
+    glm_mat4_mulv(view_proj,near,near);
+    glm_mat4_mulv(view_proj,far,far);
+    glm_vec3_scale(near,1.0f / near[3],ray->origin);
+    glm_vec3_scale(far,1.0f / far[3],far);
+
+    // unit direction, so t is a world space distance and the ray ends on the far plane
+    glm_vec3_sub(far,ray->origin,ray->direction);
+    ray->t_max = glm_vec3_norm(ray->direction);
+    glm_vec3_scale(ray->direction,1.0f / ray->t_max,ray->direction);
+}
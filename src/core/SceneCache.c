@@ -0,0 +1,380 @@
+#include "SceneCache.h"
+#include "Hash.h"
+#include "AtomicFile.h"
+#include "cgltf.h"
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+#define SECTION_ALIGNMENT 64
+
+typedef enum {
+    SECTION_VERTICES,
+    SECTION_PACKED_VERTICES,
+    SECTION_SKIN_VERTICES,
+    SECTION_INDICES,
+    SECTION_CULLED_COMMANDS,
+    SECTION_NON_CULLED_COMMANDS,
+    SECTION_CULLED_MATERIAL_INDICES,
+    SECTION_NON_CULLED_MATERIAL_INDICES,
+    SECTION_MESHLETS,
+    SECTION_CULLED_AABBS,
+    SECTION_NON_CULLED_AABBS,
+    SECTION_MATERIALS,
+    SECTION_TEXTURE_REFS,
+    SECTION_TEXTURE_DATA,
+    SECTION_COUNT
+}SectionType;
+
+typedef struct {
+    u64 offset;
+    u64 size;
+}Section;
+
+typedef struct {
+    u32 magic;
+    u32 version;
+    u32 vertex_stride;   // guards against struct layout changes between builds
+    u32 packed_vertex_stride;
+    u32 material_stride;
+    u32 meshlet_stride;
+    SceneCacheKey key;
+    SceneCacheBase base;
+    AABB aabb;
+    Section sections[SECTION_COUNT];
+}Header;
+
+// folds the size and contents of every external buffer of a .gltf into hash, a .glb carries its buffer in the
+// container that is already hashed. A source cgltf can not parse has no buffers to follow
+static bool hash_buffers(const char* source_path,u64* hash) {
+    cgltf_options options = {0};
+    cgltf_data* data = NULL;
+    if(cgltf_parse_file(&options,source_path,&data) != cgltf_result_success)
+        return true;
+
+    const char* slash = strrchr(source_path,'/');
+    const char* backslash = strrchr(source_path,'\\');
+    if(backslash && (!slash || backslash > slash))
+        slash = backslash;
+    u64 folder_length = slash ? (u64)(slash - source_path) + 1 : 0;
+
+    bool ok = true;
+    char path[1024];
+    for(cgltf_size i = 0; ok && i < data->buffers_count; i++) {
+        const char* uri = data->buffers[i].uri;
+        if(!uri || strncmp(uri,"data:",5) == 0)
+            continue; // base64 buffers live in the source itself
+        if(folder_length + strlen(uri) + 1 > sizeof(path)) {
+            ok = false;
+            break;
+        }
+        memcpy(path,source_path,folder_length);
+        strcpy(path + folder_length,uri);
+        cgltf_decode_uri(path + folder_length);
+
+        struct stat info;
+        u64 buffer_hash;
+        ok = stat(path,&info) == 0 && hash_file(path,&buffer_hash);
+        if(ok) {
+            u64 size = (u64)info.st_size;
+            *hash = hash_fnv1a(&size,sizeof(size),*hash);
+            *hash = hash_fnv1a(&buffer_hash,sizeof(buffer_hash),*hash);
+        }
+    }
+    cgltf_free(data);
+    return ok;
+}
+
+bool scene_cache_key(const char* source_path,u32 import_flags,SceneCacheKey* key) {
+    struct stat info;
+    if(stat(source_path,&info) != 0)
+        return false;
+
+    memset(key,0,sizeof(SceneCacheKey));
+    key->source_size  = (u64)info.st_size;
+    key->source_mtime = (i64)info.st_mtime;
+    key->import_flags = import_flags;
+    return hash_file(source_path,&key->source_hash) && hash_buffers(source_path,&key->source_hash);
+}
+
+void scene_cache_base(const Scene* scene,SceneCacheBase* base) {
+    base->vertex_count             = scene->vertex_vector.size + scene->packed_vertex_vector.size;
+    base->index_count              = scene->index_vector.size;
+    base->culled_command_count     = scene->culled_backface_indirect_command_vector.size;
+    base->non_culled_command_count = scene->non_culled_backface_indirect_command_vector.size;
+    base->material_count           = scene->material_vector.size;
+    base->texture_count            = scene->texture_handle_vector.size;
+    base->meshlet_count            = scene->meshlet_vector.size;
+}
+
+static u64 align_up(u64 value,u64 alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+static bool write_section(FILE* f,Header* header,SectionType type,const void* data,u64 size) {
+    u64 offset = align_up((u64)ftell(f),SECTION_ALIGNMENT);
+    static const u8 zeros[SECTION_ALIGNMENT] = {0};
+    u64 padding = offset - (u64)ftell(f);
+    if(padding && fwrite(zeros,1,padding,f) != padding)
+        return false;
+
+    header->sections[type].offset = offset;
+    header->sections[type].size = size;
+    return !size || fwrite(data,1,size,f) == size;
+}
+
+// the verticies past first, a packed scene has none left unpacked and an unpacked one has none packed
+#define write_vertex_section(f,header,type,vec,T,first) \
+    write_section(f,header,type,(vec).size > (first) ? (vec).data + (first) : NULL,\
+                  (vec).size > (first) ? (u64)((vec).size - (first)) * sizeof(T) : 0)
+
+bool scene_cache_write(const char* cache_path,const SceneCacheKey* key,const SceneCacheBase* base,const Scene* scene,
+                       const SceneTextureRef* refs,u32 ref_count,const u8* texture_data,u64 texture_data_size) {
+    AtomicFile atomic;
+    if(!atomic_file_open(&atomic,cache_path))
+        return false;
+    FILE* f = atomic.file;
+
+    Header header = {0};
+    header.magic           = SCENE_CACHE_MAGIC;
+    header.version         = SCENE_CACHE_VERSION;
+    header.vertex_stride   = sizeof(Vertex);
+    header.packed_vertex_stride = sizeof(PackedVertex);
+    header.material_stride = sizeof(Material);
+    header.meshlet_stride  = sizeof(Meshlet);
+    header.key  = *key;
+    header.base = *base;
+    header.aabb = scene->aabb;
+
+    bool ok = fwrite(&header,sizeof(Header),1,f) == 1;
+
+    ok = ok && write_vertex_section(f,&header,SECTION_VERTICES,scene->vertex_vector,Vertex,base->vertex_count);
+    ok = ok && write_vertex_section(f,&header,SECTION_PACKED_VERTICES,scene->packed_vertex_vector,PackedVertex,base->vertex_count);
+    ok = ok && write_vertex_section(f,&header,SECTION_SKIN_VERTICES,scene->skin_vertex_vector,SkinVertex,base->vertex_count);
+    ok = ok && write_section(f,&header,SECTION_INDICES,
+                             scene->index_vector.data + base->index_count,
+                             (u64)(scene->index_vector.size - base->index_count) * sizeof(u32));
+    ok = ok && write_section(f,&header,SECTION_CULLED_COMMANDS,
+                             scene->culled_backface_indirect_command_vector.data + base->culled_command_count,
+                             (u64)(scene->culled_backface_indirect_command_vector.size - base->culled_command_count) * sizeof(DrawElementsIndirectCommand));
+    ok = ok && write_section(f,&header,SECTION_NON_CULLED_COMMANDS,
+                             scene->non_culled_backface_indirect_command_vector.data + base->non_culled_command_count,
+                             (u64)(scene->non_culled_backface_indirect_command_vector.size - base->non_culled_command_count) * sizeof(DrawElementsIndirectCommand));
+    ok = ok && write_section(f,&header,SECTION_CULLED_MATERIAL_INDICES,
+                             scene->culled_command_material_index_vector.data + base->culled_command_count,
+                             (u64)(scene->culled_command_material_index_vector.size - base->culled_command_count) * sizeof(u32));
+    ok = ok && write_section(f,&header,SECTION_NON_CULLED_MATERIAL_INDICES,
+                             scene->non_culled_command_material_index_vector.data + base->non_culled_command_count,
+                             (u64)(scene->non_culled_command_material_index_vector.size - base->non_culled_command_count) * sizeof(u32));
+    ok = ok && write_section(f,&header,SECTION_MESHLETS,
+                             scene->meshlet_vector.data + base->meshlet_count,
+                             (u64)(scene->meshlet_vector.size - base->meshlet_count) * sizeof(Meshlet));
+    ok = ok && write_section(f,&header,SECTION_CULLED_AABBS,
+                             scene->culled_command_aabb_vector.data + base->culled_command_count,
+                             (u64)(scene->culled_command_aabb_vector.size - base->culled_command_count) * sizeof(AABB));
+    ok = ok && write_section(f,&header,SECTION_NON_CULLED_AABBS,
+                             scene->non_culled_command_aabb_vector.data + base->non_culled_command_count,
+                             (u64)(scene->non_culled_command_aabb_vector.size - base->non_culled_command_count) * sizeof(AABB));
+    ok = ok && write_section(f,&header,SECTION_MATERIALS,
+                             scene->material_vector.data + base->material_count,
+                             (u64)(scene->material_vector.size - base->material_count) * sizeof(Material));
+    ok = ok && write_section(f,&header,SECTION_TEXTURE_REFS,refs,(u64)ref_count * sizeof(SceneTextureRef));
+    ok = ok && write_section(f,&header,SECTION_TEXTURE_DATA,texture_data,texture_data_size);
+
+    ok = ok && fseek(f,0,SEEK_SET) == 0;
+    ok = ok && fwrite(&header,sizeof(Header),1,f) == 1;
+    return atomic_file_commit(&atomic,ok);
+}
+
+static void* map_file(const char* path,u64* size) {
+#if defined(_WIN32)
+    HANDLE file = CreateFileA(path,GENERIC_READ,FILE_SHARE_READ,NULL,OPEN_EXISTING,FILE_ATTRIBUTE_NORMAL,NULL);
+    if(file == INVALID_HANDLE_VALUE)
+        return NULL;
+
+    LARGE_INTEGER file_size;
+    if(!GetFileSizeEx(file,&file_size) || file_size.QuadPart == 0) {
+        CloseHandle(file);
+        return NULL;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file,NULL,PAGE_WRITECOPY,0,0,NULL);
+    CloseHandle(file);
+    if(!mapping)
+        return NULL;
+
+    void* base = MapViewOfFile(mapping,FILE_MAP_COPY,0,0,0);
+    CloseHandle(mapping);
+    *size = (u64)file_size.QuadPart;
+    return base;
+#else
+    int fd = open(path,O_RDONLY);
+    if(fd < 0)
+        return NULL;
+
+    struct stat info;
+    if(fstat(fd,&info) != 0 || info.st_size == 0) {
+        close(fd);
+        return NULL;
+    }
+
+    // private mapping so in place edits (scene_scale, scene_translate) never reach the file
+    void* base = mmap(NULL,info.st_size,PROT_READ | PROT_WRITE,MAP_PRIVATE,fd,0);
+    close(fd);
+    if(base == MAP_FAILED)
+        return NULL;
+
+    *size = (u64)info.st_size;
+    return base;
+#endif
+}
+
+static void unmap_file(void* base,u64 size) {
+#if defined(_WIN32)
+    (void)size;
+    UnmapViewOfFile(base);
+#else
+    munmap(base,size);
+#endif
+}
+
+static bool header_valid(const Header* header,u64 file_size,const SceneCacheKey* key,const SceneCacheBase* base) {
+    if(header->magic != SCENE_CACHE_MAGIC || header->version != SCENE_CACHE_VERSION)
+        return false;
+    if(header->vertex_stride != sizeof(Vertex) || header->packed_vertex_stride != sizeof(PackedVertex) ||
+       header->material_stride != sizeof(Material) || header->meshlet_stride != sizeof(Meshlet))
+        return false;
+    if(memcmp(&header->key,key,sizeof(SceneCacheKey)) != 0 || memcmp(&header->base,base,sizeof(SceneCacheBase)) != 0)
+        return false;
+
+    for(int i = 0; i < SECTION_COUNT; i++) {
+        const Section* section = &header->sections[i];
+        if(section->offset > file_size || section->size > file_size - section->offset)
+            return false;
+    }
+
+    static const u64 strides[SECTION_COUNT] = {
+        sizeof(Vertex), sizeof(PackedVertex), sizeof(SkinVertex), sizeof(u32), sizeof(DrawElementsIndirectCommand), sizeof(DrawElementsIndirectCommand),
+        sizeof(u32), sizeof(u32), sizeof(Meshlet), sizeof(AABB), sizeof(AABB), sizeof(Material), sizeof(SceneTextureRef), 1
+    };
+    for(int i = 0; i < SECTION_COUNT; i++)
+        if(header->sections[i].size % strides[i])
+            return false;
+
+    return header->sections[SECTION_CULLED_COMMANDS].size / sizeof(DrawElementsIndirectCommand) ==
+           header->sections[SECTION_CULLED_MATERIAL_INDICES].size / sizeof(u32) &&
+           header->sections[SECTION_NON_CULLED_COMMANDS].size / sizeof(DrawElementsIndirectCommand) ==
+           header->sections[SECTION_NON_CULLED_MATERIAL_INDICES].size / sizeof(u32) &&
+           header->sections[SECTION_CULLED_COMMANDS].size / sizeof(DrawElementsIndirectCommand) ==
+           header->sections[SECTION_CULLED_AABBS].size / sizeof(AABB) &&
+           header->sections[SECTION_NON_CULLED_COMMANDS].size / sizeof(DrawElementsIndirectCommand) ==
+           header->sections[SECTION_NON_CULLED_AABBS].size / sizeof(AABB);
+}
+
+// empty vectors borrow the mapped pages, anything else gets the section appended
+#define adopt_section(vec,T,mapping,section) {\
+    T* section_data = (T*)((u8*)(mapping) + (section).offset);\
+    u32 section_count = (u32)((section).size / sizeof(T));\
+    if(vec.size == 0 && section_count) {\
+        vector_borrow(vec,T,section_data,section_count);\
+    } else if(section_count) {\
+        vector_push_array(vec,T,section_data,section_count);\
+    }\
+}
+
+// zero weights for the packed verticies of imports without skin
+static void pad_skin(Scene* scene,u32 count) {
+    u32 first = scene->skin_vertex_vector.size;
+    if(first >= count)
+        return;
+    if(count >= scene->skin_vertex_vector.capacity)
+        vector_reserve(scene->skin_vertex_vector,SkinVertex,count + 1);
+    memset(scene->skin_vertex_vector.data + first,0,(u64)(count - first) * sizeof(SkinVertex));
+    scene->skin_vertex_vector.size = count;
+}
+
+bool scene_cache_load(const char* cache_path,const SceneCacheKey* key,Scene* scene,SceneCacheTextures* textures) {
+    if(scene->cache_mapping)
+        return false;
+
+    u64 size = 0;
+    void* mapping = map_file(cache_path,&size);
+    if(!mapping)
+        return false;
+
+    SceneCacheBase base;
+    scene_cache_base(scene,&base);
+
+    const Header* header = (const Header*)mapping;
+    if(size < sizeof(Header) || !header_valid(header,size,key,&base)) {
+        unmap_file(mapping,size);
+        return false;
+    }
+
+    // the skin verticies line up with the packed ones once any import had skin, as scene_pack_vertices keeps them
+    const Section* sections = header->sections;
+    if(sections[SECTION_SKIN_VERTICES].size)
+        pad_skin(scene,base.vertex_count);
+    adopt_section(scene->vertex_vector,Vertex,mapping,sections[SECTION_VERTICES]);
+    adopt_section(scene->packed_vertex_vector,PackedVertex,mapping,sections[SECTION_PACKED_VERTICES]);
+    adopt_section(scene->skin_vertex_vector,SkinVertex,mapping,sections[SECTION_SKIN_VERTICES]);
+    if(scene->skin_vertex_vector.size)
+        pad_skin(scene,scene->packed_vertex_vector.size);
+    adopt_section(scene->index_vector,u32,mapping,sections[SECTION_INDICES]);
+    adopt_section(scene->culled_backface_indirect_command_vector,DrawElementsIndirectCommand,mapping,sections[SECTION_CULLED_COMMANDS]);
+    adopt_section(scene->non_culled_backface_indirect_command_vector,DrawElementsIndirectCommand,mapping,sections[SECTION_NON_CULLED_COMMANDS]);
+    adopt_section(scene->culled_command_material_index_vector,u32,mapping,sections[SECTION_CULLED_MATERIAL_INDICES]);
+    adopt_section(scene->non_culled_command_material_index_vector,u32,mapping,sections[SECTION_NON_CULLED_MATERIAL_INDICES]);
+    adopt_section(scene->meshlet_vector,Meshlet,mapping,sections[SECTION_MESHLETS]);
+    adopt_section(scene->culled_command_aabb_vector,AABB,mapping,sections[SECTION_CULLED_AABBS]);
+    adopt_section(scene->non_culled_command_aabb_vector,AABB,mapping,sections[SECTION_NON_CULLED_AABBS]);
+
+    const Material* materials = (const Material*)((u8*)mapping + sections[SECTION_MATERIALS].offset);
+    u32 material_count = (u32)(sections[SECTION_MATERIALS].size / sizeof(Material));
+    if(material_count)
+        vector_push_array(scene->material_vector,Material,materials,material_count);
+
+    scene->aabb = header->aabb;
+    scene->cache_mapping = mapping;
+    scene->cache_mapping_size = size;
+
+    textures->refs      = (const SceneTextureRef*)((u8*)mapping + sections[SECTION_TEXTURE_REFS].offset);
+    textures->ref_count = (u32)(sections[SECTION_TEXTURE_REFS].size / sizeof(SceneTextureRef));
+    textures->data      = (const u8*)mapping + sections[SECTION_TEXTURE_DATA].offset;
+    return true;
+}
+
+// vectors still borrowing the mapping are emptied, the ones that grew since own a heap copy and keep it
+#define drop_section(vec,T) {\
+    if(vec.borrowed) {\
+        vector_free(vec);\
+        vector_create(vec,T);\
+    }\
+}
+
+void scene_cache_release(Scene* scene) {
+    if(!scene->cache_mapping)
+        return;
+    drop_section(scene->vertex_vector,Vertex);
+    drop_section(scene->packed_vertex_vector,PackedVertex);
+    drop_section(scene->skin_vertex_vector,SkinVertex);
+    drop_section(scene->index_vector,u32);
+    drop_section(scene->culled_backface_indirect_command_vector,DrawElementsIndirectCommand);
+    drop_section(scene->non_culled_backface_indirect_command_vector,DrawElementsIndirectCommand);
+    drop_section(scene->culled_command_material_index_vector,u32);
+    drop_section(scene->non_culled_command_material_index_vector,u32);
+    drop_section(scene->meshlet_vector,Meshlet);
+    drop_section(scene->culled_command_aabb_vector,AABB);
+    drop_section(scene->non_culled_command_aabb_vector,AABB);
+    unmap_file(scene->cache_mapping,scene->cache_mapping_size);
+    scene->cache_mapping = NULL;
+    scene->cache_mapping_size = 0;
+}
@@ -0,0 +1,137 @@
+#include "Shader.h"
+#include "Hash.h"
+#include <glad/glad.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static char* read_file(const char* path) {
+    FILE* file = fopen(path,"rb");
+    if(!file) {
+        fprintf(stderr,"[SHADER] Failed to open \"%s\"\n",path);
+        return NULL;
+    }
+    fseek(file,0,SEEK_END);
+    long size = ftell(file);
+    fseek(file,0,SEEK_SET);
+    char* buffer = malloc(size + 1);
+    size_t read = fread(buffer,1,size,file);
+    buffer[read] = '\0';
+    fclose(file);
+    return buffer;
+}
+
+static GLuint compile_stage(GLenum stage,const char* path) {
+    char* source = read_file(path);
+    if(!source)
+        return 0;
+
+    GLuint shader = glCreateShader(stage);
+    glShaderSource(shader,1,(const char**)&source,NULL);
+    glCompileShader(shader);
+    free(source);
+
+    GLint ok;
+    glGetShaderiv(shader,GL_COMPILE_STATUS,&ok);
+    if(!ok) {
+        char log[1024];
+        glGetShaderInfoLog(shader,sizeof(log),NULL,log);
+        fprintf(stderr,"[SHADER] %s\n%s\n",path,log);
+        glDeleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+static void reflect_uniforms(ShaderProgram* program) {
+    GLint active = 0;
+    glGetProgramiv(program->id,GL_ACTIVE_UNIFORMS,&active);
+    program->uniforms = malloc((active ? active : 1) * sizeof(ShaderUniform));
+    program->uniform_count = 0;
+
+    for(GLint i = 0; i < active; i++) {
+        char name[256];
+        GLsizei length = 0;
+        GLint size;
+        GLenum type;
+        glGetActiveUniform(program->id,i,sizeof(name),&length,&size,&type,name);
+        // block members have no location, they are set through their buffer
+        GLint location = glGetUniformLocation(program->id,name);
+        if(location < 0)
+            continue;
+        // arrays are reported as name[0], look them up by their bare name
+        if(length > 3 && strcmp(name + length - 3,"[0]") == 0)
+            length -= 3;
+        program->uniforms[program->uniform_count++] = (ShaderUniform){ hash_fnv1a(name,length,HASH_FNV_SEED), location };
+    }
+}
+
+bool shader_program_create(ShaderProgram* program,const char* vs_path,const char* fs_path) {
+    memset(program,0,sizeof(*program));
+    GLuint vs = compile_stage(GL_VERTEX_SHADER,vs_path);
+    GLuint fs = vs ? compile_stage(GL_FRAGMENT_SHADER,fs_path) : 0;
+    if(!fs) {
+        glDeleteShader(vs);
+        return false;
+    }
+
+    GLuint id = glCreateProgram();
+    glAttachShader(id,vs);
+    glAttachShader(id,fs);
+    glLinkProgram(id);
+    glDeleteShader(vs);
+    glDeleteShader(fs);
+
+    GLint ok;
+    glGetProgramiv(id,GL_LINK_STATUS,&ok);
+    if(!ok) {
+        char log[1024];
+        glGetProgramInfoLog(id,sizeof(log),NULL,log);
+        fprintf(stderr,"[SHADER] %s + %s\n%s\n",vs_path,fs_path,log);
+        glDeleteProgram(id);
+        return false;
+    }
+
+    program->id = id;
+    reflect_uniforms(program);
+    return true;
+}
+
+void shader_program_destroy(ShaderProgram* program) {
+    glDeleteProgram(program->id);
+    free(program->uniforms);
+    memset(program,0,sizeof(*program));
+}
+
+void shader_bind(const ShaderProgram* program) {
+    glUseProgram(program ? program->id : 0);
+}
+
+i32 shader_uniform_location(const ShaderProgram* program,const char* name) {
+    u64 hash = hash_fnv1a(name,strlen(name),HASH_FNV_SEED);
+    for(u32 i = 0; i < program->uniform_count; i++) {
+        if(program->uniforms[i].name_hash == hash)
+            return program->uniforms[i].location;
+    }
+    return -1;
+}
+
+void shader_set_int(const ShaderProgram* program,const char* name,i32 value) {
+    glProgramUniform1i(program->id,shader_uniform_location(program,name),value);
+}
+
+void shader_set_float(const ShaderProgram* program,const char* name,f32 value) {
+    glProgramUniform1f(program->id,shader_uniform_location(program,name),value);
+}
+
+void shader_set_mat4(const ShaderProgram* program,const char* name,mat4 value) {
+    glProgramUniformMatrix4fv(program->id,shader_uniform_location(program,name),1,GL_FALSE,(const f32*)value);
+}
+
+void shader_set_vec4_array(const ShaderProgram* program,const char* name,const vec4* values,u32 count) {
+    glProgramUniform4fv(program->id,shader_uniform_location(program,name),count,(const f32*)values);
+}
+
+void shader_set_texture_handle(const ShaderProgram* program,const char* name,u64 handle) {
+    glProgramUniformHandleui64ARB(program->id,shader_uniform_location(program,name),handle);
+}
@@ -0,0 +1,141 @@
+#include "ShadowCascades.h"
+#include <cglm/cglm.h>
+#include <float.h>
+#include <math.h>
+#include <string.h>
+
+void shadow_cascade_splits(f32 near_depth,f32 far_depth,f32 lambda,u32 count,f32* splits) {
+    splits[0] = near_depth;
+    for(u32 i = 1; i < count; i++) {
+        f32 fraction = (f32)i / count;
+        f32 logarithmic = near_depth * powf(far_depth / near_depth,fraction);
+        f32 uniform = near_depth + (far_depth - near_depth) * fraction;
+        splits[i] = lambda * logarithmic + (1.0f - lambda) * uniform;
+    }
+    splits[count] = far_depth;
+}
+
+void shadow_cascade_fit(const CascadeCamera* camera,const f32* light_dir,const AABB* scene_bounds,f32 split_near,f32 split_far,
+                        u32 resolution,ShadowCascade* cascade) {
+    // the slice's corners in world space, their centre lies on the view axis so the sphere only depends on the depths
+    mat4 inverse_view;
+    glm_mat4_inv((vec4*)camera->view,inverse_view);
+    f32 tan_y = camera->tan_half_fov_y;
+    f32 tan_x = tan_y * camera->aspect;
+    vec3 corners[8];
+    vec3 center = { 0.0f, 0.0f, 0.0f };
+    for(u32 i = 0; i < 8; i++) {
+        f32 depth = i & 4 ? split_far : split_near;
+        vec4 view_corner = { (i & 1 ? 1.0f : -1.0f) * depth * tan_x, (i & 2 ? 1.0f : -1.0f) * depth * tan_y, -depth, 1.0f };
+        vec4 world;
+        glm_mat4_mulv(inverse_view,view_corner,world);
+        glm_vec3_copy(world,corners[i]);
+        glm_vec3_add(center,corners[i],center);
+    }
+    glm_vec3_scale(center,1.0f / 8.0f,center);
+    f32 radius = 0.0f;
+    for(u32 i = 0; i < 8; i++)
+        radius = glm_max(radius,glm_vec3_distance(center,corners[i]));
+    // rounded up so float noise in the inverse view never changes the map's size
+    radius = ceilf(radius * 16.0f) / 16.0f;
+
+    // rotation only, translating it with the camera would move the texel grid
+    mat4 light_view;
+    vec3 eye = { 0.0f, 0.0f, 0.0f };
+    vec3 target = { -light_dir[0], -light_dir[1], -light_dir[2] };
+    vec3 up = { 0.0f, 1.0f, 0.0f };
+    if(fabsf(light_dir[1]) > 0.99f)
+        up[0] = 1.0f;
+    glm_lookat(eye,target,up,light_view);
+
+    // snapping moves the centre by up to a texel, the map gets one to spare on each side
+    vec3 light_center;
+    glm_mat4_mulv3(light_view,center,1.0f,light_center);
+    f32 texel = 2.0f * radius / (resolution - 2);
+    f32 half_width = 0.5f * texel * resolution;
+    light_center[0] = floorf(light_center[0] / texel) * texel;
+    light_center[1] = floorf(light_center[1] / texel) * texel;
+
+    // light view looks down -z, the depth range spans the slice and everything in the scene along the light
+    f32 near_z = -light_center[2] - radius;
+    f32 far_z = -light_center[2] + radius;
+    for(u32 i = 0; i < 8; i++) {
+        vec3 corner = { i & 1 ? scene_bounds->max[0] : scene_bounds->min[0], i & 2 ? scene_bounds->max[1] : scene_bounds->min[1],
+                        i & 4 ? scene_bounds->max[2] : scene_bounds->min[2] };
+        vec3 light_corner;
+        glm_mat4_mulv3(light_view,corner,1.0f,light_corner);
+        near_z = glm_min(near_z,-light_corner[2]);
+        far_z = glm_max(far_z,-light_corner[2]);
+    }
+
+    // in coarse steps too, so a camera moving inside one texel reproduces the matrix exactly and the cache can reuse it
+    f32 depth_step = 0.25f * half_width;
+    near_z = floorf(near_z / depth_step) * depth_step - 1.0f;
+    far_z = ceilf(far_z / depth_step) * depth_step + 1.0f;
+
+    mat4 proj;
+    glm_ortho(light_center[0] - half_width,light_center[0] + half_width,light_center[1] - half_width,light_center[1] + half_width,
+              near_z,far_z,proj);
+    glm_mat4_mul(proj,light_view,cascade->view_proj);
+    cascade->split_near = split_near;
+    cascade->split_far = split_far;
+    cascade->half_width = half_width;
+    cascade->texel_size = texel;
+}
+
+void shadow_cascades_build(const CascadeCamera* camera,const f32* light_dir,const AABB* scene_bounds,f32 near_depth,f32 far_depth,
+                           f32 lambda,u32 count,u32 resolution,ShadowCascade* cascades) {
+    f32 splits[SHADOW_MAX_CASCADES + 1];
+    shadow_cascade_splits(near_depth,far_depth,lambda,count,splits);
+    for(u32 i = 0; i < count; i++)
+        shadow_cascade_fit(camera,light_dir,scene_bounds,splits[i],splits[i + 1],resolution,&cascades[i]);
+}
+
+void shadow_cache_init(ShadowCache* cache,bool enabled,f32 angle_threshold) {
+    memset(cache,0,sizeof(ShadowCache));
+    cache->enabled = enabled;
+    cache->cos_threshold = cosf(angle_threshold);
+}
+
+u32 shadow_cache_update(ShadowCache* cache,const CascadeCamera* camera,const f32* light_dir,const AABB* scene_bounds,f32 near_depth,
+                        f32 far_depth,f32 lambda,u32 count,u32 resolution) {
+    // until the light turns past the threshold the cascades are fitted to the direction they were rendered with,
+    // so a still camera reproduces their matrices exactly
+    bool turned = !cache->enabled || !cache->cascade_count || glm_vec3_dot((f32*)light_dir,cache->light_dir) < cache->cos_threshold;
+    if(turned)
+        glm_vec3_copy((f32*)light_dir,cache->light_dir);
+    ShadowCascade fitted[SHADOW_MAX_CASCADES];
+    shadow_cascades_build(camera,cache->light_dir,scene_bounds,near_depth,far_depth,lambda,count,resolution,fitted);
+
+    u32 render = 0;
+    for(u32 c = 0; c < count; c++) {
+        bool moved = memcmp(fitted[c].view_proj,cache->cascades[c].view_proj,sizeof(mat4)) != 0;
+        if(turned || moved || cache->dirty[c] || count != cache->cascade_count) {
+            render |= 1u << c;
+            cache->cascades[c] = fitted[c];
+            cache->dirty[c] = false;
+            ++cache->rendered[c];
+        } else {
+            ++cache->skipped[c];
+        }
+    }
+    cache->cascade_count = count;
+    return render;
+}
+
+// conservative, the box's corners in the cascade's clip space against the unit cube
+static bool cascade_overlaps(const ShadowCascade* cascade,const AABB* box) {
+    vec3 min = { FLT_MAX, FLT_MAX, FLT_MAX }, max = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+    for(u32 i = 0; i < 8; i++) {
+        vec4 corner = { i & 1 ? box->max[0] : box->min[0], i & 2 ? box->max[1] : box->min[1], i & 4 ? box->max[2] : box->min[2], 1.0f }, clip;
+        glm_mat4_mulv((vec4*)cascade->view_proj,corner,clip);
+        glm_vec3_minv(min,clip,min);
+        glm_vec3_maxv(max,clip,max);
+    }
+    return min[0] <= 1.0f && max[0] >= -1.0f && min[1] <= 1.0f && max[1] >= -1.0f && min[2] <= 1.0f && max[2] >= -1.0f;
+}
+
+void shadow_cache_invalidate(ShadowCache* cache,const AABB* bounds) {
+    for(u32 c = 0; c < cache->cascade_count; c++)
+        cache->dirty[c] |= cascade_overlaps(&cache->cascades[c],bounds);
+}
@@ -0,0 +1,151 @@
+#include "SphericalHarmonics.h"
+#include "Simd.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// a run of 12 floats holds whole pixels of 1, 2, 3 or 4 channels and fills three SSE registers
+#define SH_CHUNK 12
+// azimuthal factors the basis separates into on a row: 1, cos phi, sin phi, cos 2phi, sin 2phi
+#define SH_AZIMUTH_COUNT 5
+
+#define SH_Y0 0.282094792f
+#define SH_Y1 0.488602512f
+#define SH_Y2 1.092548431f
+#define SH_Y3 0.315391565f
+#define SH_Y4 0.546274215f
+
+void sh9_basis(const f32* direction,f32* basis) {
+    f32 x = direction[0], y = direction[1], z = direction[2];
+    basis[0] = SH_Y0;
+    basis[1] = SH_Y1 * y;
+    basis[2] = SH_Y1 * z;
+    basis[3] = SH_Y1 * x;
+    basis[4] = SH_Y2 * x * y;
+    basis[5] = SH_Y2 * y * z;
+    basis[6] = SH_Y3 * (3.0f * z * z - 1.0f);
+    basis[7] = SH_Y2 * x * z;
+    basis[8] = SH_Y4 * (x * x - y * y);
+}
+
+typedef struct {
+    const f32* pixels;
+    u32 width;
+    u32 height;
+    u32 channels;
+    u32 row_floats;
+    const f32* azimuth; // SH_AZIMUTH_COUNT tables of row_floats, each pixel's factor repeated for its channels
+    f32* rows;          // SH_COEFFICIENT_COUNT * 4 per row, summed in row order once every row is done
+}ProjectJob;
+
+// sums of row[i] * table[i] split by channel
+static void row_dot(const f32* row,const f32* table,u32 count,u32 channels,f32* sums) {
+    f32 lanes[SH_CHUNK] = {0};
+    u32 i = 0;
+#if defined(SIMD_SSE)
+    __m128 a0 = _mm_setzero_ps(), a1 = _mm_setzero_ps(), a2 = _mm_setzero_ps();
+    for(; i + SH_CHUNK <= count; i += SH_CHUNK) {
+        a0 = _mm_add_ps(a0,_mm_mul_ps(_mm_loadu_ps(row + i),_mm_loadu_ps(table + i)));
+        a1 = _mm_add_ps(a1,_mm_mul_ps(_mm_loadu_ps(row + i + 4),_mm_loadu_ps(table + i + 4)));
+        a2 = _mm_add_ps(a2,_mm_mul_ps(_mm_loadu_ps(row + i + 8),_mm_loadu_ps(table + i + 8)));
+    }
+    _mm_storeu_ps(lanes,a0);
+    _mm_storeu_ps(lanes + 4,a1);
+    _mm_storeu_ps(lanes + 8,a2);
+#endif
+    for(u32 lane = 0; i < count; i++, lane = lane + 1 < SH_CHUNK ? lane + 1 : 0)
+        lanes[lane] += row[i] * table[i];
+    for(u32 c = 0; c < channels; c++)
+        sums[c] = 0.0f;
+    for(u32 lane = 0; lane < SH_CHUNK; lane++)
+        sums[lane % channels] += lanes[lane];
+}
+
+static void project_rows(void* data,u32 begin,u32 end) {
+    ProjectJob* job = data;
+    f32 d_phi = 2.0f * GLM_PIf / job->width;
+    f32 d_beta = GLM_PIf / job->height;
+    u32 channels = job->channels < 3 ? job->channels : 3;
+    for(u32 y = begin; y < end; y++) {
+        const f32* row = job->pixels + (u64)y * job->row_floats;
+        f32 sums[SH_AZIMUTH_COUNT][4];
+        for(u32 g = 0; g < SH_AZIMUTH_COUNT; g++)
+            row_dot(row,job->azimuth + (u64)g * job->row_floats,job->row_floats,job->channels,sums[g]);
+
+        // elevation from the bottom row up, the solid angle of a texel shrinks with cos
+        f32 beta = ((y + 0.5f) / job->height - 0.5f) * GLM_PIf;
+        f32 sb = sinf(beta), cb = cosf(beta);
+        f32 weight = d_phi * d_beta * cb;
+        f32* out = job->rows + (u64)y * SH_COEFFICIENT_COUNT * 4;
+        memset(out,0,SH_COEFFICIENT_COUNT * 4 * sizeof(f32));
+        for(u32 c = 0; c < channels; c++) {
+            f32 s1 = sums[0][c], sc = sums[1][c], ss = sums[2][c], sc2 = sums[3][c], ss2 = sums[4][c];
+            // x = cb cos phi, y = sb, z = cb sin phi put into sh9_basis and summed over the row
+            out[0 * 4 + c] = weight * SH_Y0 * s1;
+            out[1 * 4 + c] = weight * SH_Y1 * sb * s1;
+            out[2 * 4 + c] = weight * SH_Y1 * cb * ss;
+            out[3 * 4 + c] = weight * SH_Y1 * cb * sc;
+            out[4 * 4 + c] = weight * SH_Y2 * sb * cb * sc;
+            out[5 * 4 + c] = weight * SH_Y2 * sb * cb * ss;
+            out[6 * 4 + c] = weight * SH_Y3 * (1.5f * cb * cb * (s1 - sc2) - s1);
+            out[7 * 4 + c] = weight * SH_Y2 * 0.5f * cb * cb * ss2;
+            out[8 * 4 + c] = weight * SH_Y4 * (0.5f * cb * cb * (s1 + sc2) - sb * sb * s1);
+        }
+        // a single channel image is grey
+        for(u32 c = channels; c < 3; c++)
+            for(u32 k = 0; k < SH_COEFFICIENT_COUNT; k++)
+                out[k * 4 + c] = out[k * 4];
+    }
+}
+
+void sh9_project_equirect(JobSystem* jobs,const f32* pixels,u32 width,u32 height,u32 channels,SH9* radiance) {
+    memset(radiance,0,sizeof(SH9));
+    if(!width || !height || !channels)
+        return;
+
+    ProjectJob job = { pixels, width, height, channels, width * channels };
+    f32* azimuth = malloc((u64)SH_AZIMUTH_COUNT * job.row_floats * sizeof(f32));
+    job.rows = malloc((u64)height * SH_COEFFICIENT_COUNT * 4 * sizeof(f32));
+    for(u32 x = 0; x < width; x++) {
+        // u = atan(z,x) / 2pi + 0.5 in eqrec_to_cubemap_fs.glsl
+        f32 phi = ((x + 0.5f) / width - 0.5f) * 2.0f * GLM_PIf;
+        f32 factors[SH_AZIMUTH_COUNT] = { 1.0f, cosf(phi), sinf(phi), cosf(2.0f * phi), sinf(2.0f * phi) };
+        for(u32 g = 0; g < SH_AZIMUTH_COUNT; g++)
+            for(u32 c = 0; c < channels; c++)
+                azimuth[(u64)g * job.row_floats + x * channels + c] = factors[g];
+    }
+    job.azimuth = azimuth;
+
+    job_system_parallel_for(jobs,height,16,project_rows,&job);
+
+    for(u32 y = 0; y < height; y++) {
+        const f32* row = job.rows + (u64)y * SH_COEFFICIENT_COUNT * 4;
+        for(u32 k = 0; k < SH_COEFFICIENT_COUNT; k++)
+            glm_vec4_add(radiance->coefficients[k],(f32*)row + k * 4,radiance->coefficients[k]);
+    }
+    free(job.rows);
+    free(azimuth);
+}
+
+void sh9_irradiance(const SH9* radiance,SH9* irradiance) {
+    // clamped cosine band factors pi, 2pi/3 and pi/4, over pi
+    static const f32 bands[SH_COEFFICIENT_COUNT] = { 1.0f, 2.0f / 3.0f, 2.0f / 3.0f, 2.0f / 3.0f, 0.25f, 0.25f, 0.25f, 0.25f, 0.25f };
+    for(u32 k = 0; k < SH_COEFFICIENT_COUNT; k++)
+        glm_vec4_scale((f32*)radiance->coefficients[k],bands[k],irradiance->coefficients[k]);
+}
+
+void sh9_evaluate(const SH9* sh,const f32* direction,f32* rgb) {
+    f32 basis[SH_COEFFICIENT_COUNT];
+    sh9_basis(direction,basis);
+    glm_vec3_zero(rgb);
+    for(u32 k = 0; k < SH_COEFFICIENT_COUNT; k++)
+        glm_vec3_muladds((f32*)sh->coefficients[k],basis[k],rgb);
+}
+
+const char* sh9_isa(void) {
+#if defined(SIMD_SSE)
+    return "SSE";
+#else
+    return "scalar";
+#endif
+}
@@ -0,0 +1,139 @@
+#include "StreamBuffer.h"
+#include <glad/glad.h>
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+void stream_ring_init(StreamRing* ring,u64 slice_size,u32 slice_count) {
+    assert(slice_count > 0 && slice_count <= STREAM_BUFFER_MAX_FRAMES);
+    memset(ring,0,sizeof(StreamRing));
+    ring->slice_size = slice_size;
+    ring->slice_count = slice_count;
+}
+
+u32 stream_ring_next_slice(const StreamRing* ring) {
+    return ring->frame % ring->slice_count;
+}
+
+void stream_ring_retire(StreamRing* ring,u32 slice) {
+    ring->pending[slice] = false;
+}
+
+bool stream_ring_begin_frame(StreamRing* ring) {
+    assert(!ring->in_frame);
+    u32 slice = stream_ring_next_slice(ring);
+    if(ring->pending[slice])
+        return false;
+    ring->slice = slice;
+    ring->used = 0;
+    ring->in_frame = true;
+    ++ring->frame;
+    return true;
+}
+
+bool stream_ring_alloc(StreamRing* ring,u64 size,u64 alignment,u64* offset) {
+    assert(ring->in_frame && alignment && (alignment & (alignment - 1)) == 0);
+    // slices start at multiples of slice_size, which is kept a multiple of every alignment
+    u64 start = (ring->used + alignment - 1) & ~(alignment - 1);
+    if(start + size > ring->slice_size) {
+        ++ring->failed;
+        return false;
+    }
+    ring->used = start + size;
+    if(ring->used > ring->peak_used)
+        ring->peak_used = ring->used;
+    *offset = ring->slice * ring->slice_size + start;
+    return true;
+}
+
+void stream_ring_end_frame(StreamRing* ring) {
+    assert(ring->in_frame);
+    ring->pending[ring->slice] = true;
+    ring->in_frame = false;
+}
+
+bool stream_buffer_create(StreamBuffer* stream,u64 slice_size,u32 slice_count) {
+    memset(stream,0,sizeof(StreamBuffer));
+    GLint uniform_alignment = 0, storage_alignment = 0;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT,&uniform_alignment);
+    glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT,&storage_alignment);
+    if(uniform_alignment > STREAM_BUFFER_MAX_ALIGNMENT || storage_alignment > STREAM_BUFFER_MAX_ALIGNMENT) {
+        fprintf(stderr,"[STREAM] Offset alignments %d/%d exceed %d\n",uniform_alignment,storage_alignment,STREAM_BUFFER_MAX_ALIGNMENT);
+        return false;
+    }
+    stream->uniform_alignment = uniform_alignment > 0 ? uniform_alignment : 1;
+    stream->storage_alignment = storage_alignment > 0 ? storage_alignment : 1;
+
+    slice_size = (slice_size + STREAM_BUFFER_MAX_ALIGNMENT - 1) & ~(u64)(STREAM_BUFFER_MAX_ALIGNMENT - 1);
+    stream_ring_init(&stream->ring,slice_size,slice_count);
+
+    GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glCreateBuffers(1,&stream->buffer);
+    glNamedBufferStorage(stream->buffer,slice_size * slice_count,NULL,flags);
+    stream->mapped = glMapNamedBufferRange(stream->buffer,0,slice_size * slice_count,flags);
+    if(!stream->mapped) {
+        fprintf(stderr,"[STREAM] Failed to map %llu bytes\n",(unsigned long long)(slice_size * slice_count));
+        glDeleteBuffers(1,&stream->buffer);
+        stream->buffer = 0;
+        return false;
+    }
+    return true;
+}
+
+void stream_buffer_destroy(StreamBuffer* stream) {
+    for(u32 i = 0; i < STREAM_BUFFER_MAX_FRAMES; i++) {
+        if(stream->fences[i])
+            glDeleteSync(stream->fences[i]);
+    }
+    if(stream->buffer) {
+        glUnmapNamedBuffer(stream->buffer);
+        glDeleteBuffers(1,&stream->buffer);
+    }
+    memset(stream,0,sizeof(StreamBuffer));
+}
+
+void stream_buffer_begin_frame(StreamBuffer* stream) {
+    u32 slice = stream_ring_next_slice(&stream->ring);
+    if(stream->ring.pending[slice]) {
+        GLsync fence = stream->fences[slice];
+        GLenum status = glClientWaitSync(fence,0,0);
+        if(status == GL_TIMEOUT_EXPIRED) {
+            ++stream->stalls;
+            // the first wait flushes so the fence is guaranteed to signal eventually
+            GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+            do {
+                status = glClientWaitSync(fence,flags,1000000000ull);
+                flags = 0;
+            } while(status == GL_TIMEOUT_EXPIRED);
+        }
+        glDeleteSync(fence);
+        stream->fences[slice] = NULL;
+        stream_ring_retire(&stream->ring,slice);
+    }
+    bool started = stream_ring_begin_frame(&stream->ring);
+    assert(started);
+    (void)started;
+}
+
+void* stream_buffer_alloc(StreamBuffer* stream,u64 size,u64 alignment,u64* offset) {
+    if(!stream_ring_alloc(&stream->ring,size,alignment,offset)) {
+        if(stream->ring.failed == 1)
+            fprintf(stderr,"[STREAM] Slice of %llu bytes is full, dropping data\n",(unsigned long long)stream->ring.slice_size);
+        return NULL;
+    }
+    return stream->mapped + *offset;
+}
+
+bool stream_buffer_write(StreamBuffer* stream,const void* data,u64 size,u64 alignment,u64* offset) {
+    void* destination = stream_buffer_alloc(stream,size,alignment,offset);
+    if(!destination)
+        return false;
+    memcpy(destination,data,size);
+    return true;
+}
+
+void stream_buffer_end_frame(StreamBuffer* stream) {
+    u32 slice = stream->ring.slice;
+    stream->fences[slice] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE,0);
+    stream_ring_end_frame(&stream->ring);
+}
@@ -0,0 +1,744 @@
+#include "TextureCompress.h"
+#include "Hash.h"
+#include "AtomicFile.h"
+#include "Timer.h"
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#if defined(_WIN32)
+#include <direct.h>
+#define make_directory(path) _mkdir(path)
+#else
+#define make_directory(path) mkdir(path,0755)
+#endif
+
+#define BLOCK_TEXELS 16
+
+// interpolation weights of BC7's 4 bit indices, out of 64
+static const u32 bc7_weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+TextureFormat texture_role_format(TextureRole role) {
+    switch(role) {
+        case TEXTURE_ROLE_OCCLUSION:        return TEXTURE_FORMAT_BC4;
+        case TEXTURE_ROLE_EMISSIVE:         return TEXTURE_FORMAT_BC1;
+        case TEXTURE_ROLE_BASE_COLOR_ALPHA: return TEXTURE_FORMAT_BC3;
+        case TEXTURE_ROLE_NORMAL:           return TEXTURE_FORMAT_BC5;
+        default:                            return TEXTURE_FORMAT_BC7;
+    }
+}
+
+MipMode texture_role_mip_mode(TextureRole role) {
+    switch(role) {
+        case TEXTURE_ROLE_EMISSIVE:
+        case TEXTURE_ROLE_BASE_COLOR:
+        case TEXTURE_ROLE_BASE_COLOR_ALPHA: return MIP_MODE_SRGB;
+        case TEXTURE_ROLE_NORMAL:           return MIP_MODE_NORMAL;
+        default:                            return MIP_MODE_LINEAR;
+    }
+}
+
+const char* texture_format_name(TextureFormat format) {
+    static const char* names[TEXTURE_FORMAT_COUNT] = { "BC1", "BC3", "BC4", "BC5", "BC7" };
+    return format < TEXTURE_FORMAT_COUNT ? names[format] : "?";
+}
+
+u32 texture_format_block_size(TextureFormat format) {
+    return format == TEXTURE_FORMAT_BC1 || format == TEXTURE_FORMAT_BC4 ? 8 : 16;
+}
+
+static u32 format_channels(TextureFormat format) {
+    switch(format) {
+        case TEXTURE_FORMAT_BC1: return 3;
+        case TEXTURE_FORMAT_BC4: return 1;
+        case TEXTURE_FORMAT_BC5: return 2;
+        default:                 return 4;
+    }
+}
+
+typedef struct {
+    u8* bytes;
+    u32 bit;
+}BitWriter;
+
+static void put_bits(BitWriter* writer,u32 value,u32 count) {
+    for(u32 i = 0; i < count; i++, writer->bit++)
+        if((value >> i) & 1)
+            writer->bytes[writer->bit >> 3] |= (u8)(1u << (writer->bit & 7));
+}
+
+static u32 get_bits(const u8* bytes,u32* bit,u32 count) {
+    u32 value = 0;
+    for(u32 i = 0; i < count; i++, (*bit)++)
+        value |= (u32)((bytes[*bit >> 3] >> (*bit & 7)) & 1) << i;
+    return value;
+}
+
+static f32 clamp_255(f32 value) {
+    return value < 0.0f ? 0.0f : value > 255.0f ? 255.0f : value;
+}
+
+// principal axis of the texels' first channels by power iteration on their covariance, zero for a flat block
+static void principal_axis(const u8* rgba,u32 channels,f32* mean,f32* axis) {
+    f32 covariance[4][4] = {{0}};
+    for(u32 c = 0; c < channels; c++) {
+        mean[c] = 0.0f;
+        for(u32 i = 0; i < BLOCK_TEXELS; i++)
+            mean[c] += rgba[i * 4 + c];
+        mean[c] /= BLOCK_TEXELS;
+    }
+    for(u32 i = 0; i < BLOCK_TEXELS; i++)
+        for(u32 a = 0; a < channels; a++)
+            for(u32 b = 0; b < channels; b++)
+                covariance[a][b] += (rgba[i * 4 + a] - mean[a]) * (rgba[i * 4 + b] - mean[b]);
+
+    // start from the widest channel's column so the iteration does not begin orthogonal to the answer
+    u32 widest = 0;
+    for(u32 c = 1; c < channels; c++)
+        widest = covariance[c][c] > covariance[widest][widest] ? c : widest;
+    for(u32 c = 0; c < channels; c++)
+        axis[c] = covariance[c][widest];
+    for(u32 iteration = 0; iteration < 8; iteration++) {
+        f32 next[4] = {0}, length = 0.0f;
+        for(u32 a = 0; a < channels; a++) {
+            for(u32 b = 0; b < channels; b++)
+                next[a] += covariance[a][b] * axis[b];
+            length += next[a] * next[a];
+        }
+        if(length < 1e-12f) {
+            memset(axis,0,channels * sizeof(f32));
+            return;
+        }
+        length = 1.0f / sqrtf(length);
+        for(u32 c = 0; c < channels; c++)
+            axis[c] = next[c] * length;
+    }
+}
+
+// extremes of the texels along the axis, the starting endpoints of every encoder
+static void axis_endpoints(const u8* rgba,u32 channels,const f32* mean,const f32* axis,f32* e0,f32* e1) {
+    f32 low = 0.0f, high = 0.0f;
+    for(u32 i = 0; i < BLOCK_TEXELS; i++) {
+        f32 t = 0.0f;
+        for(u32 c = 0; c < channels; c++)
+            t += (rgba[i * 4 + c] - mean[c]) * axis[c];
+        low = t < low ? t : low;
+        high = t > high ? t : high;
+    }
+    for(u32 c = 0; c < channels; c++) {
+        e0[c] = clamp_255(mean[c] + axis[c] * low);
+        e1[c] = clamp_255(mean[c] + axis[c] * high);
+    }
+}
+
+// endpoints minimising the squared error for fixed interpolation weights (fraction of e1 per texel), false when
+// every texel has the same weight
+static bool least_squares(const u8* rgba,u32 channels,const f32* weights,f32* e0,f32* e1) {
+    f32 aa = 0.0f, bb = 0.0f, ab = 0.0f, ax[4] = {0}, bx[4] = {0};
+    for(u32 i = 0; i < BLOCK_TEXELS; i++) {
+        f32 b = weights[i], a = 1.0f - b;
+        aa += a * a;
+        bb += b * b;
+        ab += a * b;
+        for(u32 c = 0; c < channels; c++) {
+            ax[c] += a * rgba[i * 4 + c];
+            bx[c] += b * rgba[i * 4 + c];
+        }
+    }
+    f32 det = aa * bb - ab * ab;
+    if(fabsf(det) < 1e-6f)
+        return false;
+    for(u32 c = 0; c < channels; c++) {
+        e0[c] = clamp_255((ax[c] * bb - bx[c] * ab) / det);
+        e1[c] = clamp_255((bx[c] * aa - ax[c] * ab) / det);
+    }
+    return true;
+}
+
+// BC1 colour block, always in 4 colour mode so it also serves BC3
+
+static u16 pack_565(const f32* rgb) {
+    u32 r = (u32)(rgb[0] * 31.0f / 255.0f + 0.5f), g = (u32)(rgb[1] * 63.0f / 255.0f + 0.5f), b = (u32)(rgb[2] * 31.0f / 255.0f + 0.5f);
+    return (u16)((r << 11) | (g << 5) | b);
+}
+
+static void unpack_565(u16 color,u32* rgb) {
+    u32 r = (color >> 11) & 31, g = (color >> 5) & 63, b = color & 31;
+    rgb[0] = (r << 3) | (r >> 2);
+    rgb[1] = (g << 2) | (g >> 4);
+    rgb[2] = (b << 3) | (b >> 2);
+}
+
+static void bc1_palette(u16 c0,u16 c1,bool four_colors,u32 palette[4][4]) {
+    unpack_565(c0,palette[0]);
+    unpack_565(c1,palette[1]);
+    for(u32 c = 0; c < 3; c++) {
+        if(four_colors) {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        } else {
+            palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+            palette[3][c] = 0;
+        }
+    }
+    palette[0][3] = palette[1][3] = palette[2][3] = 255;
+    palette[3][3] = four_colors ? 255 : 0;
+}
+
+// indices for the 4 colour palette of c0, c1 and the total squared error
+static u32 bc1_indices(const u8* rgba,u16 c0,u16 c1,u8* indices) {
+    u32 palette[4][4];
+    bc1_palette(c0,c1,true,palette);
+    u32 total = 0;
+    for(u32 i = 0; i < BLOCK_TEXELS; i++) {
+        u32 best = UINT32_MAX;
+        for(u32 p = 0; p < 4; p++) {
+            u32 error = 0;
+            for(u32 c = 0; c < 3; c++) {
+                i32 d = (i32)rgba[i * 4 + c] - (i32)palette[p][c];
+                error += d * d;
+            }
+            if(error < best) {
+                best = error;
+                indices[i] = p;
+            }
+        }
+        total += best;
+    }
+    return total;
+}
+
+static void encode_bc1(const u8* rgba,u8* block) {
+    f32 mean[4], axis[4], e0[4], e1[4];
+    principal_axis(rgba,3,mean,axis);
+    axis_endpoints(rgba,3,mean,axis,e0,e1);
+
+    u16 c0 = pack_565(e1), c1 = pack_565(e0);
+    u8 indices[BLOCK_TEXELS];
+    u32 error = bc1_indices(rgba,c0,c1,indices);
+
+    // one least squares pass on the chosen indices, kept when it helps
+    static const f32 index_weights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+    f32 weights[BLOCK_TEXELS];
+    for(u32 i = 0; i < BLOCK_TEXELS; i++)
+        weights[i] = index_weights[indices[i]];
+    if(error && least_squares(rgba,3,weights,e0,e1)) {
+        u16 r0 = pack_565(e0), r1 = pack_565(e1);
+        u8 refined[BLOCK_TEXELS];
+        u32 refined_error = bc1_indices(rgba,r0,r1,refined);
+        if(refined_error < error) {
+            c0 = r0;
+            c1 = r1;
+            error = refined_error;
+            memcpy(indices,refined,sizeof(indices));
+        }
+    }
+
+    // c0 > c1 selects 4 colour mode, swapping the endpoints swaps 0 with 1 and 2 with 3
+    if(c0 < c1) {
+        u16 t = c0;
+        c0 = c1;
+        c1 = t;
+        for(u32 i = 0; i < BLOCK_TEXELS; i++)
+            indices[i] ^= 1;
+    } else if(c0 == c1) {
+        memset(indices,0,sizeof(indices));
+    }
+
+    u32 bits = 0;
+    for(u32 i = 0; i < BLOCK_TEXELS; i++)
+        bits |= (u32)indices[i] << (i * 2);
+    block[0] = c0 & 0xff;
+    block[1] = c0 >> 8;
+    block[2] = c1 & 0xff;
+    block[3] = c1 >> 8;
+    memcpy(block + 4,&bits,4);
+}
+
+static void decode_bc1(const u8* block,bool force_four_colors,u8* rgba) {
+    u16 c0 = block[0] | (block[1] << 8), c1 = block[2] | (block[3] << 8);
+    u32 palette[4][4];
+    bc1_palette(c0,c1,force_four_colors || c0 > c1,palette);
+    u32 bits;
+    memcpy(&bits,block + 4,4);
+    for(u32 i = 0; i < BLOCK_TEXELS; i++) {
+        u32 index = (bits >> (i * 2)) & 3;
+        for(u32 c = 0; c < 4; c++)
+            rgba[i * 4 + c] = (u8)palette[index][c];
+    }
+}
+
+// BC4 block of one channel of the rgba texels, always in 8 value mode
+
+static void bc4_palette(u32 r0,u32 r1,u32* palette) {
+    palette[0] = r0;
+    palette[1] = r1;
+    if(r0 > r1) {
+        for(u32 i = 2; i < 8; i++)
+            palette[i] = ((8 - i) * r0 + (i - 1) * r1) / 7;
+    } else {
+        for(u32 i = 2; i < 6; i++)
+            palette[i] = ((6 - i) * r0 + (i - 1) * r1) / 5;
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+}
+
+static void encode_bc4(const u8* rgba,u32 channel,u8* block) {
+    u32 low = 255, high = 0;
+    for(u32 i = 0; i < BLOCK_TEXELS; i++) {
+        u32 v = rgba[i * 4 + channel];
+        low = v < low ? v : low;
+        high = v > high ? v : high;
+    }
+    memset(block,0,8);
+    block[0] = (u8)high;
+    block[1] = (u8)low;
+    if(high == low)
+        return;
+
+    u32 palette[8];
+    bc4_palette(high,low,palette);
+    u64 bits = 0;
+    for(u32 i = 0; i < BLOCK_TEXELS; i++) {
+        i32 v = rgba[i * 4 + channel];
+        u32 best = 0, best_error = UINT32_MAX;
+        for(u32 p = 0; p < 8; p++) {
+            u32 error = (u32)abs(v - (i32)palette[p]);
+            if(error < best_error) {
+                best_error = error;
+                best = p;
+            }
+        }
+        bits |= (u64)best << (i * 3);
+    }
+    for(u32 b = 0; b < 6; b++)
+        block[2 + b] = (u8)(bits >> (b * 8));
+}
+
+static void decode_bc4(const u8* block,u32 channel,u8* rgba) {
+    u32 palette[8];
+    bc4_palette(block[0],block[1],palette);
+    u64 bits = 0;
+    for(u32 b = 0; b < 6; b++)
+        bits |= (u64)block[2 + b] << (b * 8);
+    for(u32 i = 0; i < BLOCK_TEXELS; i++)
+        rgba[i * 4 + channel] = (u8)palette[(bits >> (i * 3)) & 7];
+}
+
+// BC7 mode 6: 7 bit rgba endpoints, each with its own p bit as the shared least significant bit
+
+// the 8 bit endpoint closest to value, over both p bits, written as 7 bit values and the p bit
+static void bc7_quantize(const f32* endpoint,u32* quantized,u32* p_bit) {
+    f32 best_error = FLT_MAX;
+    for(u32 p = 0; p < 2; p++) {
+        u32 q[4];
+        f32 error = 0.0f;
+        for(u32 c = 0; c < 4; c++) {
+            f32 v = (endpoint[c] - p) * 0.5f + 0.5f;
+            q[c] = v < 0.0f ? 0 : v > 127.0f ? 127 : (u32)v;
+            f32 d = (f32)((q[c] << 1) | p) - endpoint[c];
+            error += d * d;
+        }
+        if(error < best_error) {
+            best_error = error;
+            memcpy(quantized,q,sizeof(q));
+            *p_bit = p;
+        }
+    }
+}
+
+// the palette lies on a line, so each texel's projection onto it leaves only the neighbouring indices to test
+static u32 bc7_indices(const u8* rgba,const u32* q0,u32 p0,const u32* q1,u32 p1,u8* indices) {
+    u32 palette[16][4];
+    f32 line[4], length = 0.0f;
+    for(u32 c = 0; c < 4; c++) {
+        u32 a = (q0[c] << 1) | p0, b = (q1[c] << 1) | p1;
+        for(u32 i = 0; i < 16; i++)
+            palette[i][c] = (a * (64 - bc7_weights[i]) + b * bc7_weights[i] + 32) >> 6;
+        line[c] = (f32)b - (f32)a;
+        length += line[c] * line[c];
+    }
+    f32 scale = length > 0.0f ? 64.0f / length : 0.0f;
+
+    u32 total = 0;
+    for(u32 i = 0; i < BLOCK_TEXELS; i++) {
+        f32 t = 0.0f;
+        for(u32 c = 0; c < 4; c++)
+            t += ((f32)rgba[i * 4 + c] - (f32)palette[0][c]) * line[c];
+        t *= scale;
+        u32 guess = 0;
+        while(guess < 15 && bc7_weights[guess + 1] <= t)
+            guess++;
+
+        u32 best = UINT32_MAX;
+        u32 first = guess ? guess - 1 : 0, last = guess < 14 ? guess + 2 : 15;
+        for(u32 p = first; p <= last; p++) {
+            u32 error = 0;
+            for(u32 c = 0; c < 4; c++) {
+                i32 d = (i32)rgba[i * 4 + c] - (i32)palette[p][c];
+                error += d * d;
+            }
+            if(error < best) {
+                best = error;
+                indices[i] = p;
+            }
+        }
+        total += best;
+    }
+    return total;
+}
+
+static void encode_bc7(const u8* rgba,u8* block) {
+    f32 mean[4], axis[4], e0[4], e1[4];
+    principal_axis(rgba,4,mean,axis);
+    axis_endpoints(rgba,4,mean,axis,e0,e1);
+
+    u32 q0[4], q1[4], p0, p1;
+    bc7_quantize(e0,q0,&p0);
+    bc7_quantize(e1,q1,&p1);
+    u8 indices[BLOCK_TEXELS];
+    u32 error = bc7_indices(rgba,q0,p0,q1,p1,indices);
+
+    f32 weights[BLOCK_TEXELS];
+    for(u32 i = 0; i < BLOCK_TEXELS; i++)
+        weights[i] = bc7_weights[indices[i]] / 64.0f;
+    if(error && least_squares(rgba,4,weights,e0,e1)) {
+        u32 r0[4], r1[4], rp0, rp1;
+        bc7_quantize(e0,r0,&rp0);
+        bc7_quantize(e1,r1,&rp1);
+        u8 refined[BLOCK_TEXELS];
+        u32 refined_error = bc7_indices(rgba,r0,rp0,r1,rp1,refined);
+        if(refined_error < error) {
+            memcpy(q0,r0,sizeof(q0));
+            memcpy(q1,r1,sizeof(q1));
+            p0 = rp0;
+            p1 = rp1;
+            memcpy(indices,refined,sizeof(indices));
+        }
+    }
+
+    // the first index is stored without its top bit, swapping the endpoints clears it
+    if(indices[0] & 8) {
+        u32 t[4];
+        memcpy(t,q0,sizeof(t));
+        memcpy(q0,q1,sizeof(t));
+        memcpy(q1,t,sizeof(t));
+        u32 p = p0;
+        p0 = p1;
+        p1 = p;
+        for(u32 i = 0; i < BLOCK_TEXELS; i++)
+            indices[i] = 15 - indices[i];
+    }
+
+    memset(block,0,16);
+    BitWriter writer = { block, 0 };
+    put_bits(&writer,1u << 6,7);
+    for(u32 c = 0; c < 4; c++) {
+        put_bits(&writer,q0[c],7);
+        put_bits(&writer,q1[c],7);
+    }
+    put_bits(&writer,p0,1);
+    put_bits(&writer,p1,1);
+    put_bits(&writer,indices[0],3);
+    for(u32 i = 1; i < BLOCK_TEXELS; i++)
+        put_bits(&writer,indices[i],4);
+}
+
+// decodes the mode the encoder writes, other modes come out magenta
+static void decode_bc7(const u8* block,u8* rgba) {
+    if((block[0] & 0x7f) != 1u << 6) {
+        for(u32 i = 0; i < BLOCK_TEXELS; i++) {
+            rgba[i * 4 + 0] = 255;
+            rgba[i * 4 + 1] = 0;
+            rgba[i * 4 + 2] = 255;
+            rgba[i * 4 + 3] = 255;
+        }
+        return;
+    }
+    u32 bit = 7, q0[4], q1[4];
+    for(u32 c = 0; c < 4; c++) {
+        q0[c] = get_bits(block,&bit,7);
+        q1[c] = get_bits(block,&bit,7);
+    }
+    u32 p0 = get_bits(block,&bit,1), p1 = get_bits(block,&bit,1);
+    for(u32 i = 0; i < BLOCK_TEXELS; i++) {
+        u32 w = bc7_weights[get_bits(block,&bit,i == 0 ? 3 : 4)];
+        for(u32 c = 0; c < 4; c++) {
+            u32 a = (q0[c] << 1) | p0, b = (q1[c] << 1) | p1;
+            rgba[i * 4 + c] = (u8)((a * (64 - w) + b * w + 32) >> 6);
+        }
+    }
+}
+
+void texture_compress_block(TextureFormat format,const u8* rgba,u8* block) {
+    switch(format) {
+        case TEXTURE_FORMAT_BC1:
+            encode_bc1(rgba,block);
+            break;
+        case TEXTURE_FORMAT_BC3:
+            encode_bc4(rgba,3,block);
+            encode_bc1(rgba,block + 8);
+            break;
+        case TEXTURE_FORMAT_BC4:
+            encode_bc4(rgba,0,block);
+            break;
+        case TEXTURE_FORMAT_BC5:
+            encode_bc4(rgba,0,block);
+            encode_bc4(rgba,1,block + 8);
+            break;
+        default:
+            encode_bc7(rgba,block);
+            break;
+    }
+}
+
+void texture_decompress_block(TextureFormat format,const u8* block,u8* rgba) {
+    switch(format) {
+        case TEXTURE_FORMAT_BC1:
+            decode_bc1(block,false,rgba);
+            break;
+        case TEXTURE_FORMAT_BC3:
+            decode_bc1(block + 8,true,rgba);
+            decode_bc4(block,3,rgba);
+            break;
+        case TEXTURE_FORMAT_BC4:
+            memset(rgba,0,BLOCK_TEXELS * 4);
+            decode_bc4(block,0,rgba);
+            for(u32 i = 0; i < BLOCK_TEXELS; i++)
+                rgba[i * 4 + 3] = 255;
+            break;
+        case TEXTURE_FORMAT_BC5:
+            memset(rgba,0,BLOCK_TEXELS * 4);
+            decode_bc4(block,0,rgba);
+            decode_bc4(block + 8,1,rgba);
+            for(u32 i = 0; i < BLOCK_TEXELS; i++)
+                rgba[i * 4 + 3] = 255;
+            break;
+        default:
+            decode_bc7(block,rgba);
+            break;
+    }
+}
+
+// the 4x4 texels at block (bx,by) as rgba8, clamped at the edges and expanded the way GL expands GL_RED, GL_RG
+// and GL_RGB uploads
+static void fetch_block(const DecodedTexture* texture,u32 mip,u32 bx,u32 by,u8* rgba) {
+    const TextureMip* level = &texture->mips[mip];
+    const u8* pixels = texture->pixels + level->offset;
+    u32 channels = texture->channels;
+    for(u32 y = 0; y < 4; y++) {
+        u32 py = by * 4 + y < level->height ? by * 4 + y : level->height - 1;
+        for(u32 x = 0; x < 4; x++) {
+            u32 px = bx * 4 + x < level->width ? bx * 4 + x : level->width - 1;
+            const u8* texel = pixels + ((u64)py * level->width + px) * channels;
+            u8* out = rgba + (y * 4 + x) * 4;
+            out[0] = texel[0];
+            out[1] = channels > 1 ? texel[1] : 0;
+            out[2] = channels > 2 ? texel[2] : 0;
+            out[3] = channels > 3 ? texel[3] : 255;
+        }
+    }
+}
+
+static u32 blocks_across(u32 size) {
+    return (size + 3) / 4;
+}
+
+typedef struct {
+    u32 texture;
+    u32 mip;
+    u32 row; // of blocks
+}BlockRow;
+
+typedef struct {
+    const DecodedTexture* textures;
+    const TextureFormat* formats;
+    CompressedTexture* compressed;
+    const BlockRow* rows;
+}CompressBatch;
+
+static void compress_rows(void* data,u32 begin,u32 end) {
+    CompressBatch* batch = data;
+    u8 rgba[BLOCK_TEXELS * 4];
+    for(u32 r = begin; r < end; r++) {
+        const BlockRow* row = &batch->rows[r];
+        const DecodedTexture* texture = &batch->textures[row->texture];
+        CompressedTexture* compressed = &batch->compressed[row->texture];
+        TextureFormat format = batch->formats[row->texture];
+        u32 block_size = texture_format_block_size(format);
+        u32 across = blocks_across(texture->mips[row->mip].width);
+        u8* out = compressed->blocks + compressed->mips[row->mip].offset + (u64)row->row * across * block_size;
+        for(u32 bx = 0; bx < across; bx++, out += block_size) {
+            fetch_block(texture,row->mip,bx,row->row,rgba);
+            texture_compress_block(format,rgba,out);
+        }
+    }
+}
+
+void texture_compress_batch(JobSystem* jobs,const DecodedTexture* textures,const TextureFormat* formats,u32 count,
+                            CompressedTexture* compressed,TextureCompressStats* stats) {
+    f64 start = timer_now();
+    u32 row_count = 0;
+    u64 texel_count = 0, compressed_bytes = 0;
+    for(u32 i = 0; i < count; i++) {
+        CompressedTexture* out = &compressed[i];
+        memset(out,0,sizeof(CompressedTexture));
+        if(!textures[i].pixels)
+            continue;
+        out->format = formats[i];
+        out->width = textures[i].width;
+        out->height = textures[i].height;
+        out->mip_count = textures[i].mip_count;
+        for(u32 mip = 0; mip < out->mip_count; mip++) {
+            const TextureMip* level = &textures[i].mips[mip];
+            out->mips[mip].width = level->width;
+            out->mips[mip].height = level->height;
+            out->mips[mip].offset = out->blocks_size;
+            out->mips[mip].size = (u64)blocks_across(level->width) * blocks_across(level->height) * texture_format_block_size(formats[i]);
+            out->blocks_size += out->mips[mip].size;
+            row_count += blocks_across(level->height);
+            texel_count += (u64)level->width * level->height;
+        }
+        out->blocks = malloc(out->blocks_size);
+        compressed_bytes += out->blocks_size;
+    }
+
+    BlockRow* rows = malloc((row_count ? row_count : 1) * sizeof(BlockRow));
+    u32 row = 0;
+    for(u32 i = 0; i < count; i++)
+        for(u32 mip = 0; mip < compressed[i].mip_count; mip++)
+            for(u32 y = 0; y < blocks_across(compressed[i].mips[mip].height); y++)
+                rows[row++] = (BlockRow){ i, mip, y };
+
+    CompressBatch batch = { textures, formats, compressed, rows };
+    job_system_parallel_for(jobs,row_count,4,compress_rows,&batch);
+    free(rows);
+
+    if(stats) {
+        stats->texture_count = count;
+        stats->texel_count = texel_count;
+        stats->compressed_bytes = compressed_bytes;
+        stats->seconds = timer_now() - start;
+    }
+}
+
+void texture_compressed_free(CompressedTexture* textures,u32 count) {
+    for(u32 i = 0; i < count; i++) {
+        free(textures[i].blocks);
+        textures[i].blocks = NULL;
+    }
+}
+
+f64 texture_psnr(const DecodedTexture* source,const CompressedTexture* compressed,u32 mip) {
+    const TextureMip* level = &source->mips[mip];
+    u32 channels = format_channels(compressed->format);
+    u32 across = blocks_across(level->width), block_size = texture_format_block_size(compressed->format);
+    const u8* blocks = compressed->blocks + compressed->mips[mip].offset;
+    u8 original[BLOCK_TEXELS * 4], decoded[BLOCK_TEXELS * 4];
+    f64 squared = 0.0;
+    for(u32 by = 0; by < blocks_across(level->height); by++)
+        for(u32 bx = 0; bx < across; bx++) {
+            fetch_block(source,mip,bx,by,original);
+            texture_decompress_block(compressed->format,blocks + ((u64)by * across + bx) * block_size,decoded);
+            for(u32 y = 0; y < 4 && by * 4 + y < level->height; y++)
+                for(u32 x = 0; x < 4 && bx * 4 + x < level->width; x++)
+                    for(u32 c = 0; c < channels; c++) {
+                        f64 d = (f64)original[(y * 4 + x) * 4 + c] - decoded[(y * 4 + x) * 4 + c];
+                        squared += d * d;
+                    }
+        }
+    f64 mse = squared / ((f64)level->width * level->height * channels);
+    return mse > 0.0 ? 10.0 * log10(255.0 * 255.0 / mse) : 99.0;
+}
+
+void texture_compress_stats_print(const TextureCompressStats* stats,u32 thread_count) {
+    f64 seconds = stats->seconds > 0.0 ? stats->seconds : 1e-9;
+    printf("[TEXTURE] compressed %u images on %u threads in %.3f ms, %.2f Mtexels/s, %.2f MB of blocks\n",stats->texture_count,thread_count,
+           stats->seconds * 1000.0,stats->texel_count / seconds / 1e6,stats->compressed_bytes / (1024.0 * 1024.0));
+}
+
+bool texture_cache_key(const TextureSource* source,TextureFormat format,MipMode mip_mode,u64* key) {
+    u64 hash;
+    if(source->data)
+        hash = hash_fnv1a(source->data,source->size,HASH_FNV_SEED);
+    else if(!hash_file(source->path,&hash))
+        return false;
+    u32 tag[3] = { format, mip_mode, TEXTURE_CACHE_VERSION };
+    *key = hash_fnv1a(tag,sizeof(tag),hash);
+    return true;
+}
+
+void texture_cache_path(const char* directory,u64 key,char* path,u32 capacity) {
+    make_directory(directory);
+    snprintf(path,capacity,"%s/%016llx" TEXTURE_CACHE_EXTENSION,directory,(unsigned long long)key);
+}
+
+typedef struct {
+    u32 magic;
+    u32 version;
+    u64 key;
+    u32 format;
+    u32 width;
+    u32 height;
+    u32 mip_count;
+    TextureMip mips[TEXTURE_MAX_MIPS];
+    u64 blocks_size;
+}CacheHeader;
+
+bool texture_cache_write(const char* path,u64 key,const CompressedTexture* texture) {
+    CacheHeader header;
+    memset(&header,0,sizeof(CacheHeader));
+    header.magic = TEXTURE_CACHE_MAGIC;
+    header.version = TEXTURE_CACHE_VERSION;
+    header.key = key;
+    header.format = texture->format;
+    header.width = texture->width;
+    header.height = texture->height;
+    header.mip_count = texture->mip_count;
+    memcpy(header.mips,texture->mips,sizeof(header.mips));
+    header.blocks_size = texture->blocks_size;
+
+    return file_write_atomic(path,&header,sizeof(CacheHeader),texture->blocks,texture->blocks_size);
+}
+
+bool texture_cache_load(const char* path,u64 key,CompressedTexture* texture) {
+    FILE* f = fopen(path,"rb");
+    if(!f)
+        return false;
+    CacheHeader header;
+    bool ok = fread(&header,sizeof(CacheHeader),1,f) == 1 && header.magic == TEXTURE_CACHE_MAGIC &&
+              header.version == TEXTURE_CACHE_VERSION && header.key == key && header.format < TEXTURE_FORMAT_COUNT &&
+              header.mip_count && header.mip_count <= TEXTURE_MAX_MIPS;
+
+    // levels must be the blocks their size needs, back to back
+    u64 total = 0;
+    for(u32 mip = 0; ok && mip < header.mip_count; mip++) {
+        const TextureMip* level = &header.mips[mip];
+        ok = level->width && level->height && level->offset == total &&
+             level->size == (u64)blocks_across(level->width) * blocks_across(level->height) * texture_format_block_size(header.format);
+        total += level->size;
+    }
+    ok = ok && total == header.blocks_size;
+
+    u8* blocks = ok ? malloc(header.blocks_size) : NULL;
+    ok = ok && blocks && fread(blocks,1,header.blocks_size,f) == header.blocks_size;
+    fclose(f);
+    if(!ok) {
+        free(blocks);
+        return false;
+    }
+
+    memset(texture,0,sizeof(CompressedTexture));
+    texture->blocks = blocks;
+    texture->blocks_size = header.blocks_size;
+    texture->format = header.format;
+    texture->width = header.width;
+    texture->height = header.height;
+    texture->mip_count = header.mip_count;
+    memcpy(texture->mips,header.mips,sizeof(header.mips));
+    return true;
+}
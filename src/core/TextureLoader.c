@@ -0,0 +1,120 @@
+#include "TextureLoader.h"
+#include "MipGenerator.h"
+#include "Timer.h"
+#include "stb_image.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    const TextureSource* sources;
+    DecodedTexture* textures;
+    u64* encoded_sizes;
+    bool generate_mips;
+}DecodeBatch;
+
+u32 texture_mip_count(u32 width,u32 height) {
+    u32 largest = width > height ? width : height;
+    u32 count = 1;
+    while(largest > 1 && count < TEXTURE_MAX_MIPS) {
+        largest >>= 1;
+        ++count;
+    }
+    return count;
+}
+
+static u8* read_file_bytes(const char* path,u64* size) {
+    FILE* f = fopen(path,"rb");
+    if(!f) return NULL;
+    fseek(f,0,SEEK_END);
+    long length = ftell(f);
+    fseek(f,0,SEEK_SET);
+    u8* bytes = length > 0 ? malloc(length) : NULL;
+    if(bytes && fread(bytes,1,length,f) != (size_t)length) {
+        free(bytes);
+        bytes = NULL;
+    }
+    fclose(f);
+    *size = bytes ? (u64)length : 0;
+    return bytes;
+}
+
+static void decode_texture(const TextureSource* source,bool generate_mips,DecodedTexture* texture,u64* encoded_size) {
+    memset(texture,0,sizeof(DecodedTexture));
+
+    const u8* encoded = source->data;
+    u64 size = source->size;
+    u8* file_bytes = NULL;
+    if(!encoded) {
+        file_bytes = read_file_bytes(source->path,&size);
+        encoded = file_bytes;
+    }
+    *encoded_size = size;
+    if(!encoded) {
+        fprintf(stderr,"Failed to read texture %s\n",source->path ? source->path : "");
+        return;
+    }
+
+    int width,height,channels;
+    u8* data = stbi_load_from_memory(encoded,(int)size,&width,&height,&channels,0);
+    free(file_bytes);
+    if(!data) {
+        fprintf(stderr,"Failed to decode texture %s: %s\n",source->path ? source->path : "<embedded>",stbi_failure_reason());
+        return;
+    }
+
+    texture->width     = width;
+    texture->height    = height;
+    texture->channels  = channels;
+    texture->mip_count = 1;
+    texture->mips[0]   = (TextureMip){ width, height, 0, (u64)width * height * channels };
+    texture->pixels    = data;
+    texture->pixels_size = texture->mips[0].size;
+
+    // already inside a job of the batch, so the chain is filtered on this thread
+    if(generate_mips)
+        mip_generate(NULL,texture,MIP_MODE_LINEAR);
+}
+
+static void decode_job(void* data,u32 begin,u32 end) {
+    DecodeBatch* batch = (DecodeBatch*)data;
+    for(u32 i = begin; i < end; i++)
+        decode_texture(&batch->sources[i],batch->generate_mips,&batch->textures[i],&batch->encoded_sizes[i]);
+}
+
+void texture_decode_batch(JobSystem* jobs,const TextureSource* sources,u32 count,bool generate_mips,
+                          DecodedTexture* textures,TextureDecodeStats* stats) {
+    f64 start = timer_now();
+    DecodeBatch batch = { sources, textures, calloc(count ? count : 1,sizeof(u64)), generate_mips };
+
+    job_system_parallel_for(jobs,count,1,decode_job,&batch);
+
+    if(stats) {
+        memset(stats,0,sizeof(TextureDecodeStats));
+        stats->image_count = count;
+        for(u32 i = 0; i < count; i++) {
+            stats->encoded_bytes += batch.encoded_sizes[i];
+            stats->decoded_bytes += textures[i].pixels_size;
+            stats->failed_count  += textures[i].pixels == NULL;
+        }
+        stats->seconds = timer_now() - start;
+    }
+    free(batch.encoded_sizes);
+}
+
+void texture_decoded_free(DecodedTexture* textures,u32 count) {
+    for(u32 i = 0; i < count; i++) {
+        free(textures[i].pixels);
+        textures[i].pixels = NULL;
+    }
+}
+
+void texture_decode_stats_print(const TextureDecodeStats* stats,u32 thread_count) {
+    f64 seconds = stats->seconds > 0.0 ? stats->seconds : 1e-9;
+    printf("[TEXTURE] decoded %u images (%u failed) on %u threads in %.3f ms\n",
+           stats->image_count,stats->failed_count,thread_count,stats->seconds * 1000.0);
+    printf("[TEXTURE] %.2f images/s, %.2f MB/s encoded in, %.2f MB/s decoded out\n",
+           stats->image_count / seconds,
+           stats->encoded_bytes / (1024.0 * 1024.0) / seconds,
+           stats->decoded_bytes / (1024.0 * 1024.0) / seconds);
+}
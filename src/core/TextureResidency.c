@@ -0,0 +1,255 @@
+#include "TextureResidency.h"
+#include <glad/glad.h>
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+void residency_policy_init(ResidencyPolicy* policy,u64 budget,u32 max_promotions) {
+    memset(policy,0,sizeof(ResidencyPolicy));
+    policy->budget = budget ? budget : ~0ull;
+    policy->max_promotions = max_promotions;
+    policy->lru_oldest = policy->lru_newest = RESIDENCY_NONE;
+}
+
+void residency_policy_free(ResidencyPolicy* policy) {
+    free(policy->entries);
+    free(policy->promoted);
+    free(policy->evicted);
+    free(policy->released);
+    memset(policy,0,sizeof(ResidencyPolicy));
+}
+
+static void lru_remove(ResidencyPolicy* policy,u32 id) {
+    ResidencyEntry* entry = &policy->entries[id];
+    if(entry->older != RESIDENCY_NONE)
+        policy->entries[entry->older].newer = entry->newer;
+    else
+        policy->lru_oldest = entry->newer;
+    if(entry->newer != RESIDENCY_NONE)
+        policy->entries[entry->newer].older = entry->older;
+    else
+        policy->lru_newest = entry->older;
+    entry->older = entry->newer = RESIDENCY_NONE;
+}
+
+static void lru_push_newest(ResidencyPolicy* policy,u32 id) {
+    ResidencyEntry* entry = &policy->entries[id];
+    entry->older = policy->lru_newest;
+    entry->newer = RESIDENCY_NONE;
+    if(policy->lru_newest != RESIDENCY_NONE)
+        policy->entries[policy->lru_newest].newer = id;
+    else
+        policy->lru_oldest = id;
+    policy->lru_newest = id;
+}
+
+u32 residency_policy_add(ResidencyPolicy* policy,u64 size,u64 fallback_size) {
+    assert(!policy->in_frame && fallback_size <= size);
+    if(policy->count == policy->capacity) {
+        policy->capacity = policy->capacity ? policy->capacity * 2 : 64;
+        policy->entries = realloc(policy->entries,policy->capacity * sizeof(ResidencyEntry));
+        policy->promoted = realloc(policy->promoted,policy->capacity * sizeof(u32));
+        policy->evicted = realloc(policy->evicted,policy->capacity * sizeof(u32));
+        policy->released = realloc(policy->released,policy->capacity * sizeof(u32));
+    }
+    u32 id = policy->count++;
+    ResidencyEntry* entry = &policy->entries[id];
+    memset(entry,0,sizeof(ResidencyEntry));
+    entry->size = size;
+    entry->fallback_size = fallback_size;
+    entry->older = entry->newer = RESIDENCY_NONE;
+    entry->state = size == fallback_size ? RESIDENCY_PINNED : RESIDENCY_RESIDENT;
+    policy->resident_bytes += fallback_size;
+    if(entry->state == RESIDENCY_RESIDENT) {
+        policy->resident_bytes += size;
+        lru_push_newest(policy,id);
+    }
+    return id;
+}
+
+static void residency_evict(ResidencyPolicy* policy,u32 id) {
+    ResidencyEntry* entry = &policy->entries[id];
+    lru_remove(policy,id);
+    entry->state = RESIDENCY_RELEASING;
+    entry->release_frame = policy->frame + RESIDENCY_RELEASE_DELAY;
+    policy->resident_bytes -= entry->size;
+    policy->releasing_bytes += entry->size;
+    policy->evicted[policy->evicted_count++] = id;
+    ++policy->stats.evictions;
+}
+
+// evicts from the old end of the LRU until size more bytes fit once the releasing chains are gone, the list is in
+// last use order so it stops at the first texture this frame touched
+static bool residency_make_room(ResidencyPolicy* policy,u64 size) {
+    while(policy->resident_bytes + size > policy->budget) {
+        u32 oldest = policy->lru_oldest;
+        if(oldest == RESIDENCY_NONE || policy->entries[oldest].last_used == policy->frame)
+            return false;
+        residency_evict(policy,oldest);
+    }
+    return true;
+}
+
+// releasing chains stay resident in GL until their release, new bytes only fit next to them
+static bool residency_fits(const ResidencyPolicy* policy,u64 size) {
+    return policy->resident_bytes + policy->releasing_bytes + size <= policy->budget;
+}
+
+void residency_policy_begin_frame(ResidencyPolicy* policy) {
+    assert(!policy->in_frame);
+    ++policy->frame;
+    policy->in_frame = true;
+    policy->promotions_left = policy->max_promotions;
+    policy->promoted_count = policy->evicted_count = policy->released_count = 0;
+    for(u32 i = 0; i < policy->count; i++) {
+        ResidencyEntry* entry = &policy->entries[i];
+        if(entry->state != RESIDENCY_RELEASING || entry->release_frame > policy->frame)
+            continue;
+        entry->state = RESIDENCY_EVICTED;
+        policy->releasing_bytes -= entry->size;
+        policy->released[policy->released_count++] = i;
+        ++policy->stats.releases;
+    }
+}
+
+bool residency_policy_touch(ResidencyPolicy* policy,u32 id) {
+    assert(policy->in_frame && id < policy->count);
+    ResidencyEntry* entry = &policy->entries[id];
+    if(entry->last_used == policy->frame)
+        return entry->state == RESIDENCY_RESIDENT || entry->state == RESIDENCY_PINNED;
+    entry->last_used = policy->frame;
+    ++policy->stats.touches;
+
+    if(entry->state == RESIDENCY_PINNED) {
+        ++policy->stats.hits;
+        return true;
+    }
+    if(entry->state == RESIDENCY_RESIDENT) {
+        lru_remove(policy,id);
+        lru_push_newest(policy,id);
+        ++policy->stats.hits;
+        return true;
+    }
+
+    // a releasing chain is still resident in GL, taking it back costs no promotion and no new bytes. An evicted one
+    // waits on its fallback until the chains evicted to make room for it are released
+    bool releasing = entry->state == RESIDENCY_RELEASING;
+    if((!releasing && !policy->promotions_left) || !residency_make_room(policy,entry->size) ||
+       (!releasing && !residency_fits(policy,entry->size))) {
+        ++policy->stats.fallbacks;
+        return false;
+    }
+    if(releasing)
+        policy->releasing_bytes -= entry->size;
+    else
+        --policy->promotions_left;
+    entry->state = RESIDENCY_RESIDENT;
+    policy->resident_bytes += entry->size;
+    lru_push_newest(policy,id);
+    policy->promoted[policy->promoted_count++] = id;
+    ++policy->stats.promotions;
+    return true;
+}
+
+void residency_policy_end_frame(ResidencyPolicy* policy) {
+    assert(policy->in_frame);
+    residency_make_room(policy,0);
+    if(!residency_fits(policy,0))
+        ++policy->stats.over_budget_frames;
+    u64 bytes = policy->resident_bytes + policy->releasing_bytes;
+    if(bytes > policy->stats.peak_bytes)
+        policy->stats.peak_bytes = bytes;
+    ++policy->stats.frames;
+    policy->in_frame = false;
+}
+
+void residency_stats_print(const ResidencyStats* stats,u64 budget) {
+    f64 frames = stats->frames ? (f64)stats->frames : 1.0;
+    char budget_text[32] = "unlimited";
+    if(budget && budget != ~0ull)
+        snprintf(budget_text,sizeof(budget_text),"%.1f MB",budget / (1024.0 * 1024.0));
+    printf("[RESIDENCY] %llu frames, %.1f textures touched per frame, %.2f%% hits, %.2f promotions, %.2f fallbacks and %.2f evictions per frame\n",
+           (unsigned long long)stats->frames,stats->touches / frames,stats->touches ? 100.0 * stats->hits / stats->touches : 100.0,
+           stats->promotions / frames,stats->fallbacks / frames,stats->evictions / frames);
+    printf("[RESIDENCY] peak %.1f MB with chains awaiting release, %s budget, %llu frames over it\n",stats->peak_bytes / (1024.0 * 1024.0),budget_text,
+           (unsigned long long)stats->over_budget_frames);
+}
+
+u32 residency_fallback_level(u32 width,u32 height,u32 mip_count) {
+    u32 level = 0;
+    while(level + 1 < mip_count && (width > RESIDENCY_FALLBACK_SIZE || height > RESIDENCY_FALLBACK_SIZE)) {
+        width = width > 1 ? width / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
+        ++level;
+    }
+    return level;
+}
+
+void texture_residency_init(TextureResidency* residency,u64 budget,u32 max_promotions) {
+    residency_policy_init(&residency->policy,budget,max_promotions);
+    residency->bindings = NULL;
+    residency->capacity = 0;
+}
+
+void texture_residency_free(TextureResidency* residency) {
+    residency_policy_free(&residency->policy);
+    free(residency->bindings);
+    residency->bindings = NULL;
+    residency->capacity = 0;
+}
+
+u32 texture_residency_add(TextureResidency* residency,u32 buffer,u32 slot,const ResidentTexture* texture) {
+    u64 fallback_size = texture->handle == texture->fallback_handle ? texture->size : texture->fallback_size;
+    u32 id = residency_policy_add(&residency->policy,texture->size,fallback_size);
+    if(id == residency->capacity) {
+        residency->capacity = residency->policy.capacity;
+        residency->bindings = realloc(residency->bindings,residency->capacity * sizeof(ResidencyBinding));
+    }
+    ResidencyBinding* binding = &residency->bindings[id];
+    binding->texture = *texture;
+    binding->buffer = buffer;
+    binding->slot = slot;
+    binding->resident = true;
+    return id;
+}
+
+void texture_residency_begin_frame(TextureResidency* residency) {
+    residency_policy_begin_frame(&residency->policy);
+}
+
+bool texture_residency_touch(TextureResidency* residency,u32 id) {
+    return residency_policy_touch(&residency->policy,id);
+}
+
+static void texture_residency_write_slot(const ResidencyBinding* binding,GLuint64 handle) {
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER,binding->buffer);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER,binding->slot * sizeof(GLuint64),sizeof(GLuint64),&handle);
+}
+
+void texture_residency_apply(TextureResidency* residency) {
+    ResidencyPolicy* policy = &residency->policy;
+    residency_policy_end_frame(policy);
+
+    // a chain released and promoted in the same frame simply stays resident
+    for(u32 i = 0; i < policy->released_count; i++) {
+        ResidencyBinding* binding = &residency->bindings[policy->released[i]];
+        if(policy->entries[policy->released[i]].state == RESIDENCY_RESIDENT || !binding->resident)
+            continue;
+        glMakeTextureHandleNonResidentARB(binding->texture.handle);
+        binding->resident = false;
+    }
+    // evicted first, a chain evicted and taken back in the same frame ends up on its full handle
+    for(u32 i = 0; i < policy->evicted_count; i++)
+        texture_residency_write_slot(&residency->bindings[policy->evicted[i]],residency->bindings[policy->evicted[i]].texture.fallback_handle);
+    for(u32 i = 0; i < policy->promoted_count; i++) {
+        ResidencyBinding* binding = &residency->bindings[policy->promoted[i]];
+        if(!binding->resident) {
+            glMakeTextureHandleResidentARB(binding->texture.handle);
+            binding->resident = true;
+        }
+        texture_residency_write_slot(binding,binding->texture.handle);
+    }
+    if(policy->evicted_count || policy->promoted_count)
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER,0);
+}
@@ -0,0 +1,23 @@
+#include "Timer.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+
+f64 timer_now(void) {
+    static LARGE_INTEGER frequency = {0};
+    if(!frequency.QuadPart)
+        QueryPerformanceFrequency(&frequency);
+
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+    return (f64)counter.QuadPart / (f64)frequency.QuadPart;
+}
+#else
+#include <time.h>
+
+f64 timer_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return (f64)ts.tv_sec + (f64)ts.tv_nsec * 1e-9;
+}
+#endif
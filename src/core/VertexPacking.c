@@ -0,0 +1,255 @@
+#include "VertexPacking.h"
+#include <math.h>
+#include <float.h>
+#include <string.h>
+
+#define PACK_BATCH_SIZE 4096
+
+typedef struct {
+    const Vertex* verticies;
+    PackedVertex* packed;
+    SkinVertex* skin;
+}PackBatch;
+
+u16 float_to_half(f32 value) {
+    u32 bits;
+    memcpy(&bits,&value,sizeof(bits));
+
+    u32 sign = (bits >> 16) & 0x8000;
+    i32 exponent = (i32)((bits >> 23) & 0xff) - 127 + 15;
+    u32 mantissa = bits & 0x007fffff;
+
+    if(((bits >> 23) & 0xff) == 0xff) // inf / nan
+        return (u16)(sign | 0x7c00 | (mantissa ? 0x200 : 0));
+    if(exponent >= 0x1f)
+        return (u16)(sign | 0x7c00);
+    if(exponent <= 0) {
+        if(exponent < -10)
+            return (u16)sign;
+        // denormal, round to nearest even
+        mantissa |= 0x00800000;
+        u32 shift = (u32)(14 - exponent);
+        u32 half_mantissa = mantissa >> shift;
+        u32 remainder = mantissa & ((1u << shift) - 1);
+        u32 halfway = 1u << (shift - 1);
+        if(remainder > halfway || (remainder == halfway && (half_mantissa & 1)))
+            ++half_mantissa;
+        return (u16)(sign | half_mantissa);
+    }
+
+    u32 half = sign | ((u32)exponent << 10) | (mantissa >> 13);
+    u32 remainder = mantissa & 0x1fff;
+    // a carry out of the mantissa correctly bumps the exponent
+    if(remainder > 0x1000 || (remainder == 0x1000 && (half & 1)))
+        ++half;
+    return (u16)half;
+}
+
+f32 half_to_float(u16 value) {
+    u32 sign = (u32)(value & 0x8000) << 16;
+    u32 exponent = (value >> 10) & 0x1f;
+    u32 mantissa = value & 0x3ff;
+    u32 bits;
+
+    if(exponent == 0) {
+        if(!mantissa) {
+            bits = sign;
+        } else {
+            exponent = 127 - 15 + 1;
+            while(!(mantissa & 0x400)) {
+                mantissa <<= 1;
+                --exponent;
+            }
+            bits = sign | (exponent << 23) | ((mantissa & 0x3ff) << 13);
+        }
+    } else if(exponent == 0x1f) {
+        bits = sign | 0x7f800000 | (mantissa << 13);
+    } else {
+        bits = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+    }
+
+    f32 result;
+    memcpy(&result,&bits,sizeof(result));
+    return result;
+}
+
+i16 float_to_snorm16(f32 value) {
+    if(value > 1.0f) value = 1.0f;
+    if(value < -1.0f) value = -1.0f;
+    return (i16)lrintf(value * 32767.0f);
+}
+
+f32 snorm16_to_float(i16 value) {
+    f32 result = value / 32767.0f;
+    return result < -1.0f ? -1.0f : result;
+}
+
+static f32 sign_not_zero(f32 value) {
+    return value >= 0.0f ? 1.0f : -1.0f;
+}
+
+static void oct_wrap(f32* x,f32* y,f32 z) {
+    if(z < 0.0f) {
+        f32 ox = *x, oy = *y;
+        *x = (1.0f - fabsf(oy)) * sign_not_zero(ox);
+        *y = (1.0f - fabsf(ox)) * sign_not_zero(oy);
+    }
+}
+
+void oct_decode(const i16 e[2],f32 dest[3]) {
+    f32 x = snorm16_to_float(e[0]);
+    f32 y = snorm16_to_float(e[1]);
+    f32 z = 1.0f - fabsf(x) - fabsf(y);
+    oct_wrap(&x,&y,z);
+
+    f32 length = sqrtf(x * x + y * y + z * z);
+    dest[0] = x / length;
+    dest[1] = y / length;
+    dest[2] = z / length;
+}
+
+void oct_encode(const f32 v[3],i16 dest[2]) {
+    f32 length = fabsf(v[0]) + fabsf(v[1]) + fabsf(v[2]);
+    if(length == 0.0f) {
+        dest[0] = 0;
+        dest[1] = 0;
+        return;
+    }
+
+    f32 x = v[0] / length;
+    f32 y = v[1] / length;
+    oct_wrap(&x,&y,v[2]);
+
+    f32 norm = sqrtf(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+    f32 n[3] = { v[0] / norm, v[1] / norm, v[2] / norm };
+    f32 best_distance = FLT_MAX;
+    f32 fx = floorf(x * 32767.0f), fy = floorf(y * 32767.0f);
+
+    // try the four neighbouring grid points instead of plain rounding. Compared by distance, a float dot product
+    // of two directions a grid step apart rounds to 1 and cannot tell them apart
+    for(int i = 0; i < 4; i++) {
+        f32 cx = (fx + (i & 1)) / 32767.0f;
+        f32 cy = (fy + (i >> 1)) / 32767.0f;
+        i16 candidate[2] = { float_to_snorm16(cx), float_to_snorm16(cy) };
+        f32 decoded[3];
+        oct_decode(candidate,decoded);
+        f32 distance = (decoded[0] - n[0]) * (decoded[0] - n[0]) + (decoded[1] - n[1]) * (decoded[1] - n[1]) +
+                       (decoded[2] - n[2]) * (decoded[2] - n[2]);
+        if(distance < best_distance) {
+            best_distance = distance;
+            dest[0] = candidate[0];
+            dest[1] = candidate[1];
+        }
+    }
+}
+
+// the second component keeps the handedness as its sign: y' = y/2 + w/2, which never lands on 0 for w < 0
+void tangent_encode(const f32 tangent[4],i16 dest[2]) {
+    i16 oct[2];
+    oct_encode(tangent,oct);
+    f32 w = tangent[3] < 0.0f ? -1.0f : 1.0f;
+
+    dest[0] = oct[0];
+    dest[1] = float_to_snorm16(snorm16_to_float(oct[1]) * 0.5f + w * 0.5f);
+    if(w < 0.0f && dest[1] == 0)
+        dest[1] = -1;
+}
+
+void tangent_decode(const i16 e[2],f32 dest[4]) {
+    f32 y = snorm16_to_float(e[1]);
+    f32 w = y >= 0.0f ? 1.0f : -1.0f;
+    y = y * 2.0f - w;
+
+    i16 oct[2] = { e[0], float_to_snorm16(y) };
+    oct_decode(oct,dest);
+    dest[3] = w;
+}
+
+static u8 float_to_unorm8(f32 value) {
+    if(value > 1.0f) value = 1.0f;
+    if(value < 0.0f) value = 0.0f;
+    return (u8)lrintf(value * 255.0f);
+}
+
+static u16 float_to_unorm16(f32 value) {
+    if(value > 1.0f) value = 1.0f;
+    if(value < 0.0f) value = 0.0f;
+    return (u16)lrintf(value * 65535.0f);
+}
+
+void pack_vertex(const Vertex* vertex,PackedVertex* packed) {
+    memcpy(packed->position,vertex->position,sizeof(vec3));
+    oct_encode(vertex->normal,packed->normal);
+    tangent_encode(vertex->tangent,packed->tangent);
+    for(int i = 0; i < 2; i++) {
+        packed->uv0[i] = float_to_half(vertex->uv0[i]);
+        packed->uv1[i] = float_to_half(vertex->uv1[i]);
+    }
+    for(int i = 0; i < 4; i++)
+        packed->color[i] = float_to_unorm8(vertex->color[i]);
+}
+
+void unpack_vertex(const PackedVertex* packed,const SkinVertex* skin,Vertex* vertex) {
+    memset(vertex,0,sizeof(Vertex));
+    memcpy(vertex->position,packed->position,sizeof(vec3));
+    oct_decode(packed->normal,vertex->normal);
+    tangent_decode(packed->tangent,vertex->tangent);
+    for(int i = 0; i < 2; i++) {
+        vertex->uv0[i] = half_to_float(packed->uv0[i]);
+        vertex->uv1[i] = half_to_float(packed->uv1[i]);
+    }
+    for(int i = 0; i < 4; i++)
+        vertex->color[i] = packed->color[i] / 255.0f;
+
+    if(skin) {
+        memcpy(&vertex->joint_ids,skin->joint_ids,sizeof(u64));
+        for(int i = 0; i < 4; i++)
+            vertex->weights[i] = skin->weights[i] / 65535.0f;
+    }
+}
+
+static void pack_job(void* data,u32 begin,u32 end) {
+    PackBatch* batch = (PackBatch*)data;
+    for(u32 i = begin; i < end; i++) {
+        const Vertex* vertex = &batch->verticies[i];
+        pack_vertex(vertex,&batch->packed[i]);
+        if(batch->skin) {
+            memcpy(batch->skin[i].joint_ids,&vertex->joint_ids,sizeof(u64));
+            for(int j = 0; j < 4; j++)
+                batch->skin[i].weights[j] = float_to_unorm16(vertex->weights[j]);
+        }
+    }
+}
+
+void scene_pack_vertices(JobSystem* jobs,Scene* scene,bool has_skin,u32 first_culled_command,u32 first_non_culled_command) {
+    u32 first = scene->packed_vertex_vector.size;
+    u32 count = scene->vertex_vector.size;
+    bool skinned = has_skin || scene->skin_vertex_vector.size;
+
+    if(first + count >= scene->packed_vertex_vector.capacity)
+        vector_reserve(scene->packed_vertex_vector,PackedVertex,first + count + 1);
+    scene->packed_vertex_vector.size = first + count;
+    if(skinned) {
+        // earlier imports without skin get zero weights so the skin verticies keep lining up with the packed ones
+        u32 skin_first = scene->skin_vertex_vector.size;
+        if(first + count >= scene->skin_vertex_vector.capacity)
+            vector_reserve(scene->skin_vertex_vector,SkinVertex,first + count + 1);
+        memset(scene->skin_vertex_vector.data + skin_first,0,(u64)(first - skin_first) * sizeof(SkinVertex));
+        scene->skin_vertex_vector.size = first + count;
+    }
+
+    PackBatch batch = {
+        scene->vertex_vector.data,
+        scene->packed_vertex_vector.data + first,
+        skinned ? scene->skin_vertex_vector.data + first : NULL
+    };
+    job_system_parallel_for(jobs,count,PACK_BATCH_SIZE,pack_job,&batch);
+
+    for(u32 i = first_culled_command; i < scene->culled_backface_indirect_command_vector.size; i++)
+        scene->culled_backface_indirect_command_vector.data[i].baseVertex += first;
+    for(u32 i = first_non_culled_command; i < scene->non_culled_backface_indirect_command_vector.size; i++)
+        scene->non_culled_backface_indirect_command_vector.data[i].baseVertex += first;
+
+    vector_free(scene->vertex_vector);
+    vector_create(scene->vertex_vector,Vertex);
+}
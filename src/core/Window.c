@@ -2,6 +2,7 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include <stdlib.h>
+#include <stdio.h>
 #include <cglm/cglm.h>
 
 #define MOUSE_MOVED  0b00000001
@@ -64,8 +65,10 @@ Window* windowCreate(i32 width,i32 height,const char* title) {
     window->title      = title;
     window->flags     |= FIRST_MOUSE | MOUSE_LOCKED;
 
-    if (!window->windPtr)
+    if (!window->windPtr) {
+        free(window);
         return NULL;
+    }
 
     glfwSetInputMode(window->windPtr, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
     glfwMakeContextCurrent(window->windPtr);
@@ -75,6 +78,38 @@ Window* windowCreate(i32 width,i32 height,const char* title) {
     return window;
 }
 
+Window* windowCreateHeadless(i32 width,i32 height,const char* title) {
+    static const struct {
+        int platform;
+        int context_api;
+        const char* name;
+    } attempts[] = {
+        { GLFW_PLATFORM_NULL, GLFW_EGL_CONTEXT_API, "surfaceless EGL" },
+        { GLFW_PLATFORM_NULL, GLFW_OSMESA_CONTEXT_API, "OSMesa" },
+        { GLFW_ANY_PLATFORM, GLFW_NATIVE_CONTEXT_API, "hidden window" }
+    };
+
+    for(u32 i = 0; i < sizeof(attempts) / sizeof(attempts[0]); i++) {
+        glfwInitHint(GLFW_PLATFORM,attempts[i].platform);
+        if(!glfwInit())
+            continue;
+
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 5);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+        glfwWindowHint(GLFW_CONTEXT_CREATION_API,attempts[i].context_api);
+        glfwWindowHint(GLFW_VISIBLE,GLFW_FALSE);
+
+        Window* window = windowCreate(width,height,title);
+        if(window) {
+            printf("[WINDOW] Headless context: %s\n",attempts[i].name);
+            return window;
+        }
+        glfwTerminate();
+    }
+    return NULL;
+}
+
 void windowDestroy(Window* window) {
     glfwDestroyWindow(window->windPtr);
     free(window);
@@ -143,3 +178,6 @@ i32 windowKeyState(Window* window,i32 key) {
     return glfwGetKey(window->windPtr,key); 
 }
 
+i32 windowMouseButtonState(Window* window,i32 button) {
+    return glfwGetMouseButton(window->windPtr,button);
+}
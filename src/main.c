@@ -7,17 +7,22 @@
 #include <stdbool.h>
 #include <string.h>
 #include <stddef.h>
+#include <float.h>
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 
-#define VISUAL_STUDIO
-#undef VISUAL_STUDIO
-#if defined(VISUAL_STUDIO) 
-#define asset_path(str) "../../../assets/" str
-#define path(str) "../../../" str
-#else
-#define asset_path(str) "../assets/" str
-#define path(str) "../" str
+#define HEADLESS_WIDTH 1280
+#define HEADLESS_HEIGHT 720
+#define HEADLESS_TIMESTEP (1.0f / 60.0f)
+#define FRAME_BENCH_WARMUP 16 // frames rendered at the start of the path before timing starts
+#define CAMERA_RECORD_INTERVAL 0.25f
+
+// S3TC is an extension glad was not generated with, the values are fixed by EXT_texture_compression_s3tc
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
 #endif
 
 #define CGLTF_IMPLEMENTATION
@@ -28,11 +33,32 @@
 #include "Global.h"
 #include "Arena.h"
 #include "Vector.h"
-
-typedef struct {
-    vec3 min;
-    vec3 max;
-} AABB;
+#include "Scene.h"
+#include "SceneCache.h"
+#include "JobSystem.h"
+#include "TextureLoader.h"
+#include "TextureCompress.h"
+#include "MipGenerator.h"
+#include "TextureResidency.h"
+#include "Timer.h"
+#include "VertexPacking.h"
+#include "MeshOptimizer.h"
+#include "Meshlet.h"
+#include "Culling.h"
+#include "BVH.h"
+#include "Raycast.h"
+#include "CameraPath.h"
+#include "FrameCapture.h"
+#include "FrameStats.h"
+#include "Profiler.h"
+#include "Shader.h"
+#include "StreamBuffer.h"
+#include "LightCluster.h"
+#include "ShadowCascades.h"
+#include "IBLCache.h"
+#include "SphericalHarmonics.h"
+#include "IBLBaker.h"
+#include "bench/Bench.h"
 
 void str_concat(const char* s1,const char* s2,char* dest) {
     u32 len1 = strlen(s1);
@@ -52,136 +78,51 @@ void dir_parent(const char* src,char* dest) {
 
 static vec4 white = {1.0f,1.0f,1.0f,1.0f};
 
-typedef struct {
-    u32 count;
-    u32 instanceCount;
-    u32 firstIndex;
-    u32 baseVertex;
-    u32 baseInstance;
-} DrawElementsIndirectCommand;
-
-typedef struct {
-    vec4 color;
-    vec4 tangent;
-    vec4 weights;
-    vec3 position;
-    vec3 normal;
-    vec2 uv0;
-    vec2 uv1;
-    u64 joint_ids;
-}Vertex;
-
-typedef struct {
-    vec4 color_intensity;
-    vec4 pos; 
-    vec4 attenuation_factors; // vec4 due to paddings
-}PointLight;
-
-#define set_alpha_mode_opaque(material) material.flags &= 0xfffffffc
-#define set_alpha_mode_mask(material) material.flags = (material.flags & 0xfffffffc) | 0xfffffffd
-#define set_alpha_mode_blend(material) material.flags = (material.flags & 0xfffffffc) | 0xfffffffe
-
-#define alpha_mode_opaque(material) !(material.flags & 0)
-#define alpha_mode_mask(material) (material.flags & 0x00000001)
-#define alpha_mode_blend(material) (material.flags & 0x00000002)
-
-typedef struct {
-    vec4 base_color;
-    vec4 base_color_factor;
-    vec3 emissive_factor;
-    float metalic_factor;
-    float alpha_cutoff;
-    float roughness_factor;
-    int32_t base_color_texture_index;
-    int32_t metalic_texture_index;
-    int32_t normal_texture_index;
-    int32_t occlusion_texture_index;
-    int32_t emissive_texture_index;
-    uint32_t flags;
-}Material;
-
-typedef struct {
-    vector(Vertex) vertex_vector;
-    vector(uint32_t) index_vector;
-    vector(DrawElementsIndirectCommand) culled_backface_indirect_command_vector;
-    vector(DrawElementsIndirectCommand) non_culled_backface_indirect_command_vector;
-    vector(GLuint64) texture_handle_vector;
-    vector(Material) material_vector;
-    vector(uint32_t) culled_command_material_index_vector;
-    vector(uint32_t) non_culled_command_material_index_vector;
-    vector(PointLight) point_light_vector;
-    AABB aabb;
-    u32 vertex_array;
-    u32 vertex_buffer;
-    u32 index_buffer;
-    u32 culled_backface_indirect_command_buffer;
-    u32 non_culled_backface_indirect_command_buffer;
-    u32 texture_handles_buffer;
-    u32 material_buffer;
-    u32 culled_command_material_index_buffer;
-    u32 non_culled_command_material_index_buffer;
-    u32 point_light_buffer;
-}Scene;
-
-GLuint64 bindless_texture_from_file(const char* img_path,const cgltf_sampler* sampler) { 
-    int width,height,channels;
-    unsigned char* data = stbi_load(img_path,&width,&height,&channels,0);
-    GLenum format = GL_RGBA;
-
-    if (channels == 1)
-        format = GL_RED;
-    else if (channels == 2)
-        format = GL_RG;
-    else if(channels == 3)
-        format = GL_RGB;
-    else if(channels == 4)
-        format = GL_RGBA;
-
+// an immutable texture with storage for every level and the glTF sampler of ref, bound to GL_TEXTURE_2D
+GLuint scene_texture_create(const SceneTextureRef* ref,GLenum internal_format,u32 width,u32 height,u32 mip_count) {
     GLuint tex;
     glGenTextures(1, &tex);
     glBindTexture(GL_TEXTURE_2D, tex);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, sampler ? sampler->wrap_s : GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, sampler ? sampler->wrap_t : GL_REPEAT);
-
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, sampler ? sampler->min_filter : GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, sampler ? sampler->mag_filter : GL_NEAREST);
-    glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format,GL_UNSIGNED_BYTE, data);
-    glGenerateMipmap(GL_TEXTURE_2D);
-    stbi_image_free(data);
+    glTexStorage2D(GL_TEXTURE_2D, mip_count, internal_format, width, height);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, ref->has_sampler && ref->wrap_s ? ref->wrap_s : GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, ref->has_sampler && ref->wrap_t ? ref->wrap_t : GL_REPEAT);
 
-    GLuint64 handle = glGetTextureHandleARB(tex);
-    glMakeTextureHandleResidentARB(handle);
-    return handle;
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, ref->has_sampler && ref->min_filter ? ref->min_filter : GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, ref->has_sampler && ref->mag_filter ? ref->mag_filter : GL_NEAREST);
+    return tex;
 }
 
-GLuint64 bindless_texture_from_mem(const unsigned char* img_buffer,size_t len,const cgltf_sampler* sampler) { 
-    int width,height,channels;
-    unsigned char* data = stbi_load_from_memory(img_buffer,len,&width,&height,&channels,0);
-    GLenum format = GL_RGBA;
-
-    if(channels == 1)
-        format = GL_RED;
-    else if(channels == 3)
-        format = GL_RGB;
-
-    GLuint tex;
-    glGenTextures(1, &tex);
-    glBindTexture(GL_TEXTURE_2D, tex);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, sampler ? sampler->wrap_s : GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, sampler ? sampler->wrap_t : GL_REPEAT);
-
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, sampler ? sampler->min_filter : GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, sampler ? sampler->mag_filter : GL_NEAREST);
-    glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format,GL_UNSIGNED_BYTE, data);
-    glGenerateMipmap(GL_TEXTURE_2D);
-    stbi_image_free(data);
+// the levels of texture from first_mip down as a resident bindless texture of their own
+GLuint64 bindless_texture_from_decoded(const DecodedTexture* texture,const SceneTextureRef* ref,u32 first_mip) {
+    GLenum format = GL_RGBA, internal_format = GL_RGBA8;
+    if (texture->channels == 1)
+        format = GL_RED, internal_format = GL_R8;
+    else if (texture->channels == 2)
+        format = GL_RG, internal_format = GL_RG8;
+    else if(texture->channels == 3)
+        format = GL_RGB, internal_format = GL_RGB8;
+
+    const TextureMip* first = &texture->mips[first_mip];
+    GLuint tex = scene_texture_create(ref,internal_format,first->width,first->height,texture->mip_count - first_mip);
+
+    // rows are tightly packed, RGB levels are rarely 4 byte aligned
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for(u32 mip = first_mip; mip < texture->mip_count; mip++) {
+        const TextureMip* level = &texture->mips[mip];
+        glTexSubImage2D(GL_TEXTURE_2D, mip - first_mip, 0, 0, level->width, level->height, format, GL_UNSIGNED_BYTE, texture->pixels + level->offset);
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
 
     GLuint64 handle = glGetTextureHandleARB(tex);
     glMakeTextureHandleResidentARB(handle);
     return handle;
 }
 
-GLuint bindless_missing_texture() {
+// one white texel, created the first time it is asked for and shared by every scene
+GLuint64 bindless_missing_texture() {
+    static GLuint64 handle = 0;
+    if(handle)
+        return handle;
     unsigned char data[] = { 255, 255, 255, 255};
 
     GLuint tex;
@@ -192,61 +133,186 @@ GLuint bindless_missing_texture() {
 
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA,GL_UNSIGNED_BYTE, data);
-    glGenerateMipmap(GL_TEXTURE_2D);
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, 1, 1);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, data);
+
+    handle = glGetTextureHandleARB(tex);
+    glMakeTextureHandleResidentARB(handle);
+    return handle;
+}
+
+GLenum compressed_texture_gl_format(TextureFormat format) {
+    switch(format) {
+        case TEXTURE_FORMAT_BC1: return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+        case TEXTURE_FORMAT_BC3: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+        case TEXTURE_FORMAT_BC4: return GL_COMPRESSED_RED_RGTC1;
+        case TEXTURE_FORMAT_BC5: return GL_COMPRESSED_RG_RGTC2;
+        default:                 return GL_COMPRESSED_RGBA_BPTC_UNORM;
+    }
+}
+
+GLuint64 bindless_texture_from_compressed(const CompressedTexture* texture,const SceneTextureRef* ref,u32 first_mip) {
+    GLenum format = compressed_texture_gl_format(texture->format);
+    const TextureMip* first = &texture->mips[first_mip];
+    GLuint tex = scene_texture_create(ref,format,first->width,first->height,texture->mip_count - first_mip);
+    for(u32 mip = first_mip; mip < texture->mip_count; mip++) {
+        const TextureMip* level = &texture->mips[mip];
+        glCompressedTexSubImage2D(GL_TEXTURE_2D, mip - first_mip, 0, 0, level->width, level->height, format, level->size, texture->blocks + level->offset);
+    }
 
     GLuint64 handle = glGetTextureHandleARB(tex);
     glMakeTextureHandleResidentARB(handle);
     return handle;
 }
 
-void compute_dir_light_ortho(mat4 view,mat4 proj,mat4 light_view,mat4 ortho) {
-    vec4 corners[8] = { 
-        {-1.0f, -1.0f, 1.0f, 1.0f}, {-1.0f, -1.0f, -1.0f, 1.0f}, {-1.0f, 1.0f, 1.0f, 1.0f}, {-1.0f, 1.0f, -1.0f, 1.0f},
-        { 1.0f, -1.0f, 1.0f, 1.0f}, { 1.0f, -1.0f, -1.0f, 1.0f}, { 1.0f, 1.0f, 1.0f, 1.0f}, { 1.0f, 1.0f, -1.0f, 1.0f} 
-    };
+// appends a texture's slot to the scene, with the sizes of its full chain and of the mip tail from fallback_mip
+// that stays resident when the residency manager evicts the chain
+void scene_texture_push(Scene* scene,GLuint64 handle,GLuint64 fallback_handle,const TextureMip* mips,u32 mip_count,u32 fallback_mip) {
+    ResidentTexture texture = { .handle = handle, .fallback_handle = fallback_handle };
+    for(u32 mip = 0; mip < mip_count; mip++) {
+        texture.size += mips[mip].size;
+        if(mip >= fallback_mip)
+            texture.fallback_size += mips[mip].size;
+    }
+    vector_push(scene->texture_handle_vector,GLuint64,handle);
+    vector_push(scene->resident_texture_vector,ResidentTexture,texture);
+}
 
-    mat4 inverse_view_proj;
-    glm_mat4_mul(proj,view,inverse_view_proj);
-    glm_mat4_inv(inverse_view_proj,inverse_view_proj); 
-    
-    // transform view frustum into world space
-    for(int i = 0; i < 8; i++) {
-        glm_mat4_mulv(inverse_view_proj,corners[i],corners[i]);
-        glm_vec4_scale(corners[i],1.0f/corners[i][3],corners[i]);
+// an image that failed to decode keeps its slot as the missing texture, sized 0 so the residency manager pins it
+void scene_texture_push_missing(Scene* scene,const TextureSource* source) {
+    fprintf(stderr,"[TEXTURE] Failed to load \"%s\", using the missing texture\n",source->path ? source->path : "embedded image");
+    GLuint64 handle = bindless_missing_texture();
+    scene_texture_push(scene,handle,handle,NULL,0,0);
+}
+
+// decodes every texture of a scene and filters its mips for its role on the job system, without block
+// compression
+void decode_scene_textures(JobSystem* jobs,const TextureSource* sources,const SceneTextureRef* refs,const u32* indices,u32 count,
+                           DecodedTexture* textures,MipMode* mip_modes) {
+    TextureDecodeStats decode_stats;
+    texture_decode_batch(jobs,sources,count,false,textures,&decode_stats);
+    texture_decode_stats_print(&decode_stats,job_system_thread_count(jobs));
+
+    for(u32 i = 0; i < count; i++)
+        mip_modes[i] = texture_role_mip_mode(refs[indices ? indices[i] : i].role);
+    MipStats mip_stats;
+    mip_generate_batch(jobs,textures,mip_modes,count,&mip_stats);
+    mip_stats_print(&mip_stats,job_system_thread_count(jobs));
+}
+
+// decodes every texture of a scene on the job system, then uploads them in one go on the GL thread
+void load_scene_textures_raw(Arena* arena,JobSystem* jobs,const TextureSource* sources,const SceneTextureRef* refs,u32 count,DecodedTexture* textures,Scene* scene) {
+    decode_scene_textures(jobs,sources,refs,NULL,count,textures,arena_alloc(arena,MipMode,count));
+
+    for(u32 i = 0; i < count; i++) {
+        if(!textures[i].pixels) {
+            scene_texture_push_missing(scene,&sources[i]);
+            continue;
+        }
+        u32 fallback_mip = residency_fallback_level(textures[i].width,textures[i].height,textures[i].mip_count);
+        GLuint64 bindless_handle = bindless_texture_from_decoded(&textures[i],&refs[i],0);
+        GLuint64 fallback_handle = fallback_mip ? bindless_texture_from_decoded(&textures[i],&refs[i],fallback_mip) : bindless_handle;
+        scene_texture_push(scene,bindless_handle,fallback_handle,textures[i].mips,textures[i].mip_count,fallback_mip);
     }
 
-    vec4 view_space_frustum_in_ws[8]; 
-    memcpy(view_space_frustum_in_ws,corners,8 * 4 * sizeof(float));
+    texture_decoded_free(textures,count);
+}
 
-    vec3 origin = {0.0,0.0,0.0};
-    vec3 up = {0.0,1.0,0.0};
+// block compresses every texture of a scene in the format of its role. Textures already in the folder's texture
+// cache are read back as blocks, only the others are decoded and compressed on the job system and then cached
+void load_scene_textures(Arena* arena,JobSystem* jobs,const char* folder_path,const SceneTextureRef* refs,u32 count,const u8* texture_data,Scene* scene) {
+    if(!count || (scene->import_flags & SCENE_IMPORT_SKIP_TEXTURES))
+        return;
 
-    AABB aabb;
-    glm_vec3_copy(corners[0],aabb.min);
-    glm_vec3_copy(corners[0],aabb.max);
-
-    for(int i = 0; i < 8; i++) {
-        if(aabb.min[0] > corners[i][0])
-            aabb.min[0] = corners[i][0];
-        if(aabb.min[1] > corners[i][1])
-            aabb.min[1] = corners[i][1];
-        if(aabb.min[2] > corners[i][2])
-            aabb.min[2] = corners[i][2];
-
-        if(aabb.max[0] < corners[i][0])
-            aabb.max[0] = corners[i][0];
-        if(aabb.max[1] < corners[i][1])
-            aabb.max[1] = corners[i][1];
-        if(aabb.max[2] < corners[i][2])
-            aabb.max[2] = corners[i][2];
-    }
-
-    origin[0] = (aabb.min[0] + aabb.max[0]) / 2.0f;
-    origin[1] = (aabb.min[1] + aabb.max[1]) / 2.0f;
-    origin[2] = (aabb.min[2] + aabb.max[2]) / 2.0f;
-
-    glm_ortho(aabb.min[0],aabb.max[0],aabb.min[1],aabb.max[1],aabb.min[2],aabb.max[2],ortho); 
+    TextureSource* sources = arena_alloc(arena,TextureSource,count);
+    DecodedTexture* textures = arena_alloc(arena,DecodedTexture,count);
+    memset(sources,0,count * sizeof(TextureSource));
+
+    for(u32 i = 0; i < count; i++) {
+        if(refs[i].source == SCENE_TEXTURE_EMBEDDED) {
+            sources[i].data = texture_data + refs[i].offset;
+            sources[i].size = refs[i].size;
+            continue;
+        }
+        char* texture_path = arena_alloc(arena,char,strlen(folder_path) + refs[i].size + 1);
+        memcpy(texture_path,folder_path,strlen(folder_path));
+        memcpy(texture_path + strlen(folder_path),texture_data + refs[i].offset,refs[i].size);
+        texture_path[strlen(folder_path) + refs[i].size] = 0;
+        sources[i].path = texture_path;
+    }
+
+    if(scene->import_flags & SCENE_IMPORT_RAW_TEXTURES) {
+        load_scene_textures_raw(arena,jobs,sources,refs,count,textures,scene);
+        return;
+    }
+
+    f64 start = timer_now();
+    CompressedTexture* compressed = arena_alloc(arena,CompressedTexture,count);
+    TextureFormat* formats = arena_alloc(arena,TextureFormat,count);
+    u64* keys = arena_alloc(arena,u64,count);
+    bool* has_keys = arena_alloc(arena,bool,count);
+    u32* misses = arena_alloc(arena,u32,count);
+    memset(compressed,0,count * sizeof(CompressedTexture));
+
+    char* cache_directory = arena_alloc(arena,char,strlen(folder_path) + strlen(TEXTURE_CACHE_DIRECTORY) + 1);
+    str_concat(folder_path,TEXTURE_CACHE_DIRECTORY,cache_directory);
+    char cache_path[1024];
+
+    u32 miss_count = 0;
+    for(u32 i = 0; i < count; i++) {
+        formats[i] = texture_role_format(refs[i].role);
+        has_keys[i] = texture_cache_key(&sources[i],formats[i],texture_role_mip_mode(refs[i].role),&keys[i]);
+        if(has_keys[i]) {
+            texture_cache_path(cache_directory,keys[i],cache_path,sizeof(cache_path));
+            if(texture_cache_load(cache_path,keys[i],&compressed[i]))
+                continue;
+        }
+        misses[miss_count++] = i;
+    }
+
+    if(miss_count) {
+        TextureSource* miss_sources = arena_alloc(arena,TextureSource,miss_count);
+        TextureFormat* miss_formats = arena_alloc(arena,TextureFormat,miss_count);
+        CompressedTexture* miss_compressed = arena_alloc(arena,CompressedTexture,miss_count);
+        for(u32 i = 0; i < miss_count; i++) {
+            miss_sources[i] = sources[misses[i]];
+            miss_formats[i] = formats[misses[i]];
+        }
+
+        decode_scene_textures(jobs,miss_sources,refs,misses,miss_count,textures,arena_alloc(arena,MipMode,miss_count));
+
+        TextureCompressStats compress_stats;
+        texture_compress_batch(jobs,textures,miss_formats,miss_count,miss_compressed,&compress_stats);
+        texture_compress_stats_print(&compress_stats,job_system_thread_count(jobs));
+        texture_decoded_free(textures,miss_count);
+
+        for(u32 i = 0; i < miss_count; i++) {
+            u32 index = misses[i];
+            compressed[index] = miss_compressed[i];
+            if(!has_keys[index] || !compressed[index].blocks)
+                continue;
+            texture_cache_path(cache_directory,keys[index],cache_path,sizeof(cache_path));
+            if(!texture_cache_write(cache_path,keys[index],&compressed[index]))
+                fprintf(stderr,"[TEXTURE] Failed to write \"%s\"\n",cache_path);
+        }
+    }
+
+    u64 compressed_bytes = 0;
+    for(u32 i = 0; i < count; i++) {
+        if(!compressed[i].blocks) {
+            scene_texture_push_missing(scene,&sources[i]);
+            continue;
+        }
+        u32 fallback_mip = residency_fallback_level(compressed[i].width,compressed[i].height,compressed[i].mip_count);
+        GLuint64 bindless_handle = bindless_texture_from_compressed(&compressed[i],&refs[i],0);
+        GLuint64 fallback_handle = fallback_mip ? bindless_texture_from_compressed(&compressed[i],&refs[i],fallback_mip) : bindless_handle;
+        scene_texture_push(scene,bindless_handle,fallback_handle,compressed[i].mips,compressed[i].mip_count,fallback_mip);
+        compressed_bytes += compressed[i].blocks_size;
+    }
+    texture_compressed_free(compressed,count);
+
+    printf("[TEXTURE] %u images, %u from \"%s\", %.2f MB of blocks in %.3f ms\n",count,count - miss_count,cache_directory,
+           compressed_bytes / (1024.0 * 1024.0),(timer_now() - start) * 1000.0);
 }
 
 const char* attribute_type_to_str(const cgltf_attribute_type type) {
@@ -271,7 +337,29 @@ const char* attribute_type_to_str(const cgltf_attribute_type type) {
 }
 
 
-void process_node(Arena* arena,const cgltf_data* data,cgltf_node* node,mat4 parent_transform,Scene* scene) {
+typedef struct {
+    const cgltf_primitive* primitive;
+    mat4 transform;
+    u32 first_vertex;
+    u32 vertex_count;
+    u32 first_index;
+    u32 index_count;
+    AABB aabb;
+    MeshCacheStats cache_before;
+    MeshCacheStats cache_after;
+}PrimitiveRecord;
+
+typedef struct {
+    Scene* scene;
+    vector(PrimitiveRecord) record_vector;
+    u32 vertex_count;
+    u32 index_count;
+    bool has_skin;
+}GltfImport;
+
+// first pass: resolves world transforms and hands every primitive its slice of the scene vectors
+void flatten_node(const cgltf_data* data,cgltf_node* node,mat4 parent_transform,GltfImport* import) {
+    Scene* scene = import->scene;
     mat4 current_transform;
     glm_mat4_identity(current_transform);
    
@@ -285,7 +373,6 @@ void process_node(Arena* arena,const cgltf_data* data,cgltf_node* node,mat4 pare
         glm_mat4_mul(parent_transform,current_transform,current_transform);
     }
 
-
     if(node->mesh) {
         cgltf_mesh* mesh = node->mesh;
         for(int i = 0; i < mesh->primitives_count; i++) {
@@ -296,120 +383,29 @@ void process_node(Arena* arena,const cgltf_data* data,cgltf_node* node,mat4 pare
 
             assert(primitive->indices && "non indexed are not supporeted");
 
-            cgltf_accessor* acc = primitive->indices;
-            size_t indices_count = acc->count;
-            uint8_t* indices_ptr = (uint8_t*)acc->buffer_view->buffer->data + acc->buffer_view->offset + acc->offset;
-
-            for (size_t k = 0; k < indices_count; k++) {
-                uint32_t value;
-                if (acc->component_type == cgltf_component_type_r_16u)
-                    value = ((uint16_t*)indices_ptr)[k];
-                else if (acc->component_type == cgltf_component_type_r_32u)
-                    value = ((uint32_t*)indices_ptr)[k];
-                else if (acc->component_type == cgltf_component_type_r_8u)
-                    value = indices_ptr[k];
-                vector_push(scene->index_vector,uint32_t,value);
+            for(int j = 0; j < primitive->attributes_count; j++) {
+                if(primitive->attributes[j].type == cgltf_attribute_type_joints ||
+                   primitive->attributes[j].type == cgltf_attribute_type_weights)
+                    import->has_skin = true;
             }
 
-            uint32_t verticies_count = primitive->attributes[0].data->count;
-            Vertex* verticies = arena_alloc(arena,Vertex,verticies_count);
-
-            for(int vert = 0; vert < verticies_count; vert++)
-                glm_vec4_copy(white,verticies[vert].color);
+            PrimitiveRecord record = {0};
+            record.primitive    = primitive;
+            record.first_vertex = import->vertex_count;
+            record.vertex_count = primitive->attributes[0].data->count;
+            record.first_index  = import->index_count;
+            record.index_count  = primitive->indices->count;
+            glm_mat4_copy(current_transform,record.transform);
+            vector_push(import->record_vector,PrimitiveRecord,record);
 
-            for(int j = 0; j < primitive->attributes_count; j++) {
-                cgltf_attribute* attribute = &primitive->attributes[j];
-                cgltf_accessor* accessor = attribute->data;
-                
-                uint8_t* data_ptr = (uint8_t*)accessor->buffer_view->buffer->data + accessor->buffer_view->offset + accessor->offset;
-                assert(accessor->stride && "Stride is 0!");
-
-                switch (attribute->type) {
-                    case cgltf_attribute_type_position:
-                        for(int pos_index = 0; pos_index < verticies_count; pos_index++) {
-                            float* pos = (float*)(data_ptr + pos_index * accessor->stride);
-                            vec4 world_pos = {0.0f,0.0f,0.0f,1.0f};
-                            glm_vec3_copy(pos,world_pos);
-                            glm_mat4_mulv(current_transform,world_pos,world_pos);
-                            glm_vec3_copy(world_pos,verticies[pos_index].position);
-
-                            if(world_pos[0] < scene->aabb.min[0])
-                                scene->aabb.min[0] = world_pos[0]; 
-                            else if(world_pos[0] > scene->aabb.max[0])
-                                scene->aabb.max[0] = world_pos[0]; 
-                            
-                            if(world_pos[1] < scene->aabb.min[1])
-                                scene->aabb.min[1] = world_pos[1]; 
-                            else if(world_pos[1] > scene->aabb.max[1])
-                                scene->aabb.max[1] = world_pos[1]; 
-
-                            if(world_pos[2] < scene->aabb.min[2])
-                                scene->aabb.min[2] = world_pos[2]; 
-                            else if(world_pos[2] > scene->aabb.max[2])
-                                scene->aabb.max[2] = world_pos[2]; 
-                        }                      
-                        break;
-                    case cgltf_attribute_type_normal:
-                        for(int normal_index = 0; normal_index < verticies_count; normal_index++) {
-                            float* normal = (float*)(data_ptr + normal_index * accessor->stride);
-                            vec4 aux = {1.0f};
-                            glm_vec3_copy(normal,aux); 
-                            glm_mat4_mulv(current_transform,aux,aux); 
-                            glm_vec3_copy(aux,verticies[normal_index].normal);
-                        }                      
-                        break;
-                    case cgltf_attribute_type_texcoord:
-                        int index = attribute->index;
-                        for(int uv_index = 0; uv_index < verticies_count; uv_index++) {
-                            float* uv = (float*)(data_ptr + uv_index * accessor->stride);
-                            glm_vec2_copy(uv,index == 0 ? verticies[uv_index].uv0 : verticies[uv_index].uv1);
-                        }
-                        break;
-                    case cgltf_attribute_type_color:
-                        for(int color_index = 0; color_index < verticies_count; color_index++) {
-                            float* color = (float*)(data_ptr + color_index * accessor->stride);
-                            if(accessor->type == cgltf_type_vec3) {
-                                glm_vec3_copy(color,verticies[color_index].color);
-                                verticies[color_index].color[3] = 1.0f;
-                            } else if(accessor->type == cgltf_type_vec4) {
-                                glm_vec4_copy(color,verticies[color_index].color);
-                            }
-                        }
-                        break;
-                    case cgltf_attribute_type_tangent:
-                        for(int tangent_index = 0; tangent_index < verticies_count; tangent_index++) {
-                            float* tangent = (float*)(data_ptr + tangent_index * accessor->stride);
-                            glm_vec4_copy(tangent,verticies[tangent_index].tangent);
-                            glm_mat4_mulv(current_transform,verticies[tangent_index].tangent,verticies[tangent_index].tangent); 
-                        }
-                        break;
-                    case cgltf_attribute_type_joints:
-                        assert(accessor->type == cgltf_type_vec4 && "If this fails then there are less than 3 joint ids");
-                        assert(accessor->component_type != cgltf_component_type_r_8u && "Component type is not unsigend byte!!");
-
-                        for(int joint_index = 0; joint_index < verticies_count; joint_index++) {
-                            verticies[joint_index].joint_ids = *(u64*)(data_ptr + joint_index * accessor->stride);
-                        }
-                        break;
-                    case cgltf_attribute_type_weights:
-                        for(int weights_index = 0; weights_index < verticies_count; weights_index++) {
-                            float* weights = (float*)(data_ptr + weights_index * accessor->stride);
-                                glm_vec4_copy(weights,verticies[weights_index].weights);
-                        }
-                        break;
-                    default:
-                        printf("Missing attribute: %s\n",attribute_type_to_str(attribute->type));
-                        break;
-                }
-            }
+            import->vertex_count += record.vertex_count;
+            import->index_count  += record.index_count;
 
-            vector_push_array(scene->vertex_vector,Vertex,verticies,verticies_count);
-            
             DrawElementsIndirectCommand command = {
-                indices_count,
+                record.index_count,
                 1,
-                scene->index_vector.size - indices_count,
-                scene->vertex_vector.size - verticies_count,
+                record.first_index,
+                record.first_vertex,
                 0
             };
             
@@ -422,7 +418,7 @@ void process_node(Arena* arena,const cgltf_data* data,cgltf_node* node,mat4 pare
                 printf("[DEBUG] primitive does not have a material\n");
             }
             
-            if(material->double_sided) {
+            if(material && material->double_sided) {
                 vector_push(scene->non_culled_command_material_index_vector,uint32_t,material_index);
                 vector_push(scene->non_culled_backface_indirect_command_vector,DrawElementsIndirectCommand,command);
             } else {
@@ -430,20 +426,165 @@ void process_node(Arena* arena,const cgltf_data* data,cgltf_node* node,mat4 pare
                 vector_push(scene->culled_backface_indirect_command_vector,DrawElementsIndirectCommand,command);
             }
         }
-
     }
    
     for(int n = 0; n < node->children_count; n++) {
-        process_node(arena,data,node->children[n],current_transform,scene);
+        flatten_node(data,node->children[n],current_transform,import);
     }
 }
 
-void load_scene_from_gltf(Arena* arena,const char* folder_path,const char* file_name,Scene* scene) { 
+// second pass: every primitive only writes its own slice, so any thread order gives the same scene
+void decode_primitive(PrimitiveRecord* record,Vertex* verticies,uint32_t* indices) {
+    const cgltf_primitive* primitive = record->primitive;
+    vec4* current_transform = record->transform;
+
+    cgltf_accessor* acc = primitive->indices;
+    size_t indices_count = record->index_count;
+    uint8_t* indices_ptr = (uint8_t*)acc->buffer_view->buffer->data + acc->buffer_view->offset + acc->offset;
+
+    for (size_t k = 0; k < indices_count; k++) {
+        uint32_t value = 0;
+        if (acc->component_type == cgltf_component_type_r_16u)
+            value = ((uint16_t*)indices_ptr)[k];
+        else if (acc->component_type == cgltf_component_type_r_32u)
+            value = ((uint32_t*)indices_ptr)[k];
+        else if (acc->component_type == cgltf_component_type_r_8u)
+            value = indices_ptr[k];
+        indices[k] = value;
+    }
+
+    uint32_t verticies_count = record->vertex_count;
+    memset(verticies,0,verticies_count * sizeof(Vertex));
+
+    for(int vert = 0; vert < verticies_count; vert++)
+        glm_vec4_copy(white,verticies[vert].color);
+
+    glm_vec3_copy((vec3){FLT_MAX,FLT_MAX,FLT_MAX},record->aabb.min);
+    glm_vec3_copy((vec3){-FLT_MAX,-FLT_MAX,-FLT_MAX},record->aabb.max);
+
+    for(int j = 0; j < primitive->attributes_count; j++) {
+        cgltf_attribute* attribute = &primitive->attributes[j];
+        cgltf_accessor* accessor = attribute->data;
+        
+        uint8_t* data_ptr = (uint8_t*)accessor->buffer_view->buffer->data + accessor->buffer_view->offset + accessor->offset;
+        assert(accessor->stride && "Stride is 0!");
+
+        switch (attribute->type) {
+            case cgltf_attribute_type_position:
+                for(int pos_index = 0; pos_index < verticies_count; pos_index++) {
+                    float* pos = (float*)(data_ptr + pos_index * accessor->stride);
+                    vec4 world_pos = {0.0f,0.0f,0.0f,1.0f};
+                    glm_vec3_copy(pos,world_pos);
+                    glm_mat4_mulv(current_transform,world_pos,world_pos);
+                    glm_vec3_copy(world_pos,verticies[pos_index].position);
+                    glm_vec3_minv(record->aabb.min,world_pos,record->aabb.min);
+                    glm_vec3_maxv(record->aabb.max,world_pos,record->aabb.max);
+                }                      
+                break;
+            case cgltf_attribute_type_normal:
+                for(int normal_index = 0; normal_index < verticies_count; normal_index++) {
+                    float* normal = (float*)(data_ptr + normal_index * accessor->stride);
+                    vec4 aux = {1.0f};
+                    glm_vec3_copy(normal,aux); 
+                    glm_mat4_mulv(current_transform,aux,aux); 
+                    glm_vec3_copy(aux,verticies[normal_index].normal);
+                }                      
+                break;
+            case cgltf_attribute_type_texcoord:
+                int index = attribute->index;
+                for(int uv_index = 0; uv_index < verticies_count; uv_index++) {
+                    float* uv = (float*)(data_ptr + uv_index * accessor->stride);
+                    glm_vec2_copy(uv,index == 0 ? verticies[uv_index].uv0 : verticies[uv_index].uv1);
+                }
+                break;
+            case cgltf_attribute_type_color:
+                for(int color_index = 0; color_index < verticies_count; color_index++) {
+                    float* color = (float*)(data_ptr + color_index * accessor->stride);
+                    if(accessor->type == cgltf_type_vec3) {
+                        glm_vec3_copy(color,verticies[color_index].color);
+                        verticies[color_index].color[3] = 1.0f;
+                    } else if(accessor->type == cgltf_type_vec4) {
+                        glm_vec4_copy(color,verticies[color_index].color);
+                    }
+                }
+                break;
+            case cgltf_attribute_type_tangent:
+                for(int tangent_index = 0; tangent_index < verticies_count; tangent_index++) {
+                    float* tangent = (float*)(data_ptr + tangent_index * accessor->stride);
+                    glm_vec4_copy(tangent,verticies[tangent_index].tangent);
+                    glm_mat4_mulv(current_transform,verticies[tangent_index].tangent,verticies[tangent_index].tangent); 
+                }
+                break;
+            case cgltf_attribute_type_joints:
+                assert(accessor->type == cgltf_type_vec4 && "If this fails then there are less than 3 joint ids");
+                assert(accessor->component_type != cgltf_component_type_r_8u && "Component type is not unsigend byte!!");
+
+                for(int joint_index = 0; joint_index < verticies_count; joint_index++) {
+                    verticies[joint_index].joint_ids = *(u64*)(data_ptr + joint_index * accessor->stride);
+                }
+                break;
+            case cgltf_attribute_type_weights:
+                for(int weights_index = 0; weights_index < verticies_count; weights_index++) {
+                    float* weights = (float*)(data_ptr + weights_index * accessor->stride);
+                        glm_vec4_copy(weights,verticies[weights_index].weights);
+                }
+                break;
+            default:
+                printf("Missing attribute: %s\n",attribute_type_to_str(attribute->type));
+                break;
+        }
+    }
+}
+
+void decode_primitives_job(void* data,u32 begin,u32 end) {
+    GltfImport* import = (GltfImport*)data;
+    u32 flags = import->scene->import_flags;
+    for(u32 i = begin; i < end; i++) {
+        PrimitiveRecord* record = &import->record_vector.data[i];
+        Vertex* verticies = import->scene->vertex_vector.data + record->first_vertex;
+        uint32_t* indices = import->scene->index_vector.data + record->first_index;
+        decode_primitive(record,verticies,indices);
+
+        // indices are local to the primitive (baseVertex), so its slice can be reordered on its own
+        if(flags & (SCENE_IMPORT_OPTIMIZE_MESHES | SCENE_IMPORT_OPTIMIZE_OVERDRAW))
+            mesh_optimize(indices,record->index_count,verticies,record->vertex_count,sizeof(Vertex),offsetof(Vertex,position),
+                          flags & SCENE_IMPORT_OPTIMIZE_OVERDRAW,arena_scratch(),&record->cache_before,&record->cache_after);
+    }
+}
+
+void print_mesh_optimize_stats(const GltfImport* import,f64 seconds) {
+    u64 triangles = 0;
+    f64 misses_before = 0.0, misses_after = 0.0;
+    for(u32 i = 0; i < import->record_vector.size; i++) {
+        const PrimitiveRecord* record = &import->record_vector.data[i];
+        u32 triangle_count = record->index_count / 3;
+        if(!triangle_count)
+            continue;
+        printf("[MESHOPT] primitive %u (%u tris): ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n",i,triangle_count,
+               record->cache_before.acmr,record->cache_after.acmr,record->cache_before.atvr,record->cache_after.atvr);
+        triangles += triangle_count;
+        misses_before += record->cache_before.acmr * triangle_count;
+        misses_after += record->cache_after.acmr * triangle_count;
+    }
+    if(triangles)
+        printf("[MESHOPT] %u primitives, %llu tris: ACMR %.3f -> %.3f, decode + optimize %.3f ms\n",
+               (u32)import->record_vector.size,(unsigned long long)triangles,misses_before / triangles,misses_after / triangles,seconds * 1000.0);
+}
+
+// a texture bound several ways keeps the role that needs the most of its channels
+void texture_ref_add_role(SceneTextureRef* refs,const cgltf_data* data,const cgltf_texture* texture,TextureRole role) {
+    if(!texture)
+        return;
+    SceneTextureRef* ref = &refs[texture - data->textures];
+    ref->role = role > ref->role ? role : ref->role;
+}
+
+void import_scene_from_gltf(Arena* arena,JobSystem* jobs,const char* folder_path,const char* file_name,Scene* scene) { 
     cgltf_options options = {0};
     cgltf_data* data = NULL;
 
     vec3 min = {FLT_MAX,FLT_MAX,FLT_MAX};
-    vec3 max = {FLT_MIN,FLT_MIN,FLT_MIN};
+    vec3 max = {-FLT_MAX,-FLT_MAX,-FLT_MAX};
 
     glm_vec3_copy(min,scene->aabb.min);
     glm_vec3_copy(max,scene->aabb.max);
@@ -452,6 +593,20 @@ void load_scene_from_gltf(Arena* arena,const char* folder_path,const char* file_
     str_concat(folder_path,"/",inter_path);
     char* path = arena_alloc(arena,char,strlen(inter_path) + strlen(file_name) + 1);
     str_concat(inter_path,file_name,path);
+    char* cache_path = arena_alloc(arena,char,strlen(path) + strlen(SCENE_CACHE_EXTENSION) + 1);
+    str_concat(path,SCENE_CACHE_EXTENSION,cache_path);
+
+    SceneCacheKey cache_key;
+    SceneCacheBase cache_base;
+    SceneCacheTextures cached_textures;
+    bool has_cache_key = scene_cache_key(path,scene->import_flags & ~(SCENE_IMPORT_SKIP_TEXTURES | SCENE_IMPORT_RAW_TEXTURES),&cache_key);
+    scene_cache_base(scene,&cache_base);
+
+    if(has_cache_key && scene_cache_load(cache_path,&cache_key,scene,&cached_textures)) {
+        printf("[DEBUG] Loaded baked scene \"%s\"\n",cache_path);
+        load_scene_textures(arena,jobs,inter_path,cached_textures.refs,cached_textures.ref_count,cached_textures.data,scene);
+        return;
+    }
 
     cgltf_result result = cgltf_parse_file(&options, path, &data);
 
@@ -474,15 +629,32 @@ void load_scene_from_gltf(Arena* arena,const char* folder_path,const char* file_
         return;
     }
 
+    vector(SceneTextureRef) texture_ref_vector;
+    vector(u8) texture_data_vector;
+    vector_create(texture_ref_vector,SceneTextureRef);
+    vector_create(texture_data_vector,u8);
+
     for(int i = 0; i < data->textures_count; i++) {
         cgltf_texture* texture = &data->textures[i];
         cgltf_image* img = texture->image;
 
-        GLuint64 bindless_handle = 0;
+        SceneTextureRef texture_ref = {0};
+        if(texture->sampler) {
+            texture_ref.has_sampler = 1;
+            texture_ref.wrap_s      = texture->sampler->wrap_s;
+            texture_ref.wrap_t      = texture->sampler->wrap_t;
+            texture_ref.min_filter  = texture->sampler->min_filter;
+            texture_ref.mag_filter  = texture->sampler->mag_filter;
+        }
+        texture_ref.offset = texture_data_vector.size;
+
         if (img->buffer_view) {
             uint8_t* buffer_data = (uint8_t*)img->buffer_view->buffer->data + img->buffer_view->offset;
             size_t len = img->buffer_view->size;
-            bindless_handle = bindless_texture_from_mem(buffer_data,len,texture->sampler);
+
+            texture_ref.source = SCENE_TEXTURE_EMBEDDED;
+            texture_ref.size = len;
+            vector_push_array(texture_data_vector,u8,buffer_data,len);
         } 
         else if (img->uri) {
             if (strncmp(img->uri, "data:", 5) == 0) {
@@ -497,18 +669,35 @@ void load_scene_from_gltf(Arena* arena,const char* folder_path,const char* file_
                     fprintf(stderr, "%s %d", "Failed to deecode base64 string!",__LINE__);
                     return; 
                 }
-                bindless_handle = bindless_texture_from_mem(decoded_data,byte_len,texture->sampler);  
+                texture_ref.source = SCENE_TEXTURE_EMBEDDED;
+                texture_ref.size = byte_len;
+                vector_push_array(texture_data_vector,u8,decoded_data,byte_len);
                 free(decoded_data); 
             } else {
-                char* texture_path = arena_alloc(arena,char,strlen(inter_path) + strlen(img->uri) + 1);                   
-                str_concat(inter_path,img->uri,texture_path);
-                bindless_handle = bindless_texture_from_file(texture_path,texture->sampler);
+                texture_ref.source = SCENE_TEXTURE_FILE;
+                texture_ref.size = strlen(img->uri);
+                vector_push_array(texture_data_vector,u8,img->uri,texture_ref.size);
             }
         }
-        assert(bindless_handle && "Failed to set bindless handle");
-        vector_push(scene->texture_handle_vector,GLuint64,bindless_handle);
+        vector_push(texture_ref_vector,SceneTextureRef,texture_ref);
+    }
+
+    // the materials are read after the upload, but their bindings already pick each texture's block format
+    for(int i = 0; i < data->materials_count; i++) {
+        const cgltf_material* mat = &data->materials[i];
+        TextureRole base_color_role = mat->alpha_mode == cgltf_alpha_mode_opaque ? TEXTURE_ROLE_BASE_COLOR : TEXTURE_ROLE_BASE_COLOR_ALPHA;
+        texture_ref_add_role(texture_ref_vector.data,data,mat->occlusion_texture.texture,TEXTURE_ROLE_OCCLUSION);
+        texture_ref_add_role(texture_ref_vector.data,data,mat->emissive_texture.texture,TEXTURE_ROLE_EMISSIVE);
+        texture_ref_add_role(texture_ref_vector.data,data,mat->normal_texture.texture,TEXTURE_ROLE_NORMAL);
+        if(mat->has_pbr_metallic_roughness) {
+            texture_ref_add_role(texture_ref_vector.data,data,mat->pbr_metallic_roughness.base_color_texture.texture,base_color_role);
+            texture_ref_add_role(texture_ref_vector.data,data,mat->pbr_metallic_roughness.metallic_roughness_texture.texture,
+                                 TEXTURE_ROLE_METALLIC_ROUGHNESS);
+        }
     }
 
+    load_scene_textures(arena,jobs,inter_path,texture_ref_vector.data,texture_ref_vector.size,texture_data_vector.data,scene);
+
     for(int i = 0; i < data->materials_count; i++) {
         cgltf_material* mat = &data->materials[i];
          
@@ -586,28 +775,186 @@ void load_scene_from_gltf(Arena* arena,const char* folder_path,const char* file_
         vector_push(scene->material_vector,Material,material);
     }
 
+    // packed scenes keep only the verticies of the import in vertex_vector, until scene_pack_vertices appends them
+    u32 first_vertex = scene->vertex_vector.size;
+    GltfImport import = {0};
+    import.scene = scene;
+    import.vertex_count = first_vertex;
+    import.index_count = scene->index_vector.size;
+    vector_create(import.record_vector,PrimitiveRecord);
+
     cgltf_scene* gltf_scene = &data->scenes[0];
     for(int node_index = 0; node_index < gltf_scene->nodes_count; node_index++) {
         mat4 identity = GLM_MAT4_IDENTITY_INIT;
-        process_node(arena,data,gltf_scene->nodes[node_index],identity,scene);
+        flatten_node(data,gltf_scene->nodes[node_index],identity,&import);
     }
+
+    if(import.vertex_count > scene->vertex_vector.capacity)
+        vector_reserve(scene->vertex_vector,Vertex,import.vertex_count);
+    if(import.index_count > scene->index_vector.capacity)
+        vector_reserve(scene->index_vector,uint32_t,import.index_count);
+    scene->vertex_vector.size = import.vertex_count;
+    scene->index_vector.size = import.index_count;
+
+    f64 decode_start = timer_now();
+    job_system_parallel_for(jobs,import.record_vector.size,1,decode_primitives_job,&import);
+    if(scene->import_flags & (SCENE_IMPORT_OPTIMIZE_MESHES | SCENE_IMPORT_OPTIMIZE_OVERDRAW))
+        print_mesh_optimize_stats(&import,timer_now() - decode_start);
+
+    // merged in record order so the result does not depend on scheduling
+    for(int i = 0; i < import.record_vector.size; i++) {
+        PrimitiveRecord* record = &import.record_vector.data[i];
+        if(!record->vertex_count)
+            continue;
+        glm_vec3_minv(scene->aabb.min,record->aabb.min,scene->aabb.min);
+        glm_vec3_maxv(scene->aabb.max,record->aabb.max,scene->aabb.max);
+    }
+
+    free(import.record_vector.data);
     cgltf_free(data);
+
+    // after the per primitive optimization, welded primitives share verticies and can no longer be reordered alone
+    if(scene->import_flags & SCENE_IMPORT_WELD_VERTICES) {
+        MeshWeldStats weld;
+        scene_weld_vertices(scene,first_vertex,cache_base.culled_command_count,cache_base.non_culled_command_count,
+                            arena_scratch(),&weld);
+        printf("[WELD] \"%s\": %u -> %u verticies, %.2f MB saved\n",file_name,weld.vertex_count_before,weld.vertex_count_after,
+               weld.bytes_saved / (1024.0 * 1024.0));
+    }
+
+    if(scene->import_flags & SCENE_IMPORT_BUILD_MESHLETS) {
+        MeshletBuildStats meshlet_stats;
+        scene_build_meshlets(jobs,scene,cache_base.culled_command_count,cache_base.non_culled_command_count,&meshlet_stats);
+        meshlet_build_stats_print(&meshlet_stats,file_name);
+    }
+
+    scene_compute_command_aabbs(jobs,scene,cache_base.culled_command_count,cache_base.non_culled_command_count);
+
+    if(scene->import_flags & SCENE_IMPORT_PACKED_VERTICES) {
+        u32 vertex_count = scene->vertex_vector.size;
+        scene_pack_vertices(jobs,scene,import.has_skin,cache_base.culled_command_count,cache_base.non_culled_command_count);
+        printf("[DEBUG] Packed %u verticies: %.2f MB -> %.2f MB\n",vertex_count,
+               vertex_count * sizeof(Vertex) / (1024.0 * 1024.0),
+               vertex_count * (sizeof(PackedVertex) + (import.has_skin ? sizeof(SkinVertex) : 0)) / (1024.0 * 1024.0));
+    }
+
+    if(has_cache_key && !scene_cache_write(cache_path,&cache_key,&cache_base,scene,texture_ref_vector.data,texture_ref_vector.size,
+                                           texture_data_vector.data,texture_data_vector.size))
+        fprintf(stderr,"Failed to write scene cache %s\n",cache_path);
+
+    free(texture_ref_vector.data);
+    free(texture_data_vector.data);
+}
+
+void load_scene_from_gltf(Arena* arena,JobSystem* jobs,const char* folder_path,const char* file_name,Scene* scene) {
+    // paths and texture decode records only live for the import, so loading more scenes does not grow the arena
+    ArenaMarker marker = arena_marker(arena);
+    import_scene_from_gltf(arena,jobs,folder_path,file_name,scene);
+    arena_restore(arena,marker);
 }
 
 void scene_init(Scene* scene) {
+    memset(scene,0,sizeof(Scene)); // no cache mapping and no import flags until the caller sets them
     vector_create(scene->index_vector,uint32_t);
     vector_create(scene->vertex_vector,Vertex);
+    vector_create(scene->packed_vertex_vector,PackedVertex);
+    vector_create(scene->skin_vertex_vector,SkinVertex);
     vector_create(scene->culled_backface_indirect_command_vector,DrawElementsIndirectCommand);
     vector_create(scene->non_culled_backface_indirect_command_vector,DrawElementsIndirectCommand);
     vector_create(scene->texture_handle_vector,GLuint64);
+    vector_create(scene->resident_texture_vector,ResidentTexture);
     vector_create(scene->material_vector,Material);
     vector_create(scene->culled_command_material_index_vector,uint32_t);
     vector_create(scene->non_culled_command_material_index_vector,uint32_t);
     vector_create(scene->point_light_vector,PointLight);
+    vector_create(scene->meshlet_vector,Meshlet);
+    vector_create(scene->culled_command_aabb_vector,AABB);
+    vector_create(scene->non_culled_command_aabb_vector,AABB);
+}
+
+void scene_draw_list_init(SceneDrawList* list,u32 culled_capacity,u32 non_culled_capacity) {
+    memset(list,0,sizeof(SceneDrawList));
+    list->culled_capacity = culled_capacity;
+    list->non_culled_capacity = non_culled_capacity;
+}
+
+// hands every texture slot of the scene to the residency manager, after scene_buffers_init made its handle table
+void scene_residency_register(TextureResidency* residency,Scene* scene) {
+    for(u32 slot = 0; slot < scene->resident_texture_vector.size; slot++) {
+        u32 id = texture_residency_add(residency,scene->texture_handles_buffer,slot,&scene->resident_texture_vector.data[slot]);
+        if(slot == 0)
+            scene->residency_first = id;
+    }
+}
+
+// marks the textures of the materials of the visible commands as used this frame
+void scene_touch_textures(TextureResidency* residency,const Scene* scene,const u32* visible,u32 visible_count,const u32* material_indices) {
+    for(u32 i = 0; i < visible_count; i++) {
+        const Material* material = &scene->material_vector.data[material_indices[visible[i]]];
+        i32 slots[] = { material->base_color_texture_index, material->metalic_texture_index, material->normal_texture_index,
+                        material->occlusion_texture_index, material->emissive_texture_index };
+        for(u32 t = 0; t < sizeof(slots) / sizeof(slots[0]); t++) {
+            if(slots[t] >= 0 && (u32)slots[t] < scene->resident_texture_vector.size)
+                texture_residency_touch(residency,scene->residency_first + slots[t]);
+        }
+    }
+}
+
+// residency may be NULL, views that sample no material textures leave it alone
+void scene_cull_view(Arena* frame_arena,StreamBuffer* stream,const Scene* scene,SceneDrawList* list,const Frustum* frustum,const MeshletCullView* meshlet_view,
+                     TextureResidency* residency) {
+    u32 culled_count = scene->culled_command_bounds.count;
+    u32 non_culled_count = scene->non_culled_command_bounds.count;
+    u32* culled_visible = arena_alloc(frame_arena,u32,culled_count + 1);
+    u32* non_culled_visible = arena_alloc(frame_arena,u32,non_culled_count + 1);
+    u32 culled_visible_count = frustum_cull_aabbs(frustum,&scene->culled_command_bounds,culled_visible);
+    u32 non_culled_visible_count = frustum_cull_aabbs(frustum,&scene->non_culled_command_bounds,non_culled_visible);
+    // per visible command rather than per surviving meshlet, a few textures more than the frame samples
+    if(residency) {
+        scene_touch_textures(residency,scene,culled_visible,culled_visible_count,scene->culled_command_material_index_vector.data);
+        scene_touch_textures(residency,scene,non_culled_visible,non_culled_visible_count,scene->non_culled_command_material_index_vector.data);
+    }
+
+    // compacted straight into this frame's slice of the stream buffer, nothing is copied afterwards
+    list->buffer = stream->buffer;
+    list->culled_count = list->non_culled_count = 0;
+    MeshletDrawList culled = {
+        stream_buffer_alloc(stream,list->culled_capacity * sizeof(DrawElementsIndirectCommand),sizeof(u32),&list->culled_command_offset),
+        stream_buffer_alloc(stream,list->culled_capacity * sizeof(u32),stream->storage_alignment,&list->culled_material_index_offset),
+        culled_visible_count
+    };
+    MeshletDrawList non_culled = {
+        stream_buffer_alloc(stream,list->non_culled_capacity * sizeof(DrawElementsIndirectCommand),sizeof(u32),&list->non_culled_command_offset),
+        stream_buffer_alloc(stream,list->non_culled_capacity * sizeof(u32),stream->storage_alignment,&list->non_culled_material_index_offset),
+        non_culled_visible_count
+    };
+    if(!culled.commands || !culled.material_indices || !non_culled.commands || !non_culled.material_indices)
+        return;
+
+    if(meshlet_view && scene->meshlet_vector.size) {
+        u8* culled_command_visible = arena_alloc(frame_arena,u8,culled_count + 1);
+        u8* non_culled_command_visible = arena_alloc(frame_arena,u8,non_culled_count + 1);
+        memset(culled_command_visible,0,culled_count + 1);
+        memset(non_culled_command_visible,0,non_culled_count + 1);
+        for(u32 i = 0; i < culled_visible_count; i++)
+            culled_command_visible[culled_visible[i]] = 1;
+        for(u32 i = 0; i < non_culled_visible_count; i++)
+            non_culled_command_visible[non_culled_visible[i]] = 1;
+        scene_cull_meshlets(scene,meshlet_view,culled_command_visible,non_culled_command_visible,&culled,&non_culled,NULL);
+    } else {
+        cull_compact_commands(scene->culled_backface_indirect_command_vector.data,scene->culled_command_material_index_vector.data,
+                              culled_visible,culled_visible_count,culled.commands,culled.material_indices);
+        cull_compact_commands(scene->non_culled_backface_indirect_command_vector.data,scene->non_culled_command_material_index_vector.data,
+                              non_culled_visible,non_culled_visible_count,non_culled.commands,non_culled.material_indices);
+    }
+
+    list->culled_count = culled.count;
+    list->non_culled_count = non_culled.count;
 }
 
 void scene_buffers_init(Scene* scene) {
-    assert(scene->vertex_vector.size && "Vertex Vector is empty!");
+    bool packed = scene->packed_vertex_vector.size != 0;
+    assert((scene->vertex_vector.size || packed) && "Vertex Vector is empty!");
     assert(scene->index_vector.size && "Index Vector is empty!");
 
     glGenVertexArrays(1,&scene->vertex_array);
@@ -615,25 +962,56 @@ void scene_buffers_init(Scene* scene) {
 
     glGenBuffers(1,&scene->vertex_buffer);
     glBindBuffer(GL_ARRAY_BUFFER,scene->vertex_buffer); 
-    glBufferData(GL_ARRAY_BUFFER,scene->vertex_vector.size * sizeof(Vertex),scene->vertex_vector.data,GL_STATIC_DRAW);
-
-    glVertexAttribPointer(0,4,GL_FLOAT,GL_FALSE,sizeof(Vertex),(void*)offsetof(Vertex,color));    // color
-    glVertexAttribPointer(1,4,GL_FLOAT,GL_FALSE,sizeof(Vertex),(void*)offsetof(Vertex,tangent));  // tangent 
-    glVertexAttribPointer(2,4,GL_FLOAT,GL_FALSE,sizeof(Vertex),(void*)offsetof(Vertex,weights));  // weights 
-    glVertexAttribPointer(3,3,GL_FLOAT,GL_FALSE,sizeof(Vertex),(void*)offsetof(Vertex,position)); // pos
-    glVertexAttribPointer(4,3,GL_FLOAT,GL_FALSE,sizeof(Vertex),(void*)offsetof(Vertex,normal));   // normal
-    glVertexAttribPointer(5,2,GL_FLOAT,GL_FALSE,sizeof(Vertex),(void*)offsetof(Vertex,uv0));      // uv0
-    glVertexAttribPointer(6,2,GL_FLOAT,GL_FALSE,sizeof(Vertex),(void*)offsetof(Vertex,uv1));      // uv1
-    glVertexAttribIPointer(7,4,GL_UNSIGNED_SHORT,sizeof(Vertex),(void*)offsetof(Vertex,joint_ids)); // bone ids 
-    
-    glEnableVertexAttribArray(0);
-    glEnableVertexAttribArray(1);
-    glEnableVertexAttribArray(2);
-    glEnableVertexAttribArray(3);
-    glEnableVertexAttribArray(4);
-    glEnableVertexAttribArray(5);
-    glEnableVertexAttribArray(6);
-    glEnableVertexAttribArray(7);
+
+    if(packed) {
+        glBufferData(GL_ARRAY_BUFFER,scene->packed_vertex_vector.size * sizeof(PackedVertex),scene->packed_vertex_vector.data,GL_STATIC_DRAW);
+
+        glVertexAttribPointer(0,4,GL_UNSIGNED_BYTE,GL_TRUE,sizeof(PackedVertex),(void*)offsetof(PackedVertex,color));  // color
+        glVertexAttribPointer(1,2,GL_SHORT,GL_TRUE,sizeof(PackedVertex),(void*)offsetof(PackedVertex,tangent));        // octahedral tangent 
+        glVertexAttribPointer(3,3,GL_FLOAT,GL_FALSE,sizeof(PackedVertex),(void*)offsetof(PackedVertex,position));      // pos
+        glVertexAttribPointer(4,2,GL_SHORT,GL_TRUE,sizeof(PackedVertex),(void*)offsetof(PackedVertex,normal));         // octahedral normal
+        glVertexAttribPointer(5,2,GL_HALF_FLOAT,GL_FALSE,sizeof(PackedVertex),(void*)offsetof(PackedVertex,uv0));      // uv0
+        glVertexAttribPointer(6,2,GL_HALF_FLOAT,GL_FALSE,sizeof(PackedVertex),(void*)offsetof(PackedVertex,uv1));      // uv1
+
+        glEnableVertexAttribArray(0);
+        glEnableVertexAttribArray(1);
+        glEnableVertexAttribArray(3);
+        glEnableVertexAttribArray(4);
+        glEnableVertexAttribArray(5);
+        glEnableVertexAttribArray(6);
+
+        // skinning lives in its own stream, left disabled (constant zero) for static scenes
+        if(scene->skin_vertex_vector.size) {
+            glGenBuffers(1,&scene->skin_vertex_buffer);
+            glBindBuffer(GL_ARRAY_BUFFER,scene->skin_vertex_buffer); 
+            glBufferData(GL_ARRAY_BUFFER,scene->skin_vertex_vector.size * sizeof(SkinVertex),scene->skin_vertex_vector.data,GL_STATIC_DRAW);
+
+            glVertexAttribPointer(2,4,GL_UNSIGNED_SHORT,GL_TRUE,sizeof(SkinVertex),(void*)offsetof(SkinVertex,weights));    // weights 
+            glVertexAttribIPointer(7,4,GL_UNSIGNED_SHORT,sizeof(SkinVertex),(void*)offsetof(SkinVertex,joint_ids));        // bone ids 
+            glEnableVertexAttribArray(2);
+            glEnableVertexAttribArray(7);
+        }
+    } else {
+        glBufferData(GL_ARRAY_BUFFER,scene->vertex_vector.size * sizeof(Vertex),scene->vertex_vector.data,GL_STATIC_DRAW);
+
+        glVertexAttribPointer(0,4,GL_FLOAT,GL_FALSE,sizeof(Vertex),(void*)offsetof(Vertex,color));    // color
+        glVertexAttribPointer(1,4,GL_FLOAT,GL_FALSE,sizeof(Vertex),(void*)offsetof(Vertex,tangent));  // tangent 
+        glVertexAttribPointer(2,4,GL_FLOAT,GL_FALSE,sizeof(Vertex),(void*)offsetof(Vertex,weights));  // weights 
+        glVertexAttribPointer(3,3,GL_FLOAT,GL_FALSE,sizeof(Vertex),(void*)offsetof(Vertex,position)); // pos
+        glVertexAttribPointer(4,3,GL_FLOAT,GL_FALSE,sizeof(Vertex),(void*)offsetof(Vertex,normal));   // normal
+        glVertexAttribPointer(5,2,GL_FLOAT,GL_FALSE,sizeof(Vertex),(void*)offsetof(Vertex,uv0));      // uv0
+        glVertexAttribPointer(6,2,GL_FLOAT,GL_FALSE,sizeof(Vertex),(void*)offsetof(Vertex,uv1));      // uv1
+        glVertexAttribIPointer(7,4,GL_UNSIGNED_SHORT,sizeof(Vertex),(void*)offsetof(Vertex,joint_ids)); // bone ids 
+        
+        glEnableVertexAttribArray(0);
+        glEnableVertexAttribArray(1);
+        glEnableVertexAttribArray(2);
+        glEnableVertexAttribArray(3);
+        glEnableVertexAttribArray(4);
+        glEnableVertexAttribArray(5);
+        glEnableVertexAttribArray(6);
+        glEnableVertexAttribArray(7);
+    }
 
     glGenBuffers(1,&scene->index_buffer);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER,scene->index_buffer); 
@@ -641,143 +1019,125 @@ void scene_buffers_init(Scene* scene) {
     
     glBindVertexArray(0);
 
-    glGenBuffers(1, &scene->culled_backface_indirect_command_buffer);
-    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, scene->culled_backface_indirect_command_buffer);
-    glBufferData(GL_DRAW_INDIRECT_BUFFER, 
-                 scene->culled_backface_indirect_command_vector.size * sizeof(DrawElementsIndirectCommand),
-                 scene->culled_backface_indirect_command_vector.data, GL_STATIC_DRAW);
+    // a meshlet can become its own draw, so the camera lists must hold every meshlet
+    u32 culled_meshlet_count = 0, non_culled_meshlet_count = 0;
+    for(u32 i = 0; i < scene->meshlet_vector.size; i++) {
+        if(scene->meshlet_vector.data[i].flags & MESHLET_DOUBLE_SIDED)
+            ++non_culled_meshlet_count;
+        else
+            ++culled_meshlet_count;
+    }
+    u32 culled_count = scene->culled_backface_indirect_command_vector.size;
+    u32 non_culled_count = scene->non_culled_backface_indirect_command_vector.size;
+    scene_draw_list_init(&scene->camera_draw_list,culled_count > culled_meshlet_count ? culled_count : culled_meshlet_count,
+                         non_culled_count > non_culled_meshlet_count ? non_culled_count : non_culled_meshlet_count);
+    for(u32 c = 0; c < SHADOW_MAX_CASCADES; c++)
+        scene_draw_list_init(&scene->cascade_draw_lists[c],culled_count,non_culled_count);
 
-    glGenBuffers(1, &scene->non_culled_backface_indirect_command_buffer);
-    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, scene->non_culled_backface_indirect_command_buffer);
-    glBufferData(GL_DRAW_INDIRECT_BUFFER, 
-                 scene->non_culled_backface_indirect_command_vector.size * sizeof(DrawElementsIndirectCommand),
-                 scene->non_culled_backface_indirect_command_vector.data, GL_STATIC_DRAW);
+    cull_bounds_build(&scene->culled_command_bounds,scene->culled_command_aabb_vector.data,scene->culled_command_aabb_vector.size);
+    cull_bounds_build(&scene->non_culled_command_bounds,scene->non_culled_command_aabb_vector.data,scene->non_culled_command_aabb_vector.size);
 
     glGenBuffers(1,&scene->texture_handles_buffer);
     glBindBuffer(GL_SHADER_STORAGE_BUFFER,scene->texture_handles_buffer);
-    glBufferData(GL_SHADER_STORAGE_BUFFER,scene->texture_handle_vector.size * sizeof(GLuint64) , scene->texture_handle_vector.data, GL_STATIC_DRAW);
+    glBufferData(GL_SHADER_STORAGE_BUFFER,scene->texture_handle_vector.size * sizeof(GLuint64) , scene->texture_handle_vector.data, GL_DYNAMIC_DRAW); // slots swap with residency
 
     glGenBuffers(1,&scene->material_buffer);
     glBindBuffer(GL_SHADER_STORAGE_BUFFER,scene->material_buffer);
     glBufferData(GL_SHADER_STORAGE_BUFFER,scene->material_vector.size * sizeof(Material) , scene->material_vector.data, GL_STATIC_DRAW);
-
-    glGenBuffers(1,&scene->culled_command_material_index_buffer);
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER,scene->culled_command_material_index_buffer);
-    glBufferData(GL_SHADER_STORAGE_BUFFER,scene->culled_command_material_index_vector.size * sizeof(uint32_t) , scene->culled_command_material_index_vector.data, GL_STATIC_DRAW);
-
-    glGenBuffers(1,&scene->non_culled_command_material_index_buffer);
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER,scene->non_culled_command_material_index_buffer);
-    glBufferData(GL_SHADER_STORAGE_BUFFER,scene->non_culled_command_material_index_vector.size * sizeof(uint32_t) , scene->non_culled_command_material_index_vector.data, GL_STATIC_DRAW);
-   
-    glGenBuffers(1,&scene->point_light_buffer);
-    glBindBuffer(GL_UNIFORM_BUFFER,scene->point_light_buffer); 
-    glBufferData(GL_UNIFORM_BUFFER,sizeof(u32)*4 + scene->point_light_vector.size * sizeof(PointLight),NULL,GL_STATIC_DRAW);
-    glBufferSubData(GL_UNIFORM_BUFFER,0,sizeof(u32),&scene->point_light_vector.size);
-    glBufferSubData(GL_UNIFORM_BUFFER,4*sizeof(u32),scene->point_light_vector.size * sizeof(PointLight),scene->point_light_vector.data);
-}
-
-void update_light_buffer(Scene* scene) {
-    glBindBuffer(GL_UNIFORM_BUFFER,scene->point_light_buffer); 
-    glBufferData(GL_UNIFORM_BUFFER,sizeof(u32)*4 + scene->point_light_vector.size * sizeof(PointLight),NULL,GL_STATIC_DRAW);
-    glBufferSubData(GL_UNIFORM_BUFFER,0,sizeof(u32),&scene->point_light_vector.size);
-    glBufferSubData(GL_UNIFORM_BUFFER,4*sizeof(u32),scene->point_light_vector.size * sizeof(PointLight),scene->point_light_vector.data);
-}
-
-void scene_data_destroy(Scene* scene_data) {
-    
 }
 
-char* readFile(const char* path) {
-    FILE* f = fopen(path, "rb");
-    if (!f) return NULL;
-    fseek(f, 0, SEEK_END);
-    long size = ftell(f);
-    fseek(f, 0, SEEK_SET);
-    char* buf = malloc(size + 1);
-    if (!buf) {
-        fclose(f);
-        return NULL;
-    }
-    fread(buf, 1, size, f);
-    buf[size] = '\0';
-    fclose(f);
-    return buf;
-}
-
-GLuint shaderProgramCreate(const char* vs_path, const char* fs_path) {
-    const char* vs_src = readFile(vs_path); 
-    const char* fs_src = readFile(fs_path); 
-
-    GLuint vs = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vs, 1, &vs_src, NULL);
-    glCompileShader(vs);
-    GLint ok;
-    glGetShaderiv(vs, GL_COMPILE_STATUS, &ok);
-    if (!ok) {
-        char log[512];
-        glGetShaderInfoLog(vs, 512, NULL, log);
-        fprintf(stderr, "VERTEX SHADER %s\n", log);
-        glDeleteShader(vs);
-        return 0;
-    }
-
-    GLuint fs = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fs, 1, &fs_src, NULL);
-    glCompileShader(fs);
-    glGetShaderiv(fs, GL_COMPILE_STATUS, &ok);
-    if (!ok) {
-        char log[512];
-        glGetShaderInfoLog(fs, 512, NULL, log);
-        fprintf(stderr, "FRAGMENT SHADER %s\n", log);
-        glDeleteShader(vs);
-        glDeleteShader(fs);
-        return 0;
-    }
-
-    GLuint prog = glCreateProgram();
-    glAttachShader(prog, vs);
-    glAttachShader(prog, fs);
-    glLinkProgram(prog);
-    glGetProgramiv(prog, GL_LINK_STATUS, &ok);
-    if (!ok) {
-        char log[512];
-        glGetProgramInfoLog(prog, 512, NULL, log);
-        fprintf(stderr, "%s\n", log);
-        glDeleteShader(vs);
-        glDeleteShader(fs);
-        glDeleteProgram(prog);
-        return 0;
-    }
-
-    glDeleteShader(vs);
-    glDeleteShader(fs);
-    free((char*)vs_src);
-    free((char*)fs_src);
-    return prog;
-}
-
-void shaderBind(GLuint program) {
-    glUseProgram(program);
-}
+// the world's lights, the clusters and their light indices at the bindings default_fs.glsl reads them from.
+// Index lists past CLUSTER_MAX_INDICES are cut, which drops lights from the farthest clusters first
+void upload_light_clusters(StreamBuffer* stream,const LightClusterGrid* grid,const PointLight* lights,u32 light_count) {
+    u32 index_count = grid->index_count < CLUSTER_MAX_INDICES ? grid->index_count : CLUSTER_MAX_INDICES;
+    static bool warned = false;
+    if(index_count < grid->index_count && !warned) {
+        fprintf(stderr,"[CLUSTER] %u light indices, only the first %u are uploaded\n",grid->index_count,CLUSTER_MAX_INDICES);
+        warned = true;
+    }
 
-void shaderUnbind() {
-    glUseProgram(0);
-}
+    // empty storage ranges cannot be bound, the extra entry is never read
+    u64 light_size = (light_count ? light_count : 1) * sizeof(PointLight);
+    u64 index_size = (index_count ? index_count : 1) * sizeof(u32);
+    u64 light_offset, cluster_offset, index_offset;
+    PointLight* light_data = stream_buffer_alloc(stream,light_size,stream->storage_alignment,&light_offset);
+    u32* index_data = stream_buffer_alloc(stream,index_size,stream->storage_alignment,&index_offset);
+    LightCluster* cluster_data = stream_buffer_alloc(stream,sizeof(grid->clusters),stream->storage_alignment,&cluster_offset);
+    if(!cluster_data)
+        return;
+    if(!light_data || !index_data) {
+        memset(cluster_data,0,sizeof(grid->clusters));
+        glBindBufferRange(GL_SHADER_STORAGE_BUFFER,4,stream->buffer,cluster_offset,sizeof(grid->clusters));
+        return;
+    }
 
-void shaderDestroy(GLuint program) {
-    glDeleteProgram(program);
+    memcpy(light_data,lights,light_count * sizeof(PointLight));
+    memcpy(index_data,grid->indices,index_count * sizeof(u32));
+    memcpy(cluster_data,grid->clusters,sizeof(grid->clusters));
+    if(index_count < grid->index_count) {
+        for(u32 i = 0; i < CLUSTER_COUNT; i++) {
+            LightCluster* cluster = &cluster_data[i];
+            if(cluster->offset + cluster->count > index_count)
+                cluster->count = cluster->offset >= index_count ? 0 : index_count - cluster->offset;
+        }
+    }
+    glBindBufferRange(GL_SHADER_STORAGE_BUFFER,3,stream->buffer,light_offset,light_size);
+    glBindBufferRange(GL_SHADER_STORAGE_BUFFER,4,stream->buffer,cluster_offset,sizeof(grid->clusters));
+    glBindBufferRange(GL_SHADER_STORAGE_BUFFER,5,stream->buffer,index_offset,index_size);
 }
 
-void shaderSetMat4Uniform(GLuint program,const char* name,mat4 value) {
-    glUniformMatrix4fv(glGetUniformLocation(program,name),1,GL_FALSE,(const float*)value);
+// scattered inside bounds with ranges of a few units, for stressing the clusters
+void random_point_lights(u32* seed,const AABB* bounds,u32 count,PointLight* lights) {
+    for(u32 i = 0; i < count; i++) {
+        f32 random[8];
+        for(u32 r = 0; r < 8; r++) {
+            *seed = *seed * 1664525u + 1013904223u;
+            random[r] = (*seed >> 8) / 16777216.0f;
+        }
+        PointLight* light = &lights[i];
+        *light = (PointLight){ .color_intensity = { 0.2f + 0.8f * random[0], 0.2f + 0.8f * random[1], 0.2f + 0.8f * random[2], 0.5f + 1.5f * random[3] },
+                               .attenuation_factors = { 1.0f, 0.1f, 2.0f + 14.0f * random[4] } };
+        for(u32 axis = 0; axis < 3; axis++)
+            light->pos[axis] = bounds->min[axis] + (bounds->max[axis] - bounds->min[axis]) * random[5 + axis];
+        light->attenuation_factors[3] = point_light_radius(light);
+    }
 }
 
-void shaderSetInt(GLuint program, const char* name,int value) {
-    glUniform1i(glGetUniformLocation(program,name),value);
+// worst case of one frame: the frame uniforms, every scene's draw lists and the clustered lights, each padded to the largest alignment
+u64 scene_stream_slice_size(const Scene* scenes,u32 count,u32 light_count) {
+    u64 size = sizeof(FrameUniforms) + STREAM_BUFFER_MAX_ALIGNMENT;
+    for(u32 i = 0; i < count; i++) {
+        const SceneDrawList* lists[1 + SHADOW_MAX_CASCADES] = { &scenes[i].camera_draw_list };
+        for(u32 c = 0; c < SHADOW_MAX_CASCADES; c++)
+            lists[1 + c] = &scenes[i].cascade_draw_lists[c];
+        for(u32 l = 0; l < 1 + SHADOW_MAX_CASCADES; l++) {
+            u64 commands = (u64)lists[l]->culled_capacity + lists[l]->non_culled_capacity;
+            size += commands * (sizeof(DrawElementsIndirectCommand) + sizeof(u32)) + 4 * STREAM_BUFFER_MAX_ALIGNMENT;
+        }
+    }
+    size += (light_count + 1) * sizeof(PointLight) + CLUSTER_COUNT * sizeof(LightCluster) + CLUSTER_MAX_INDICES * sizeof(u32) +
+            3 * STREAM_BUFFER_MAX_ALIGNMENT;
+    return size;
 }
 
-void shaderSetFloat(GLuint program, const char* name,float value) {
-    glUniform1f(glGetUniformLocation(program,name),value);
+// frees every vector scene_init made, the ones borrowing the scene cache are dropped when it is unmapped
+void scene_data_destroy(Scene* scene_data) {
+    scene_cache_release(scene_data);
+    vector_free(scene_data->index_vector);
+    vector_free(scene_data->vertex_vector);
+    vector_free(scene_data->packed_vertex_vector);
+    vector_free(scene_data->skin_vertex_vector);
+    vector_free(scene_data->culled_backface_indirect_command_vector);
+    vector_free(scene_data->non_culled_backface_indirect_command_vector);
+    vector_free(scene_data->texture_handle_vector);
+    vector_free(scene_data->resident_texture_vector);
+    vector_free(scene_data->material_vector);
+    vector_free(scene_data->culled_command_material_index_vector);
+    vector_free(scene_data->non_culled_command_material_index_vector);
+    vector_free(scene_data->point_light_vector);
+    vector_free(scene_data->meshlet_vector);
+    vector_free(scene_data->culled_command_aabb_vector);
+    vector_free(scene_data->non_culled_command_aabb_vector);
 }
 
 typedef struct {
@@ -814,91 +1174,97 @@ TextureAtlas createAtlas(i32 imgWidth,i32 imgHeight,i32 tileDim) {
     return atlas;
 }
 
-void scene_draw(Scene* scenes,u32 count,uint32_t shader_program,vec3 camera_pos,bool wireframe,u32 depth_map,mat4 light_view,mat4 light_ortho,vec3 light_dir) {
-    shaderBind(shader_program);
-    glUniform3f(glGetUniformLocation(shader_program,"camera_pos"),camera_pos[0],camera_pos[1],camera_pos[2]);
-    glUniform3f(glGetUniformLocation(shader_program,"light_dir"),light_dir[0],light_dir[1],light_dir[2]);
-    shaderSetMat4Uniform(shader_program,"light_view",light_view);
-    shaderSetMat4Uniform(shader_program,"light_ortho",light_ortho);
+// camera and light parameters come from the frame UBO, packed_vertices is the only per scene uniform
+void scene_draw(Scene* scenes,u32 count,const ShaderProgram* program,i32 packed_vertices_location,bool wireframe,u32 depth_map) {
+    shader_bind(program);
     glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D,depth_map);
+    glBindTexture(GL_TEXTURE_2D_ARRAY,depth_map);
 
     for(int i = 0; i < count; i++) {
-        update_light_buffer(&scenes[i]);
-
         glBindVertexArray(scenes[i].vertex_array); 
+        glUniform1i(packed_vertices_location,scenes[i].packed_vertex_vector.size != 0);
 
         glBindBufferBase(GL_SHADER_STORAGE_BUFFER,0,scenes[i].texture_handles_buffer);
         glBindBufferBase(GL_SHADER_STORAGE_BUFFER,1,scenes[i].material_buffer);
-        glBindBufferBase(GL_UNIFORM_BUFFER,3,scenes[i].point_light_buffer);
 
-        if(scenes[i].culled_backface_indirect_command_vector.size) {
+        const SceneDrawList* list = &scenes[i].camera_draw_list;
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER,list->buffer);
+        if(list->culled_count) {
             glEnable(GL_CULL_FACE);
-            glBindBuffer(GL_DRAW_INDIRECT_BUFFER,scenes[i].culled_backface_indirect_command_buffer);
-            glBindBufferBase(GL_SHADER_STORAGE_BUFFER,2,scenes[i].culled_command_material_index_buffer);
-            glMultiDrawElementsIndirect(wireframe ? GL_LINES : GL_TRIANGLES,GL_UNSIGNED_INT,0,scenes[i].culled_backface_indirect_command_vector.size,0);
+            glBindBufferRange(GL_SHADER_STORAGE_BUFFER,2,list->buffer,list->culled_material_index_offset,list->culled_count * sizeof(u32));
+            glMultiDrawElementsIndirect(wireframe ? GL_LINES : GL_TRIANGLES,GL_UNSIGNED_INT,(const void*)(uintptr_t)list->culled_command_offset,
+                                        list->culled_count,0);
         }
 
-        if(scenes[i].non_culled_backface_indirect_command_vector.size) {
+        if(list->non_culled_count) {
             glDisable(GL_CULL_FACE);
-            glBindBuffer(GL_DRAW_INDIRECT_BUFFER,scenes[i].non_culled_backface_indirect_command_buffer);
-            glBindBufferBase(GL_SHADER_STORAGE_BUFFER,2,scenes[i].non_culled_command_material_index_buffer);
-            glMultiDrawElementsIndirect(wireframe ? GL_LINES : GL_TRIANGLES,GL_UNSIGNED_INT,0,scenes[i].non_culled_backface_indirect_command_vector.size,0);
+            glBindBufferRange(GL_SHADER_STORAGE_BUFFER,2,list->buffer,list->non_culled_material_index_offset,list->non_culled_count * sizeof(u32));
+            glMultiDrawElementsIndirect(wireframe ? GL_LINES : GL_TRIANGLES,GL_UNSIGNED_INT,(const void*)(uintptr_t)list->non_culled_command_offset,
+                                        list->non_culled_count,0);
         }
     }
 }
 
 
-void render_directional_shadowmap(const Scene* scenes,u32 count,mat4 ortho,mat4 light_view,vec3 light_dir,u32 dir_shadowmap_shader,u32* shadow_map_texture) {
+// one layer of a depth array per cascade, each drawing the commands culled against it. Only the cascades in the
+// render mask are drawn, the others keep their depth from an earlier frame. The cascade matrices come from the
+// frame UBO, the array is created on the first call with SHADOW_MAX_CASCADES layers
+void render_directional_shadowmap(const Scene* scenes,u32 count,const ShaderProgram* dir_shadowmap_shader,i32 cascade_location,u32 cascade_count,
+                                  u32 render_mask,u32* shadow_map_texture) {
     static u32 fbo = 0;
 
     if(!fbo) {
         glGenTextures(1, shadow_map_texture);
-        glBindTexture(GL_TEXTURE_2D, *shadow_map_texture);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, *shadow_map_texture);
 
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, 2048, 2048, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT24, SHADOW_CASCADE_RESOLUTION, SHADOW_CASCADE_RESOLUTION, SHADOW_MAX_CASCADES, 0,
+                     GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
 
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
 
         float border_color[] = { 1.0f, 1.0f, 1.0f, 1.0f };
-        glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, border_color);
+        glTexParameterfv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BORDER_COLOR, border_color);
 
         glGenFramebuffers(1,&fbo);
         glBindFramebuffer(GL_FRAMEBUFFER,fbo); 
 
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, *shadow_map_texture,0);
+        glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, *shadow_map_texture, 0, 0);
 
         glDrawBuffer(GL_NONE);
         glReadBuffer(GL_NONE);
     }
 
-    glViewport(0, 0, 2048, 2048);
+    glViewport(0, 0, SHADOW_CASCADE_RESOLUTION, SHADOW_CASCADE_RESOLUTION);
 
-    shaderBind(dir_shadowmap_shader);
-
-    shaderSetMat4Uniform(dir_shadowmap_shader,"view",light_view);
-    shaderSetMat4Uniform(dir_shadowmap_shader,"ortho",ortho);
+    shader_bind(dir_shadowmap_shader);
 
     glBindFramebuffer(GL_FRAMEBUFFER,fbo);
     glCullFace(GL_FRONT);
-    glClear(GL_DEPTH_BUFFER_BIT);
 
-    for(int i = 0; i < count; i++) {
-        glBindVertexArray(scenes[i].vertex_array); 
-
-        if(scenes[i].culled_backface_indirect_command_vector.size) {
-            glEnable(GL_CULL_FACE);
-            glBindBuffer(GL_DRAW_INDIRECT_BUFFER,scenes[i].culled_backface_indirect_command_buffer);
-            glMultiDrawElementsIndirect(GL_TRIANGLES,GL_UNSIGNED_INT,0,scenes[i].culled_backface_indirect_command_vector.size,0);
-        }
+    for(u32 c = 0; c < cascade_count; c++) {
+        if(!(render_mask & (1u << c)))
+            continue;
+        glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, *shadow_map_texture, 0, c);
+        glClear(GL_DEPTH_BUFFER_BIT);
+        glUniform1i(cascade_location,c);
+
+        for(int i = 0; i < count; i++) {
+            glBindVertexArray(scenes[i].vertex_array); 
+
+            const SceneDrawList* list = &scenes[i].cascade_draw_lists[c];
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER,list->buffer);
+            if(list->culled_count) {
+                glEnable(GL_CULL_FACE);
+                glMultiDrawElementsIndirect(GL_TRIANGLES,GL_UNSIGNED_INT,(const void*)(uintptr_t)list->culled_command_offset,list->culled_count,0);
+            }
 
-        if(scenes[i].non_culled_backface_indirect_command_vector.size) {
-            glDisable(GL_CULL_FACE);
-            glBindBuffer(GL_DRAW_INDIRECT_BUFFER,scenes[i].non_culled_backface_indirect_command_buffer);
-            glMultiDrawElementsIndirect(GL_TRIANGLES,GL_UNSIGNED_INT,0,scenes[i].non_culled_backface_indirect_command_vector.size,0);
+            if(list->non_culled_count) {
+                glDisable(GL_CULL_FACE);
+                glMultiDrawElementsIndirect(GL_TRIANGLES,GL_UNSIGNED_INT,(const void*)(uintptr_t)list->non_culled_command_offset,list->non_culled_count,0);
+            }
         }
     }
 
@@ -916,7 +1282,8 @@ void APIENTRY debug_callback(GLenum source, GLenum type, GLuint id, GLenum sever
 }
 
 
-bool load_hdi_skybox(const char* path,GLuint* hdr_texture,GLuint* env_map) {
+// also projects the image's diffuse lighting into SH while the float pixels are at hand
+bool load_hdi_skybox(JobSystem* jobs,const char* path,GLuint* hdr_texture,GLuint* env_map,SH9* irradiance_sh) {
     stbi_set_flip_vertically_on_load(true);
     int width, height, components;
     float *data = stbi_loadf(path, &width, &height, &components, 0);
@@ -925,6 +1292,10 @@ bool load_hdi_skybox(const char* path,GLuint* hdr_texture,GLuint* env_map) {
     if(!data)
         return false;
 
+    SH9 radiance;
+    sh9_project_equirect(jobs,data,width,height,components,&radiance);
+    sh9_irradiance(&radiance,irradiance_sh);
+
     glGenTextures(1, hdr_texture);
     glBindTexture(GL_TEXTURE_2D, *hdr_texture);
     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16F, width, height, 0, GL_RGB, GL_FLOAT, data); 
@@ -1002,7 +1373,7 @@ void skybox_buffers_init(unsigned int* vao_out,unsigned int* fbo_out,unsigned in
     *rbo_out = rbo;
 }
 
-void eq_rec_to_cubemap(unsigned int vao,unsigned int fbo,unsigned int hdr_texture,unsigned int cubemap_texture,unsigned int shader) {
+void eq_rec_to_cubemap(unsigned int vao,unsigned int fbo,unsigned int hdr_texture,unsigned int cubemap_texture,const ShaderProgram* shader) {
     mat4 capture_proj;
     glm_perspective(glm_rad(90.0),1.0f, 0.1f,10.0f,capture_proj); 
 
@@ -1025,9 +1396,9 @@ void eq_rec_to_cubemap(unsigned int vao,unsigned int fbo,unsigned int hdr_textur
     glm_lookat(origin, front, up1, capture_views[4]);
     glm_lookat(origin, back,  up1, capture_views[5]);
 
-    shaderBind(shader);
-    shaderSetInt(shader,"equirectangularMap",0);
-    shaderSetMat4Uniform(shader,"projection",capture_proj);
+    shader_bind(shader);
+    shader_set_int(shader,"equirectangularMap",0);
+    shader_set_mat4(shader,"projection",capture_proj);
     glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_2D,hdr_texture);
 
@@ -1035,7 +1406,7 @@ void eq_rec_to_cubemap(unsigned int vao,unsigned int fbo,unsigned int hdr_textur
     glBindFramebuffer(GL_FRAMEBUFFER, fbo);
 
     for (unsigned int i = 0; i < 6; ++i) {
-        shaderSetMat4Uniform(shader,"view",capture_views[i]);
+        shader_set_mat4(shader,"view",capture_views[i]);
         glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, 
                                GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, cubemap_texture, 0);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -1046,63 +1417,7 @@ void eq_rec_to_cubemap(unsigned int vao,unsigned int fbo,unsigned int hdr_textur
     glBindFramebuffer(GL_FRAMEBUFFER, 0);  
 }
 
-void create_irradiance_cubemap(unsigned int vao,unsigned int fbo,unsigned int rbo,unsigned int shader,unsigned int env_map,unsigned int* irradiance_map) {
-    mat4 capture_proj;
-    glm_perspective(glm_rad(90.0),1.0f, 0.1f,10.0f,capture_proj); 
-
-    mat4 capture_views[6];  
-    vec3 origin = {0.0};
-    vec3 left   = {1.0f,0.0f,0.0};
-    vec3 right  = {-1.0f,0.0f,0.0};
-    vec3 up     = {0.0f,1.0f,0.0};
-    vec3 down   = {0.0f,-1.0f,0.0};
-    vec3 front  = {0.0f,0.0f,1.0};
-    vec3 back   = {0.0f,0.0f,-1.0};
-    vec3 up1 = {0.0,-1.0f,0.0};
-    vec3 up2 = {0.0,0.0f,1.0};
-    vec3 up3 = {0.0,0.0,-1.0};
-
-    glm_lookat(origin, left,  up1, capture_views[0]);
-    glm_lookat(origin, right, up1, capture_views[1]);
-    glm_lookat(origin, up,    up2, capture_views[2]);
-    glm_lookat(origin, down,  up3, capture_views[3]);
-    glm_lookat(origin, front, up1, capture_views[4]);
-    glm_lookat(origin, back,  up1, capture_views[5]);
-
-    glGenTextures(1, irradiance_map);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, *irradiance_map);
-    glTexStorage2D(GL_TEXTURE_CUBE_MAP, 1, GL_RGB16F, 32, 32);
-
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-    shaderBind(shader);  
-    shaderSetInt(shader,"enviromentMap",0);
-    shaderSetMat4Uniform(shader,"projection",capture_proj);
-    glActiveTexture(GL_TEXTURE0); 
-    glBindTexture(GL_TEXTURE_CUBE_MAP,env_map);
-
-    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
-    glBindRenderbuffer(GL_RENDERBUFFER, rbo);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, 32, 32);
-
-    glViewport(0, 0, 32, 32);
-    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
-    for (unsigned int i = 0; i < 6; ++i) {
-        shaderSetMat4Uniform(shader,"view", capture_views[i]);
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, *irradiance_map, 0);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-        glBindVertexArray(vao); 
-        glDrawElements(GL_TRIANGLES,36,GL_UNSIGNED_INT,0); 
-    }
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-}
-
-void prefilter_cubemap(unsigned int vao,unsigned int fbo, unsigned int rbo,unsigned int shader,unsigned int env_map,unsigned int *prefilter_map) {
+void prefilter_cubemap(unsigned int vao,unsigned int fbo, unsigned int rbo,const ShaderProgram* shader,unsigned int env_map,unsigned int *prefilter_map) {
     mat4 capture_proj;
     glm_perspective(glm_rad(90.0),1.0f, 0.1f,10.0f,capture_proj); 
 
@@ -1136,9 +1451,9 @@ void prefilter_cubemap(unsigned int vao,unsigned int fbo, unsigned int rbo,unsig
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
 
-    shaderBind(shader);
-    shaderSetInt(shader, "environmentMap", 0);
-    shaderSetMat4Uniform(shader, "projection", capture_proj);
+    shader_bind(shader);
+    shader_set_int(shader,"environmentMap", 0);
+    shader_set_mat4(shader,"projection", capture_proj);
     glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_CUBE_MAP, env_map);
 
@@ -1153,9 +1468,9 @@ void prefilter_cubemap(unsigned int vao,unsigned int fbo, unsigned int rbo,unsig
         glViewport(0, 0, mipWidth, mipHeight);
 
         float roughness = (float)mip / (float)(maxMipLevels - 1);
-        shaderSetFloat(shader, "roughness", roughness);
+        shader_set_float(shader,"roughness", roughness);
         for (unsigned int i = 0; i < 6; ++i) {
-            shaderSetMat4Uniform(shader, "view", capture_views[i]);
+            shader_set_mat4(shader,"view", capture_views[i]);
             glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, *prefilter_map, mip);
             glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
@@ -1166,7 +1481,7 @@ void prefilter_cubemap(unsigned int vao,unsigned int fbo, unsigned int rbo,unsig
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 }
 
-void generate_brdf_lut(unsigned int fbo,unsigned int rbo,unsigned int shader,unsigned int *brdf_lut) {
+void generate_brdf_lut(unsigned int fbo,unsigned int rbo,const ShaderProgram* shader,unsigned int *brdf_lut) {
     unsigned int vao, vbo, ebo;
     float vertices[] = {
         -1.0f,  1.0f, 0.0f,  0.0f, 1.0f, // Top Left
@@ -1215,27 +1530,28 @@ void generate_brdf_lut(unsigned int fbo,unsigned int rbo,unsigned int shader,uns
 
     glViewport(0, 0, 512, 512);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    shaderBind(shader);
+    shader_bind(shader);
 
     glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
 
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 }
 
-void render_skybox_cube(unsigned int vao,unsigned int env_map,unsigned int shader) {
-    shaderSetInt(shader, "environmentMap", 0);
+void render_skybox_cube(unsigned int vao,unsigned int env_map,const ShaderProgram* shader) {
+    shader_bind(shader);
     glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_CUBE_MAP,env_map);
     glBindVertexArray(vao); 
     glDrawElements(GL_TRIANGLES,36,GL_UNSIGNED_INT,0);
 }
 
-void draw_quad(u32 shader,u32 texture,float len) {
+// one layer of a texture array in the top left corner
+void draw_quad(const ShaderProgram* shader,i32 layer_location,u32 texture_array,u32 layer,float len) {
     static u32 vbo = 0;
     static u32 ebo = 0;
     static u32 vao = 0;
 
-    shaderBind(shader);
+    shader_bind(shader);
     
     if(!vao && !vbo && !ebo) {
         static float vertices[] = {
@@ -1269,13 +1585,12 @@ void draw_quad(u32 shader,u32 texture,float len) {
         glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
 
         glBindVertexArray(0);
-
-        shaderSetInt(shader,"sampler",0);
     }
 
+    glUniform1i(layer_location,layer);
     glClear(GL_DEPTH_BUFFER_BIT);
     glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D,texture);
+    glBindTexture(GL_TEXTURE_2D_ARRAY,texture_array);
     glBindVertexArray(vao);
     glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
 }
@@ -1283,31 +1598,153 @@ void draw_quad(u32 shader,u32 texture,float len) {
 void scene_translate(Scene* scene,vec3 translation) {
     for(int i = 0; i < scene->vertex_vector.size; i++)
         glm_vec3_add(translation,scene->vertex_vector.data[i].position,scene->vertex_vector.data[i].position);
+    for(int i = 0; i < scene->packed_vertex_vector.size; i++)
+        glm_vec3_add(translation,scene->packed_vertex_vector.data[i].position,scene->packed_vertex_vector.data[i].position);
+    glm_vec3_add(translation,scene->aabb.min,scene->aabb.min);
+    glm_vec3_add(translation,scene->aabb.max,scene->aabb.max);
+    for(int i = 0; i < scene->culled_command_aabb_vector.size; i++) {
+        glm_vec3_add(translation,scene->culled_command_aabb_vector.data[i].min,scene->culled_command_aabb_vector.data[i].min);
+        glm_vec3_add(translation,scene->culled_command_aabb_vector.data[i].max,scene->culled_command_aabb_vector.data[i].max);
+    }
+    for(int i = 0; i < scene->non_culled_command_aabb_vector.size; i++) {
+        glm_vec3_add(translation,scene->non_culled_command_aabb_vector.data[i].min,scene->non_culled_command_aabb_vector.data[i].min);
+        glm_vec3_add(translation,scene->non_culled_command_aabb_vector.data[i].max,scene->non_culled_command_aabb_vector.data[i].max);
+    }
+    for(int i = 0; i < scene->meshlet_vector.size; i++) {
+        glm_vec3_add(translation,scene->meshlet_vector.data[i].sphere,scene->meshlet_vector.data[i].sphere);
+        glm_vec3_add(translation,scene->meshlet_vector.data[i].cone_apex,scene->meshlet_vector.data[i].cone_apex);
+    }
+}
+
+// a negative scale swaps the sides
+void aabb_scale(AABB* box,vec3 scale) {
+    vec3 a, b;
+    glm_vec3_mul(scale,box->min,a);
+    glm_vec3_mul(scale,box->max,b);
+    glm_vec3_minv(a,b,box->min);
+    glm_vec3_maxv(a,b,box->max);
 }
 
 void scene_scale(Scene* scene,vec3 scale) {
     for(int i = 0; i < scene->vertex_vector.size; i++)
         glm_vec3_mul(scale,scene->vertex_vector.data[i].position,scene->vertex_vector.data[i].position);
+    for(int i = 0; i < scene->packed_vertex_vector.size; i++)
+        glm_vec3_mul(scale,scene->packed_vertex_vector.data[i].position,scene->packed_vertex_vector.data[i].position);
+
+    aabb_scale(&scene->aabb,scale);
+    for(int i = 0; i < scene->culled_command_aabb_vector.size; i++)
+        aabb_scale(&scene->culled_command_aabb_vector.data[i],scale);
+    for(int i = 0; i < scene->non_culled_command_aabb_vector.size; i++)
+        aabb_scale(&scene->non_culled_command_aabb_vector.data[i],scale);
+
+    // normal cones only survive a uniform positive scale
+    bool uniform = scale[0] > 0.0f && scale[0] == scale[1] && scale[0] == scale[2];
+    f32 largest = glm_max(fabsf(scale[0]),glm_max(fabsf(scale[1]),fabsf(scale[2])));
+    for(int i = 0; i < scene->meshlet_vector.size; i++) {
+        Meshlet* meshlet = &scene->meshlet_vector.data[i];
+        glm_vec3_mul(scale,meshlet->sphere,meshlet->sphere);
+        glm_vec3_mul(scale,meshlet->cone_apex,meshlet->cone_apex);
+        meshlet->sphere[3] *= largest;
+        if(!uniform)
+            meshlet->cone[3] = 2.0f;
+    }
 }
 
-int main() {
-    Arena arena;
-        arena_create(&arena,MB(100));
+// command line modes that run a self check instead of the renderer, see src/bench
+typedef struct {
+    const char* flag;
+    int (*run)(int argc,char** argv); // gets the arguments after the flag
+}BenchMode;
+
+static const BenchMode bench_modes[] = {
+    { "--texture-decode-bench", texture_decode_benchmark },
+    { "--texture-compress-bench", texture_compress_benchmark },
+    { "--mip-bench", mip_benchmark },
+    { "--vertex-pack-bench", vertex_pack_benchmark },
+    { "--scene-cache-bench", scene_cache_benchmark },
+    { "--mesh-optimize-bench", mesh_optimize_benchmark },
+    { "--meshlet-bench", meshlet_benchmark },
+    { "--cull-bench", cull_benchmark },
+    { "--bvh-bench", bvh_benchmark },
+    { "--raycast-bench", raycast_benchmark },
+    { "--profile-bench", profile_benchmark },
+    { "--stream-bench", stream_benchmark },
+    { "--residency-bench", residency_benchmark },
+    { "--cascade-bench", cascade_benchmark },
+    { "--shadow-cache-bench", shadow_cache_benchmark },
+    { "--cluster-bench", cluster_benchmark },
+    { "--sh-bench", sh_benchmark },
+    { "--ibl-bake", ibl_bake_file },
+    { "--ibl-bake-bench", ibl_bake_benchmark },
+};
+
+// value of "name <value>" anywhere on the command line, removed from argv so positional arguments are unaffected
+u32 take_option(int* argc,char** argv,const char* name,u32 fallback) {
+    for(int i = 1; i + 1 < *argc; i++) {
+        if(strcmp(argv[i],name) == 0) {
+            u32 value = atoi(argv[i + 1]);
+            memmove(argv + i,argv + i + 2,(*argc - i - 1) * sizeof(char*)); // with the terminating NULL
+            *argc -= 2;
+            return value;
+        }
+    }
+    return fallback;
+}
 
-    if (!glfwInit()) {
-        printf("Failed to initialize GLFW\n");
-        return -1;
+int main(int argc,char** argv) {
+    for(u32 i = 0; i < sizeof(bench_modes) / sizeof(BenchMode); i++) {
+        if(argc > 1 && strcmp(argv[1],bench_modes[i].flag) == 0)
+            return bench_modes[i].run(argc - 2,argv + 2);
     }
 
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 5);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    Arena arena;
+        arena_create(&arena,MB(16));
+    Arena frame_arena;
+        arena_create(&frame_arena,MB(4));
+    JobSystem* jobs = job_system_create(0);
+
+    // --headless <frames> [output_dir] [camera_path] [capture_every]
+    // --frame-bench <frames> [camera_path] [output_json]
+    // --record-path <camera_path>
+    // these go with any mode, they are taken out before the mode's own arguments are read
+    u32 random_light_count = take_option(&argc,argv,"--lights",0);
+    u32 cascade_count = take_option(&argc,argv,"--shadow-cascades",SHADOW_MAX_CASCADES);
+    cascade_count = cascade_count < 1 ? 1 : cascade_count > SHADOW_MAX_CASCADES ? SHADOW_MAX_CASCADES : cascade_count;
+    bool shadow_caching = take_option(&argc,argv,"--shadow-cache",1) != 0;
+    bool texture_compression = take_option(&argc,argv,"--texture-compression",1) != 0;
+    u32 texture_budget_mb = take_option(&argc,argv,"--texture-budget",512);
+    bool frame_bench = argc > 2 && strcmp(argv[1],"--frame-bench") == 0;
+    bool headless = frame_bench || (argc > 2 && strcmp(argv[1],"--headless") == 0);
+    u32 headless_frames = headless ? atoi(argv[2]) : 0;
+    const char* capture_directory = headless && !frame_bench && argc > 3 ? argv[3] : "frames";
+    const char* camera_path_file = frame_bench ? (argc > 3 ? argv[3] : NULL) : (headless && argc > 4 ? argv[4] : NULL);
+    u32 capture_every = headless && !frame_bench && argc > 5 ? atoi(argv[5]) : 1;
+    const char* bench_json = frame_bench && argc > 4 ? argv[4] : "frame_bench.json";
+    const char* record_path_file = argc > 2 && strcmp(argv[1],"--record-path") == 0 ? argv[2] : NULL;
+
+    Window* window;
+    if(headless) {
+        window = windowCreateHeadless(HEADLESS_WIDTH,HEADLESS_HEIGHT,"CCraft");
+        if (!window) {
+            printf("Failed to create a headless GL context\n");
+            return -1;
+        }
+    } else {
+        if (!glfwInit()) {
+            printf("Failed to initialize GLFW\n");
+            return -1;
+        }
+
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 5);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
-    Window* window = windowCreate(1280,960,"CCraft");
-    if (!window) {
-        printf("Failed to create GLFW window\n");
-        glfwTerminate();
-        return -1;
+        window = windowCreate(1280,960,"CCraft");
+        if (!window) {
+            printf("Failed to create GLFW window\n");
+            glfwTerminate();
+            return -1;
+        }
     }
 
     if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
@@ -1327,44 +1764,69 @@ int main() {
     glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
     glDepthFunc(GL_LEQUAL);
 
-    GLuint defaultProgram = shaderProgramCreate(path("shaders/default_vs.glsl"),path("shaders/default_fs.glsl"));
-    GLuint eqrec_to_cubemap_shader = shaderProgramCreate(path("shaders/cubemap_vs.glsl"),path("shaders/eqrec_to_cubemap_fs.glsl"));
-    GLuint irradiance_shader = shaderProgramCreate(path("shaders/cubemap_vs.glsl"),path("shaders/irradiance_convolution_fs.glsl"));
-    GLuint background_shader = shaderProgramCreate(path("shaders/background_vs.glsl"),path("shaders/background_fs.glsl"));
-    GLuint prefilter_shader = shaderProgramCreate(path("shaders/cubemap_vs.glsl"),path("shaders/prefilter_fs.glsl"));
-    GLuint brdf_shader = shaderProgramCreate(path("shaders/brdf_vs.glsl"),path("shaders/brdf_fs.glsl"));
-    GLuint shadowmap_shader = shaderProgramCreate(path("shaders/shadow_map_vs.glsl"),path("shaders/shadow_map_fs.glsl"));
-    GLuint quad_shader = shaderProgramCreate(path("shaders/quad_vs.glsl"),path("shaders/quad_fs.glsl"));
+    ShaderProgram defaultProgram, eqrec_to_cubemap_shader, background_shader, prefilter_shader, brdf_shader, shadowmap_shader, quad_shader;
+    if(!shader_program_create(&defaultProgram,path("shaders/default_vs.glsl"),path("shaders/default_fs.glsl")) ||
+       !shader_program_create(&eqrec_to_cubemap_shader,path("shaders/cubemap_vs.glsl"),path("shaders/eqrec_to_cubemap_fs.glsl")) ||
+       !shader_program_create(&background_shader,path("shaders/background_vs.glsl"),path("shaders/background_fs.glsl")) ||
+       !shader_program_create(&prefilter_shader,path("shaders/cubemap_vs.glsl"),path("shaders/prefilter_fs.glsl")) ||
+       !shader_program_create(&brdf_shader,path("shaders/brdf_vs.glsl"),path("shaders/brdf_fs.glsl")) ||
+       !shader_program_create(&shadowmap_shader,path("shaders/shadow_map_vs.glsl"),path("shaders/shadow_map_fs.glsl")) ||
+       !shader_program_create(&quad_shader,path("shaders/quad_vs.glsl"),path("shaders/quad_fs.glsl")))
+        return -1;
+    i32 packed_vertices_location = shader_uniform_location(&defaultProgram,"packed_vertices");
+    i32 cascade_location = shader_uniform_location(&shadowmap_shader,"cascade");
+    i32 layer_location = shader_uniform_location(&quad_shader,"layer");
 
     Camera defaultCam;
     cameraDefaultInit(&defaultCam);
     mat4 proj;
     mat4 view;
     cameraViewMat(&defaultCam,view);
-    glm_perspective(glm_rad(90.0f),windowAspectRatio(window),0.01f,100.0f,proj);
+    glm_perspective(glm_rad(90.0f),windowAspectRatio(window),CAMERA_NEAR,CAMERA_FAR,proj);
     
-    GLuint hdr_texture,env_map,irradiance_map,skybox_vao,skybox_fbo,skybox_rbo,prefilter_map,brdf_lut;
-    load_hdi_skybox(asset_path("skybox.hdr"),&hdr_texture,&env_map);
+    GLuint hdr_texture,env_map,skybox_vao,skybox_fbo,skybox_rbo,prefilter_map,brdf_lut;
     skybox_buffers_init(&skybox_vao,&skybox_fbo,&skybox_rbo);
-    eq_rec_to_cubemap(skybox_vao,skybox_fbo,hdr_texture,env_map,eqrec_to_cubemap_shader);
-    create_irradiance_cubemap(skybox_vao,skybox_fbo,skybox_rbo,irradiance_shader,env_map,&irradiance_map);
-    prefilter_cubemap(skybox_vao, skybox_fbo, skybox_rbo, prefilter_shader,env_map, &prefilter_map);
-    generate_brdf_lut(skybox_fbo, skybox_rbo, brdf_shader, &brdf_lut);
 
-    GLuint64 bindless_irradiance_cubemap = glGetTextureHandleARB(irradiance_map);
+    // the bake only depends on the environment image and the bake shaders, later launches load the result
+    static const char* ibl_shader_paths[] = {
+        path("shaders/cubemap_vs.glsl"), path("shaders/eqrec_to_cubemap_fs.glsl"), path("shaders/prefilter_fs.glsl"),
+        path("shaders/brdf_vs.glsl"), path("shaders/brdf_fs.glsl"),
+    };
+    const char* ibl_cache_path = asset_path("skybox.hdr" IBL_CACHE_EXTENSION);
+    IBLCacheKey ibl_key;
+    IBLEnvironment ibl;
+    f64 ibl_start = timer_now();
+    bool has_ibl_key = ibl_cache_key(asset_path("skybox.hdr"),ibl_shader_paths,sizeof(ibl_shader_paths) / sizeof(ibl_shader_paths[0]),&ibl_key);
+    if(has_ibl_key && ibl_cache_load(ibl_cache_path,&ibl_key,&ibl)) {
+        glFinish();
+        printf("[IBL] Loaded \"%s\" in %.1f ms\n",ibl_cache_path,(timer_now() - ibl_start) * 1000.0);
+    } else {
+        load_hdi_skybox(jobs,asset_path("skybox.hdr"),&hdr_texture,&ibl.env_map,&ibl.irradiance_sh);
+        eq_rec_to_cubemap(skybox_vao,skybox_fbo,hdr_texture,ibl.env_map,&eqrec_to_cubemap_shader);
+        prefilter_cubemap(skybox_vao, skybox_fbo, skybox_rbo, &prefilter_shader,ibl.env_map, &ibl.prefilter_map);
+        generate_brdf_lut(skybox_fbo, skybox_rbo, &brdf_shader, &ibl.brdf_lut);
+        glDeleteTextures(1,&hdr_texture);
+        glFinish();
+        printf("[IBL] Baked \"%s\" in %.1f ms\n",asset_path("skybox.hdr"),(timer_now() - ibl_start) * 1000.0);
+        if(has_ibl_key && !ibl_cache_write(ibl_cache_path,&ibl_key,&ibl))
+            fprintf(stderr,"[IBL] Failed to write \"%s\"\n",ibl_cache_path);
+    }
+    env_map = ibl.env_map;
+    prefilter_map = ibl.prefilter_map;
+    brdf_lut = ibl.brdf_lut;
+
     GLuint64 prefilter_bindless = glGetTextureHandleARB(prefilter_map);
     GLuint64 brdf_bindless = glGetTextureHandleARB(brdf_lut);
 
-    glMakeTextureHandleResidentARB(bindless_irradiance_cubemap);
     glMakeTextureHandleResidentARB(prefilter_bindless);
     glMakeTextureHandleResidentARB(brdf_bindless);
 
-    shaderBind(defaultProgram);
-    shaderSetInt(defaultProgram,"dir_shadowmap",0);
-    glUniformHandleui64ARB(glGetUniformLocation(defaultProgram, "irradiance_map"), bindless_irradiance_cubemap);
-    glUniformHandleui64ARB(glGetUniformLocation(defaultProgram, "prefilter_map"), prefilter_bindless);
-    glUniformHandleui64ARB(glGetUniformLocation(defaultProgram, "brdf_lut"), brdf_bindless);
-    shaderBind(0);
+    shader_set_int(&defaultProgram,"dir_shadowmap",0);
+    shader_set_vec4_array(&defaultProgram,"irradiance_sh",ibl.irradiance_sh.coefficients,SH_COEFFICIENT_COUNT);
+    shader_set_texture_handle(&defaultProgram,"prefilter_map",prefilter_bindless);
+    shader_set_texture_handle(&defaultProgram,"brdf_lut",brdf_bindless);
+    shader_set_int(&background_shader,"environmentMap",0);
+    shader_set_int(&quad_shader,"sampler",0);
 
     glViewport(0, 0, windowWidth(window), windowHeight(window));
     glEnable(GL_BLEND);
@@ -1379,6 +1841,7 @@ int main() {
     bool cameraMoved = false;
     
     GLuint64 missing_texture_handle = bindless_missing_texture(); 
+    ResidentTexture missing_texture = { missing_texture_handle, missing_texture_handle, 4, 4 };
     Material missing_material = {0};
     missing_material.base_color[0] = 1.0f;
     missing_material.base_color[1] = 1.0f;
@@ -1389,40 +1852,131 @@ int main() {
     u32 scene_count = sizeof(scenes) / sizeof(Scene);
 
     scene_init(&scenes[0]);
+    scenes[0].import_flags = SCENE_IMPORT_PACKED_VERTICES | SCENE_IMPORT_OPTIMIZE_MESHES | SCENE_IMPORT_WELD_VERTICES |
+                             SCENE_IMPORT_BUILD_MESHLETS | (texture_compression ? 0 : SCENE_IMPORT_RAW_TEXTURES);
     vector_push(scenes[0].texture_handle_vector,GLuint64,missing_texture_handle);
+    vector_push(scenes[0].resident_texture_vector,ResidentTexture,missing_texture);
     vector_push(scenes[0].material_vector,Material,missing_material);
 
     PointLight camera_light = { .color_intensity = {1.0f,0.0f,1.0f,0.5f}, .pos = {defaultCam.pos[0],defaultCam.pos[1],defaultCam.pos[2] }, .attenuation_factors = {0.5,0.5,0.5} };
     vector_push(scenes[0].point_light_vector,PointLight,camera_light);
 
-    load_scene_from_gltf(&arena,asset_path("city"), "scene.gltf", &scenes[0]);
+    load_scene_from_gltf(&arena,jobs,asset_path("city"), "scene.gltf", &scenes[0]);
     scene_buffers_init(&scenes[0]);    
 
 
     scene_init(&scenes[1]);
     vector_push(scenes[1].texture_handle_vector,GLuint64,missing_texture_handle);
+    vector_push(scenes[1].resident_texture_vector,ResidentTexture,missing_texture);
     vector_push(scenes[1].material_vector,Material,missing_material);
 
-    vector_push(scenes[1].point_light_vector,PointLight,camera_light);
-
-    load_scene_from_gltf(&arena,asset_path("car"), "scene.gltf", &scenes[1]);
+    load_scene_from_gltf(&arena,jobs,asset_path("car"), "scene.gltf", &scenes[1]);
     vec3 scale = { 0.01f, 0.01f, 0.01f };
     vec3 translation = {-5.0,0.25,0.0};
     scene_scale(&scenes[1],scale);
     scene_translate(&scenes[1],translation);
     
     scene_buffers_init(&scenes[1]);    
+    arena_print_stats(&arena,"load");
+
+    // everything loads resident, the first frame evicts what it does not draw down to the budget
+    TextureResidency residency;
+    texture_residency_init(&residency,(u64)texture_budget_mb << 20,RESIDENCY_MAX_PROMOTIONS);
+    for(int i = 0; i < scene_count; i++)
+        scene_residency_register(&residency,&scenes[i]);
+
+    if(random_light_count) {
+        u32 first = scenes[0].point_light_vector.size;
+        u32 light_total = first + random_light_count;
+        vector_resize(scenes[0].point_light_vector,PointLight,light_total);
+        u32 seed = 0x2545f491u;
+        random_point_lights(&seed,&scenes[0].aabb,random_light_count,scenes[0].point_light_vector.data + first);
+    }
+
+    // every scene's lights in one world space list the clusters index into, the camera light first
+    vector(PointLight) world_lights;
+    vector_create(world_lights,PointLight);
+    for(int i = 0; i < scene_count; i++) {
+        for(u32 l = 0; l < scenes[i].point_light_vector.size; l++) {
+            PointLight* light = &scenes[i].point_light_vector.data[l];
+            light->attenuation_factors[3] = point_light_radius(light);
+        }
+        vector_push_array(world_lights,PointLight,scenes[i].point_light_vector.data,scenes[i].point_light_vector.size);
+    }
+    AABB world_bounds = scenes[0].aabb;
+    for(int i = 1; i < scene_count; i++) {
+        glm_vec3_minv(world_bounds.min,scenes[i].aabb.min,world_bounds.min);
+        glm_vec3_maxv(world_bounds.max,scenes[i].aabb.max,world_bounds.max);
+    }
+
+    ShadowCache shadow_cache;
+    shadow_cache_init(&shadow_cache,shadow_caching,SHADOW_CACHE_ANGLE);
+
+    LightClusterGrid light_grid;
+    light_cluster_grid_init(&light_grid);
+    printf("[CLUSTER] %u point lights in %ux%ux%u froxels\n",world_lights.size,CLUSTER_X,CLUSTER_Y,CLUSTER_Z);
+
+    // only picking reads the raycasters, they are built on the first click instead of delaying the first frame
+    SceneRaycaster raycasters[sizeof(scenes) / sizeof(Scene)];
+    bool raycasters_built = false;
 
 
     bool wireframe = false;
     u32 depth_map = 0;
 
+    // headless runs render into an FBO along a scripted camera path at a fixed timestep
+    OffscreenTarget offscreen = {0};
+    CameraPath camera_path;
+    camera_path_init(&camera_path);
+    FILE* timing_csv = NULL;
+    u32 frame_index = 0;
+    // the frame bench renders the same way but keeps per pass timings instead of images
+    FrameStats frame_stats;
+    frame_stats_init(&frame_stats,frame_bench ? headless_frames : 0);
+    u32 warmup_frames = frame_bench ? FRAME_BENCH_WARMUP : 0;
+    f32 record_start = 0.0f, next_record_time = 0.0f;
+    if(headless) {
+        if(!offscreen_target_create(&offscreen,windowWidth(window),windowHeight(window)))
+            return -1;
+        if(camera_path_file && !camera_path_load(&camera_path,camera_path_file))
+            return -1;
+        if(!camera_path_file)
+            camera_path_orbit(&camera_path,&scenes[0].aabb,10.0f,8);
+    }
+    if(headless && !frame_bench) {
+        if(!capture_directory_create(capture_directory))
+            return -1;
+
+        char csv_path[512];
+        snprintf(csv_path,sizeof(csv_path),"%s/frames.csv",capture_directory);
+        timing_csv = fopen(csv_path,"w");
+        if(!timing_csv) {
+            fprintf(stderr,"[CAPTURE] Failed to open \"%s\"\n",csv_path);
+            return -1;
+        }
+        fprintf(timing_csv,"frame,time_s,cpu_ms,gpu_wait_ms,readback_ms,write_ms\n");
+    }
+
+    // lights, frame uniforms and the culled draw lists are rewritten every frame into a persistently mapped ring
+    StreamBuffer stream;
+    if(!stream_buffer_create(&stream,scene_stream_slice_size(scenes,scene_count,world_lights.size),STREAM_BUFFER_FRAMES))
+        return -1;
+
+    Profiler* profiler = profiler_create(true);
+
     while (!windowShouldClose(window)) {
+        if(headless && frame_index >= headless_frames + warmup_frames)
+            break;
+        f64 frame_start = timer_now();
+        PROFILE_BEGIN(profiler,"frame");
+        stream_buffer_begin_frame(&stream);
+        arena_reset(&frame_arena);
 
         float currentFrame = (float)glfwGetTime();
-        deltaTime = currentFrame - lastFrame;
+        deltaTime = headless ? HEADLESS_TIMESTEP : currentFrame - lastFrame;
         lastFrame = currentFrame;
         
+        glBindFramebuffer(GL_FRAMEBUFFER,offscreen.framebuffer);
         glClearColor(32.0f/255.0f,167.0f/255.0f,219.0f/255.0f,1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
         
@@ -1458,13 +2012,57 @@ int main() {
         if(windowGetKey(window,GLFW_KEY_ESCAPE) == GLFW_PRESS)
             windowToggleMouseLock(window);
 
+        i32 p_state = windowGetKey(window,GLFW_KEY_P);
+        static bool trace_lock = false;
+        if(p_state == GLFW_PRESS && !trace_lock)
+            profiler_write_chrome_trace(profiler,"trace.json");
+        trace_lock = p_state == GLFW_PRESS;
+
+        // left click with a free cursor prints what is under it
+        i32 click_state = windowMouseButtonState(window,GLFW_MOUSE_BUTTON_LEFT);
+        static bool click_lock = false;
+        if(click_state == GLFW_PRESS && !click_lock && windowPaused(window)) {
+            if(!raycasters_built) {
+                for(int i = 0; i < scene_count; i++)
+                    scene_raycaster_build(&raycasters[i],jobs,&scenes[i]);
+                raycasters_built = true;
+            }
+            vec2 mousePos;
+            windowMousePos(window,mousePos);
+            Ray ray;
+            ray_from_screen(&defaultCam,proj,mousePos[0],mousePos[1],(f32)windowWidth(window),(f32)windowHeight(window),&ray);
+            RayHit closest = {0};
+            u32 closest_scene = 0;
+            for(int i = 0; i < scene_count; i++) {
+                RayHit hit;
+                if(scene_raycast(&raycasters[i],&ray,&hit) && (!closest.hit || hit.t < closest.t)) {
+                    closest = hit;
+                    closest_scene = i;
+                }
+            }
+            if(closest.hit)
+                printf("[PICK] scene %u primitive %u triangle %u material %u at %.2f (u %.2f v %.2f)\n",closest_scene,closest.primitive,
+                       closest.triangle,closest.material_index,closest.t,closest.u,closest.v);
+            else
+                printf("[PICK] nothing\n");
+        }
+        click_lock = click_state == GLFW_PRESS;
+
+        f32 path_time = (frame_index > warmup_frames ? frame_index - warmup_frames : 0) * HEADLESS_TIMESTEP;
+        if(headless) {
+            camera_path_sample(&camera_path,path_time,&defaultCam);
+            cameraViewMat(&defaultCam,view);
+        }
+        if(record_path_file && currentFrame >= next_record_time) {
+            if(!camera_path.keys.size)
+                record_start = currentFrame;
+            camera_path_record(&camera_path,currentFrame - record_start,&defaultCam);
+            next_record_time = currentFrame + CAMERA_RECORD_INTERVAL;
+        }
+
         if(windowResized(window))
-            glm_perspective(glm_rad(90.0f),windowAspectRatio(window),0.01f,100.0f,proj);
+            glm_perspective(glm_rad(90.0f),windowAspectRatio(window),CAMERA_NEAR,CAMERA_FAR,proj);
 
-        shaderBind(defaultProgram);
-        shaderSetMat4Uniform(defaultProgram, "proj", proj);
-        shaderSetMat4Uniform(defaultProgram, "view", view);
-        
         int q_state = windowGetKey(window,GLFW_KEY_Q); 
         static bool lock = false;
         if(q_state == GLFW_PRESS && !lock) {
@@ -1478,13 +2076,7 @@ int main() {
             lock = false;
         }
 
-        mat4 light_ortho;
-        glm_ortho(-50,50,-50,50,-0.1,50,light_ortho);
-        
-        vec3 origin = {0.0f,0.0f,0.0f};
-
-        for(int i = 0; i < scene_count; i++)
-            glm_vec3_copy(defaultCam.pos,(float*)&scenes[i].point_light_vector.data[0].pos);
+        glm_vec3_copy(defaultCam.pos,world_lights.data[0].pos);
 
         static float time = 0.0f;
         time += 0.005f;
@@ -1494,22 +2086,14 @@ int main() {
         light_dir[2] = 0.0f;
 
         glm_normalize(light_dir);
-        vec3 light_pos;
-        float distance = 30.0f;
-        glm_vec3_scale(light_dir,distance, light_pos); 
-        glm_vec3_add(origin, light_pos, light_pos);
-
-        mat4 light_view;
-        vec3 up = {0.0f, 1.0f, 0.0f};
-        if(fabs(light_dir[1]) > 0.99f) up[0] = 1.0f; 
-        glm_lookat(light_pos, origin, up, light_view);
- 
-        render_directional_shadowmap(scenes,scene_count,light_ortho,light_view,light_dir,shadowmap_shader,&depth_map);
-        draw_quad(quad_shader,depth_map,0.4f);
 
-        glViewport(0,0,windowWidth(window),windowHeight(window));
-        scene_draw(scenes,scene_count,defaultProgram,defaultCam.pos,false,depth_map,light_view,light_ortho,light_dir);
-        
+        CascadeCamera cascade_camera = { .tan_half_fov_y = tanf(glm_rad(90.0f) * 0.5f), .aspect = windowAspectRatio(window) };
+        glm_mat4_copy(view,cascade_camera.view);
+        // cascades that would render the same as last time keep their layer, shading samples with the cached matrices
+        u32 render_cascades = shadow_cache_update(&shadow_cache,&cascade_camera,light_dir,&world_bounds,CAMERA_NEAR,SHADOW_DISTANCE,
+                                                  SHADOW_SPLIT_LAMBDA,cascade_count,SHADOW_CASCADE_RESOLUTION);
+        ShadowCascade* cascades = shadow_cache.cascades;
+
         static u32 color_state = 0;
         if(windowKeyState(window,GLFW_KEY_1) == GLFW_PRESS)
             color_state = 0;
@@ -1520,20 +2104,156 @@ int main() {
         else if(windowKeyState(window,GLFW_KEY_4) == GLFW_PRESS)
             color_state = 3;
 
-        shaderBind(defaultProgram);
-        shaderSetInt(defaultProgram,"color_state",color_state);
-
-        shaderBind(background_shader);
-        shaderSetMat4Uniform(background_shader,"view",view);
-        shaderSetMat4Uniform(background_shader,"projection",proj);
-        render_skybox_cube(skybox_vao,env_map,background_shader);
+        // everything the passes share goes up in one upload
+        FrameUniforms frame_uniforms = {0};
+        glm_mat4_copy(proj,frame_uniforms.proj);
+        glm_mat4_copy(view,frame_uniforms.view);
+        for(u32 c = 0; c < cascade_count; c++) {
+            glm_mat4_copy(cascades[c].view_proj,frame_uniforms.cascade_view_proj[c]);
+            frame_uniforms.cascade_splits[c] = cascades[c].split_far;
+        }
+        frame_uniforms.cascade_count = cascade_count;
+        glm_vec3_copy(defaultCam.pos,frame_uniforms.camera_pos);
+        glm_vec3_copy(light_dir,frame_uniforms.light_dir);
+        frame_uniforms.color_state = color_state;
+        frame_uniforms.viewport[0] = windowWidth(window);
+        frame_uniforms.viewport[1] = windowHeight(window);
+        frame_uniforms.cluster_near = LIGHT_CLUSTER_NEAR;
+        frame_uniforms.cluster_far = LIGHT_CLUSTER_FAR;
+        u64 frame_uniform_offset;
+        if(stream_buffer_write(&stream,&frame_uniforms,sizeof(FrameUniforms),stream.uniform_alignment,&frame_uniform_offset))
+            glBindBufferRange(GL_UNIFORM_BUFFER,FRAME_UNIFORM_BINDING,stream.buffer,frame_uniform_offset,sizeof(FrameUniforms));
+
+        mat4 camera_view_proj;
+        glm_mat4_mul(proj,view,camera_view_proj);
+        Frustum camera_frustum, cascade_frusta[SHADOW_MAX_CASCADES];
+        frustum_from_matrix(camera_view_proj,&camera_frustum);
+        for(u32 c = 0; c < cascade_count; c++)
+            frustum_from_matrix(cascades[c].view_proj,&cascade_frusta[c]);
+        f64 lights_start = timer_now();
+        PROFILE_BEGIN(profiler,"light clusters");
+        ClusterView cluster_view = { .tan_half_fov_y = tanf(glm_rad(90.0f) * 0.5f), .aspect = windowAspectRatio(window),
+                                     .z_near = LIGHT_CLUSTER_NEAR, .z_far = LIGHT_CLUSTER_FAR };
+        glm_mat4_copy(view,cluster_view.view);
+        light_cluster_build(&light_grid,jobs,world_lights.data,world_lights.size,&cluster_view);
+        upload_light_clusters(&stream,&light_grid,world_lights.data,world_lights.size);
+        PROFILE_END(profiler);
+        f64 cull_start = timer_now();
+        PROFILE_BEGIN(profiler,"cull");
+        MeshletCullView meshlet_view;
+        meshlet_cull_view(camera_view_proj,defaultCam.pos,&meshlet_view);
+        texture_residency_begin_frame(&residency);
+        for(int i = 0; i < scene_count; i++) {
+            scene_cull_view(&frame_arena,&stream,&scenes[i],&scenes[i].camera_draw_list,&camera_frustum,&meshlet_view,&residency);
+            for(u32 c = 0; c < cascade_count; c++) {
+                if(render_cascades & (1u << c))
+                    scene_cull_view(&frame_arena,&stream,&scenes[i],&scenes[i].cascade_draw_lists[c],&cascade_frusta[c],NULL,NULL);
+            }
+        }
+        texture_residency_apply(&residency);
+        PROFILE_END(profiler);
+ 
+        f64 shadow_start = timer_now();
+        PROFILE_GPU_BEGIN(profiler,"shadow");
+        render_directional_shadowmap(scenes,scene_count,&shadowmap_shader,cascade_location,cascade_count,render_cascades,&depth_map);
+        PROFILE_END(profiler);
+        f64 main_start = timer_now();
+        glBindFramebuffer(GL_FRAMEBUFFER,offscreen.framebuffer);
+        PROFILE_GPU_BEGIN(profiler,"debug quad");
+        draw_quad(&quad_shader,layer_location,depth_map,0,0.4f);
+        PROFILE_END(profiler);
+
+        PROFILE_GPU_BEGIN(profiler,"main");
+        glViewport(0,0,windowWidth(window),windowHeight(window));
+        scene_draw(scenes,scene_count,&defaultProgram,packed_vertices_location,false,depth_map);
+        PROFILE_END(profiler);
+
+        f64 skybox_start = timer_now();
+        PROFILE_GPU_BEGIN(profiler,"skybox");
+        render_skybox_cube(skybox_vao,env_map,&background_shader);
+        PROFILE_END(profiler);
+        stream_buffer_end_frame(&stream);
+        PROFILE_END(profiler);
+        profiler_frame(profiler);
+
+        if(frame_bench) {
+            f64 submitted = timer_now();
+            glFinish();
+            if(frame_index >= warmup_frames) {
+                frame_stats_add(&frame_stats,FRAME_PASS_LIGHTS,cull_start - lights_start);
+                frame_stats_add(&frame_stats,FRAME_PASS_CULL,shadow_start - cull_start);
+                frame_stats_add(&frame_stats,FRAME_PASS_SHADOW,main_start - shadow_start);
+                frame_stats_add(&frame_stats,FRAME_PASS_MAIN,skybox_start - main_start);
+                frame_stats_add(&frame_stats,FRAME_PASS_SKYBOX,submitted - skybox_start);
+                frame_stats_add(&frame_stats,FRAME_PASS_TOTAL,timer_now() - frame_start);
+            }
+            ++frame_index;
+        } else if(headless) {
+            f64 submitted = timer_now();
+            glFinish();
+            f64 finished = timer_now();
+            bool capture = capture_every && frame_index % capture_every == 0;
+            if(capture)
+                offscreen_target_read(&offscreen);
+            f64 read = timer_now();
+            if(capture) {
+                char frame_path[512];
+                snprintf(frame_path,sizeof(frame_path),"%s/frame_%05u.png",capture_directory,frame_index);
+                offscreen_target_write_png(&offscreen,frame_path);
+            }
+            f64 written = timer_now();
+            fprintf(timing_csv,"%u,%.4f,%.3f,%.3f,%.3f,%.3f\n",frame_index,frame_index * HEADLESS_TIMESTEP,(submitted - frame_start) * 1000.0,
+                    (finished - submitted) * 1000.0,(read - finished) * 1000.0,(written - read) * 1000.0);
+            ++frame_index;
+        }
 
         windowUpdate(window);
     }
 
-    shaderDestroy(defaultProgram);     
+    if(frame_bench) {
+        for(u32 pass = 0; pass < FRAME_PASS_COUNT; pass++) {
+            FramePassSummary summary;
+            frame_stats_summarize(&frame_stats,pass,&summary);
+            printf("[BENCH] %-6s p50 %.3f ms, p95 %.3f ms, p99 %.3f ms, max %.3f ms\n",frame_pass_names[pass],summary.p50,summary.p95,summary.p99,summary.max);
+        }
+        if(frame_stats_write_json(&frame_stats,bench_json,"city/scene.gltf car/scene.gltf",camera_path_file,HEADLESS_TIMESTEP))
+            printf("[BENCH] %u frames written to \"%s\"\n",frame_stats.samples[FRAME_PASS_TOTAL].size,bench_json);
+    } else if(headless) {
+        printf("[CAPTURE] %u frames written to \"%s\"\n",frame_index,capture_directory);
+        fclose(timing_csv);
+        char trace_path[512];
+        snprintf(trace_path,sizeof(trace_path),"%s/trace.json",capture_directory);
+        profiler_write_chrome_trace(profiler,trace_path);
+    }
+    if(headless)
+        offscreen_target_destroy(&offscreen);
+    if(record_path_file)
+        camera_path_save(&camera_path,record_path_file);
+    frame_stats_free(&frame_stats);
+    profiler_print_summary(profiler);
+    profiler_destroy(profiler);
+    camera_path_free(&camera_path);
+
+    for(int i = 0; raycasters_built && i < scene_count; i++)
+        scene_raycaster_free(&raycasters[i]);
+    ShaderProgram* programs[] = { &defaultProgram, &eqrec_to_cubemap_shader, &background_shader, &prefilter_shader, &brdf_shader, &shadowmap_shader, &quad_shader };
+    for(u32 i = 0; i < sizeof(programs) / sizeof(programs[0]); i++)
+        shader_program_destroy(programs[i]);
+    printf("[STREAM] %u slices of %llu bytes, peak %llu bytes used in a frame, %u frames waited on the GPU\n",stream.ring.slice_count,
+           (unsigned long long)stream.ring.slice_size,(unsigned long long)stream.ring.peak_used,stream.stalls);
+    stream_buffer_destroy(&stream);
+    for(u32 c = 0; c < cascade_count; c++)
+        printf("[SHADOW] cascade %u rendered %llu times, skipped %llu\n",c,(unsigned long long)shadow_cache.rendered[c],
+               (unsigned long long)shadow_cache.skipped[c]);
+    residency_stats_print(&residency.policy.stats,residency.policy.budget);
+    texture_residency_free(&residency);
+    light_cluster_grid_free(&light_grid);
+    free(world_lights.data);
     windowDestroy(window);
+    arena_print_stats(&frame_arena,"frame");
+    arena_free(&frame_arena);
     arena_free(&arena);
+    job_system_destroy(jobs);
 
     glfwTerminate();
     return 0;